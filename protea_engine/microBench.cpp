@@ -0,0 +1,528 @@
+// microBench protea micro benchmark application
+// measures isolated engine operations without opening a window
+//
+// usage: microBench [filter] [model.3ds]
+// prints one line per benchmark: name, iterations, total seconds, microseconds per iteration,
+// failed consistency checks are reported on stderr and result in exit code 1
+// All inputs except the optional 3DS model are generated deterministically, so results
+// are comparable across revisions.
+
+#include "protea.h"
+#include "proIoObj.h"
+#include "proIo3ds.h"
+#include "proIoWrl.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+using namespace std;
+
+//--- benchmark harness --------------------------------------------
+
+/// stores optional name filter passed on the command line
+static const char * s_filter = 0;
+
+/// runs func repeatedly for at least minTime seconds and prints the average duration per call
+static void bench(const char * name, void (*func)(void *), void * data, double minTime=0.5) {
+	if(s_filter && !strstr(name, s_filter)) return;
+	func(data); // warm up caches
+	unsigned int n=0;
+	double tStart=io::time(), tNow=tStart;
+	do {
+		func(data);
+		++n;
+		tNow=io::time();
+	} while(tNow-tStart<minTime);
+	printf("%-32s %10u %10.4f %12.3f\n", name, n, tNow-tStart, (tNow-tStart)*1.0e6/n);
+	fflush(stdout);
+}
+
+/// prevents the compiler from optimizing away benchmarked results
+static volatile size_t s_sink = 0;
+/// stores whether a consistency check failed, turns into the exit code
+static bool s_failed = false;
+
+/// reports a failed consistency check
+static void fail(const char * name, size_t expected, size_t actual) {
+	fprintf(stderr, "# ERROR %s: expected %lu, got %lu\n", name, static_cast<unsigned long>(expected), static_cast<unsigned long>(actual));
+	s_failed = true;
+}
+
+//--- scene traversal ----------------------------------------------
+
+/// builds a chain of nested transforms of the given depth, each carrying a number of mesh leaves
+static proScene * buildDeepScene(unsigned int depth, unsigned int leaves) {
+	proScene * pScene = new proScene("deep");
+	proTransform * pParent = pScene;
+	for(unsigned int i=0; i<depth; ++i) {
+		for(unsigned int j=0; j<leaves; ++j)
+			pParent->append(new proMesh, false);
+		pParent = pParent->create();
+	}
+	return pScene;
+}
+
+static void benchIterator(void * data) {
+	size_t n=0;
+	for(proNode::iterator iter=static_cast<proNode*>(data); iter!=0; ++iter)
+		if(iter->typeId()==proNode::TYPE_MESH) ++n;
+	s_sink+=n;
+}
+
+/// a visitor counting mesh nodes
+class CountVisitor : public proNode::visitor {
+public:
+	CountVisitor() : n(0) { }
+	virtual bool visit(proNode & node) { if(node.typeId()==proNode::TYPE_MESH) ++n; return true; }
+	size_t n;
+};
+
+static void benchTraverse(void * data) {
+	CountVisitor v;
+	static_cast<proNode*>(data)->traverse(v);
+	s_sink+=v.n;
+}
+
+static void benchNodeArray(void * data) {
+	proNodeArray & nodes = *static_cast<proNodeArray*>(data);
+	size_t n=0;
+	for(proNodeArray::iterator it=nodes.begin(); it!=nodes.end(); ++it)
+		if((*it)->typeId()==proNode::TYPE_MESH) ++n;
+	s_sink+=n;
+}
+
+static void benchTraversal() {
+	proScene * pScene = buildDeepScene(1000, 4);
+	bench("traversal/iterator", benchIterator, pScene);
+	bench("traversal/visitor", benchTraverse, pScene);
+	proNodeArray nodes(pScene);
+	bench("traversal/nodeArray", benchNodeArray, &nodes);
+	delete pScene;
+}
+
+//--- proMath -------------------------------------------------------
+
+/// an auxiliary struct holding math benchmark input data
+struct MathData {
+	mat4f m0, m1;
+	std::vector<vec3f> vV, vN;
+	frustum frs;
+	std::vector<sphere> vSphere;
+	std::vector<vec3f> vMin, vMax;
+	line ray;
+	std::vector<vec3f> vTri;
+};
+
+static void benchMatMul(void * data) {
+	MathData & d = *static_cast<MathData*>(data);
+	mat4f m(d.m0);
+	for(unsigned int i=0; i<100; ++i) m=m*d.m1;
+	s_sink+=m.isNan();
+}
+
+static void benchMatInverse(void * data) {
+	MathData & d = *static_cast<MathData*>(data);
+	for(unsigned int i=0; i<100; ++i) s_sink+=d.m0.inverse().isNan();
+}
+
+static void benchMatTransform(void * data) {
+	MathData & d = *static_cast<MathData*>(data);
+	d.m1.transform(d.vV);
+	s_sink+=d.vV.size();
+}
+
+static void benchMatTransformPosNormal(void * data) {
+	MathData & d = *static_cast<MathData*>(data);
+	d.m1.transform(d.vV, d.vN);
+	s_sink+=d.vV.size();
+}
+
+static void benchFrustumSphere(void * data) {
+	MathData & d = *static_cast<MathData*>(data);
+	size_t n=0;
+	for(size_t i=0; i<d.vSphere.size(); ++i) n+=d.frs.intersects(d.vSphere[i]);
+	s_sink+=n;
+}
+
+static void benchFrustumBox(void * data) {
+	MathData & d = *static_cast<MathData*>(data);
+	size_t n=0;
+	for(size_t i=0; i<d.vMin.size(); ++i) n+=d.frs.intersects(d.vMin[i], d.vMax[i]);
+	s_sink+=n;
+}
+
+static void benchLineTriangle(void * data) {
+	MathData & d = *static_cast<MathData*>(data);
+	size_t n=0;
+	for(size_t i=0; i+2<d.vTri.size(); i+=3) n+=d.ray.intersects(d.vTri[i], d.vTri[i+1], d.vTri[i+2]);
+	s_sink+=n;
+}
+
+static void benchMath() {
+	MathData d;
+	d.m0.set(vec6f(1.0f,2.0f,3.0f, 30.0f,20.0f,10.0f));
+	d.m1.set(vec6f(0.001f,0.002f,0.003f, 0.1f,0.2f,0.3f));
+	for(unsigned int i=0; i<10000; ++i) {
+		d.vV.push_back(vec3f(float(i%100), float(i/100), float(i%7)));
+		d.vN.push_back(vec3f(float(i%3)+1.0f, float(i%5), float(i%7)).normalize());
+	}
+	d.frs.set(-1.0f, 1.0f, -.75f, .75f, 1.0f, 1000.0f);
+	d.frs.transform(vec6f(0.0f,-10.0f,1.6f, 20.0f,-5.0f,0.0f));
+	for(int i=0; i<1000; ++i) {
+		vec3f pos(float(i%10-5)*20.0f, float(i/10%10-5)*20.0f, float(i/100-5)*20.0f);
+		d.vSphere.push_back(sphere(pos, 5.0f));
+		d.vMin.push_back(pos-vec3f(5.0f,5.0f,5.0f));
+		d.vMax.push_back(pos+vec3f(5.0f,5.0f,5.0f));
+	}
+	d.ray.set(vec3f(0.5f,0.5f,10.0f), vec3f(0.6f,0.55f,-10.0f));
+	for(int y=0; y<32; ++y) for(int x=0; x<32; ++x) { // a grid of 2048 triangles
+		d.vTri.push_back(vec3f(x*0.1f, y*0.1f, 0.0f));
+		d.vTri.push_back(vec3f((x+1)*0.1f, y*0.1f, 0.0f));
+		d.vTri.push_back(vec3f((x+1)*0.1f, (y+1)*0.1f, 0.0f));
+		d.vTri.push_back(vec3f(x*0.1f, y*0.1f, 0.0f));
+		d.vTri.push_back(vec3f((x+1)*0.1f, (y+1)*0.1f, 0.0f));
+		d.vTri.push_back(vec3f(x*0.1f, (y+1)*0.1f, 0.0f));
+	}
+	bench("math/mat4f*x100", benchMatMul, &d);
+	bench("math/mat4f::inverse x100", benchMatInverse, &d);
+	bench("math/mat4f::transform 10k", benchMatTransform, &d);
+	bench("math/mat4f::transform p+n 10k", benchMatTransformPosNormal, &d);
+	bench("math/frustum/sphere 1k", benchFrustumSphere, &d);
+	bench("math/frustum/box 1k", benchFrustumBox, &d);
+	bench("math/line/triangle 2k", benchLineTriangle, &d);
+}
+
+//--- proStr --------------------------------------------------------
+
+static void benchSplit(void * data) {
+	vector<string> vS;
+	s_sink+=split(*static_cast<string*>(data), vS);
+}
+
+static void benchS2f(void * data) {
+	vector<float> vF;
+	s_sink+=s2f(*static_cast<string*>(data), vF);
+}
+
+static void benchStr() {
+	string s;
+	for(unsigned int i=0; i<10000; ++i) 
+		s+=f2s(float(i)*0.731f-100.0f, 3)+' ';
+	bench("str/split 10k", benchSplit, &s);
+	bench("str/s2f 10k", benchS2f, &s);
+}
+
+//--- proXml ----------------------------------------------------------
+
+static void benchXmlEval(void * data) {
+	Xml xml;
+	xml.eval(*static_cast<string*>(data));
+	s_sink+=xml.nChildren();
+}
+
+static void benchXmlDoc(void * data) {
+	const string & s = *static_cast<string*>(data);
+	XmlDoc doc;
+	doc.eval(s.data(), s.size());
+	s_sink+=doc.root().find("Coordinate").attrView("point").size();
+}
+
+static void benchInterpretUse(void * data) {
+	proNode * pNode = proNode::interpret(*static_cast<Xml*>(data));
+	s_sink+=pNode ? pNode->typeId() : 0;
+	delete pNode;
+}
+
+//--- meshes and file formats --------------------------------------
+
+/// builds a mesh consisting of a regular grid of n*n quads with a sine height field
+static proMesh * buildGridMesh(unsigned int n) {
+	proMesh * pMesh = new proMesh("grid");
+	for(unsigned int y=0; y<=n; ++y) for(unsigned int x=0; x<=n; ++x)
+		pMesh->addVertex(float(x), float(y), float(sin(x*0.3)*cos(y*0.2)));
+	for(unsigned int y=0; y<n; ++y) for(unsigned int x=0; x<n; ++x) {
+		unsigned int i=y*(n+1)+x;
+		pMesh->indices().push_back(i);
+		pMesh->indices().push_back(i+1);
+		pMesh->indices().push_back(i+n+2);
+		pMesh->indices().push_back(i);
+		pMesh->indices().push_back(i+n+2);
+		pMesh->indices().push_back(i+n+1);
+	}
+	return pMesh;
+}
+
+/// writes a mesh as VRML97 IndexedFaceSet
+static void saveVrml(const proMesh & mesh, const string & filename) {
+	FILE * pFile = fopen(filename.c_str(), "w");
+	if(!pFile) return;
+	fprintf(pFile, "#VRML V2.0 utf8\nShape {\n\tgeometry IndexedFaceSet {\n\t\tcoord Coordinate { point [\n");
+	for(size_t i=0; i<mesh.nCoords(); ++i) {
+		const vec3f vtx(mesh.coord(i));
+		fprintf(pFile, "\t\t\t%g %g %g,\n", vtx[X], vtx[Z], -vtx[Y]);
+	}
+	fprintf(pFile, "\t\t] }\n\t\tcoordIndex [\n");
+	for(size_t i=0; i+2<mesh.indices().size(); i+=3)
+		fprintf(pFile, "\t\t\t%u, %u, %u, -1,\n", mesh.indices()[i], mesh.indices()[i+1], mesh.indices()[i+2]);
+	fprintf(pFile, "\t\t]\n\t}\n}\n");
+	fclose(pFile);
+}
+
+static void benchGenVNormals(void * data) {
+	proMesh mesh(*static_cast<proMesh*>(data));
+	meshUtils::genVNormals(mesh, 60.0f);
+	s_sink+=mesh.vNormals().size();
+}
+
+static void benchBuildEdgeList(void * data) {
+	proMesh mesh(*static_cast<proMesh*>(data));
+	mesh.buildEdgeList();
+	s_sink+=mesh.edgeArray().size();
+}
+
+/// an auxiliary struct holding a mesh pair in both storage layouts
+struct MeshPair {
+	MeshPair(const proMesh & mesh) : aos(mesh), soa(mesh) { soa.storage(proMesh::STORAGE_SOA); }
+	proMesh aos, soa;
+	mat4f m;
+};
+
+static void benchBoundsAos(void * data) {
+	static_cast<MeshPair*>(data)->aos.calcBounding();
+	s_sink+=static_cast<MeshPair*>(data)->aos.nCoords();
+}
+
+static void benchBoundsSoa(void * data) {
+	static_cast<MeshPair*>(data)->soa.calcBounding();
+	s_sink+=static_cast<MeshPair*>(data)->soa.nCoords();
+}
+
+static void benchTransformAos(void * data) {
+	MeshPair & d = *static_cast<MeshPair*>(data);
+	d.aos.transform(d.m);
+}
+
+static void benchTransformSoa(void * data) {
+	MeshPair & d = *static_cast<MeshPair*>(data);
+	d.soa.transform(d.m);
+}
+
+static void benchAxisSwapAos(void * data) {
+	meshUtils::zup2yup(static_cast<MeshPair*>(data)->aos);
+	meshUtils::yup2zup(static_cast<MeshPair*>(data)->aos);
+}
+
+static void benchAxisSwapSoa(void * data) {
+	meshUtils::zup2yup(static_cast<MeshPair*>(data)->soa);
+	meshUtils::yup2zup(static_cast<MeshPair*>(data)->soa);
+}
+
+static void benchFNormalsAos(void * data) {
+	meshUtils::genFNormals(static_cast<MeshPair*>(data)->aos);
+}
+
+static void benchFNormalsSoa(void * data) {
+	meshUtils::genFNormals(static_cast<MeshPair*>(data)->soa);
+}
+
+/// writes an n x n grid as OBJ with one group per row of vertices
+/** Each group defines texture coordinates and normals along with its vertices, while its plain
+ faces also refer to the vertices of the previous group. */
+static void saveObjGroups(const string & filename, unsigned int n) {
+	FILE * pFile = fopen(filename.c_str(), "w");
+	if(!pFile) return;
+	for(unsigned int y=0; y<=n; ++y) {
+		fprintf(pFile, "g row%u\n", y);
+		for(unsigned int x=0; x<=n; ++x)
+			fprintf(pFile, "v %u %u %g\nvt %g %g\nvn 0 0 1\n", x, y, sin(x*0.3)*cos(y*0.2), x/float(n), y/float(n));
+		if(y) for(unsigned int x=0; x<n; ++x) {
+			unsigned int i=(y-1)*(n+1)+x+1;
+			fprintf(pFile, "f %u %u %u\nf %u %u %u\n", i, i+1, i+n+2, i, i+n+2, i+n+1);
+		}
+	}
+	fclose(pFile);
+}
+
+/// returns the number of triangles of all meshes of a model
+static size_t countTriangles(proNode & model) {
+	vector<proNode*> vNode;
+	model.flatten(vNode);
+	size_t n=0;
+	for(size_t i=0; i<vNode.size(); ++i) if(vNode[i]->typeId()==proNode::TYPE_MESH)
+		n+=static_cast<proMesh*>(vNode[i])->indexArray().size()/3;
+	return n;
+}
+
+static void benchLoad(void * data) {
+	proNode * pNode = ModelMgr::singleton().load(*static_cast<string*>(data));
+	s_sink+=(pNode!=0);
+	delete pNode;
+}
+
+/// an auxiliary struct holding a model to be saved and the target file
+struct SaveJob {
+	SaveJob(const proNode & node, const string & fname) : model(node), filename(fname) { }
+	const proNode & model;
+	string filename;
+};
+
+static void benchSave(void * data) {
+	SaveJob & job = *static_cast<SaveJob*>(data);
+	s_sink+=ModelMgr::singleton().save(job.model, job.filename);
+}
+
+static void benchLoadSerial(void * data) {
+	const vector<string> & vFilename = *static_cast<vector<string>*>(data);
+	for(size_t i=0; i<vFilename.size(); ++i) {
+		proNode * pNode = ModelMgr::singleton().load(vFilename[i]);
+		if(pNode) meshUtils::prepare(*pNode, proNode::renderer()!=0);
+		s_sink+=(pNode!=0);
+		delete pNode;
+	}
+}
+
+static void benchLoadParallel(void * data) {
+	vector<proNode*> vModel;
+	s_sink+=ModelMgr::singleton().load(*static_cast<vector<string>*>(data), vModel);
+	for(size_t i=0; i<vModel.size(); ++i)
+		delete vModel[i];
+}
+
+static void benchMesh(const char * filename3ds) {
+	proMesh * pMesh = buildGridMesh(32);
+	bench("mesh/genVNormals 2k", benchGenVNormals, pMesh);
+	bench("mesh/buildEdgeList 2k", benchBuildEdgeList, pMesh);
+
+	proMesh * pLarge = buildGridMesh(100);
+	meshUtils::genVNormals(*pLarge, 60.0f);
+	MeshPair pair(*pLarge);
+	pair.m.set(vec6f(0.001f,0.002f,0.003f, 0.1f,0.2f,0.3f));
+	bench("mesh/calcBounding aos 10k", benchBoundsAos, &pair);
+	bench("mesh/calcBounding soa 10k", benchBoundsSoa, &pair);
+	bench("mesh/transform aos 10k", benchTransformAos, &pair);
+	bench("mesh/transform soa 10k", benchTransformSoa, &pair);
+	bench("mesh/zup2yup+yup2zup aos 10k", benchAxisSwapAos, &pair);
+	bench("mesh/zup2yup+yup2zup soa 10k", benchAxisSwapSoa, &pair);
+	bench("mesh/genFNormals aos 20k", benchFNormalsAos, &pair);
+	bench("mesh/genFNormals soa 20k", benchFNormalsSoa, &pair);
+	delete pLarge;
+
+	proScene scene("grid");
+	scene.append(buildGridMesh(100), false);
+	string sXml(scene.xml().str());
+	bench("xml/eval 20k", benchXmlEval, &sXml);
+	bench("xml/doc 20k", benchXmlDoc, &sXml);
+	Xml xUse;
+	xUse.eval("<Scene><Transform DEF=\"def\"><Shape><IndexedFaceSet coordIndex=\"0 1 2 -1\">"
+		"<Coordinate point=\"0 0 0 1 0 0 1 1 0\"/></IndexedFaceSet></Shape></Transform></Scene>");
+	Xml xRef("Transform");
+	xRef.attr("USE", "def");
+	for(unsigned int i=0; i<2000; ++i)
+		xUse.append(xRef);
+	bench("x3d/interpret USE 2k", benchInterpretUse, &xUse);
+
+	ModelMgr & modelMgr = ModelMgr::singleton();
+	modelMgr.loaderRegister(ioObj::load,"obj");
+	modelMgr.loaderRegister(io3ds::load,"3ds");
+	modelMgr.loaderRegister(ioWrl::load,"wrl");
+	modelMgr.saverRegister(ioObj::save,"obj");
+	string fnX3d("microBench.x3d"), fnObj("microBench.obj"), fnWrl("microBench.wrl");
+	modelMgr.save(scene, fnX3d);
+	ioObj::save(scene, fnObj);
+	saveVrml(*static_cast<proMesh*>(scene[0]), fnWrl);
+	bench("load/x3d 20k", benchLoad, &fnX3d);
+	bench("load/obj 20k", benchLoad, &fnObj);
+	bench("load/wrl 20k", benchLoad, &fnWrl);
+	SaveJob saveX3d(scene, fnX3d), saveObj(scene, fnObj);
+	bench("save/x3d 20k", benchSave, &saveX3d);
+	bench("save/obj 20k", benchSave, &saveObj);
+	vector<string> vFnObj(16, fnObj);
+	bench("load/obj 20k x16 serial", benchLoadSerial, &vFnObj);
+	bench("load/obj 20k x16 parallel", benchLoadParallel, &vFnObj);
+	string fnObjGroups("microBenchGroups.obj");
+	saveObjGroups(fnObjGroups, 100);
+	if(proNode * pModel = modelMgr.load(fnObjGroups)) { // faces referring to vertices of previous groups have to be kept
+		const size_t nTriangle = countTriangles(*pModel);
+		if(nTriangle!=20000) fail("load/obj groups triangles", 20000, nTriangle);
+		delete pModel;
+	}
+	else fail("load/obj groups models", 1, 0);
+	bench("load/obj groups 20k", benchLoad, &fnObjGroups);
+	remove(fnObjGroups.c_str());
+	remove(fnX3d.c_str());
+	remove(fnObj.c_str());
+	remove("microBench.mtl");
+	remove(fnWrl.c_str());
+	if(filename3ds) {
+		string fn3ds(filename3ds);
+		bench("load/3ds", benchLoad, &fn3ds);
+	}
+	delete pMesh;
+}
+
+//--- textures ------------------------------------------------------
+
+static void benchCompress(void * data) {
+	CompressedImage img(*static_cast<Image*>(data));
+	s_sink+=img.size();
+}
+
+static void benchDownsample(void * data) {
+	Image * pImg = static_cast<Image*>(data)->downsample();
+	s_sink+=pImg->width();
+	delete pImg;
+}
+
+/// parameters of a mip chain benchmark
+struct MipJob {
+	/// source image
+	const Image * pImg;
+	/// filter kernel
+	Image::MipFilter filter;
+	/// filter color channels in linear space
+	bool srgb;
+};
+
+static void benchMipmaps(void * data) {
+	const MipJob & job = *static_cast<MipJob*>(data);
+	vector<Image*> vLevel;
+	job.pImg->mipmaps(vLevel, job.filter, job.srgb);
+	s_sink+=vLevel.size();
+	for(size_t i=0; i<vLevel.size(); ++i) delete vLevel[i];
+}
+
+static void benchTexture() {
+	const unsigned int w=512, h=512;
+	unsigned char * data = new unsigned char[w*h*4];
+	for(unsigned int y=0; y<h; ++y) for(unsigned int x=0; x<w; ++x) {
+		unsigned char * p = data+(y*w+x)*4;
+		p[0]=static_cast<unsigned char>(128.0+127.0*sin(x*0.05));
+		p[1]=static_cast<unsigned char>(128.0+127.0*cos(y*0.07));
+		p[2]=static_cast<unsigned char>((x^y)&0xFF);
+		p[3]=static_cast<unsigned char>((x+y)/4);
+	}
+	Image img(data, w, h, 4);
+	bench("texture/downsample 512 rgba", benchDownsample, &img);
+	MipJob job = { &img, Image::BOX, false };
+	bench("texture/mipmaps box 512 rgba", benchMipmaps, &job);
+	job.srgb = true;
+	bench("texture/mipmaps box srgb 512 rgba", benchMipmaps, &job);
+	job.filter = Image::KAISER;
+	bench("texture/mipmaps kaiser srgb 512 rgba", benchMipmaps, &job);
+	bench("texture/compress bc3+mips 512", benchCompress, &img);
+}
+
+//--- main function ------------------------------------------------
+
+int main(int argc, char ** argv) {
+	if(argc>1) s_filter=argv[1];
+	printf("%-32s %10s %10s %12s\n", "# benchmark", "iterations", "seconds", "usec/iter");
+	benchTraversal();
+	benchMath();
+	benchStr();
+	benchMesh(argc>2 ? argv[2] : 0);
+	benchTexture();
+	return s_failed ? 1 : 0;
+}
@@ -1,6 +1,7 @@
 #include "proGui.h"
 #include <proIo.h>
 #include <proStr.h>
+#include <proProfiler.h>
 
 #ifdef _MSC_VER
 # define WIN32_LEAN_AND_MEAN
@@ -670,6 +671,7 @@ int CanvasGui::updateByPointer() {
 
 
 void CanvasGui::draw() {
+	ProfileScope profile("gui", true);
 	if(mp_cursor) {
 		mp_cursor->x(0.5f*(mp_devInput->axis(m_pointerAxisX)+1.0f)*m_wnd.width());
 		mp_cursor->y(0.5f*(mp_devInput->axis(m_pointerAxisY)+1.0f)*m_wnd.height());
@@ -1,6 +1,8 @@
 #include "proCallable.h"
 #include "proStr.h"
 #include "proIo.h"
+#include "proProfiler.h"
+#include "proRenderer.h"
 
 extern "C" {
 #include <lua.h>
@@ -444,6 +446,29 @@ ostream & operator<<(std::ostream & os, const Var & v) {
 	return ( os << v.string() ); 
 }
 
+//--- class RenderStatsCallable ------------------------------------
+
+Var RenderStatsCallable::call(const std::string & cmd, const Var & arg) {
+	const RenderStats & stats = RenderStats::singleton();
+	for(unsigned int i=0; i<RenderStats::N_COUNTERS; ++i) 
+		if(cmd==RenderStats::counterName(i)) return stats[i];
+	if(cmd=="all") {
+		Var ret;
+		for(unsigned int i=0; i<RenderStats::N_COUNTERS; ++i) 
+			ret.set(RenderStats::counterName(i), stats[i]);
+		return ret;
+	}
+	if(cmd=="str") return stats.str();
+	return Var::null;
+}
+
+Var RenderStatsCallable::info() const {
+	Var ret;
+	for(unsigned int i=0; i<RenderStats::N_COUNTERS; ++i) 
+		ret.append(RenderStats::counterName(i));
+	return ret.append("all").append("str");
+}
+
 //--- VMCallable auxiliary functions -------------------------------
 
 static const char * readFileChunk(lua_State *L, void *ud, size_t *size) {
@@ -580,6 +605,7 @@ int VMCallable::load(const std::string & filename) {
 }
 
 Var VMCallable::eval(const string & s) {
+	ProfileAccumulator profile("script");
 	int duplicated=0;
 	if(!s.size()) {
 		lua_pushvalue(L, -1); // duplicate script on stack for reuse
@@ -613,6 +639,7 @@ Var VMCallable::eval(const string & s) {
 }
 
 Var VMCallable::call(const std::string & cmd, const Var & arg) {
+	ProfileAccumulator profile("script");
 	int counter = push(L, cmd.c_str());
 	if(!counter) return Var::null;
 	int argc;
@@ -180,6 +180,18 @@ protected:
 /// operator for output of Var objects to streams
 std::ostream & operator<<(std::ostream & os, const Var & v);
 
+//--- class RenderStatsCallable ------------------------------------
+/// a Callable exposing the counters of the last frame of the RenderStats singleton to scripts
+/** Scripts can query the counters by name, e.g., Stats.triangles(), or all at once via 
+ Stats.all(). Being kept apart from RenderStats, the renderer does not depend on Lua. */
+class RenderStatsCallable : public Callable {
+public:
+	/// generic method calling the object instance to evalute the provided command
+	virtual Var call(const std::string & cmd, const Var & arg);
+	/// returns all keys/command names provided by this Callable as Var::ARRAY
+	virtual Var info() const;
+};
+
 //--- class VMCallable ---------------------------------------------
 struct lua_State;
 /// Lua based Callable virtual machine and adapter class
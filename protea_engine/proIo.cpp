@@ -8,6 +8,7 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <ctime>
 # include <sys/stat.h>
 
 #if defined __WIN32__ || defined WIN32
@@ -17,8 +18,11 @@
 #else
 #  include <sys/mman.h>
 #  include <fcntl.h>
+#  include <unistd.h>
 #  include <sys/wait.h>
+#  include <pthread.h>
 #endif
+#include <deque>
 
 #ifndef _MSC_VER
 # include <dirent.h>
@@ -310,6 +314,47 @@ unsigned int io::fileSize(FILE* fp) {
     return size;
 }
 
+size_t io::fileSize(const string & filename) {
+    struct stat st;
+    if(stat(filename.c_str(), &st)<0) return 0;
+    return static_cast<size_t>(st.st_size);
+}
+
+double io::fileTime(const string & filename) {
+#if defined __WIN32__ || defined WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if(!GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &data)) return -1.0;
+    const ULONGLONG t = (static_cast<ULONGLONG>(data.ftLastWriteTime.dwHighDateTime)<<32)|data.ftLastWriteTime.dwLowDateTime;
+    return static_cast<double>(t)*1.0e-7-11644473600.0; // 100ns intervals since 1601
+#else
+    struct stat st;
+    if(stat(filename.c_str(), &st)<0) return -1.0;
+#  if defined __APPLE__
+    return static_cast<double>(st.st_mtimespec.tv_sec)+static_cast<double>(st.st_mtimespec.tv_nsec)*1.0e-9;
+#  else
+    return static_cast<double>(st.st_mtim.tv_sec)+static_cast<double>(st.st_mtim.tv_nsec)*1.0e-9;
+#  endif
+#endif
+}
+
+bool io::rename(const string & oldName, const string & newName) {
+#if defined __WIN32__ || defined WIN32
+    return MoveFileExA(oldName.c_str(), newName.c_str(), MOVEFILE_REPLACE_EXISTING)!=0;
+#else
+    return ::rename(oldName.c_str(), newName.c_str())==0;
+#endif
+}
+
+string io::tempName(const string & filename) {
+    static volatile unsigned int s_counter = 0;
+#if defined __WIN32__ || defined WIN32
+    const long pid = static_cast<long>(GetCurrentProcessId());
+#else
+    const long pid = static_cast<long>(getpid());
+#endif
+    return filename+'.'+i2s(pid)+'.'+i2s(atomicAdd(s_counter, 1))+".tmp";
+}
+
 string io::unifyPath(const string & source) {
   string s(source);
   //turn all slashes into unix notation because windows doesn't care...
@@ -343,6 +388,39 @@ int io::chdir(const string & path) {
 #endif
 }
 
+double io::time() {
+#if defined __WIN32__ || defined WIN32
+    static LARGE_INTEGER freq;
+    if(!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    LARGE_INTEGER count;
+    QueryPerformanceCounter(&count);
+    return double(count.QuadPart)/double(freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return double(ts.tv_sec)+double(ts.tv_nsec)*1.0e-9;
+#endif
+}
+
+unsigned int io::atomicAdd(volatile unsigned int & value, int delta) {
+#if defined __WIN32__ || defined WIN32
+    return static_cast<unsigned int>(InterlockedExchangeAdd(reinterpret_cast<volatile LONG*>(&value), delta)+delta);
+#else
+    return __sync_add_and_fetch(&value, delta);
+#endif
+}
+
+unsigned int io::nCores() {
+#if defined __WIN32__ || defined WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n>0 ? static_cast<unsigned int>(n) : 1;
+#endif
+}
+
 void io::openURL(const std::string & url) {
 #ifdef WIN32
     ShellExecute(GetActiveWindow(),
@@ -374,6 +452,408 @@ void io::openURL(const std::string & url) {
 #endif
 }
 
+//--- class MappedFile ---------------------------------------------
+
+bool MappedFile::open(const string & filename) {
+    close();
+#if defined __WIN32__ || defined WIN32
+    HANDLE hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(hFile==INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER sz;
+    if(!GetFileSizeEx(hFile, &sz)) {
+        CloseHandle(hFile);
+        return false;
+    }
+    m_size=static_cast<size_t>(sz.QuadPart);
+    if(m_size) {
+        HANDLE hMapping = CreateFileMapping(hFile, 0, PAGE_READONLY, 0, 0, 0);
+        if(hMapping) {
+            mp_data = static_cast<const char*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(hMapping); // the view keeps the mapping alive
+        }
+        m_mapped = (mp_data!=0);
+    }
+    CloseHandle(hFile);
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd<0) return false;
+    struct stat st;
+    if(fstat(fd, &st)<0) {
+        ::close(fd);
+        return false;
+    }
+    m_size=static_cast<size_t>(st.st_size);
+    if(m_size) {
+        void * p = mmap(0, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p!=MAP_FAILED) {
+            mp_data = static_cast<const char*>(p);
+            m_mapped = true;
+        }
+    }
+    ::close(fd);
+#endif
+    if(m_size&&!mp_data) { // fallback: read into buffer
+        FILE * fp = fopen(filename.c_str(),"rb");
+        if(!fp) {
+            m_size=0;
+            return false;
+        }
+        char * pBuf = new char[m_size];
+        m_size = fread(pBuf,1,m_size,fp);
+        fclose(fp);
+        mp_data = pBuf;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if(mp_data) {
+#if defined __WIN32__ || defined WIN32
+        if(m_mapped) UnmapViewOfFile(mp_data);
+#else
+        if(m_mapped) munmap(const_cast<char*>(mp_data), m_size);
+#endif
+        else delete [] mp_data;
+    }
+    mp_data=0;
+    m_size=0;
+    m_mapped=false;
+}
+
+//--- class FileWriter ---------------------------------------------
+
+bool FileWriter::open(const string & filename) {
+    close();
+    mp_file=fopen(filename.c_str(), "wb");
+    if(!mp_file) return false;
+    mp_buf=new char[BUFFER_SIZE];
+    m_good=true;
+    return true;
+}
+
+bool FileWriter::close() {
+    bool ret=m_good;
+    if(mp_file) {
+        flush();
+        ret=m_good&&!fclose(mp_file);
+    }
+    delete [] mp_buf;
+    mp_file=0;
+    mp_buf=0;
+    m_pos=0;
+    m_good=false;
+    return ret;
+}
+
+void FileWriter::flush() {
+    if(m_pos&&m_good&&(fwrite(mp_buf, 1, m_pos, mp_file)!=m_pos)) m_good=false;
+    m_pos=0;
+}
+
+void FileWriter::write(const char * p, size_t n) {
+    if(!mp_buf) return;
+    if(m_pos+n>BUFFER_SIZE) {
+        flush();
+        if(n>=BUFFER_SIZE) { // large blocks bypass the buffer
+            if(m_good&&(fwrite(p, 1, n, mp_file)!=n)) m_good=false;
+            return;
+        }
+    }
+    memcpy(mp_buf+m_pos, p, n);
+    m_pos+=n;
+}
+
+FileWriter & FileWriter::operator<<(const char * s) { 
+    write(s, strlen(s)); 
+    return *this; 
+}
+
+FileWriter & FileWriter::operator<<(long i) {
+    if(m_pos+24>BUFFER_SIZE) flush();
+    if(mp_buf) m_pos=printInt(mp_buf+m_pos, i)-mp_buf;
+    return *this;
+}
+
+FileWriter & FileWriter::operator<<(unsigned long u) {
+    if(m_pos+24>BUFFER_SIZE) flush();
+    if(mp_buf) m_pos=printUInt(mp_buf+m_pos, u)-mp_buf;
+    return *this;
+}
+
+FileWriter & FileWriter::operator<<(float f) {
+    if(m_pos+32>BUFFER_SIZE) flush();
+    if(mp_buf) m_pos=printFloat(mp_buf+m_pos, f)-mp_buf;
+    return *this;
+}
+
+//--- class Mutex --------------------------------------------------
+
+Mutex::Mutex() {
+#if defined __WIN32__ || defined WIN32
+    CRITICAL_SECTION * pCs = new CRITICAL_SECTION; // recursive by definition
+    InitializeCriticalSection(pCs);
+    mp_handle = pCs;
+#else
+    pthread_mutex_t * pMutex = new pthread_mutex_t;
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(pMutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    mp_handle = pMutex;
+#endif
+}
+
+Mutex::~Mutex() {
+#if defined __WIN32__ || defined WIN32
+    DeleteCriticalSection(static_cast<CRITICAL_SECTION*>(mp_handle));
+    delete static_cast<CRITICAL_SECTION*>(mp_handle);
+#else
+    pthread_mutex_destroy(static_cast<pthread_mutex_t*>(mp_handle));
+    delete static_cast<pthread_mutex_t*>(mp_handle);
+#endif
+}
+
+void Mutex::lock() {
+#if defined __WIN32__ || defined WIN32
+    EnterCriticalSection(static_cast<CRITICAL_SECTION*>(mp_handle));
+#else
+    pthread_mutex_lock(static_cast<pthread_mutex_t*>(mp_handle));
+#endif
+}
+
+void Mutex::unlock() {
+#if defined __WIN32__ || defined WIN32
+    LeaveCriticalSection(static_cast<CRITICAL_SECTION*>(mp_handle));
+#else
+    pthread_mutex_unlock(static_cast<pthread_mutex_t*>(mp_handle));
+#endif
+}
+
+//--- class ThreadPool ---------------------------------------------
+
+/// an auxiliary counting semaphore letting idle threads sleep
+class Semaphore {
+public:
+    /// constructor
+    Semaphore() : m_count(0) {
+#if defined __WIN32__ || defined WIN32
+        m_handle = CreateSemaphore(0, 0, LONG_MAX, 0);
+#else
+        pthread_mutex_init(&m_mutex, 0);
+        pthread_cond_init(&m_cond, 0);
+#endif
+    }
+    /// destructor
+    ~Semaphore() {
+#if defined __WIN32__ || defined WIN32
+        CloseHandle(m_handle);
+#else
+        pthread_cond_destroy(&m_cond);
+        pthread_mutex_destroy(&m_mutex);
+#endif
+    }
+    /// increments the counter, wakes up a waiting thread
+    void post(unsigned int n=1) {
+#if defined __WIN32__ || defined WIN32
+        ReleaseSemaphore(m_handle, n, 0);
+#else
+        pthread_mutex_lock(&m_mutex);
+        m_count+=n;
+        if(n>1) pthread_cond_broadcast(&m_cond);
+        else pthread_cond_signal(&m_cond);
+        pthread_mutex_unlock(&m_mutex);
+#endif
+    }
+    /// blocks until the counter is positive, then decrements it
+    void wait() {
+#if defined __WIN32__ || defined WIN32
+        WaitForSingleObject(m_handle, INFINITE);
+#else
+        pthread_mutex_lock(&m_mutex);
+        while(!m_count) pthread_cond_wait(&m_cond, &m_mutex);
+        --m_count;
+        pthread_mutex_unlock(&m_mutex);
+#endif
+    }
+protected:
+    /// counter, unused under Windows
+    unsigned int m_count;
+#if defined __WIN32__ || defined WIN32
+    /// semaphore handle
+    HANDLE m_handle;
+#else
+    /// mutex protecting m_count
+    pthread_mutex_t m_mutex;
+    /// condition signalling a positive m_count
+    pthread_cond_t m_cond;
+#endif
+};
+
+/// number of tasks the calling thread is currently processing
+static PRO_THREAD_LOCAL unsigned int s_taskDepth = 0;
+
+struct ThreadPool::Data {
+    /// an auxiliary struct holding a task queue and its lock
+    struct Queue {
+        /// lock protecting dqTask
+        Mutex mutex;
+        /// tasks in the order of pushing
+        std::deque<Task*> dqTask;
+    };
+    /// an auxiliary struct passed to a worker thread
+    struct Worker {
+        /// pool state
+        Data * pData;
+        /// index of the worker's own queue
+        unsigned int queue;
+#if defined __WIN32__ || defined WIN32
+        /// thread handle
+        HANDLE thread;
+#else
+        /// thread handle
+        pthread_t thread;
+#endif
+    };
+
+    /// constructor
+    Data(unsigned int nThreads) : vQueue(nThreads ? nThreads : 1), vWorker(nThreads), nPending(0), nPushed(0), nWaiting(0), stop(0) { 
+        for(size_t i=0; i<vQueue.size(); ++i) vQueue[i] = new Queue; }
+    /// destructor
+    ~Data() { for(size_t i=0; i<vQueue.size(); ++i) delete vQueue[i]; }
+
+    /// removes a task, preferably the newest one of queue own, otherwise the oldest one of another queue
+    Task * grab(unsigned int own) {
+        Task * pTask = 0;
+        for(size_t i=0; !pTask&&(i<vQueue.size()); ++i) {
+            Queue & queue = *vQueue[(own+i)%vQueue.size()];
+            MutexLock lock(queue.mutex);
+            if(queue.dqTask.empty()) continue;
+            if(!i) { // own queue
+                pTask = queue.dqTask.back();
+                queue.dqTask.pop_back();
+            }
+            else { // steal
+                pTask = queue.dqTask.front();
+                queue.dqTask.pop_front();
+            }
+        }
+        return pTask;
+    }
+    /// processes and deletes pTask
+    void process(Task * pTask) {
+        ++s_taskDepth;
+        pTask->run();
+        --s_taskDepth;
+        delete pTask;
+        if(io::atomicAdd(nPending, -1)) return;
+        // wake up every blocked waiter, waiters registering later see nPending==0 themselves:
+        const unsigned int n = io::atomicAdd(nWaiting, 0);
+        if(n) semDone.post(n);
+    }
+    /// main loop of a worker thread
+    void work(unsigned int own) {
+        while(true) {
+            semWork.wait();
+            if(io::atomicAdd(stop, 0)) break;
+            while(Task * pTask = grab(own)) process(pTask);
+        }
+    }
+#if defined __WIN32__ || defined WIN32
+    /// thread function of the workers
+    static unsigned int __stdcall threadMain(void * pArg) {
+#else
+    /// thread function of the workers
+    static void * threadMain(void * pArg) {
+#endif
+        Worker * pWorker = static_cast<Worker*>(pArg);
+        pWorker->pData->work(pWorker->queue);
+        return 0;
+    }
+
+    /// task queues, one per worker
+    std::vector<Queue*> vQueue;
+    /// worker threads
+    std::vector<Worker> vWorker;
+    /// signals pushed tasks to the workers
+    Semaphore semWork;
+    /// signals that all tasks are done, posted once per blocked waiter
+    Semaphore semDone;
+    /// number of pushed tasks that are not yet done
+    volatile unsigned int nPending;
+    /// number of pushed tasks, determines the queue of the next task
+    volatile unsigned int nPushed;
+    /// number of threads within wait() that are about to block on semDone
+    volatile unsigned int nWaiting;
+    /// tells the workers to terminate when nonzero, accessed via io::atomicAdd
+    volatile unsigned int stop;
+};
+
+ThreadPool::ThreadPool(unsigned int nThreads) {
+    if(nThreads==UINT_MAX) nThreads = io::nCores()-1; // the thread calling wait() participates
+    mp_data = new Data(nThreads);
+    for(unsigned int i=0; i<nThreads; ++i) {
+        Data::Worker & worker = mp_data->vWorker[i];
+        worker.pData = mp_data;
+        worker.queue = i;
+#if defined __WIN32__ || defined WIN32
+        worker.thread = reinterpret_cast<HANDLE>(_beginthreadex(0, 0, Data::threadMain, &worker, 0, 0));
+#else
+        pthread_create(&worker.thread, 0, Data::threadMain, &worker);
+#endif
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    io::atomicAdd(mp_data->stop, 1);
+    mp_data->semWork.post(mp_data->vWorker.size());
+    for(size_t i=0; i<mp_data->vWorker.size(); ++i) {
+#if defined __WIN32__ || defined WIN32
+        WaitForSingleObject(mp_data->vWorker[i].thread, INFINITE);
+        CloseHandle(mp_data->vWorker[i].thread);
+#else
+        pthread_join(mp_data->vWorker[i].thread, 0);
+#endif
+    }
+    delete mp_data;
+}
+
+void ThreadPool::push(Task * pTask) {
+    if(!pTask) return;
+    io::atomicAdd(mp_data->nPending, 1);
+    Data::Queue & queue = *mp_data->vQueue[io::atomicAdd(mp_data->nPushed, 1)%mp_data->vQueue.size()];
+    {
+        MutexLock lock(queue.mutex);
+        queue.dqTask.push_back(pTask);
+    }
+    if(mp_data->vWorker.size()) mp_data->semWork.post();
+}
+
+void ThreadPool::wait() {
+    unsigned int own = 0;
+    while(io::atomicAdd(mp_data->nPending, 0)) {
+        if(Task * pTask = mp_data->grab(own++)) mp_data->process(pTask);
+        else { // all remaining tasks are being processed by workers
+            io::atomicAdd(mp_data->nWaiting, 1);
+            if(io::atomicAdd(mp_data->nPending, 0)) mp_data->semDone.wait(); // recheck after registering
+            io::atomicAdd(mp_data->nWaiting, -1);
+        }
+    }
+}
+
+unsigned int ThreadPool::size() const {
+    return mp_data->vWorker.size();
+}
+
+unsigned int ThreadPool::pending() const {
+    return io::atomicAdd(mp_data->nPending, 0);
+}
+
+bool ThreadPool::inTask() {
+    return s_taskDepth>0;
+}
+
 //--- class cmdLine ------------------------------------------------
 
 vector<string> cmdLine::vArg;
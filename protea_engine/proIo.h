@@ -32,6 +32,8 @@ current version 2009-02-05
 
 #include <string>
 #include <vector>
+#include <climits>
+#include <cstdio>
 
 //--- struct SharedMemory ------------------------------------------
 
@@ -83,6 +85,19 @@ public:
     static bool fileExist(const std::string & filename);
     /// returns the file size in bytes.
     static unsigned int fileSize(FILE* fp);
+    /// returns the size of file filename in bytes, 0 if it does not exist
+    static size_t fileSize(const std::string & filename);
+    /// returns the last modification time of file filename in seconds since the epoch, <0.0 if it does not exist
+    /** The time includes fractions of a second as far as supported by the file system. */
+    static double fileTime(const std::string & filename);
+    /// renames file oldName to newName, an existing file newName is replaced atomically
+    /** Readers that have opened or mapped the previous file newName keep accessing its content. 
+     Writing a file under a temporary name and renaming it afterwards therefore never exposes 
+     partially written content. \return true in case of success */
+    static bool rename(const std::string & oldName, const std::string & newName);
+    /// returns a temporary file name next to filename, unique among concurrently writing processes and threads
+    /** Intended for writing a file that subsequently replaces filename via rename(). */
+    static std::string tempName(const std::string & filename);
     /// returns currently available drives
     /** Under Windows, a string consisting of individual drive letters is returned. Under Unix,
         always an empty string is returned, because the concept of explicit dirves does not exist here. */
@@ -93,10 +108,243 @@ public:
     static std::string cwd();
     /// changes the current working directory
     static int chdir(const std::string & path);
+    /// returns a high resolution monotonic time stamp in seconds, suitable for measuring durations
+    static double time();
+    /// atomically adds delta to value, returns the resulting value
+    static unsigned int atomicAdd(volatile unsigned int & value, int delta);
+    /// returns the number of available processor cores
+    static unsigned int nCores();
 	/// opens an URL in the system's default browser
 	void openURL(const std::string & url);
 };
 
+//--- class MappedFile ---------------------------------------------
+/// a class providing read-only access to the content of a file mapped into memory
+/** Where memory mapping is unavailable or fails, the file is read into a heap buffer instead.
+ The data remain valid until close() is called or the object is destroyed. */
+class MappedFile {
+public:
+    /// default constructor
+    MappedFile() : mp_data(0), m_size(0), m_mapped(false) { }
+    /// constructor directly opening file filename
+    MappedFile(const std::string & filename) : mp_data(0), m_size(0), m_mapped(false) { open(filename); }
+    /// destructor
+    ~MappedFile() { close(); }
+    /// maps file filename, a previously opened file is closed
+    /** \return true in case of success */
+    bool open(const std::string & filename);
+    /// releases the mapped data
+    void close();
+    /// returns pointer to file content, 0 if no file is open
+    const char * data() const { return mp_data; }
+    /// returns file size in bytes
+    size_t size() const { return m_size; }
+    /// returns true if the content is memory mapped, false if it has been read into a buffer
+    bool mapped() const { return m_mapped; }
+protected:
+    /// pointer to file content
+    const char * mp_data;
+    /// file size in bytes
+    size_t m_size;
+    /// stores whether mp_data is memory mapped
+    bool m_mapped;
+private:
+    /// prevent copies
+    MappedFile(const MappedFile &);
+    /// prevent copies
+    MappedFile & operator=(const MappedFile &);
+};
+
+//--- class SharedFile ---------------------------------------------
+/// a reference counted MappedFile, whose content may be referred to by several owners
+/** SharedFile objects have to be created by new and start with a reference count of 1. 
+ They delete themselves as soon as the last owner calls unref(). */
+class SharedFile : public MappedFile {
+public:
+    /// default constructor
+    SharedFile() : MappedFile(), m_refCount(1) { }
+    /// increments reference count, thread-safe
+    void ref() { io::atomicAdd(m_refCount, 1); }
+    /// decrements reference count, deletes this object when it drops to zero, thread-safe
+    void unref() { if(!io::atomicAdd(m_refCount, -1)) delete this; }
+protected:
+    /// destructor, only called by unref()
+    ~SharedFile() { }
+    /// stores reference counter
+    volatile unsigned int m_refCount;
+};
+
+//--- class FileWriter ---------------------------------------------
+/// a class writing a file sequentially through a fixed size buffer
+/** Numbers are formatted directly into the buffer via printInt() and printFloat(), so that large 
+ files can be written without building intermediate strings. Example:\n
+  \code
+	FileWriter out("points.txt");
+	for(size_t i=0; i<vPoint.size(); ++i) out << vPoint[i][X] << ' ' << vPoint[i][Y] << '\n';
+	if(!out.close()) cerr << "write error\n";
+  \endcode */
+class FileWriter {
+public:
+    /// default constructor
+    FileWriter() : mp_file(0), mp_buf(0), m_pos(0), m_good(false) { }
+    /// constructor directly opening file filename
+    FileWriter(const std::string & filename) : mp_file(0), mp_buf(0), m_pos(0), m_good(false) { open(filename); }
+    /// destructor, closes the file
+    ~FileWriter() { close(); }
+    /// creates or truncates file filename, a previously opened file is closed
+    /** \return true in case of success */
+    bool open(const std::string & filename);
+    /// writes the buffered data and closes the file
+    /** \return true if all data have been written successfully */
+    bool close();
+    /// returns true as long as the file is open and no write error occurred
+    bool good() const { return m_good; }
+    /// appends n bytes at p
+    void write(const char * p, size_t n);
+    /// appends a single character
+    FileWriter & operator<<(char ch) { 
+        if(m_pos==BUFFER_SIZE) flush(); 
+        if(mp_buf) mp_buf[m_pos++]=ch; 
+        return *this; }
+    /// appends a zero terminated string
+    FileWriter & operator<<(const char * s);
+    /// appends a string
+    FileWriter & operator<<(const std::string & s) { write(s.data(), s.size()); return *this; }
+    /// appends the decimal representation of an integer
+    FileWriter & operator<<(long i);
+    /// appends the decimal representation of an integer
+    FileWriter & operator<<(int i) { return *this << static_cast<long>(i); }
+    /// appends the decimal representation of an unsigned integer
+    FileWriter & operator<<(unsigned int u) { return *this << static_cast<unsigned long>(u); }
+    /// appends the decimal representation of an unsigned integer
+    FileWriter & operator<<(unsigned long u);
+    /// appends the shortest decimal representation of a float, see printFloat()
+    FileWriter & operator<<(float f);
+protected:
+    /// writes the buffer content to the file
+    void flush();
+    /// size of the write buffer in bytes
+    enum { BUFFER_SIZE=65536 };
+    /// file handle, 0 if no file is open
+    FILE * mp_file;
+    /// write buffer
+    char * mp_buf;
+    /// number of bytes used within mp_buf
+    size_t m_pos;
+    /// stores whether all writes have been successful so far
+    bool m_good;
+private:
+    /// prevent copies
+    FileWriter(const FileWriter &);
+    /// prevent copies
+    FileWriter & operator=(const FileWriter &);
+};
+
+//--- threading ----------------------------------------------------
+
+/// declares a static variable as thread local, i.e., each thread accesses its own instance
+#ifdef _MSC_VER
+# define PRO_THREAD_LOCAL __declspec(thread)
+#else
+# define PRO_THREAD_LOCAL __thread
+#endif
+
+//--- class Mutex --------------------------------------------------
+/// a recursive mutual exclusion lock
+/** The thread holding the lock may lock it repeatedly, it has to unlock it as often. */
+class Mutex {
+public:
+    /// constructor
+    Mutex();
+    /// destructor
+    ~Mutex();
+    /// blocks until the lock is acquired by the calling thread
+    void lock();
+    /// releases the lock
+    void unlock();
+protected:
+    /// platform dependent handle
+    void * mp_handle;
+private:
+    /// prevent copies
+    Mutex(const Mutex &);
+    /// prevent copies
+    Mutex & operator=(const Mutex &);
+};
+
+//--- class MutexLock ----------------------------------------------
+/// a helper class holding the lock of a Mutex for the lifetime of a local scope
+class MutexLock {
+public:
+    /// constructor, locks mutex
+    MutexLock(Mutex & mutex) : m_mutex(mutex) { m_mutex.lock(); }
+    /// destructor, unlocks mutex
+    ~MutexLock() { m_mutex.unlock(); }
+protected:
+    /// the locked mutex
+    Mutex & m_mutex;
+};
+
+//--- class ThreadPool ---------------------------------------------
+/// a pool of worker threads processing tasks by work stealing
+/** Each worker owns a task queue. Pushed tasks are distributed round-robin among the queues,
+ a worker processes its own queue in LIFO order, and when it runs empty steals the oldest task
+ of another queue. The thread calling wait() processes tasks as well, so that a pool without any 
+ worker threads simply processes all tasks sequentially within wait(). Tasks may push further
+ tasks, but must not call wait().
+ Example :\n
+  \code
+	class Square : public ThreadPool::Task {
+	public:
+		Square(float & value) : m_value(value) { }
+		virtual void run() { m_value*=m_value; }
+	protected:
+		float & m_value;
+	};
+	ThreadPool pool;
+	for(size_t i=0; i<v.size(); ++i)
+		pool.push(new Square(v[i]));
+	pool.wait();
+  \endcode
+*/
+class ThreadPool {
+public:
+    /// interface of the tasks processed by a ThreadPool
+    class Task {
+    public:
+        /// destructor
+        virtual ~Task() { }
+        /// performs the task
+        virtual void run()=0;
+    };
+    /// constructor starting nThreads worker threads
+    /** \param nThreads number of worker threads, by default one less than the number of cores */
+    ThreadPool(unsigned int nThreads=UINT_MAX);
+    /// destructor, waits for all pending tasks and stops the workers
+    ~ThreadPool();
+    /// adds a task, the pool takes ownership and deletes it after processing
+    void push(Task * pTask);
+    /// processes tasks in the calling thread until all pushed tasks are done
+    /** Several threads may wait concurrently, all of them return once the pool runs empty. */
+    void wait();
+    /// returns number of worker threads
+    unsigned int size() const;
+    /// returns number of pushed tasks that are not yet done
+    unsigned int pending() const;
+    /// returns true if the calling thread currently processes a task of any ThreadPool
+    static bool inTask();
+protected:
+    /// an auxiliary struct holding the platform dependent state
+    struct Data;
+    /// platform dependent state
+    Data * mp_data;
+private:
+    /// prevent copies
+    ThreadPool(const ThreadPool &);
+    /// prevent copies
+    ThreadPool & operator=(const ThreadPool &);
+};
+
 //--- class cmdLine --------------------------------------------
 /// a simple static class for preparsing command line arguments and options
 class cmdLine {
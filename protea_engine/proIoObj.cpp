@@ -1,220 +1,521 @@
 #include "proIoObj.h"
 #include <protea.h>
 #include <fstream>
+#include <cstring>
+#include <climits>
 
 using namespace std;
 
 //--- loading ------------------------------------------------------
 
+static inline bool isBlank(char ch) {
+    return (ch==' ')||(ch=='\t')||(ch=='\r')||(ch=='\n');
+}
+
+/// returns start of the next word in [p,pEnd), pEnd if there is none. pWordEnd is set to the end of the word.
+static const char * nextWord(const char * p, const char * pEnd, const char * & pWordEnd) {
+    while((p<pEnd)&&isBlank(*p)) ++p;
+    pWordEnd=p;
+    while((pWordEnd<pEnd)&&!isBlank(*pWordEnd)) ++pWordEnd;
+    return p;
+}
+
+/// returns the end of the line starting at p, i.e., the position of its line feed or pEnd
+static inline const char * lineEnd(const char * p, const char * pEnd) {
+    const char * pLf=static_cast<const char*>(memchr(p,'\n',pEnd-p));
+    return pLf ? pLf : pEnd;
+}
+
+/// parses an integer in [p,pEnd), returns 0 for empty ranges
+static inline int parseIndex(const char * p, const char * pEnd) {
+    int index=0;
+    parseInt(p,pEnd,index);
+    return index;
+}
+
+/// returns true if the word [p,pEnd) equals the zero terminated string s
+static inline bool wordIs(const char * p, const char * pEnd, const char * s) {
+    size_t n=strlen(s);
+    return (static_cast<size_t>(pEnd-p)==n)&&!memcmp(p,s,n);
+}
+
+/// parses up to n floats following the key of a statement, returns the number of parsed floats
+static inline unsigned int parseFloats(const char * p, const char * pEnd, float * pF, unsigned int n) {
+    unsigned int i=0;
+    while((i<n)&&(p=parseFloat(p,pEnd,pF[i]))) ++i;
+    return i;
+}
+
 static int loadMtl(const std::string & filename) {
-    //cout << "loadMtl()" << endl;
-    ifstream file(filename.c_str(), std::ios::in);
-    if (!file.good()) {
+    MappedFile file;
+    if(!file.open(filename)) {
         cerr << "ioObj::loadMtl() ERROR: " << filename << " file error or file not found!\n";
         return 1;
     }
-    
     proMaterial* pMtl=0;
-    string line;
-    while(!file.eof()) {
-        getline(file,line);
-        line=trim(line);
-        if(!line.size()||(line[0]=='#')) continue;
-        vector<string> vWord;
-        split(line,vWord);
+    float v[3];
+    for(const char * pLine=file.data(), * pFileEnd=pLine+file.size(); pLine<pFileEnd; ) {
+        const char * pEnd=lineEnd(pLine,pFileEnd), * pKeyEnd, * pArgEnd;
+        const char * pKey=nextWord(pLine,pEnd,pKeyEnd);
+        pLine=pEnd+1;
+        if((pKey==pEnd)||(*pKey=='#')) continue;
+        const char * pArg=nextWord(pKeyEnd,pEnd,pArgEnd);
+        if(pArg==pEnd) continue;
         
-        if(vWord.size()<2) continue;
-        if(vWord[0]=="newmtl") {
+        if(wordIs(pKey,pKeyEnd,"newmtl")) {
             if(pMtl) {
                 MaterialMgr::singleton().add(*pMtl);
                 delete pMtl;
 				pMtl = 0;
             }
-            pMtl= new proMaterial(vWord[1]);
+            pMtl= new proMaterial(string(pArg,pArgEnd));
             continue;
         }
         if(!pMtl) continue;
-        if(vWord[0]=="Ns")
-            pMtl->shininess(s2f(vWord[1]));
-        else if((vWord[0]=="Ka")&&(vWord.size()>3))
-            pMtl->ambientColor(vec3f(s2f(vWord[1]),s2f(vWord[2]),s2f(vWord[3])));
-        else if((vWord[0]=="Kd")&&(vWord.size()>3))
-            pMtl->color(s2f(vWord[1]),s2f(vWord[2]),s2f(vWord[3]),pMtl->color()[3]);
-        else if((vWord[0]=="Ks")&&(vWord.size()>3))
-            pMtl->specularColor(vec3f(s2f(vWord[1]),s2f(vWord[2]),s2f(vWord[3])));
-        else if((vWord[0]=="d")||(vWord[0]=="Tr")) {
+        if(wordIs(pKey,pKeyEnd,"Ns")&&parseFloats(pKeyEnd,pEnd,v,1))
+            pMtl->shininess(v[0]);
+        else if(wordIs(pKey,pKeyEnd,"Ka")&&(parseFloats(pKeyEnd,pEnd,v,3)==3))
+            pMtl->ambientColor(vec3f(v[0],v[1],v[2]));
+        else if(wordIs(pKey,pKeyEnd,"Kd")&&(parseFloats(pKeyEnd,pEnd,v,3)==3))
+            pMtl->color(v[0],v[1],v[2],pMtl->color()[3]);
+        else if(wordIs(pKey,pKeyEnd,"Ks")&&(parseFloats(pKeyEnd,pEnd,v,3)==3))
+            pMtl->specularColor(vec3f(v[0],v[1],v[2]));
+        else if((wordIs(pKey,pKeyEnd,"d")||wordIs(pKey,pKeyEnd,"Tr"))&&parseFloats(pKeyEnd,pEnd,v,1)) {
 			vec4f col(pMtl->color());
-            col[3]=s2f(vWord[1]);
+            col[3]=v[0];
 			pMtl->color(col);
 		}
-        else if(vWord[0].find("map")<vWord[0].size()) 
-            pMtl->texName(vWord[1]);
+        else if(string(pKey,pKeyEnd).find("map")<static_cast<size_t>(pKeyEnd-pKey)) 
+            pMtl->texName(string(pArg,pArgEnd));
+    }
+    if(pMtl) {
+        MaterialMgr::singleton().add(*pMtl);
+        delete pMtl;
     }
-    file.close();
-    if(pMtl) MaterialMgr::singleton().add(*pMtl);
     return 0;
 }
 
-proNode * ioObj::load(const std::string & filename) {
-    //cout << "ioObj::load" << endl;
-    string fname=io::unifyPath(filename);
-    unsigned int filenamePos=fname.rfind('/');
-    ifstream file(fname.c_str(), std::ios::in);
-    if (!file.good()) {
-        cerr << "ioObj::load() ERROR: " << fname << " file error or file not found!\n";
-        return 0;
-    }
-    
-    proTransform * pParent=new proTransform(filename);
-    
-    string line;
-    proMesh * pMesh=new proMesh;
-    bool faceMode=false;
-    unsigned int vIndexOffset=1;
-    unsigned int tIndexOffset=1;
-    unsigned int nIndexOffset=1;
-    // storage for further temporary indices:
-    vector<size_t> vTexIndices;
-    vector<size_t> vNormalIndices;
-    vector<size_t> vFaceEnds;
-        
-    while(!file.eof()) {
-        getline(file,line);
-        line=trim(line);
-        vector<string> vWord;
-        split(line,vWord);
+/// an auxiliary struct storing the vertex indices of a face corner
+/** Indices are zero based, negative (i.e. relative) OBJ indices are resolved to the beginning 
+ of the chunk they are parsed in, and afterwards to the beginning of the file. */
+struct ObjCorner {
+    /// flags of the corner
+    enum { HAS_T=1, HAS_N=2, REL_V=4, REL_T=8, REL_N=16 };
+    /// index of coordinate, texture coordinate, and normal
+    int v, t, n;
+    /// combination of flags
+    unsigned int flags;
+};
+
+/// an auxiliary struct storing a statement terminating a run of faces
+struct ObjEvent {
+    /// event types
+    enum Type { END, NAME, MATERIAL, MTLLIB };
+    /// constructor
+    ObjEvent(Type eventType, size_t nFace, size_t nCoord, size_t nTexCoord, size_t nNormal, const char * pArg, const char * pArgEnd) 
+        : type(eventType), face(nFace), arg(pArg,pArgEnd) { 
+        size[0]=static_cast<int>(nCoord); size[1]=static_cast<int>(nTexCoord); size[2]=static_cast<int>(nNormal); }
+    /// event type
+    Type type;
+    /// number of faces of the chunk preceding the event
+    size_t face;
+    /// numbers of coordinates, texture coordinates, and normals preceding the event
+    int size[3];
+    /// argument of the statement
+    std::string arg;
+};
+
+/// an auxiliary struct storing the statements of a range of lines of an OBJ file
+struct ObjChunk {
+    /// constructor
+    ObjChunk() : pBegin(0), pEnd(0) { }
+    /// parses the lines
+    void parse();
+    /// resolves relative indices, offsets refer to the beginning of the file
+    void resolve(int vOffset, int tOffset, int nOffset);
+
+    /// range of lines
+    const char * pBegin, * pEnd;
+    /// vertex coordinates
+    std::vector<vec3f> vCoord;
+    /// texture coordinates
+    std::vector<vec2f> vTexCoord;
+    /// vertex normals
+    std::vector<vec3f> vNormal;
+    /// face corners
+    std::vector<ObjCorner> vCorner;
+    /// number of corners per face
+    std::vector<unsigned int> vFaceSize;
+    /// further statements in the order of the file
+    std::vector<ObjEvent> vEvent;
+};
+
+void ObjChunk::parse() {
+    float v[3];
+    bool faceLine=true; // a run of faces may continue from the previous chunk
+    for(const char * pLine=pBegin; pLine<pEnd; ) {
+        const char * pLineEnd=lineEnd(pLine,pEnd), * pKeyEnd;
+        const char * pKey=nextWord(pLine,pLineEnd,pKeyEnd);
+        pLine=pLineEnd+1;
+        size_t nKey=pKeyEnd-pKey;
         
-        if(vWord.size()&&(vWord[0]=="f")) {
-            faceMode=true;
-            if(vWord.size()>3) {
-                for(unsigned int i=1; i<vWord.size(); ++i) {
-                    unsigned int slashPos=vWord[i].find('/');
-                    int index=s2i(vWord[i].substr(0,slashPos));
-                    if(index<0) index+=pMesh->indices().size();
-                    else index-=vIndexOffset;
-                    pMesh->indices().push_back(index);
-                    //cout << "v:" << index << " ";
-                    if(slashPos<vWord[i].size()) {
-                        index=s2i(vWord[i].substr(slashPos+1,vWord[i].rfind('/')+1-slashPos));
-                        if(index<0) vTexIndices.push_back(vTexIndices.size()+index);
-                        else if(index>0) vTexIndices.push_back(index-tIndexOffset);
-                        //if(index) cout << "t:" << index-tIndexOffset << " ";
-                        
-                        if(vWord[i].find('/',slashPos+1)<vWord[i].size()) {
-                            index=s2i(vWord[i].substr(vWord[i].rfind('/')+1,vWord[i].size()));
-                            if(index<0) vNormalIndices.push_back(vNormalIndices.size()+index);
-                            else if(index>0) vNormalIndices.push_back(index-nIndexOffset);
-                            //if(index) cout << "n:" << index-nIndexOffset;
+        if((nKey==1)&&(*pKey=='f')) {
+            faceLine=true;
+            const size_t nCorners=vCorner.size();
+            const char * pWordEnd;
+            for(const char * pWord=nextWord(pKeyEnd,pLineEnd,pWordEnd); pWord<pLineEnd; pWord=nextWord(pWordEnd,pLineEnd,pWordEnd)) {
+                ObjCorner corner;
+                corner.t=corner.n=0;
+                corner.flags=0;
+                const char * pSlash=pWord;
+                while((pSlash<pWordEnd)&&(*pSlash!='/')) ++pSlash;
+                int index=parseIndex(pWord,pSlash);
+                if(index<0) {
+                    corner.v=static_cast<int>(vCoord.size())+index;
+                    corner.flags|=ObjCorner::REL_V;
+                }
+                else corner.v=index-1;
+                if(pSlash<pWordEnd) {
+                    const char * pSlash2=pSlash+1;
+                    while((pSlash2<pWordEnd)&&(*pSlash2!='/')) ++pSlash2;
+                    index=parseIndex(pSlash+1,pSlash2);
+                    if(index<0) {
+                        corner.t=static_cast<int>(vTexCoord.size())+index;
+                        corner.flags|=ObjCorner::HAS_T|ObjCorner::REL_T;
+                    }
+                    else if(index>0) {
+                        corner.t=index-1;
+                        corner.flags|=ObjCorner::HAS_T;
+                    }
+                    if(pSlash2<pWordEnd) {
+                        index=parseIndex(pSlash2+1,pWordEnd);
+                        if(index<0) {
+                            corner.n=static_cast<int>(vNormal.size())+index;
+                            corner.flags|=ObjCorner::HAS_N|ObjCorner::REL_N;
+                        }
+                        else if(index>0) {
+                            corner.n=index-1;
+                            corner.flags|=ObjCorner::HAS_N;
                         }
                     }
-                    //cout << endl;
                 }
-                vFaceEnds.push_back(pMesh->indices().size()-1);
+                vCorner.push_back(corner);
             }
+            if(vCorner.size()>nCorners+2) vFaceSize.push_back(vCorner.size()-nCorners);
+            else vCorner.resize(nCorners); // degenerated face, discard
+            continue;
+        }
+        // any other line terminates a run of faces:
+        if(faceLine) vEvent.push_back(ObjEvent(ObjEvent::END, vFaceSize.size(), vCoord.size(), vTexCoord.size(), vNormal.size(), pKey, pKey));
+        faceLine=false;
+        if(!nKey||(*pKey=='#')) continue;
+
+        if((nKey==1)&&(*pKey=='v')) {
+            if(parseFloats(pKeyEnd,pLineEnd,v,3)==3) vCoord.push_back(vec3f(v[0],v[1],v[2]));
             continue;
         }
-        else if(faceMode) { // mesh is over
-			// normalize between various indices:
-			if(vTexIndices.size()&&(vTexIndices.size()!=pMesh->indices().size()))
-				vTexIndices.clear();
-			if(vNormalIndices.size()&&(vNormalIndices.size()!=pMesh->indices().size()))
-				vNormalIndices.clear();
-			if(vTexIndices.size()||vNormalIndices.size()) {
-				vector<vec3f> vCoord;
-				vCoord.reserve(pMesh->indices().size());
-				vector<vec2f> vTexCoord;
-				vTexCoord.reserve(pMesh->indices().size());
-				vector<vec3f> vNormal;
-				vNormal.reserve(pMesh->indices().size());
-				vector<unsigned int> vIndex;
-				vIndex.reserve(pMesh->indices().size());
-				for(size_t i=0; i<pMesh->indices().size(); ++i) { // normalize indices:
-					// search for suitable vertex:
-					size_t index=UINT_MAX;
-					for(size_t j=0; j<vCoord.size(); ++j) {
-						if(vCoord[j]!=pMesh->coords()[pMesh->indices()[i]]) 
-							continue;
-						if(pMesh->texCoords().size()&&(vTexCoord[j]!=pMesh->texCoords()[vTexIndices.size() ? vTexIndices[i] : pMesh->indices()[i]]))
-							continue;
-						if(pMesh->vNormals().size()&&(vNormal[j]!=pMesh->vNormals()[vNormalIndices.size() ? vNormalIndices[i] : pMesh->indices()[i]]))
-							continue;
-						index=j;
-						break;
-					}
-					if(index==UINT_MAX) { // no suitable vertex found, add new:
-						index=static_cast<unsigned int>(vCoord.size());
-						vCoord.push_back(pMesh->coords()[pMesh->indices()[i]]);
-						if(pMesh->texCoords().size())
-							vTexCoord.push_back(pMesh->texCoords()[vTexIndices.size() ? vTexIndices[i] : pMesh->indices()[i]]);
-						if(pMesh->vNormals().size())
-							vNormal.push_back(pMesh->vNormals()[vNormalIndices.size() ? vNormalIndices[i] : pMesh->indices()[i]]);
-					}
-					vIndex.push_back(index);
-				}
-				pMesh->coords()=vCoord;
-				if(pMesh->texCoords().size()) pMesh->texCoords()=vTexCoord;
-				if(pMesh->vNormals().size()) pMesh->vNormals()=vNormal;
-				pMesh->indices()=vIndex;
-			}
-			// triangulate vertex indices based on face ends:
-			vector<unsigned int> vIndex;
-			// rebuild indices list:
-			size_t currStart=0;
-			size_t currEnd=0;
-			for(size_t i=0; (i<pMesh->indices().size())&&(currEnd<vFaceEnds.size()); ++i) {
-				if(i>currStart+1) {
-					vIndex.push_back(pMesh->indices()[currStart]);
-					vIndex.push_back(pMesh->indices()[i-1]);
-					vIndex.push_back(pMesh->indices()[i]);
-				}
-				if(i==vFaceEnds[currEnd]) {
-					++currEnd;
-					currStart=i+1;
-				}
-			}
-			pMesh->indices()=vIndex;
-			
-			// append:
-            pParent->append(pMesh,false);
-			// cleanup for next mesh:
-            vIndexOffset+=pMesh->coords().size();
-            tIndexOffset+=pMesh->texCoords().size();
-            nIndexOffset+=pMesh->vNormals().size();
-			vTexIndices.clear();
-			vNormalIndices.clear();
-			vFaceEnds.clear();
-            pMesh=new proMesh;
-            faceMode=false;
+        if((nKey==2)&&(pKey[0]=='v')&&((pKey[1]=='t')||(pKey[1]=='n'))) {
+            if(pKey[1]=='t') {
+                if(parseFloats(pKeyEnd,pLineEnd,v,2)==2) vTexCoord.push_back(vec2f(v[0],v[1]));
+            }
+            else if(parseFloats(pKeyEnd,pLineEnd,v,3)==3) vNormal.push_back(vec3f(v[0],v[1],v[2]));
+            continue;
         }
-        if(!line.size()||(line[0]=='#')) continue;
-            
-        if(((vWord[0]=="g")||(vWord[0]=="o"))&&(vWord.size()>1))
-            pMesh->name(vWord[1]);
-        else if((vWord[0]=="v")&&(vWord.size()>3))
-            pMesh->coords().push_back(vec3f(s2f(vWord[1]),s2f(vWord[2]),s2f(vWord[3])));
-        else if((vWord[0]=="vt")&&(vWord.size()>2))
-            pMesh->texCoords().push_back(vec2f(s2f(vWord[1]),s2f(vWord[2])));
-        else if((vWord[0]=="vn")&&(vWord.size()>3))
-            pMesh->vNormals().push_back(vec3f(s2f(vWord[1]),s2f(vWord[2]),s2f(vWord[3])));
-        else if((vWord[0]=="usemtl")&&(vWord.size()>1))
-			pMesh->material(MaterialMgr::singleton()[vWord[1]]);
-        else if(vWord[0]=="mtllib") for(unsigned int i=1; i<vWord.size();++i) {
+        
+        // rare statements referring to names:
+        const char * pArgEnd;
+        const char * pArg=nextWord(pKeyEnd,pLineEnd,pArgEnd);
+        if(pArg==pLineEnd) continue;
+        if(((nKey==1)&&((*pKey=='g')||(*pKey=='o'))))
+            vEvent.push_back(ObjEvent(ObjEvent::NAME, vFaceSize.size(), vCoord.size(), vTexCoord.size(), vNormal.size(), pArg, pArgEnd));
+        else if(wordIs(pKey,pKeyEnd,"usemtl"))
+            vEvent.push_back(ObjEvent(ObjEvent::MATERIAL, vFaceSize.size(), vCoord.size(), vTexCoord.size(), vNormal.size(), pArg, pArgEnd));
+        else if(wordIs(pKey,pKeyEnd,"mtllib"))
+            vEvent.push_back(ObjEvent(ObjEvent::MTLLIB, vFaceSize.size(), vCoord.size(), vTexCoord.size(), vNormal.size(), pArg, pLineEnd));
+    }
+}
+
+void ObjChunk::resolve(int vOffset, int tOffset, int nOffset) {
+    for(vector<ObjCorner>::iterator it=vCorner.begin(); it!=vCorner.end(); ++it) {
+        if(it->flags&ObjCorner::REL_V) it->v+=vOffset;
+        if(it->flags&ObjCorner::REL_T) it->t+=tOffset;
+        if(it->flags&ObjCorner::REL_N) it->n+=nOffset;
+    }
+    for(vector<ObjEvent>::iterator it=vEvent.begin(); it!=vEvent.end(); ++it) {
+        it->size[0]+=vOffset;
+        it->size[1]+=tOffset;
+        it->size[2]+=nOffset;
+    }
+}
+
+/// an auxiliary task parsing an ObjChunk within a ThreadPool
+class ObjParseTask : public ThreadPool::Task {
+public:
+    /// constructor
+    ObjParseTask(ObjChunk & chunk) : m_chunk(chunk) { }
+    /// parses the chunk
+    virtual void run() { m_chunk.parse(); }
+protected:
+    /// the chunk to be parsed
+    ObjChunk & m_chunk;
+};
+
+/// combines a float into a hash value, 0.0 and -0.0 are treated as equal
+static inline unsigned int hashFloat(unsigned int h, float f) {
+    f+=0.0f;
+    unsigned int u;
+    memcpy(&u,&f,sizeof(u));
+    return (h^u)*16777619u;
+}
+
+/// an auxiliary class building meshes from the parsed chunks of an OBJ file
+class ObjBuilder {
+public:
+    /// constructor
+    ObjBuilder(const std::string & filename, const vector<vec3f> & vCoord, const vector<vec2f> & vTexCoord, const vector<vec3f> & vNormal) 
+        : m_filename(filename), m_vCoord(vCoord), m_vTexCoord(vTexCoord), m_vNormal(vNormal), mp_parent(new proTransform(filename)), 
+        mp_mesh(new proMesh), m_nCorner(0), m_nInvalid(0) { m_begin[0]=m_begin[1]=m_begin[2]=0; }
+    /// destructor
+    ~ObjBuilder() { delete mp_mesh; if(mp_parent) mp_parent->clear(); delete mp_parent; }
+    /// appends the faces [faceBegin,faceEnd) of chunk to the current run of faces
+    void append(const ObjChunk & chunk, size_t faceBegin, size_t faceEnd, size_t & cornerBegin);
+    /// evaluates an event, terminating the current run of faces
+    void apply(const ObjEvent & event);
+    /// builds a mesh from the current run of faces and appends it to the model
+    /** \param end numbers of coordinates, texture coordinates, and normals preceding the end of the run */
+    void finish(const int * end);
+    /// returns the model and releases its ownership, 0 if it is empty
+    proNode * release();
+    /// returns number of processed face corners
+    size_t nCorner() const { return m_nCorner; }
+protected:
+    /// path of the OBJ file
+    std::string m_filename;
+    /// vertex data of the whole file
+    const vector<vec3f> & m_vCoord;
+    /// texture coordinates of the whole file
+    const vector<vec2f> & m_vTexCoord;
+    /// normals of the whole file
+    const vector<vec3f> & m_vNormal;
+    /// the model
+    proTransform * mp_parent;
+    /// mesh receiving the current run of faces
+    proMesh * mp_mesh;
+    /// corners of the current run of faces
+    vector<ObjCorner> mv_corner;
+    /// number of corners per face of the current run of faces
+    vector<unsigned int> mv_faceSize;
+    /// number of processed face corners
+    size_t m_nCorner;
+    /// number of faces discarded due to invalid indices
+    size_t m_nInvalid;
+    /// numbers of coordinates, texture coordinates, and normals preceding the current mesh
+    /** Faces without texture coordinate or normal indices refer to those defined along with the 
+     coordinates of the mesh, i.e., after the end of the previous mesh. */
+    int m_begin[3];
+};
+
+void ObjBuilder::append(const ObjChunk & chunk, size_t faceBegin, size_t faceEnd, size_t & cornerBegin) {
+    for(size_t i=faceBegin; i<faceEnd; ++i) {
+        mv_corner.insert(mv_corner.end(), chunk.vCorner.begin()+cornerBegin, chunk.vCorner.begin()+cornerBegin+chunk.vFaceSize[i]);
+        cornerBegin+=chunk.vFaceSize[i];
+        mv_faceSize.push_back(chunk.vFaceSize[i]);
+    }
+}
+
+void ObjBuilder::apply(const ObjEvent & event) {
+    finish(event.size);
+    if(event.type==ObjEvent::NAME)
+        mp_mesh->name(event.arg);
+    else if(event.type==ObjEvent::MATERIAL)
+        mp_mesh->material(MaterialMgr::singleton()[event.arg]);
+    else if(event.type==ObjEvent::MTLLIB) {
+        const string fname=io::unifyPath(m_filename);
+        const size_t filenamePos=fname.rfind('/');
+        const char * pEnd=event.arg.data()+event.arg.size(), * pWordEnd;
+        for(const char * pWord=nextWord(event.arg.data(),pEnd,pWordEnd); pWord<pEnd; pWord=nextWord(pWordEnd,pEnd,pWordEnd)) {
             if(filenamePos<fname.size())
-                loadMtl(fname.substr(0,filenamePos+1)+vWord[i]);
-            else loadMtl(vWord[i]);
+                loadMtl(fname.substr(0,filenamePos+1)+string(pWord,pWordEnd));
+            else loadMtl(string(pWord,pWordEnd));
         }
     }
-    file.close();
-    delete pMesh;
-    //cout << "pParent->size():" << pParent->size() << endl;
-    if(pParent->size()==1) {
-        pMesh=new proMesh(*static_cast<proMesh*>((*pParent)[0]));
-        delete pParent;
-        return pMesh;
+}
+
+void ObjBuilder::finish(const int * end) {
+    if(mv_faceSize.empty()) return;
+    // faces are either textured/lit per corner, or pair their coordinates with the texture 
+    // coordinates/normals defined along with them:
+    unsigned int allFlags=ObjCorner::HAS_T|ObjCorner::HAS_N;
+    for(vector<ObjCorner>::const_iterator it=mv_corner.begin(); it!=mv_corner.end(); ++it)
+        allFlags&=it->flags;
+    const bool tPerCorner=(allFlags&ObjCorner::HAS_T)!=0, nPerCorner=(allFlags&ObjCorner::HAS_N)!=0;
+    bool hasT=tPerCorner||(end[1]>m_begin[1]);
+    bool hasN=nPerCorner||(end[2]>m_begin[2]);
+    const int nCoord=static_cast<int>(m_vCoord.size());
+    const int tBegin=tPerCorner ? 0 : m_begin[1], tEnd=tPerCorner ? static_cast<int>(m_vTexCoord.size()) : end[1];
+    const int nBegin=nPerCorner ? 0 : m_begin[2], nEnd=nPerCorner ? static_cast<int>(m_vNormal.size()) : end[2];
+    const int tOffset=m_begin[1]-m_begin[0], nOffset=m_begin[2]-m_begin[0];
+    // implicit pairing only applies if all coordinates in use have a counterpart, e.g., faces may refer
+    // to coordinates of previous meshes, otherwise the mesh goes without the attribute:
+    for(vector<ObjCorner>::const_iterator it=mv_corner.begin(); (it!=mv_corner.end())&&((hasT&&!tPerCorner)||(hasN&&!nPerCorner)); ++it) {
+        if((it->v<0)||(it->v>=nCoord)) continue; // the face is discarded anyway
+        if(!tPerCorner&&((it->v+tOffset<tBegin)||(it->v+tOffset>=tEnd))) hasT=false;
+        if(!nPerCorner&&((it->v+nOffset<nBegin)||(it->v+nOffset>=nEnd))) hasN=false;
     }
-    else if(pParent->size()) return pParent;
-    delete pParent;
-    return 0;
+    m_begin[0]=end[0];
+    m_begin[1]=end[1];
+    m_begin[2]=end[2];
+
+    // weld corners referring to identical values by hashing, or to identical coordinates if there are no further attributes:
+    size_t nSlot=1;
+    while(nSlot<2*mv_corner.size()) nSlot<<=1;
+    vector<unsigned int> vSlot(nSlot,UINT_MAX);
+    vector<int> vSource; // coordinate index per vertex in case of no further attributes
+    vector<unsigned int> vIndex;
+    vector<unsigned int> vTriangle;
+    vTriangle.reserve(3*mv_corner.size()-6*mv_faceSize.size());
+    vector<ObjCorner>::const_iterator itCorner=mv_corner.begin();
+    for(vector<unsigned int>::const_iterator itFace=mv_faceSize.begin(); itFace!=mv_faceSize.end(); itCorner+=*itFace, ++itFace) {
+        bool valid=true;
+        for(unsigned int i=0; valid&&(i<*itFace); ++i) {
+            const ObjCorner & corner=itCorner[i];
+            const int t=tPerCorner ? corner.t : corner.v+tOffset, n=nPerCorner ? corner.n : corner.v+nOffset;
+            valid=(corner.v>=0)&&(corner.v<nCoord)&&(!hasT||((t>=tBegin)&&(t<tEnd)))&&(!hasN||((n>=nBegin)&&(n<nEnd)));
+        }
+        if(!valid) {
+            ++m_nInvalid;
+            continue;
+        }
+        vIndex.clear();
+        for(unsigned int i=0; i<*itFace; ++i) {
+            const ObjCorner & corner=itCorner[i];
+            const vec3f & coord=m_vCoord[corner.v];
+            const vec2f * pTexCoord=hasT ? &m_vTexCoord[tPerCorner ? corner.t : corner.v+tOffset] : 0;
+            const vec3f * pNormal=hasN ? &m_vNormal[nPerCorner ? corner.n : corner.v+nOffset] : 0;
+            unsigned int h=2166136261u;
+            if(!hasT&&!hasN) h=(h^static_cast<unsigned int>(corner.v))*16777619u;
+            else {
+                h=hashFloat(hashFloat(hashFloat(h,coord[0]),coord[1]),coord[2]);
+                if(pTexCoord) h=hashFloat(hashFloat(h,(*pTexCoord)[0]),(*pTexCoord)[1]);
+                if(pNormal) h=hashFloat(hashFloat(hashFloat(h,(*pNormal)[0]),(*pNormal)[1]),(*pNormal)[2]);
+            }
+            size_t slot=h&(nSlot-1);
+            for(; vSlot[slot]!=UINT_MAX; slot=(slot+1)&(nSlot-1)) {
+                const unsigned int j=vSlot[slot];
+                if(!hasT&&!hasN) {
+                    if(vSource[j]==corner.v) break;
+                    continue;
+                }
+                if(mp_mesh->coords()[j]!=coord) continue;
+                if(pTexCoord&&(mp_mesh->texCoords()[j]!=*pTexCoord)) continue;
+                if(pNormal&&(mp_mesh->vNormals()[j]!=*pNormal)) continue;
+                break;
+            }
+            if(vSlot[slot]==UINT_MAX) { // no suitable vertex found, add new:
+                vSlot[slot]=static_cast<unsigned int>(mp_mesh->coords().size());
+                mp_mesh->coords().push_back(coord);
+                if(pTexCoord) mp_mesh->texCoords().push_back(*pTexCoord);
+                if(pNormal) mp_mesh->vNormals().push_back(*pNormal);
+                if(!hasT&&!hasN) vSource.push_back(corner.v);
+            }
+            vIndex.push_back(vSlot[slot]);
+        }
+        // triangulate face as fan:
+        for(size_t i=2; i<vIndex.size(); ++i) {
+            vTriangle.push_back(vIndex[0]);
+            vTriangle.push_back(vIndex[i-1]);
+            vTriangle.push_back(vIndex[i]);
+        }
+    }
+    mp_mesh->indices().swap(vTriangle);
+    m_nCorner+=mv_corner.size();
+    mv_corner.clear();
+    mv_faceSize.clear();
+    // append:
+    mp_parent->append(mp_mesh,false);
+    mp_mesh=new proMesh;
+}
+
+proNode * ObjBuilder::release() {
+    const int end[3]={ static_cast<int>(m_vCoord.size()), static_cast<int>(m_vTexCoord.size()), static_cast<int>(m_vNormal.size()) };
+    finish(end);
+    if(m_nInvalid) cerr << "ioObj::load() WARNING: " << m_nInvalid << " faces of \"" << m_filename << "\" with invalid indices discarded.\n";
+    proNode * pModel=0;
+    if(mp_parent->size()==1) pModel=new proMesh(*static_cast<proMesh*>((*mp_parent)[0]));
+    else if(mp_parent->size()) {
+        pModel=mp_parent;
+        mp_parent=0;
+    }
+    return pModel;
+}
+
+/// files larger than this are parsed in parallel chunks of at least this size
+static const size_t s_chunkSize=1<<20;
+
+proNode * ioObj::load(const std::string & filename) {
+    string fname=io::unifyPath(filename);
+    MappedFile file;
+    if(!file.open(fname)) {
+        cerr << "ioObj::load() ERROR: " << fname << " file error or file not found!\n";
+        return 0;
+    }
+    
+    // parse, large files in parallel by line ranges:
+    LoadStage stageParse("meshParse");
+    stageParse.bytes(file.size());
+    ThreadPool * pPool=(file.size()>=2*s_chunkSize)&&!ThreadPool::inTask() ? &ModelMgr::singleton().pool() : 0;
+    size_t nChunk=pPool&&pPool->size() ? min(file.size()/s_chunkSize, static_cast<size_t>(4*(pPool->size()+1))) : 1;
+    vector<ObjChunk> vChunk(nChunk);
+    const char * pData=file.data(), * pDataEnd=pData+file.size();
+    for(size_t i=0; i<nChunk; ++i) {
+        vChunk[i].pBegin=i ? vChunk[i-1].pEnd : pData;
+        vChunk[i].pEnd=(i+1<nChunk) ? lineEnd(pData+(i+1)*file.size()/nChunk, pDataEnd) : pDataEnd;
+        if(vChunk[i].pEnd<pDataEnd) ++vChunk[i].pEnd;
+        if(vChunk[i].pEnd<vChunk[i].pBegin) vChunk[i].pEnd=vChunk[i].pBegin;
+    }
+    if(nChunk>1) {
+        for(size_t i=0; i<nChunk; ++i)
+            pPool->push(new ObjParseTask(vChunk[i]));
+        pPool->wait();
+    }
+    else vChunk[0].parse();
+
+    // concatenate vertex data of all chunks:
+    vector<vec3f> vCoord;
+    vector<vec2f> vTexCoord;
+    vector<vec3f> vNormal;
+    if(nChunk==1) {
+        vCoord.swap(vChunk[0].vCoord);
+        vTexCoord.swap(vChunk[0].vTexCoord);
+        vNormal.swap(vChunk[0].vNormal);
+    }
+    else for(size_t i=0; i<nChunk; ++i) {
+        vChunk[i].resolve(static_cast<int>(vCoord.size()), static_cast<int>(vTexCoord.size()), static_cast<int>(vNormal.size()));
+        vCoord.insert(vCoord.end(), vChunk[i].vCoord.begin(), vChunk[i].vCoord.end());
+        vTexCoord.insert(vTexCoord.end(), vChunk[i].vTexCoord.begin(), vChunk[i].vTexCoord.end());
+        vNormal.insert(vNormal.end(), vChunk[i].vNormal.begin(), vChunk[i].vNormal.end());
+        vector<vec3f>().swap(vChunk[i].vCoord);
+        vector<vec2f>().swap(vChunk[i].vTexCoord);
+        vector<vec3f>().swap(vChunk[i].vNormal);
+    }
+    stageParse.elements(vCoord.size()+vTexCoord.size()+vNormal.size());
+    stageParse.finish();
+    
+    // build a mesh per run of faces, statements inbetween are evaluated in the order of the file:
+    LoadStage stageNormalize("normalizeIndices");
+    ObjBuilder builder(filename, vCoord, vTexCoord, vNormal);
+    for(vector<ObjChunk>::const_iterator it=vChunk.begin(); it!=vChunk.end(); ++it) {
+        size_t face=0, corner=0;
+        for(vector<ObjEvent>::const_iterator jt=it->vEvent.begin(); jt!=it->vEvent.end(); ++jt) {
+            builder.append(*it, face, jt->face, corner);
+            face=jt->face;
+            builder.apply(*jt);
+        }
+        builder.append(*it, face, it->vFaceSize.size(), corner); // may be continued by the next chunk
+    }
+    proNode * pModel=builder.release();
+    stageNormalize.elements(builder.nCorner());
+    return pModel;
 }
 
 
@@ -225,76 +526,69 @@ int ioObj::save(const proNode & model, const std::string & filename) {
     proNode* pModel=const_cast<proNode*>(&model)->copy();
     meshUtils::flattenTransforms(*pModel);
 
-    // collect geometry and material:
     string mtlFileName=filename.substr(0,filename.rfind('.')+1)+"mtl";
-    string obj("# "+filename+"\nmtllib "+mtlFileName+"\n\n");
+    FileWriter file;
+    if (!file.open(filename)) {
+        cerr << "ioObj::save() ERROR: " << filename << " file error.\n";
+        delete pModel;
+        return 1;
+    }
+    // the mtl file is referred to relative to the obj file:
+    file << "# " << filename << "\nmtllib " << mtlFileName.substr(mtlFileName.find_last_of("/\\")+1) << "\n\n";
 
-	// traverse scene graph and convert meshes to obj:
+	// traverse scene graph and stream meshes as obj:
     unsigned int vIndexOffset=1;
-    unsigned int tIndexOffset=1;
-    unsigned int nIndexOffset=1;
-	for(proNode::iterator it = pModel; it!=0; ++it)  if(it->type()==proMesh::TYPE) {
-        proMesh & mesh=*dynamic_cast<proMesh*>(*it);
+    vector<proNode*> vNode;
+    pModel->flatten(vNode);
+	for(vector<proNode*>::iterator it=vNode.begin(); it!=vNode.end(); ++it)  if((*it)->typeId()==proNode::TYPE_MESH) {
+        proMesh & mesh=*static_cast<proMesh*>(*it);
         // add material data:
-        if(mesh.name().size())
-            obj+="o "+mesh.name()+'\n';
-        else obj+="o mesh"+mesh.name()+'\n';
-        obj+="usemtl "+mesh.material().name()+'\n';
+        file << (mesh.name().size() ? "o " : "o mesh") << mesh.name() << '\n';
+        file << "usemtl " << mesh.material().name() << '\n';
         // add vertex data:
-        for(unsigned int i=0; i<mesh.coords().size(); ++i)
-            obj+="v "+f2s(mesh.coords()[i][X])+' '+f2s(mesh.coords()[i][Y])+' '+f2s(mesh.coords()[i][Z])+'\n';
-        for(unsigned int i=0; i<mesh.texCoords().size(); ++i)
-            obj+="vt "+f2s(mesh.texCoords()[i][X])+' '+f2s(mesh.texCoords()[i][Y])+'\n';
-        for(unsigned int i=0; i<mesh.vNormals().size(); ++i)
-            obj+="vn "+f2s(mesh.vNormals()[i][X])+' '+f2s(mesh.vNormals()[i][Y])+' '+f2s(mesh.vNormals()[i][Z])+'\n';
+        const vector<vec3f> & vCoord=mesh.coords();
+        for(size_t i=0; i<vCoord.size(); ++i)
+            file << "v " << vCoord[i][X] << ' ' << vCoord[i][Y] << ' ' << vCoord[i][Z] << '\n';
+        const vector<vec2f> & vTexCoord=mesh.texCoords();
+        for(size_t i=0; i<vTexCoord.size(); ++i)
+            file << "vt " << vTexCoord[i][X] << ' ' << vTexCoord[i][Y] << '\n';
+        const vector<vec3f> & vNormal=mesh.vNormals();
+        for(size_t i=0; i<vNormal.size(); ++i)
+            file << "vn " << vNormal[i][X] << ' ' << vNormal[i][Y] << ' ' << vNormal[i][Z] << '\n';
         // add indices:
-        if(mesh.indices().size()>2) {
-            obj+="f";
-            for(unsigned int i=0;i<mesh.indices().size(); ++i) {
-                obj+=" "+i2s(mesh.indices()[i]+vIndexOffset);
-                if(i%3==2) {
-                    if(i+1<mesh.indices().size()) obj+="\nf";
-                    else obj+="\n\n";
-                }
-            }
-        }
-        vIndexOffset+=mesh.coords().size();
-        tIndexOffset+=mesh.texCoords().size();
-        nIndexOffset+=mesh.vNormals().size();
+        const vector<unsigned int> & vIndex=mesh.indices();
+        for(size_t i=0; i+2<vIndex.size(); i+=3)
+            file << "f " << vIndex[i]+vIndexOffset << ' ' << vIndex[i+1]+vIndexOffset << ' ' << vIndex[i+2]+vIndexOffset << '\n';
+        if(vIndex.size()>2) file << '\n';
+        vIndexOffset+=vCoord.size();
     }
-    
-    // save OBJ file:
-    ofstream file(filename.c_str(), std::ios::out);
-    if (!file.good()) {
-        cerr << "ioObj::save() ERROR: " << filename << " file error.\n";
+    delete pModel;
+    if(!file.close()) {
+        cerr << "ioObj::save() ERROR: " << filename << " write error.\n";
         return 1;
     }
-    file << obj << flush;
-    file.close();
     
     // generate and save MTL file:    
-    file.open(mtlFileName.c_str(), std::ios::out);
-    if (!file.good()) {
+    if (!file.open(mtlFileName)) {
         cerr << "ioObj::save() ERROR: " << mtlFileName << " file error.\n";
         return 1;
     }
     MaterialMgr & matTable=MaterialMgr::singleton();
     for(unsigned int i=0; i<matTable.size(); ++i) {
-        file<< "newmtl " << matTable[i].name() << '\n'
-            << "Ns " << matTable[i].shininess() << '\n'
-            << "Ka " << matTable[i].ambientColor()[0] << ' ' << matTable[i].ambientColor()[1]
-                << ' ' << matTable[i].ambientColor()[2] << '\n'
-            << "Kd " << matTable[i].color()[0] << ' ' << matTable[i].color()[1] 
-                << ' ' << matTable[i].color()[2] << '\n'
-            << "Ks " << matTable[i].specularColor()[0] << ' ' << matTable[i].specularColor()[1] 
-                << ' ' << matTable[i].specularColor()[2] << '\n'
-            << "d " << matTable[i].color()[3] << '\n'
+        const proMaterial & mat=matTable[i];
+        file << "newmtl " << mat.name() << '\n'
+            << "Ns " << mat.shininess() << '\n'
+            << "Ka " << mat.ambientColor()[0] << ' ' << mat.ambientColor()[1] << ' ' << mat.ambientColor()[2] << '\n'
+            << "Kd " << mat.color()[0] << ' ' << mat.color()[1] << ' ' << mat.color()[2] << '\n'
+            << "Ks " << mat.specularColor()[0] << ' ' << mat.specularColor()[1] << ' ' << mat.specularColor()[2] << '\n'
+            << "d " << mat.color()[3] << '\n'
             << "illum 2\n";
-        if(matTable[i].texName().size())
-             file << "map_Kd " << matTable[i].texName() << "\n\n" << flush;
-        else file << endl;
+        if(mat.texName().size()) file << "map_Kd " << mat.texName() << '\n';
+        file << '\n';
+    }
+    if(!file.close()) {
+        cerr << "ioObj::save() ERROR: " << mtlFileName << " write error.\n";
+        return 1;
     }
-    
-    file.close();    
     return 0;
 }
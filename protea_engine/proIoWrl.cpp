@@ -3,193 +3,322 @@
 #include <proXml.h>
 #include <proStr.h>
 #include <proScene.h>
+#include <proIo.h>
+#include <proProfiler.h>
 #include <iostream>
-#include <fstream>
+#include <cstring>
+#include <deque>
+#include <map>
 
 using namespace std;
 
-Xml vrmlToX3d (const vector<string> & token) {
-    // prepare x3d root:
-    Xml xs("Scene");
+//--- class VrmlParser ---------------------------------------------
 
-    // split into nodes and transform into Xml:
-    Xml *currSt = &xs;
-    size_t i;
-    string s;
-    for (i=0; i<token.size(); ++i) {
-        if(!token[i].size()) continue;
-        //cout << token[i] << " " << flush;
-        // common operations:
-        if((token[i][0]=='{')&&(i>0)) {
-            Xml newSt;
-            newSt.tag(token[i-1]);
-            if((i>2)&&(token[i-3]=="DEF")) newSt.attr("DEF",token[i-2]);
-            //cout << "\nnewSt: " << newSt.str() << flush;
-            //cout << "curSt: " << currSt->tag() << endl;
-            currSt->append(newSt);
-            currSt=currSt->child(currSt->nChildren()-1).first;
-            //cout << "curSt after: " << currSt->tag() << endl;
-        }
-        else if((token[i]=="USE")&&(i>0)&&(i+1<token.size())) {
-            string name=token[i-1];
-            name[0]=toupper(name[0]);
-            Xml xCh(name);
-            xCh.attr("USE",token[++i]);
-            currSt->append(xCh);
+/// an auxiliary recursive descent parser delivering VRML97 nodes as X3D element events
+/** Nodes become elements, node valued fields become child elements, all other fields become
+ attributes. Attribute values refer directly into the parsed buffer, array brackets and string
+ quotes are excluded. Only values containing comments or escape sequences are copied. The events
+ of a toplevel node are delivered once it is complete, as a VRML node may define fields after its
+ child nodes. PROTO, EXTERNPROTO, ROUTE and Script statements are skipped. */
+class VrmlParser : public XmlParser::Source {
+public:
+    /// constructor
+    VrmlParser() : mp_sink(0), mp_pos(0), mp_end(0) { }
+    /// parses n characters at pData and delivers the resulting events to sink
+    virtual void parse(const char * pData, size_t n, XmlParser & sink);
+protected:
+    /// an auxiliary struct storing a recorded element event
+    struct Event {
+        /// constructor
+        Event(const XmlStr & elemTag, bool isStart) : tag(elemTag), attr(0), nAttr(0), start(isStart) { }
+        /// element tag
+        XmlStr tag;
+        /// index of the first attribute key in mv_attr
+        size_t attr;
+        /// number of attribute key/value pairs
+        size_t nAttr;
+        /// stores whether this is the start of an element
+        bool start;
+    };
+
+    /// returns the next token and advances, an empty range at the end of the data
+    XmlStr next();
+    /// returns the next token without advancing
+    XmlStr peek() { const char * pPrev=mp_pos; XmlStr token=next(); mp_pos=pPrev; return token; }
+    /// skips a bracketed block, the opening bracket has already been read
+    void skipBlock();
+    /// parses a node statement including DEF, USE and NULL
+    void parseNodeStatement();
+    /// parses the fields of a node, the node type and its DEF name have already been read
+    void parseNode(const XmlStr & type, const XmlStr & def);
+    /// parses the value of field name
+    void parseField(const XmlStr & name);
+    /// adds an attribute to the element currently being parsed
+    void attr(const XmlStr & key, const XmlStr & value) { mv_stack.push_back(key); mv_stack.push_back(value); }
+    /// returns [pBegin,pValueEnd) as attribute value, copied without comments if it contains any
+    XmlStr value(const char * pBegin, const char * pValueEnd);
+    /// returns the content of the quoted string token, copied if it contains escape sequences
+    XmlStr unquote(const XmlStr & token);
+    /// delivers the recorded events to the sink
+    void flush();
+    /// returns a range of a persistent copy of s
+    XmlStr store(const string & s) {
+        md_str.push_back(s);
+        return XmlStr(md_str.back());
+    }
+
+    /// receives the events
+    XmlParser * mp_sink;
+    /// current parse position
+    const char * mp_pos;
+    /// end of the data
+    const char * mp_end;
+    /// recorded events of the current toplevel node
+    vector<Event> mv_event;
+    /// attribute key/value pairs of the recorded events
+    vector<XmlStr> mv_attr;
+    /// attribute key/value pairs of the currently open nodes
+    vector<XmlStr> mv_stack;
+    /// node types of DEF names, used as tags for USE
+    map<string,XmlStr> mm_defType;
+    /// persistent copies of attribute values, referred to by the sink
+    deque<string> md_str;
+};
+
+static const XmlStr s_scene("Scene",5), s_group("Group",5), s_def("DEF",3), s_use("USE",3);
+
+static inline bool isSeparator(char ch) {
+    return (ch==' ')||(ch==',')||(ch=='\t')||(ch=='\n')||(ch=='\r');
+}
+
+static inline bool isDelimiter(char ch) {
+    return isSeparator(ch)||(ch=='#')||(ch=='"')||(ch=='{')||(ch=='}')||(ch=='[')||(ch==']');
+}
+
+/// returns true if token t starts a node statement
+static inline bool isNodeStart(const XmlStr & t) {
+    if(t.empty()) return false;
+    char ch=t.data()[0];
+    if(!(((ch>='A')&&(ch<='Z'))||((ch>='a')&&(ch<='z'))||(ch=='_'))) return false;
+    return (t!="TRUE")&&(t!="FALSE")&&(t!="IS");
+}
+
+/// returns true if token t is a number
+static inline bool isNumber(const XmlStr & t) {
+    if(t.empty()) return false;
+    char ch=t.data()[0];
+    return ((ch>='0')&&(ch<='9'))||(ch=='-')||(ch=='+')||(ch=='.');
+}
+
+XmlStr VrmlParser::next() {
+    while(mp_pos<mp_end) {
+        if(isSeparator(*mp_pos)) ++mp_pos;
+        else if(*mp_pos=='#') {
+            mp_pos=static_cast<const char*>(memchr(mp_pos,'\n',mp_end-mp_pos));
+            if(!mp_pos) mp_pos=mp_end;
         }
-        else if((token[i]=="FALSE")||(token[i]=="TRUE"))
-            currSt->attr(token[i-1],token[i]);
-        
-        else if(token[i][0]=='}') {
-            if((currSt->tag()=="TextureCoordinate")||(currSt->tag()=="Coordinate"))
-                currSt->attr("point",s);
-            else if(currSt->tag()=="Color")
-                currSt->attr("color",s);
-            else if(currSt->tag()=="Normal")
-                currSt->attr("vector",s);
-            s.erase();
-            currSt=currSt->parent();
-            //cout << "curSt back: " << currSt->tag() << endl;
+        else break;
+    }
+    if(mp_pos==mp_end) return XmlStr();
+    const char * pToken=mp_pos;
+    switch(*mp_pos) {
+    case '{': case '}': case '[': case ']':
+        ++mp_pos;
+        break;
+    case '"':
+        for(++mp_pos; (mp_pos<mp_end)&&(*mp_pos!='"'); ++mp_pos)
+            if((*mp_pos=='\\')&&(mp_pos+1<mp_end)) ++mp_pos;
+        if(mp_pos<mp_end) ++mp_pos;
+        break;
+    default:
+        while((mp_pos<mp_end)&&!isDelimiter(*mp_pos)) ++mp_pos;
+    }
+    return XmlStr(pToken,mp_pos-pToken);
+}
+
+void VrmlParser::skipBlock() {
+    unsigned int depth=1;
+    for(XmlStr t=next(); !t.empty(); t=next()) {
+        if((t=="{")||(t=="[")) ++depth;
+        else if(((t=="}")||(t=="]"))&&!--depth) return;
+    }
+}
+
+XmlStr VrmlParser::value(const char * pBegin, const char * pValueEnd) {
+    if(!memchr(pBegin,'#',pValueEnd-pBegin)) return XmlStr(pBegin,pValueEnd-pBegin);
+    string s;
+    while(pBegin<pValueEnd) {
+        const char * pComment=static_cast<const char*>(memchr(pBegin,'#',pValueEnd-pBegin));
+        if(!pComment) pComment=pValueEnd;
+        s.append(pBegin,pComment);
+        s+=' ';
+        pBegin=pComment<pValueEnd ? static_cast<const char*>(memchr(pComment,'\n',pValueEnd-pComment)) : pValueEnd;
+        if(!pBegin) pBegin=pValueEnd;
+    }
+    return store(s);
+}
+
+XmlStr VrmlParser::unquote(const XmlStr & token) {
+    const char * pBegin=token.data()+1, * pTokenEnd=token.end();
+    if((pTokenEnd>pBegin)&&(pTokenEnd[-1]=='"')) --pTokenEnd;
+    if(!memchr(pBegin,'\\',pTokenEnd-pBegin)) return XmlStr(pBegin,pTokenEnd-pBegin);
+    string s;
+    for(const char * pCh=pBegin; pCh<pTokenEnd; ++pCh) {
+        if((*pCh=='\\')&&(pCh+1<pTokenEnd)) ++pCh;
+        s+=*pCh;
+    }
+    return store(s);
+}
+
+void VrmlParser::parse(const char * pData, size_t n, XmlParser & sink) {
+    mp_sink=&sink;
+    mp_pos=pData;
+    mp_end=pData+n;
+    startElement(sink,s_scene,0,0);
+    for(XmlStr t=peek(); !t.empty(); t=peek()) {
+        if(t=="PROTO") { // PROTO name [ interface ] { body }
+            next(); next();
+            if(next()=="[") skipBlock();
+            if(next()=="{") skipBlock();
         }
-        else if(token[i]=="DEF") ++i;  // skip also following id
-        else if((i<token.size()-2)&&(token[i+1][0]=='{')) { } // skip subnode tags
-        // special operations for recognized nodes:
-        else if(currSt->tag()=="IndexedFaceSet") {
-            if((token[i]=="coordIndex")||(token[i]=="texCoordIndex")
-               ||(token[i]=="colorIndex")||(token[i]=="normalIndex")) {
-                const string & attribute=token[i++];
-                string value;
-                while(token[++i][0]!=']') value+=" "+token[i];
-                currSt->attr(attribute,value);
-            }
-            else if(token[i]=="creaseAngle") {
-                currSt->attr(token[i],token[i+1]);
-                i++;
-            }
+        else if(t=="EXTERNPROTO") { // EXTERNPROTO name [ interface ] url
+            next(); next();
+            if(next()=="[") skipBlock();
+            if(next()=="[") skipBlock();
         }
-        else if(currSt->tag()=="ElevationGrid") {
-            if((token[i]=="height")) {
-                const string & attribute=token[i++];
-                string value;
-                while(token[++i][0]!=']') value+=" "+token[i];
-                currSt->attr(attribute,value);
-            }
-            else if((token[i]=="xDimension")||(token[i]=="xSpacing")||(token[i]=="zDimension")||(token[i]=="zSpacing")) {
-                currSt->attr(token[i],token[i+1]);
-                i++;
-            }
+        else if(t=="ROUTE") { // ROUTE node.event TO node.event
+            next(); next(); next(); next();
         }
-        else if(currSt->tag()=="TextureTransform") {
-            if(token[i]=="rotation") {
-                currSt->attr(token[i],token[i+1]);
-                i++;
-            }
-            else if((token[i]=="scale")||(token[i]=="center")||(token[i]=="translation")) {
-                currSt->attr(token[i],token[i+1]+' '+token[i+2]);
-                i+=2;
-            }
+        else if(isNodeStart(t)) {
+            parseNodeStatement();
+            flush();
         }
-		else if((currSt->tag()=="LOD")) {
-            if(token[i]=="range") {
-                while((token[i][0]!='[')&&(i<token.size())) i++;
-                string s;
-                while((token[++i][0]!=']')&&(i<token.size())) s+=token[i]+" ";
-                currSt->attr("range",trim(s));
-            }
-            else if(token[i]=="center") {
-                currSt->attr(token[i],token[i+1]+' '+token[i+2]+' '+token[i+3]);
-                i+=3;
-            }
-		}
-        else if((token[i][0]=='[')||(token[i][0]==']')
-                ||(token[i]=="point")||(token[i]=="color")
-                ||(token[i]=="vector")) { }  // skip
-        else if((currSt->tag()=="TextureCoordinate")||(currSt->tag()=="Coordinate")
-                ||(currSt->tag()=="Color")||(currSt->tag()=="Normal"))
-            s+=" "+token[i];
-        else if((token[i]=="diffuseColor")||(token[i]=="emissiveColor")||(token[i]=="specularColor")) {
-            if(i+3<token.size()) {
-                currSt->attr(token[i],token[i+1]+' '+token[i+2]+' '+token[i+3]);
-                i+=3;
-            }
+        else if((next()=="{")||(t=="[")) skipBlock(); // stray block
+    }
+    endElement(sink,s_scene);
+    mp_sink=0;
+}
+
+void VrmlParser::parseNodeStatement() {
+    XmlStr t=next(), def;
+    if(t=="NULL") return;
+    if(t=="USE") {
+        XmlStr name=next();
+        map<string,XmlStr>::const_iterator it=mm_defType.find(name.str());
+        mv_event.push_back(Event(it!=mm_defType.end() ? it->second : s_group, true));
+        mv_event.back().attr=mv_attr.size();
+        mv_event.back().nAttr=1;
+        mv_attr.push_back(s_use);
+        mv_attr.push_back(name);
+        mv_event.push_back(Event(mv_event.back().tag, false));
+        return;
+    }
+    if(t=="DEF") {
+        def=next();
+        t=next();
+        mm_defType[def.str()]=t;
+    }
+    if(peek()!="{") return;
+    next();
+    if(t=="Script") skipBlock();
+    else parseNode(t,def);
+}
+
+void VrmlParser::parseNode(const XmlStr & type, const XmlStr & def) {
+    size_t nEvent=mv_event.size(), nStack=mv_stack.size();
+    mv_event.push_back(Event(type,true));
+    if(def.size()) {
+        attr(s_def,def);
+    }
+    for(XmlStr t=next(); !t.empty()&&(t!="}"); t=next()) {
+        if((t=="{")||(t=="[")) skipBlock();
+        else if(t!="]") parseField(t);
+    }
+    // the attributes of child nodes have already been moved, only the ones of this node remain:
+    mv_event[nEvent].attr=mv_attr.size();
+    mv_event[nEvent].nAttr=(mv_stack.size()-nStack)/2;
+    mv_attr.insert(mv_attr.end(), mv_stack.begin()+nStack, mv_stack.end());
+    mv_stack.resize(nStack);
+    mv_event.push_back(Event(type,false));
+}
+
+void VrmlParser::parseField(const XmlStr & name) {
+    XmlStr t=peek();
+    if(t=="IS") { // PROTO interface reference
+        next(); next();
+        return;
+    }
+    if(isNodeStart(t)) { // SFNode
+        parseNodeStatement();
+        return;
+    }
+    if(t=="[") {
+        next();
+        t=peek();
+        if(isNodeStart(t)) { // MFNode
+            for(; isNodeStart(t); t=peek()) parseNodeStatement();
+            if(t=="]") next();
+            else if(t.size()) skipBlock();
         }
-        else if((token[i]=="transparency")||(token[i]=="shininess")||(token[i]=="ambientIntensity")
-                ||(token[i]=="repeatS")||(token[i]=="repeatT")||(token[i]=="USE")) {
-            currSt->attr(token[i],token[i+1]);
-            i++;
+        else if(t.size()&&(t.data()[0]=='"')) { // MFString, only the first one is used
+            attr(name,unquote(next()));
+            skipBlock();
         }
-        else if(token[i]=="url") {
-            string url;
-            if(token[i+1][0]=='[') {
-                url=token[i+2].substr(1,token[i+2].size()-2); // strip quotation marks
-                i+=3;
-            }
-            else {
-                url=token[i+1].substr(1,token[i+1].size()-2); // strip quotation marks
-                i++;
+        else { // numeric arrays are passed as they are:
+            const char * pBegin=mp_pos, * pClose=static_cast<const char*>(memchr(mp_pos,']',mp_end-mp_pos));
+            if(pClose&&!memchr(pBegin,'#',pClose-pBegin)) mp_pos=pClose+1;
+            else { // comments may contain brackets
+                skipBlock();
+                pClose=((mp_pos>pBegin)&&(mp_pos[-1]==']')) ? mp_pos-1 : mp_pos;
             }
-            if(url.find("file://")<url.size()) url=url.substr(url.find("file://")+7);
-            currSt->attr("url",url);
-        }
-        else if(((token[i]=="translation")||(token[i]=="scale")||(token[i]=="center"))&&((i+3)<token.size())) {
-            currSt->attr(token[i],token[i+1]+" "+token[i+2]+" "+token[i+3]);
-            i+=3;
-        }
-        else if(((token[i]=="rotation")||(token[i]=="scaleOrientation"))&&((i+4)<token.size())) {
-            currSt->attr(token[i],token[i+1]+" "+token[i+2]+" "+token[i+3]+" "+token[i+4]);
-            i+=4;
+            attr(name,value(pBegin,pClose));
         }
-        else continue;
+        return;
+    }
+    if(t.empty()||(t=="{")||(t=="}")||(t=="]")) return;
+    if(t.data()[0]=='"') attr(name,unquote(next()));
+    else if(!isNumber(t)) attr(name,next()); // TRUE or FALSE
+    else { // numeric SF values:
+        const char * pBegin=t.data(), * pValueEnd=t.end();
+        for(next(); isNumber(peek()); ) pValueEnd=next().end();
+        attr(name,value(pBegin,pValueEnd));
     }
-    return xs;
-}
-
-static void tokenize (std::string s, vector<string> & token) {
-    s=replaceAll(s.substr(0,s.find('#')),"]"," ] ");   // strip comments and add a leading space before brackets which 3ds forgets
-    s=replaceAll(s,"["," [ ");  // there are lots of lazy exporters that do not stick to the whitespace rule...
-    s=replaceAll(s,"{"," { ");
-    s=replaceAll(s,"}"," } ");
-    split(s,token,", \t\n\015"); // tokenize, remove commata
 }
 
-Xml vrmlToX3d (const string & s) {
-    vector<string> vToken;
-    size_t pos=0;
-    while(pos<s.size()) {
-        size_t lineEnd=s.find('\n',pos);
-        tokenize(s.substr(pos,lineEnd-pos),vToken);
-        pos=lineEnd+1;
+void VrmlParser::flush() {
+    for(vector<Event>::const_iterator it=mv_event.begin(); it!=mv_event.end(); ++it) {
+        if(it->start) startElement(*mp_sink, it->tag, it->nAttr ? &mv_attr[it->attr] : 0, it->nAttr);
+        else endElement(*mp_sink, it->tag);
     }
-    return vrmlToX3d(vToken);
+    mv_event.clear();
+    mv_attr.clear();
 }
 
-
+//--- class ioWrl --------------------------------------------------
 
 proNode* ioWrl::load(const std::string & filename) {
-    ifstream file(filename.c_str(), std::ios::in);
-    if (!file.good()) {
-        cerr << "ioWrl ERROR: error in file "<< filename << " or file not found.\n";
-        return 0;
+    MappedFile file;
+    {
+        LoadStage stage("readFile");
+        if(!file.open(filename)) {
+            cerr << "ioWrl ERROR: error in file "<< filename << " or file not found.\n";
+            return 0;
+        }
+        stage.bytes(file.size());
     }
-    string line;
 
-    std::getline(file,line); // interpret first line
+    // interpret first line:
+    const char * pLineEnd=static_cast<const char*>(memchr(file.data(),'\n',file.size()));
+    string line(file.data(), pLineEnd ? pLineEnd : file.data()+file.size());
     float vrmlVersion=-1;
     if(line.size()>7) vrmlVersion=s2f(line.substr(7));
     else {
         cerr << "ioWrl ERROR: file "<< filename << " has corrupt VRML header.\n";
-        file.close();
         return 0;
     }
     if(vrmlVersion < 2.0f)
         cerr << "ioWrl WARNING: VRML version "<< vrmlVersion << " not officially supported.\n";
-	
-    vector<string> vToken;
-    while(!file.eof()) {
-		std::getline(file,line);
-        tokenize(line,vToken);
-    }
-    file.close();
 
-	return proNode::interpret(vrmlToX3d(vToken));
+    VrmlParser parser;
+    return proNode::interpret(file.data(), file.size(), &parser);
 }
@@ -106,35 +106,26 @@ proMaterial::proMaterial(const Xml & xs) {
 proMaterial::proMaterial(const proMaterial & source) {
     m_data=source.m_data;
     if(m_data!=&proMatData::s_default)
-        ++(m_data->m_refCount);
+        io::atomicAdd(m_data->m_refCount, 1); // materials are shared by concurrent loaders
 }
 
 proMaterial::~proMaterial() {
-    if(m_data!=&proMatData::s_default) {
-        --(m_data->m_refCount);
-        if(!m_data->m_refCount)
-            delete m_data;
-    }
+    if((m_data!=&proMatData::s_default)&&!io::atomicAdd(m_data->m_refCount, -1))
+        delete m_data;
 }
 
 const proMaterial & proMaterial::operator=(const proMaterial & source) {
-    if(m_data!=&proMatData::s_default) {
-        --(m_data->m_refCount);
-        if(!m_data->m_refCount)
-            delete m_data;
-    }
+    if(source.m_data!=&proMatData::s_default)
+        io::atomicAdd(source.m_data->m_refCount, 1);
+    if((m_data!=&proMatData::s_default)&&!io::atomicAdd(m_data->m_refCount, -1))
+        delete m_data;
     m_data=source.m_data;
-    if(m_data!=&proMatData::s_default)
-        ++(m_data->m_refCount);
     return *this;
 }
 
 void proMaterial::set(const proMaterial & source) {
-    if(m_data!=&proMatData::s_default) {
-        --(m_data->m_refCount);
-        if(!m_data->m_refCount)
-            delete m_data;
-    }
+    if((m_data!=&proMatData::s_default)&&!io::atomicAdd(m_data->m_refCount, -1))
+        delete m_data;
     m_data=new proMatData(*source.m_data);
     m_data->m_refCount=1;
 }
@@ -218,69 +209,77 @@ unsigned int proMaterial::loadTexture(bool reload) {
 MaterialMgr* MaterialMgr::sp_instance=0;
 
 void MaterialMgr::interpret(const Xml & xs) {
+    MutexLock lock(m_mutex);
     for(unsigned int i=0; i<xs.nChildren(); ++i) 
         if(xs.child(i).first)
             if((xs.child(i).first->tag()=="Appearance")||(xs.child(i).first->tag()=="Material")) {
 				bool found = false;
-				for(unsigned int j=0; j<m_vMat.size(); ++j) {
+				for(unsigned int j=0; j<md_mat.size(); ++j) {
 					string matName=xs.child(i).first->attr("DEF");
-					if(m_vMat[j].name()==matName) {
-						m_vMat[j].set(*xs.child(i).first);
+					if(md_mat[j].name()==matName) {
+						md_mat[j].set(*xs.child(i).first);
 						found=true;
 						break;
 					}
 				}
-                if(!found) m_vMat.push_back(*xs.child(i).first);
+                if(!found) md_mat.push_back(*xs.child(i).first);
 			}
 }
 
 Xml MaterialMgr::xml() const {
+    MutexLock lock(m_mutex);
     Xml xs("Materials");
-    for(unsigned int i=0; i<m_vMat.size(); ++i)
-        xs.append(m_vMat[i].xml());
+    for(unsigned int i=0; i<md_mat.size(); ++i)
+        xs.append(md_mat[i].xml());
     return xs;
 }
 
-size_t MaterialMgr::set(const proMaterial & mat) { 
-    for(unsigned int i=0; i<m_vMat.size(); ++i)
-        if(m_vMat[i].name()==mat.name()) {
-            m_vMat[i]=mat;
+size_t MaterialMgr::set(const proMaterial & mat) {
+    MutexLock lock(m_mutex);
+    for(unsigned int i=0; i<md_mat.size(); ++i)
+        if(md_mat[i].name()==mat.name()) {
+            md_mat[i]=mat;
             return i;
         }
-    m_vMat.push_back(mat); 
-    return m_vMat.size()-1;
+    md_mat.push_back(mat); 
+    return md_mat.size()-1;
 }
  
-size_t MaterialMgr::add(const proMaterial & mat) { 
+size_t MaterialMgr::add(const proMaterial & mat) {
+    MutexLock lock(m_mutex);
     if(!mat.name().size()) return addAnonymous(mat);
-    for(unsigned int i=0; i<m_vMat.size(); ++i)
-        if(m_vMat[i].name()==mat.name()) return i;
-    m_vMat.push_back(mat); 
-    return m_vMat.size()-1;
+    for(unsigned int i=0; i<md_mat.size(); ++i)
+        if(md_mat[i].name()==mat.name()) return i;
+    md_mat.push_back(mat); 
+    return md_mat.size()-1;
 }
  
-size_t MaterialMgr::addAnonymous(const proMaterial & mat) { 
-    for(unsigned int i=0; i<m_vMat.size(); ++i)
-        if(m_vMat[i]==mat) return i;
-    m_vMat.push_back(mat); 
-    m_vMat.back().name("mat_"+i2s(m_counter++));
-    return m_vMat.size()-1;
+size_t MaterialMgr::addAnonymous(const proMaterial & mat) {
+    MutexLock lock(m_mutex);
+    for(unsigned int i=0; i<md_mat.size(); ++i)
+        if(md_mat[i]==mat) return i;
+    md_mat.push_back(mat); 
+    md_mat.back().name("mat_"+i2s(m_counter++));
+    return md_mat.size()-1;
 }
  
 proMaterial & MaterialMgr::operator[](const string & s) {
-    for(unsigned int i=0; i<m_vMat.size(); ++i)
-        if(m_vMat[i].name()==s) return m_vMat[i];
-    return m_vMat[0];
+    MutexLock lock(m_mutex);
+    for(unsigned int i=0; i<md_mat.size(); ++i)
+        if(md_mat[i].name()==s) return md_mat[i];
+    return md_mat[0];
 }
 
 const proMaterial & MaterialMgr::operator[](const string & s) const {
-    for(unsigned int i=0; i<m_vMat.size(); ++i)
-        if(m_vMat[i].name()==s) return m_vMat[i];
-    return m_vMat[0];
+    MutexLock lock(m_mutex);
+    for(unsigned int i=0; i<md_mat.size(); ++i)
+        if(md_mat[i].name()==s) return md_mat[i];
+    return md_mat[0];
 }
 
 unsigned int MaterialMgr::getId(const string & s) const {
-    for(unsigned int i=0; i<m_vMat.size(); ++i)
-        if(m_vMat[i].name()==s) return i;
+    MutexLock lock(m_mutex);
+    for(unsigned int i=0; i<md_mat.size(); ++i)
+        if(md_mat[i].name()==s) return i;
     return 0;
 }
@@ -35,6 +35,8 @@
 
 #include "proXml.h"
 #include "proMath.h"
+#include "proIo.h"
+#include <deque>
 
 //--- class proMatData ---------------------------------------------
 
@@ -77,8 +79,8 @@ protected:
     /// stores texture transparency
     bool m_texTransparent;
 
-    /// stores reference counter
-    unsigned int m_refCount;
+    /// stores reference counter, modified atomically
+    volatile unsigned int m_refCount;
 
     /// global default material in case no other is set
     static proMatData s_default;
@@ -191,7 +193,8 @@ protected:
 
 //--- class MaterialMgr --------------------------------------------
 /// singleton class managing material definitions
-/** Materials currently cannot be erased individually, because this may screw up the current access system based on direct array indices. */
+/** Materials currently cannot be erased individually, because this may screw up the current access system based on direct array indices. 
+ All methods are thread-safe, and references to entries remain valid when further materials are added. */
 class MaterialMgr {
 public:
     /// returns singleton instance
@@ -202,9 +205,9 @@ public:
         if(!sp_instance) sp_instance=new MaterialMgr; return sp_instance; }
         
     /// clears material table
-    void clear() { m_vMat.clear(); m_vMat.push_back(proMaterial()); }
+    void clear() { MutexLock lock(m_mutex); md_mat.clear(); md_mat.push_back(proMaterial()); }
     /// returns number of material entries
-    size_t size() const { return m_vMat.size(); }
+    size_t size() const { MutexLock lock(m_mutex); return md_mat.size(); }
 
     /// reads multiple material definitions from a <Materials/> xml table
     void interpret(const Xml & xs);
@@ -231,25 +234,27 @@ public:
     /// returns material by its name or the default material if name is not found, const
     const proMaterial & operator[](const std::string & s) const;
     /// returns material by its numerical id
-    proMaterial & operator[](size_t n) { return m_vMat[(n<m_vMat.size()) ? n : 0]; }
+    proMaterial & operator[](size_t n) { MutexLock lock(m_mutex); return md_mat[(n<md_mat.size()) ? n : 0]; }
     /// returns material by its numerical id, const
-    const proMaterial & operator[](size_t n) const { return m_vMat[(n<m_vMat.size()) ? n : 0]; }
+    const proMaterial & operator[](size_t n) const { MutexLock lock(m_mutex); return md_mat[(n<md_mat.size()) ? n : 0]; }
 	/// returns default material
-    const proMaterial & defaultMat() const  { return m_vMat[0]; }
+    const proMaterial & defaultMat() const  { MutexLock lock(m_mutex); return md_mat[0]; }
     /// returns material id by its name or the default material's id (0) if name is not found
     unsigned int getId(const std::string & s) const;
 	/// reloads all textures and further resources
-	void reload() {
-		for(unsigned int i=0; i<m_vMat.size(); ++i) m_vMat[i].loadTexture(true); }
+	void reload() { MutexLock lock(m_mutex);
+		for(unsigned int i=0; i<md_mat.size(); ++i) md_mat[i].loadTexture(true); }
 protected:    
     /// constructor defining a default material
-    MaterialMgr() : m_counter(0) { m_vMat.push_back(proMaterial()); }
+    MaterialMgr() : m_counter(0) { md_mat.push_back(proMaterial()); }
     /// pointer to singleton instance
     static MaterialMgr* sp_instance;
     /// table for storing material data
-    std::vector<proMaterial> m_vMat;
+    std::deque<proMaterial> md_mat;
     /// counter for generating material names
     unsigned int m_counter;
+    /// lock serializing the access of concurrent loaders
+    mutable Mutex m_mutex;
 };
 
 #endif // _PRO_MATERIAL_H
@@ -2,12 +2,20 @@
 
 #include <sys/timeb.h>
 #include <cstdlib>
+#include <cstring>
 #include <cmath>
+#include <cfloat>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 
 #include "proMath.h"
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP>=1))
+#  define _PRO_SSE
+#  include <xmmintrin.h>
+#endif
+
 using namespace std;
 
 //--- functions and templates --------------------------------------
@@ -733,6 +741,97 @@ float rnd::getf() {
     return (float)((float)rand()/(float)RAND_MAX);
 }
 
+//--- matrix kernels -----------------------------------------------
+// The SSE kernels keep the summation order of the scalar code, results are therefore identical.
+
+/// multiplies the 4x4 column major matrices a and b, out may be identical to a or b
+static void mat4Mul(const float * a, const float * b, float * out) {
+#ifdef _PRO_SSE
+	__m128 a0=_mm_loadu_ps(a), a1=_mm_loadu_ps(a+4), a2=_mm_loadu_ps(a+8), a3=_mm_loadu_ps(a+12);
+	for(unsigned int j=0; j<16; j+=4) {
+		__m128 col = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[j])), _mm_mul_ps(a1, _mm_set1_ps(b[j+1]))),
+			_mm_mul_ps(a2, _mm_set1_ps(b[j+2]))), _mm_mul_ps(a3, _mm_set1_ps(b[j+3])));
+		_mm_storeu_ps(out+j, col);
+	}
+#else
+	float bCopy[16];
+	if(b==out) {
+		memcpy(bCopy, b, 16*sizeof(float));
+		b=bCopy;
+	}
+	for(unsigned int i=0; i<4; ++i) { // row i of the result only depends on row i of a
+		float row[4]={ a[i], a[i+4], a[i+8], a[i+12] };
+		for(unsigned int j=0; j<16; j+=4)
+			out[i+j]=row[0]*b[j] + row[1]*b[j+1] + row[2]*b[j+2] + row[3]*b[j+3];
+	}
+#endif
+}
+
+/// transforms n coherent coordinate triples in place by the column major matrix m
+static void mat4TransformCoords(const float * m, float * p, size_t n) {
+	size_t i=0;
+#ifdef _PRO_SSE
+	const __m128 m0=_mm_set1_ps(m[0]), m1=_mm_set1_ps(m[1]), m2=_mm_set1_ps(m[2]);
+	const __m128 m4=_mm_set1_ps(m[4]), m5=_mm_set1_ps(m[5]), m6=_mm_set1_ps(m[6]);
+	const __m128 m8=_mm_set1_ps(m[8]), m9=_mm_set1_ps(m[9]), m10=_mm_set1_ps(m[10]);
+	const __m128 m12=_mm_set1_ps(m[12]), m13=_mm_set1_ps(m[13]), m14=_mm_set1_ps(m[14]);
+	for(; i+4<=n; i+=4, p+=12) {
+		// deinterleave 4 vertices x0y0z0x1 y1z1x2y2 z2x3y3z3 into x, y and z vectors:
+		__m128 a=_mm_loadu_ps(p), b=_mm_loadu_ps(p+4), c=_mm_loadu_ps(p+8);
+		__m128 x=_mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,1,2,2)), _MM_SHUFFLE(2,0,3,0));
+		__m128 y=_mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0));
+		__m128 z=_mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3,3,0,0)), _MM_SHUFFLE(2,0,2,0));
+		__m128 tx=_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m0,x), _mm_mul_ps(m4,y)), _mm_mul_ps(m8,z)), m12);
+		__m128 ty=_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m1,x), _mm_mul_ps(m5,y)), _mm_mul_ps(m9,z)), m13);
+		__m128 tz=_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m2,x), _mm_mul_ps(m6,y)), _mm_mul_ps(m10,z)), m14);
+		// interleave again:
+		_mm_storeu_ps(p, _mm_shuffle_ps(_mm_shuffle_ps(tx, ty, _MM_SHUFFLE(0,0,0,0)), _mm_shuffle_ps(tz, tx, _MM_SHUFFLE(1,1,0,0)), _MM_SHUFFLE(2,0,2,0)));
+		_mm_storeu_ps(p+4, _mm_shuffle_ps(_mm_shuffle_ps(ty, tz, _MM_SHUFFLE(1,1,1,1)), _mm_shuffle_ps(tx, ty, _MM_SHUFFLE(2,2,2,2)), _MM_SHUFFLE(2,0,2,0)));
+		_mm_storeu_ps(p+8, _mm_shuffle_ps(_mm_shuffle_ps(tz, tx, _MM_SHUFFLE(3,3,2,2)), _mm_shuffle_ps(ty, tz, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(2,0,2,0)));
+	}
+#endif
+	for(; i<n; ++i, p+=3) {
+		float x=m[0]*p[0] + m[4]*p[1] + m[8] *p[2] + m[12];
+		float y=m[1]*p[0] + m[5]*p[1] + m[9] *p[2] + m[13];
+		float z=m[2]*p[0] + m[6]*p[1] + m[10]*p[2] + m[14];
+		p[0]=x; p[1]=y; p[2]=z;
+	}
+}
+
+/// transforms n coherent normals in place by the upper 3x3 part of the column major matrix m and renormalizes them
+static void mat4TransformNormals(const float * m, float * p, size_t n) {
+	size_t i=0;
+#ifdef _PRO_SSE
+	const __m128 m0=_mm_set1_ps(m[0]), m1=_mm_set1_ps(m[1]), m2=_mm_set1_ps(m[2]);
+	const __m128 m4=_mm_set1_ps(m[4]), m5=_mm_set1_ps(m[5]), m6=_mm_set1_ps(m[6]);
+	const __m128 m8=_mm_set1_ps(m[8]), m9=_mm_set1_ps(m[9]), m10=_mm_set1_ps(m[10]);
+	const __m128 one=_mm_set1_ps(1.0f);
+	for(; i+4<=n; i+=4, p+=12) {
+		__m128 a=_mm_loadu_ps(p), b=_mm_loadu_ps(p+4), c=_mm_loadu_ps(p+8);
+		__m128 x=_mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,1,2,2)), _MM_SHUFFLE(2,0,3,0));
+		__m128 y=_mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0));
+		__m128 z=_mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3,3,0,0)), _MM_SHUFFLE(2,0,2,0));
+		__m128 tx=_mm_add_ps(_mm_add_ps(_mm_mul_ps(m0,x), _mm_mul_ps(m4,y)), _mm_mul_ps(m8,z));
+		__m128 ty=_mm_add_ps(_mm_add_ps(_mm_mul_ps(m1,x), _mm_mul_ps(m5,y)), _mm_mul_ps(m9,z));
+		__m128 tz=_mm_add_ps(_mm_add_ps(_mm_mul_ps(m2,x), _mm_mul_ps(m6,y)), _mm_mul_ps(m10,z));
+		__m128 f=_mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx,tx), _mm_mul_ps(ty,ty)), _mm_mul_ps(tz,tz))));
+		tx=_mm_mul_ps(tx,f);
+		ty=_mm_mul_ps(ty,f);
+		tz=_mm_mul_ps(tz,f);
+		_mm_storeu_ps(p, _mm_shuffle_ps(_mm_shuffle_ps(tx, ty, _MM_SHUFFLE(0,0,0,0)), _mm_shuffle_ps(tz, tx, _MM_SHUFFLE(1,1,0,0)), _MM_SHUFFLE(2,0,2,0)));
+		_mm_storeu_ps(p+4, _mm_shuffle_ps(_mm_shuffle_ps(ty, tz, _MM_SHUFFLE(1,1,1,1)), _mm_shuffle_ps(tx, ty, _MM_SHUFFLE(2,2,2,2)), _MM_SHUFFLE(2,0,2,0)));
+		_mm_storeu_ps(p+8, _mm_shuffle_ps(_mm_shuffle_ps(tz, tx, _MM_SHUFFLE(3,3,2,2)), _mm_shuffle_ps(ty, tz, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(2,0,2,0)));
+	}
+#endif
+	for(; i<n; ++i, p+=3) {
+		float x=m[0]*p[0] + m[4]*p[1] + m[8] *p[2];
+		float y=m[1]*p[0] + m[5]*p[1] + m[9] *p[2];
+		float z=m[2]*p[0] + m[6]*p[1] + m[10]*p[2];
+		float f=1.0f/sqrt(x*x+y*y+z*z);
+		p[0]=x*f; p[1]=y*f; p[2]=z*f;
+	}
+}
+
 //--- class mat4f ----------------------------------------------
 
 mat4f::mat4f(const mat4f & source) {
@@ -779,30 +878,16 @@ const mat4f & mat4f::operator=(const mat4f & source) {
     return *this;
 }
 
-const mat4f mat4f::operator*(const mat4f & m) const {
+const mat4f mat4f::operator*(const mat4f & m2) const {
     mat4f res;
-    res[0] =(*this)[0]*m[0] + (*this)[4]*m[1] + (*this)[8]*m[2]  + (*this)[12]*m[3];
-    res[4] =(*this)[0]*m[4] + (*this)[4]*m[5] + (*this)[8]*m[6]  + (*this)[12]*m[7];
-    res[8] =(*this)[0]*m[8] + (*this)[4]*m[9] + (*this)[8]*m[10] + (*this)[12]*m[11];
-    res[12]=(*this)[0]*m[12]+ (*this)[4]*m[13]+ (*this)[8]*m[14] + (*this)[12]*m[15];
-
-    res[1] =(*this)[1]*m[0] + (*this)[5]*m[1] + (*this)[9]*m[2]  + (*this)[13]*m[3];
-    res[5] =(*this)[1]*m[4] + (*this)[5]*m[5] + (*this)[9]*m[6]  + (*this)[13]*m[7];
-    res[9] =(*this)[1]*m[8] + (*this)[5]*m[9] + (*this)[9]*m[10] + (*this)[13]*m[11];
-    res[13]=(*this)[1]*m[12]+ (*this)[5]*m[13]+ (*this)[9]*m[14] + (*this)[13]*m[15];
-
-    res[2] =(*this)[2]*m[0] + (*this)[6]*m[1] + (*this)[10]*m[2]  + (*this)[14]*m[3];
-    res[6] =(*this)[2]*m[4] + (*this)[6]*m[5] + (*this)[10]*m[6]  + (*this)[14]*m[7];
-    res[10]=(*this)[2]*m[8] + (*this)[6]*m[9] + (*this)[10]*m[10] + (*this)[14]*m[11];
-    res[14]=(*this)[2]*m[12]+ (*this)[6]*m[13]+ (*this)[10]*m[14] + (*this)[14]*m[15];
-
-    res[3] =(*this)[3]*m[0] + (*this)[7]*m[1] + (*this)[11]*m[2]  + (*this)[15]*m[3];
-    res[7] =(*this)[3]*m[4] + (*this)[7]*m[5] + (*this)[11]*m[6]  + (*this)[15]*m[7];
-    res[11]=(*this)[3]*m[8] + (*this)[7]*m[9] + (*this)[11]*m[10] + (*this)[15]*m[11];
-    res[15]=(*this)[3]*m[12]+ (*this)[7]*m[13]+ (*this)[11]*m[14] + (*this)[15]*m[15];
+    mat4Mul(m, m2.m, res.m);
     return res;
 }
 
+void mat4f::operator*=(const mat4f & m2) {
+    mat4Mul(m, m2.m, m);
+}
+
 vec3f mat4f::operator*(vec3f& vV) const {
 	float x=m[0]*vV[X] + m[4]*vV[Y] + m[8] *vV[Z] + m[12];
 	float y=m[1]*vV[X] + m[5]*vV[Y] + m[9] *vV[Z] + m[13];
@@ -862,32 +947,41 @@ void mat4f::scale(float sx, float sy, float sz) {
 }
 
 void mat4f::transform(std::vector<vec3f> & vV) const {
-    for(unsigned int i=0; i<vV.size(); i++) {
-        float x=m[0]*vV[i][X] + m[4]*vV[i][Y] + m[8] *vV[i][Z] + m[12];
-        float y=m[1]*vV[i][X] + m[5]*vV[i][Y] + m[9] *vV[i][Z] + m[13];
-        float z=m[2]*vV[i][X] + m[6]*vV[i][Y] + m[10]*vV[i][Z] + m[14];
-        vV[i].set(x,y,z);
-    }
+    if(vV.size()) mat4TransformCoords(m, &vV[0][X], vV.size());
 }
 
 void mat4f::transform(std::vector<float> & vF) const {
-    for(unsigned int i=0; i<vF.size()-2; i+=3) {
-        float x=m[0]*vF[i] + m[4]*vF[i+1] + m[8] *vF[i+2] + m[12];
-        float y=m[1]*vF[i] + m[5]*vF[i+1] + m[9] *vF[i+2] + m[13];
-        float z=m[2]*vF[i] + m[6]*vF[i+1] + m[10]*vF[i+2] + m[14];
-        vF[i]=x; vF[i+1]=y; vF[i+2]=z;
-    }
+    if(vF.size()) mat4TransformCoords(m, &vF[0], vF.size()/3);
 }
 
 void mat4f::transform(float * pF, unsigned int n) const {
-    for(unsigned int i=0; i<n*3-2; i+=3) {
-        float x=m[0]*pF[i] + m[4]*pF[i+1] + m[8] *pF[i+2] + m[12];
-        float y=m[1]*pF[i] + m[5]*pF[i+1] + m[9] *pF[i+2] + m[13];
-        float z=m[2]*pF[i] + m[6]*pF[i+1] + m[10]*pF[i+2] + m[14];
-        pF[i]=x; pF[i+1]=y; pF[i+2]=z;
+    mat4TransformCoords(m, pF, n);
+}
+
+void mat4f::transform(std::vector<vec3f> & vPos, std::vector<vec3f> & vNormal) const {
+    mat4f mTrInv(inverse()); // transposed inverse matrix for normals
+    mTrInv.transpose();
+    if(vPos.size()!=vNormal.size()) {
+        transform(vPos);
+        if(vNormal.size()) mat4TransformNormals(mTrInv.m, &vNormal[0][X], vNormal.size());
+        return;
+    }
+    const size_t blockSize=256; // interleave both streams in cache friendly blocks
+    for(size_t i=0; i<vPos.size(); i+=blockSize) {
+        size_t n=min(blockSize, vPos.size()-i);
+        mat4TransformCoords(m, &vPos[i][X], n);
+        mat4TransformNormals(mTrInv.m, &vNormal[i][X], n);
     }
 }
 
+bool mat4f::simd() {
+#ifdef _PRO_SSE
+    return true;
+#else
+    return false;
+#endif
+}
+
 bool mat4f::isIdentity() const {
     if((m[0]!=1.0f)||(m[5]!=1.0f)||(m[10]!=1.0f)||(m[15]!=1.0f)) return false;
     if(m[1]||m[2]||m[3]) return false;
@@ -936,35 +1030,55 @@ void mat4f::transpose() {
 }
 
 void mat4f::invert() {
-    vec4d vRow[]={ row(0), row(1), row(2), row(3) };
-    vec4d vRes[]={ vec4d(1,0,0,0), vec4d(0,1,0,0), vec4d(0,0,1,0), vec4d(0,0,0,1) };
-    unsigned int i,j;
-    const unsigned int sz=4;
-    for(j=0; j<sz; ++j) {
-        i=j;
-        while(i<sz)
-            if(!vRow[i][j]) ++i;
-            else break;
-        if(i==sz) { // singular matrix
+    if((m[3]==0.0f)&&(m[7]==0.0f)&&(m[11]==0.0f)&&(m[15]==1.0f)) { // affine transformation, invert 3x3 part by cofactors:
+        double c0=double(m[5])*m[10]-double(m[9])*m[6];
+        double c1=double(m[9])*m[2] -double(m[1])*m[10];
+        double c2=double(m[1])*m[6] -double(m[5])*m[2];
+        double det=m[0]*c0 + m[4]*c1 + m[8]*c2;
+        if(det==0.0) { // singular matrix
             nan();
             return;
         }
-        if(i!=j) {
-            swap(vRes[j],vRes[i]);
-            swap(vRow[j],vRow[i]);
-        }
-        vRes[j]/=vRow[j][j];
-        vRow[j]/=vRow[j][j];
-        for(i=0; i<sz; ++i) {
-            if(i==j) continue;
-            vRes[i]+=(vRes[j]*(-1.0*vRow[i][j]));
-            vRow[i]+=(vRow[j]*(-1.0*vRow[i][j]));
+        double f=1.0/det;
+        double inv[9] = { c0*f, c1*f, c2*f,
+            (double(m[8])*m[6]-double(m[4])*m[10])*f, (double(m[0])*m[10]-double(m[8])*m[2])*f, (double(m[4])*m[2]-double(m[0])*m[6])*f,
+            (double(m[4])*m[9]-double(m[8])*m[5])*f,  (double(m[8])*m[1]-double(m[0])*m[9])*f,  (double(m[0])*m[5]-double(m[4])*m[1])*f };
+        double t[3] = { m[12], m[13], m[14] };
+        for(unsigned int i=0; i<3; ++i) {
+            m[i]  =static_cast<float>(inv[i]);
+            m[i+4]=static_cast<float>(inv[i+3]);
+            m[i+8]=static_cast<float>(inv[i+6]);
+            m[i+12]=static_cast<float>(-(inv[i]*t[0] + inv[i+3]*t[1] + inv[i+6]*t[2]));
         }
+        return;
     }
-    m[0]=vRes[0][0]; m[1]=vRes[1][0]; m[2]=vRes[2][0]; m[3]=vRes[3][0];
-    m[4]=vRes[0][1]; m[5]=vRes[1][1]; m[6]=vRes[2][1]; m[7]=vRes[3][1];
-    m[8]=vRes[0][2]; m[9]=vRes[1][2]; m[10]=vRes[2][2];m[11]=vRes[3][2];
-    m[12]=vRes[0][3];m[13]=vRes[1][3];m[14]=vRes[2][3];m[15]=vRes[3][3];
+    // general case, adjugate matrix divided by determinant:
+    double a[16];
+    for(unsigned int i=0; i<16; ++i) a[i]=m[i];
+    double inv[16];
+    inv[0] = a[5]*a[10]*a[15] - a[5]*a[11]*a[14] - a[9]*a[6]*a[15] + a[9]*a[7]*a[14] + a[13]*a[6]*a[11] - a[13]*a[7]*a[10];
+    inv[4] =-a[4]*a[10]*a[15] + a[4]*a[11]*a[14] + a[8]*a[6]*a[15] - a[8]*a[7]*a[14] - a[12]*a[6]*a[11] + a[12]*a[7]*a[10];
+    inv[8] = a[4]*a[9]*a[15]  - a[4]*a[11]*a[13] - a[8]*a[5]*a[15] + a[8]*a[7]*a[13] + a[12]*a[5]*a[11] - a[12]*a[7]*a[9];
+    inv[12]=-a[4]*a[9]*a[14]  + a[4]*a[10]*a[13] + a[8]*a[5]*a[14] - a[8]*a[6]*a[13] - a[12]*a[5]*a[10] + a[12]*a[6]*a[9];
+    inv[1] =-a[1]*a[10]*a[15] + a[1]*a[11]*a[14] + a[9]*a[2]*a[15] - a[9]*a[3]*a[14] - a[13]*a[2]*a[11] + a[13]*a[3]*a[10];
+    inv[5] = a[0]*a[10]*a[15] - a[0]*a[11]*a[14] - a[8]*a[2]*a[15] + a[8]*a[3]*a[14] + a[12]*a[2]*a[11] - a[12]*a[3]*a[10];
+    inv[9] =-a[0]*a[9]*a[15]  + a[0]*a[11]*a[13] + a[8]*a[1]*a[15] - a[8]*a[3]*a[13] - a[12]*a[1]*a[11] + a[12]*a[3]*a[9];
+    inv[13]= a[0]*a[9]*a[14]  - a[0]*a[10]*a[13] - a[8]*a[1]*a[14] + a[8]*a[2]*a[13] + a[12]*a[1]*a[10] - a[12]*a[2]*a[9];
+    inv[2] = a[1]*a[6]*a[15]  - a[1]*a[7]*a[14]  - a[5]*a[2]*a[15] + a[5]*a[3]*a[14] + a[13]*a[2]*a[7]  - a[13]*a[3]*a[6];
+    inv[6] =-a[0]*a[6]*a[15]  + a[0]*a[7]*a[14]  + a[4]*a[2]*a[15] - a[4]*a[3]*a[14] - a[12]*a[2]*a[7]  + a[12]*a[3]*a[6];
+    inv[10]= a[0]*a[5]*a[15]  - a[0]*a[7]*a[13]  - a[4]*a[1]*a[15] + a[4]*a[3]*a[13] + a[12]*a[1]*a[7]  - a[12]*a[3]*a[5];
+    inv[14]=-a[0]*a[5]*a[14]  + a[0]*a[6]*a[13]  + a[4]*a[1]*a[14] - a[4]*a[2]*a[13] - a[12]*a[1]*a[6]  + a[12]*a[2]*a[5];
+    inv[3] =-a[1]*a[6]*a[11]  + a[1]*a[7]*a[10]  + a[5]*a[2]*a[11] - a[5]*a[3]*a[10] - a[9]*a[2]*a[7]   + a[9]*a[3]*a[6];
+    inv[7] = a[0]*a[6]*a[11]  - a[0]*a[7]*a[10]  - a[4]*a[2]*a[11] + a[4]*a[3]*a[10] + a[8]*a[2]*a[7]   - a[8]*a[3]*a[6];
+    inv[11]=-a[0]*a[5]*a[11]  + a[0]*a[7]*a[9]   + a[4]*a[1]*a[11] - a[4]*a[3]*a[9]  - a[8]*a[1]*a[7]   + a[8]*a[3]*a[5];
+    inv[15]= a[0]*a[5]*a[10]  - a[0]*a[6]*a[9]   - a[4]*a[1]*a[10] + a[4]*a[2]*a[9]  + a[8]*a[1]*a[6]   - a[8]*a[2]*a[5];
+    double det=a[0]*inv[0] + a[1]*inv[4] + a[2]*inv[8] + a[3]*inv[12];
+    if(det==0.0) { // singular matrix
+        nan();
+        return;
+    }
+    det=1.0/det;
+    for(unsigned int i=0; i<16; ++i) m[i]=static_cast<float>(inv[i]*det);
 }
 
 mat4f mat4f::inverse() const {
@@ -980,8 +1094,421 @@ std::ostream & operator<<(std::ostream & os, const mat4f & m) {
 		<<  m[12] << ' ' << m[13] << ' ' << m[14] << ' ' << m[15];
 }
 
+//--- class vec3fArray ---------------------------------------------
+
+vec3fArray::vec3fArray(const std::vector<vec3f> & vV) : mp_data(0), m_size(0), m_capacity(0) {
+    mp_c[X]=mp_c[Y]=mp_c[Z]=0;
+    assign(vV);
+}
+
+vec3fArray::vec3fArray(const vec3fArray & source) : mp_data(0), m_size(0), m_capacity(0) {
+    mp_c[X]=mp_c[Y]=mp_c[Z]=0;
+    operator=(source);
+}
+
+const vec3fArray & vec3fArray::operator=(const vec3fArray & source) {
+    if(&source==this) return *this;
+    m_size=0;
+    reserve(source.m_size);
+    if(source.m_size) for(unsigned int c=X; c<=Z; ++c) // empty sources may have null component pointers
+        memcpy(mp_c[c], source.mp_c[c], source.m_size*sizeof(float));
+    m_size=source.m_size;
+    return *this;
+}
+
+void vec3fArray::release() {
+    delete [] mp_data;
+    mp_data=0;
+    mp_c[X]=mp_c[Y]=mp_c[Z]=0;
+    m_size=m_capacity=0;
+}
+
+void vec3fArray::reserve(size_t n) {
+    if(n<=m_capacity) return;
+    size_t capacity=(n+7)&~size_t(7);
+    float * pData = new float[3*capacity+8];
+    memset(pData, 0, (3*capacity+8)*sizeof(float));
+    float * pBase = pData+((32-(reinterpret_cast<size_t>(pData)&31))&31)/sizeof(float);
+    for(unsigned int c=X; c<=Z; ++c) {
+        if(m_size) memcpy(pBase+c*capacity, mp_c[c], m_size*sizeof(float));
+        mp_c[c]=pBase+c*capacity;
+    }
+    delete [] mp_data;
+    mp_data=pData;
+    m_capacity=capacity;
+}
+
+void vec3fArray::resize(size_t n) {
+    reserve(n);
+    for(unsigned int c=X; c<=Z; ++c) if(n>m_size)
+        memset(mp_c[c]+m_size, 0, (n-m_size)*sizeof(float));
+    m_size=n;
+}
+
+void vec3fArray::assign(const std::vector<vec3f> & vV) {
+    m_size=0;
+    reserve(vV.size());
+    float * pX=mp_c[X], * pY=mp_c[Y], * pZ=mp_c[Z];
+    for(size_t i=0; i<vV.size(); ++i) {
+        pX[i]=vV[i][X]; pY[i]=vV[i][Y]; pZ[i]=vV[i][Z];
+    }
+    m_size=vV.size();
+}
+
+void vec3fArray::copyTo(std::vector<vec3f> & vV) const {
+    vV.resize(m_size);
+    const float * pX=mp_c[X], * pY=mp_c[Y], * pZ=mp_c[Z];
+    for(size_t i=0; i<m_size; ++i) vV[i].set(pX[i], pY[i], pZ[i]);
+}
+
+bool vec3fArray::bounds(vec3f & vMin, vec3f & vMax) const {
+    if(!m_size) return false;
+    for(unsigned int c=X; c<=Z; ++c) {
+        const float * p=mp_c[c];
+        float fMin=p[0], fMax=p[0];
+        size_t i=0;
+#ifdef _PRO_SSE
+        if(m_size>=4) {
+            __m128 vecMin=_mm_load_ps(p), vecMax=vecMin;
+            for(i=4; i+4<=m_size; i+=4) {
+                __m128 v=_mm_load_ps(p+i);
+                vecMin=_mm_min_ps(vecMin, v);
+                vecMax=_mm_max_ps(vecMax, v);
+            }
+            float aMin[4], aMax[4];
+            _mm_storeu_ps(aMin, vecMin);
+            _mm_storeu_ps(aMax, vecMax);
+            for(unsigned int j=0; j<4; ++j) {
+                if(aMin[j]<fMin) fMin=aMin[j];
+                if(aMax[j]>fMax) fMax=aMax[j];
+            }
+        }
+#endif
+        for(; i<m_size; ++i) {
+            if(p[i]<fMin) fMin=p[i];
+            if(p[i]>fMax) fMax=p[i];
+        }
+        vMin[c]=fMin;
+        vMax[c]=fMax;
+    }
+    return true;
+}
+
+void vec3fArray::transform(const mat4f & m) {
+    float * pX=mp_c[X], * pY=mp_c[Y], * pZ=mp_c[Z];
+    size_t i=0;
+#ifdef _PRO_SSE
+    const __m128 m0=_mm_set1_ps(m[0]), m1=_mm_set1_ps(m[1]), m2=_mm_set1_ps(m[2]);
+    const __m128 m4=_mm_set1_ps(m[4]), m5=_mm_set1_ps(m[5]), m6=_mm_set1_ps(m[6]);
+    const __m128 m8=_mm_set1_ps(m[8]), m9=_mm_set1_ps(m[9]), m10=_mm_set1_ps(m[10]);
+    const __m128 m12=_mm_set1_ps(m[12]), m13=_mm_set1_ps(m[13]), m14=_mm_set1_ps(m[14]);
+    for(; i+4<=m_size; i+=4) {
+        __m128 x=_mm_load_ps(pX+i), y=_mm_load_ps(pY+i), z=_mm_load_ps(pZ+i);
+        _mm_store_ps(pX+i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m0,x), _mm_mul_ps(m4,y)), _mm_mul_ps(m8,z)), m12));
+        _mm_store_ps(pY+i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m1,x), _mm_mul_ps(m5,y)), _mm_mul_ps(m9,z)), m13));
+        _mm_store_ps(pZ+i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m2,x), _mm_mul_ps(m6,y)), _mm_mul_ps(m10,z)), m14));
+    }
+#endif
+    for(; i<m_size; ++i) {
+        float x=m[0]*pX[i] + m[4]*pY[i] + m[8] *pZ[i] + m[12];
+        float y=m[1]*pX[i] + m[5]*pY[i] + m[9] *pZ[i] + m[13];
+        float z=m[2]*pX[i] + m[6]*pY[i] + m[10]*pZ[i] + m[14];
+        pX[i]=x; pY[i]=y; pZ[i]=z;
+    }
+}
+
+void vec3fArray::transformNormals(const mat4f & m) {
+    mat4f mTrInv(m.inverse()); // transposed inverse matrix for normals
+    mTrInv.transpose();
+    float * pX=mp_c[X], * pY=mp_c[Y], * pZ=mp_c[Z];
+    size_t i=0;
+#ifdef _PRO_SSE
+    const __m128 m0=_mm_set1_ps(mTrInv[0]), m1=_mm_set1_ps(mTrInv[1]), m2=_mm_set1_ps(mTrInv[2]);
+    const __m128 m4=_mm_set1_ps(mTrInv[4]), m5=_mm_set1_ps(mTrInv[5]), m6=_mm_set1_ps(mTrInv[6]);
+    const __m128 m8=_mm_set1_ps(mTrInv[8]), m9=_mm_set1_ps(mTrInv[9]), m10=_mm_set1_ps(mTrInv[10]);
+    const __m128 one=_mm_set1_ps(1.0f);
+    for(; i+4<=m_size; i+=4) {
+        __m128 x=_mm_load_ps(pX+i), y=_mm_load_ps(pY+i), z=_mm_load_ps(pZ+i);
+        __m128 tx=_mm_add_ps(_mm_add_ps(_mm_mul_ps(m0,x), _mm_mul_ps(m4,y)), _mm_mul_ps(m8,z));
+        __m128 ty=_mm_add_ps(_mm_add_ps(_mm_mul_ps(m1,x), _mm_mul_ps(m5,y)), _mm_mul_ps(m9,z));
+        __m128 tz=_mm_add_ps(_mm_add_ps(_mm_mul_ps(m2,x), _mm_mul_ps(m6,y)), _mm_mul_ps(m10,z));
+        __m128 f=_mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx,tx), _mm_mul_ps(ty,ty)), _mm_mul_ps(tz,tz))));
+        _mm_store_ps(pX+i, _mm_mul_ps(tx,f));
+        _mm_store_ps(pY+i, _mm_mul_ps(ty,f));
+        _mm_store_ps(pZ+i, _mm_mul_ps(tz,f));
+    }
+#endif
+    for(; i<m_size; ++i) {
+        float x=mTrInv[0]*pX[i] + mTrInv[4]*pY[i] + mTrInv[8] *pZ[i];
+        float y=mTrInv[1]*pX[i] + mTrInv[5]*pY[i] + mTrInv[9] *pZ[i];
+        float z=mTrInv[2]*pX[i] + mTrInv[6]*pY[i] + mTrInv[10]*pZ[i];
+        float f=1.0f/sqrt(x*x+y*y+z*z);
+        pX[i]=x*f; pY[i]=y*f; pZ[i]=z*f;
+    }
+}
+
+void vec3fArray::normalize() {
+    float * pX=mp_c[X], * pY=mp_c[Y], * pZ=mp_c[Z];
+    size_t i=0;
+#ifdef _PRO_SSE
+    const __m128 zero=_mm_setzero_ps(), one=_mm_set1_ps(1.0f);
+    for(; i+4<=m_size; i+=4) {
+        __m128 x=_mm_load_ps(pX+i), y=_mm_load_ps(pY+i), z=_mm_load_ps(pZ+i);
+        __m128 sqrLen=_mm_add_ps(_mm_add_ps(_mm_mul_ps(x,x), _mm_mul_ps(y,y)), _mm_mul_ps(z,z));
+        __m128 valid=_mm_cmpgt_ps(sqrLen, zero); // also false for NaN
+        __m128 f=_mm_div_ps(one, _mm_sqrt_ps(sqrLen));
+        _mm_store_ps(pX+i, _mm_and_ps(valid, _mm_mul_ps(x,f)));
+        _mm_store_ps(pY+i, _mm_and_ps(valid, _mm_mul_ps(y,f)));
+        _mm_store_ps(pZ+i, _mm_or_ps(_mm_and_ps(valid, _mm_mul_ps(z,f)), _mm_andnot_ps(valid, one)));
+    }
+#endif
+    for(; i<m_size; ++i) {
+        float sqrLen=pX[i]*pX[i]+pY[i]*pY[i]+pZ[i]*pZ[i];
+        if(!(sqrLen>0.0f)) {
+            pX[i]=pY[i]=0.0f;
+            pZ[i]=1.0f;
+            continue;
+        }
+        float f=1.0f/sqrt(sqrLen);
+        pX[i]*=f; pY[i]*=f; pZ[i]*=f;
+    }
+}
+
+void vec3fArray::zup2yup() {
+    std::swap(mp_c[Y], mp_c[Z]); // no data movement, only the new y component has to be negated
+    float * pY=mp_c[Y];
+    for(size_t i=0; i<m_size; ++i) pY[i]=-pY[i];
+}
+
+void vec3fArray::yup2zup() {
+    std::swap(mp_c[Y], mp_c[Z]); // no data movement, only the new z component has to be negated
+    float * pZ=mp_c[Z];
+    for(size_t i=0; i<m_size; ++i) pZ[i]=-pZ[i];
+}
+
+void vec3fArray::faceNormals(const std::vector<unsigned int> & vIndex, vec3fArray & fNormals) const {
+    size_t nFaces=vIndex.size()/3;
+    fNormals.m_size=0;
+    fNormals.resize(nFaces);
+    const float * pX=mp_c[X], * pY=mp_c[Y], * pZ=mp_c[Z];
+    float * nX=fNormals.mp_c[X], * nY=fNormals.mp_c[Y], * nZ=fNormals.mp_c[Z];
+    // first pass, unnormalized cross products:
+    for(size_t i=0; i<nFaces; ++i) {
+        unsigned int i0=vIndex[3*i], i1=vIndex[3*i+1], i2=vIndex[3*i+2];
+        float v1x=pX[i1]-pX[i0], v1y=pY[i1]-pY[i0], v1z=pZ[i1]-pZ[i0];
+        float v2x=pX[i2]-pX[i0], v2y=pY[i2]-pY[i0], v2z=pZ[i2]-pZ[i0];
+        nX[i]=v1y*v2z-v1z*v2y;
+        nY[i]=v1z*v2x-v1x*v2z;
+        nZ[i]=v1x*v2y-v1y*v2x;
+    }
+    // second pass, vectorized normalization:
+    fNormals.normalize();
+}
+
 //--- class sphere ---------------------------------------------
 
+#ifdef _PRO_SSE
+/// loads 4 points starting at index i from component arrays with a stride of 1 or 3 floats into x, y, and z vectors
+static inline void load4(const float * pX, const float * pY, const float * pZ, size_t i, size_t stride, __m128 & x, __m128 & y, __m128 & z) {
+    if(stride==1) {
+        x=_mm_loadu_ps(pX+i); y=_mm_loadu_ps(pY+i); z=_mm_loadu_ps(pZ+i);
+        return;
+    }
+    const float * p=pX+3*i; // deinterleave x0y0z0x1 y1z1x2y2 z2x3y3z3
+    __m128 a=_mm_loadu_ps(p), b=_mm_loadu_ps(p+4), c=_mm_loadu_ps(p+8);
+    x=_mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,1,2,2)), _MM_SHUFFLE(2,0,3,0));
+    y=_mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0));
+    z=_mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3,3,0,0)), _MM_SHUFFLE(2,0,2,0));
+}
+#endif
+
+/// number of directions used for finding extremal points, 3 axes and 4 cube diagonals (EPOS-14)
+static const unsigned int s_nDir=7;
+
+/// returns the projection of point x|y|z onto direction k, unnormalized
+static inline float project(float x, float y, float z, unsigned int k) {
+    switch(k) {
+    case 0: return x;
+    case 1: return y;
+    case 2: return z;
+    case 3: return (x+y)+z;
+    case 4: return (x+y)-z;
+    case 5: return (x-y)+z;
+    default: return (x-y)-z;
+    }
+}
+
+/// returns the index of the point whose projection onto direction k is closest to value
+static size_t locate(const float * pX, const float * pY, const float * pZ, size_t n, size_t stride, unsigned int k, float value) {
+    // direction weights, evaluated in the same order as project() to reproduce its results:
+    static const float s_weight[s_nDir][3]={ {1,0,0}, {0,1,0}, {0,0,1}, {1,1,1}, {1,1,-1}, {1,-1,1}, {1,-1,-1} };
+    const float wx=s_weight[k][X], wy=s_weight[k][Y], wz=s_weight[k][Z];
+    size_t iBest=0;
+    float dBest=FLT_MAX;
+    for(size_t i=0, j=0; i<n; ++i, j+=stride) {
+        float d=fabs((pX[j]*wx+pY[j]*wy)+pZ[j]*wz-value);
+        if(d>=dBest) continue;
+        dBest=d;
+        iBest=j;
+        if(d==0.0f) break;
+    }
+    return iBest;
+}
+
+/// returns the maximal squared distance of n points given as component arrays to cx|cy|cz
+static float maxSqrDist(const float * pX, const float * pY, const float * pZ, size_t n, size_t stride, float cx, float cy, float cz) {
+    float d2Max=0.0f;
+    size_t i=0, j;
+#ifdef _PRO_SSE
+    const __m128 centerX=_mm_set1_ps(cx), centerY=_mm_set1_ps(cy), centerZ=_mm_set1_ps(cz);
+    __m128 vMax=_mm_setzero_ps();
+    for(; i+4<=n; i+=4) {
+        __m128 x, y, z;
+        load4(pX, pY, pZ, i, stride, x, y, z);
+        __m128 dx=_mm_sub_ps(x, centerX), dy=_mm_sub_ps(y, centerY), dz=_mm_sub_ps(z, centerZ);
+        vMax=_mm_max_ps(vMax, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx,dx), _mm_mul_ps(dy,dy)), _mm_mul_ps(dz,dz)));
+    }
+    float aMax[4];
+    _mm_storeu_ps(aMax, vMax);
+    d2Max=max(max(aMax[0],aMax[1]),max(aMax[2],aMax[3]));
+#endif
+    for(j=i*stride; i<n; ++i, j+=stride) {
+        float d2=(pX[j]-cx)*(pX[j]-cx)+(pY[j]-cy)*(pY[j]-cy)+(pZ[j]-cz)*(pZ[j]-cz);
+        if(d2>d2Max) d2Max=d2;
+    }
+    return d2Max;
+}
+
+/// computes a bounding sphere and the axis aligned bounding box of n points given as component arrays with a stride of 1 or 3 floats
+static void sphereFit(const float * pX, const float * pY, const float * pZ, size_t n, size_t stride, 
+    vec3f & center, float & radius, std::pair<vec3f,vec3f> * pBox) {
+    if(!n) {
+        center.set(0.0f,0.0f,0.0f);
+        radius=-1.0f;
+        return;
+    }
+    // single pass over all points finding minimal and maximal projections along all directions:
+    float projMin[s_nDir], projMax[s_nDir];
+    unsigned int k;
+    for(k=0; k<s_nDir; ++k) projMin[k]=projMax[k]=project(pX[0],pY[0],pZ[0],k);
+    size_t i=0, j;
+#ifdef _PRO_SSE
+    if(n>=4) {
+        __m128 vMin[s_nDir], vMax[s_nDir];
+        for(k=0; k<s_nDir; ++k) vMin[k]=vMax[k]=_mm_set1_ps(projMin[k]);
+        for(; i+4<=n; i+=4) {
+            __m128 x, y, z;
+            load4(pX, pY, pZ, i, stride, x, y, z);
+            __m128 s=_mm_add_ps(x,y), d=_mm_sub_ps(x,y);
+            __m128 proj[s_nDir]={ x, y, z, _mm_add_ps(s,z), _mm_sub_ps(s,z), _mm_add_ps(d,z), _mm_sub_ps(d,z) };
+            for(k=0; k<s_nDir; ++k) {
+                vMin[k]=_mm_min_ps(vMin[k], proj[k]);
+                vMax[k]=_mm_max_ps(vMax[k], proj[k]);
+            }
+        }
+        for(k=0; k<s_nDir; ++k) {
+            float aMin[4], aMax[4];
+            _mm_storeu_ps(aMin, vMin[k]);
+            _mm_storeu_ps(aMax, vMax[k]);
+            for(j=0; j<4; ++j) {
+                if(aMin[j]<projMin[k]) projMin[k]=aMin[j];
+                if(aMax[j]>projMax[k]) projMax[k]=aMax[j];
+            }
+        }
+    }
+#endif
+    for(j=i*stride; i<n; ++i, j+=stride) for(k=0; k<s_nDir; ++k) {
+        float proj=project(pX[j],pY[j],pZ[j],k);
+        if(proj<projMin[k]) projMin[k]=proj;
+        if(proj>projMax[k]) projMax[k]=proj;
+    }
+    if(pBox) {
+        pBox->first.set(projMin[X], projMin[Y], projMin[Z]);
+        pBox->second.set(projMax[X], projMax[Y], projMax[Z]);
+    }
+
+    // initial sphere spanned by the extremal points of the direction with the largest extent:
+    unsigned int kMax=0;
+    float extMax=-1.0f;
+    for(k=0; k<s_nDir; ++k) {
+        float ext=(projMax[k]-projMin[k])*(k<3 ? 1.0f : 0.57735027f);
+        if(ext>extMax) {
+            extMax=ext;
+            kMax=k;
+        }
+    }
+    size_t i0=locate(pX, pY, pZ, n, stride, kMax, projMin[kMax]);
+    size_t i1=locate(pX, pY, pZ, n, stride, kMax, projMax[kMax]);
+    float cx=(pX[i0]+pX[i1])*0.5f, cy=(pY[i0]+pY[i1])*0.5f, cz=(pZ[i0]+pZ[i1])*0.5f;
+    radius=dist(pX[i0],pY[i0],pZ[i0], pX[i1],pY[i1],pZ[i1])*0.5f;
+
+    // grow sphere to include all points (Ritter), additionally measure the sphere around the box center:
+    float r2=radius*radius;
+    float bx=(projMin[X]+projMax[X])*0.5f, by=(projMin[Y]+projMax[Y])*0.5f, bz=(projMin[Z]+projMax[Z])*0.5f, b2=0.0f;
+    i=0;
+#ifdef _PRO_SSE
+    const __m128 boxX=_mm_set1_ps(bx), boxY=_mm_set1_ps(by), boxZ=_mm_set1_ps(bz);
+    __m128 boxMax=_mm_setzero_ps();
+    for(; i+4<=n; i+=4) { // skip blocks of 4 points inside the current sphere
+        __m128 x, y, z;
+        load4(pX, pY, pZ, i, stride, x, y, z);
+        __m128 dx=_mm_sub_ps(x, boxX), dy=_mm_sub_ps(y, boxY), dz=_mm_sub_ps(z, boxZ);
+        boxMax=_mm_max_ps(boxMax, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx,dx), _mm_mul_ps(dy,dy)), _mm_mul_ps(dz,dz)));
+        x=_mm_sub_ps(x, _mm_set1_ps(cx));
+        y=_mm_sub_ps(y, _mm_set1_ps(cy));
+        z=_mm_sub_ps(z, _mm_set1_ps(cz));
+        __m128 d2=_mm_add_ps(_mm_add_ps(_mm_mul_ps(x,x), _mm_mul_ps(y,y)), _mm_mul_ps(z,z));
+        if(!_mm_movemask_ps(_mm_cmpgt_ps(d2, _mm_set1_ps(r2)))) continue;
+        for(j=i*stride; j<(i+4)*stride; j+=stride) {
+            float ex=pX[j]-cx, ey=pY[j]-cy, ez=pZ[j]-cz;
+            float e2=ex*ex+ey*ey+ez*ez;
+            if(e2<=r2) continue;
+            float d=sqrt(e2), rNew=(radius+d)*0.5f, f=(rNew-radius)/d;
+            cx+=ex*f; cy+=ey*f; cz+=ez*f;
+            radius=rNew;
+            r2=radius*radius;
+        }
+    }
+    float aMax[4];
+    _mm_storeu_ps(aMax, boxMax);
+    b2=max(max(aMax[0],aMax[1]),max(aMax[2],aMax[3]));
+#endif
+    for(j=i*stride; i<n; ++i, j+=stride) {
+        float d2=(pX[j]-bx)*(pX[j]-bx)+(pY[j]-by)*(pY[j]-by)+(pZ[j]-bz)*(pZ[j]-bz);
+        if(d2>b2) b2=d2;
+        float ex=pX[j]-cx, ey=pY[j]-cy, ez=pZ[j]-cz;
+        float e2=ex*ex+ey*ey+ez*ez;
+        if(e2<=r2) continue;
+        float d=sqrt(e2), rNew=(radius+d)*0.5f, f=(rNew-radius)/d;
+        cx+=ex*f; cy+=ey*f; cz+=ez*f;
+        radius=rNew;
+        r2=radius*radius;
+    }
+    if(b2<radius*radius) { // for evenly distributed points the box centered sphere may be tighter
+        cx=bx; cy=by; cz=bz;
+        radius=sqrt(b2);
+    }
+    else // the incremental center updates accumulate rounding errors, hence the points are measured again
+        radius=sqrt(maxSqrDist(pX, pY, pZ, n, stride, cx, cy, cz));
+    center.set(cx,cy,cz);
+    // compensate rounding of distances evaluated at the magnitude of the coordinates, also far off the origin:
+    radius+=(max(max(fabs(cx),fabs(cy)),fabs(cz))+radius)*4.0f*FLT_EPSILON;
+}
+
+void sphere::fit(const std::vector<vec3f> & vV, std::pair<vec3f,vec3f> * pBox) {
+    if(!vV.size()) sphereFit(0, 0, 0, 0, 3, *this, r, pBox);
+    else sphereFit(&vV[0][X], &vV[0][Y], &vV[0][Z], vV.size(), 3, *this, r, pBox);
+}
+
+void sphere::fit(const constArray<vec3f> & vV, std::pair<vec3f,vec3f> * pBox) {
+    if(vV.empty()) sphereFit(0, 0, 0, 0, 3, *this, r, pBox);
+    else sphereFit(&vV[0][X], &vV[0][Y], &vV[0][Z], vV.size(), 3, *this, r, pBox);
+}
+
+void sphere::fit(const vec3fArray & vV, std::pair<vec3f,vec3f> * pBox) {
+    sphereFit(vV.data(X), vV.data(Y), vV.data(Z), vV.size(), 1, *this, r, pBox);
+}
+
 std::ostream & operator<<(std::ostream & os, const sphere & s) {
     return os << s[X] << ' ' << s[Y] << ' ' << s[Z] << ' ' << s.radius();
 }
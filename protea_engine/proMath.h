@@ -29,12 +29,14 @@
 #include <cmath>
 #include <iostream>
 #include <vector>
+#include <utility>
 
 using namespace std;
 
 class vec3f;
 class vec6f;
 class plane;
+class vec3fArray;
 
 //--- constants and enums ------------------------------------------
 /// defines PI
@@ -611,6 +613,37 @@ std::ostream & operator<<(std::ostream & os, const vec6f & sdof);
 inline const vec6f operator+(const vec3f &v1, const vec6f &v2) {
     return vec6f(v1[X]+v2[X],v1[Y]+v2[Y],v1[Z]+v2[Z], v2[H],v2[P],v2[R]); }
 
+//--- class constArray -----------------------------------------
+
+/// a read-only view of a contiguous array, owned either by a std::vector or by external memory
+/** The view does not own the elements and becomes invalid as soon as the referred memory is
+ modified or released. */
+template <class T> class constArray {
+public:
+    /// constructor referring to n elements starting at pData
+    constArray(const T * pData=0, size_t n=0) : mp_data(pData), m_size(n) { }
+    /// constructor referring to the content of vector vV
+    constArray(const std::vector<T> & vV) : mp_data(vV.size() ? &vV[0] : 0), m_size(vV.size()) { }
+    /// returns number of elements
+    size_t size() const { return m_size; }
+    /// returns true if there are no elements
+    bool empty() const { return !m_size; }
+    /// returns pointer to the first element
+    const T * data() const { return mp_data; }
+    /// returns pointer to the first element
+    const T * begin() const { return mp_data; }
+    /// returns pointer behind the last element
+    const T * end() const { return mp_data+m_size; }
+    /// returns element i
+    /** Warning, for efficiency reasons no range check is performed! */
+    const T & operator[](size_t i) const { return mp_data[i]; }
+protected:
+    /// pointer to the first element
+    const T * mp_data;
+    /// number of elements
+    size_t m_size;
+};
+
 //--- class sphere ---------------------------------------------
 
 /// a class representing a sphere.
@@ -632,6 +665,17 @@ public:
     float radius() const { return r; }
     /// sets radius
     void radius(float newRadius) { r=newRadius; }
+    /// sets this sphere to a tight bounding sphere of the points vV, optionally also computes their axis aligned bounding box
+    /** A single vectorized pass determines the extremal projections along the 3 axes and the
+     4 cube diagonals (EPOS-14). The initial sphere spans the extremal points of the direction
+     with the largest extent and is afterwards grown to include all points (Ritter).
+     The result typically is within a few percent of the minimal bounding sphere. 
+     An empty vV results in a negative radius. */
+    void fit(const std::vector<vec3f> & vV, std::pair<vec3f,vec3f> * pBox=0);
+    /// sets this sphere to a tight bounding sphere of the points vV, optionally also computes their axis aligned bounding box
+    void fit(const constArray<vec3f> & vV, std::pair<vec3f,vec3f> * pBox=0);
+    /// sets this sphere to a tight bounding sphere of the points vV, optionally also computes their axis aligned bounding box
+    void fit(const vec3fArray & vV, std::pair<vec3f,vec3f> * pBox=0);
 protected:
     /// stores radius
     float r;
@@ -1000,8 +1044,8 @@ public:
     void set(const vec6f & sdof);
     /// operator multiplying two matrixes in the order (*this) * m
     const mat4f operator*(const mat4f & m) const;
-    /// multiplies this matrix by m2, (*this) = (*this) * m2
-    void operator*=(const mat4f & m2) { (*this)= (*this)*m2; };
+    /// multiplies this matrix by m2 in place, (*this) = (*this) * m2
+    void operator*=(const mat4f & m2);
 	/// multiplies a vector by this matrix;
 	vec3f operator*(vec3f& vV)const;
 	/// adds the translation x|y|z to the transformation
@@ -1028,6 +1072,11 @@ public:
     void transform(std::vector<float> & vF) const;
     /// transforms an array of coherent float coordinates n*(x|y|z) starting at pF by applying this matrix
     void transform(float * pF, unsigned int n) const;
+    /// transforms positions by this matrix and normals by its inverse transpose in a single pass, normals are renormalized
+    /** In case both vectors differ in size, they are transformed one after the other. */
+    void transform(std::vector<vec3f> & vPos, std::vector<vec3f> & vNormal) const;
+    /// returns true if the matrix and batch transformation kernels use SIMD instructions
+    static bool simd();
 protected:
     /// stores values.
     float m[16];
@@ -1036,6 +1085,81 @@ protected:
 /// operator for output in streams
 std::ostream & operator<<(std::ostream & os, const mat4f & m);
 
+//--- class vec3fArray ---------------------------------------------
+
+/// a structure of arrays container for bulk vec3f data
+/** The x, y, and z components are stored in separate float arrays starting at 32 byte
+ aligned addresses and padded to multiples of 8 elements, so that bulk operations
+ (bounds, transformation, axis swapping, normal generation) can process several vectors
+ per SIMD instruction without shuffling. Individual elements are accessed via vec3f values. */
+class vec3fArray {
+public:
+    /// default constructor, empty array
+    vec3fArray() : mp_data(0), m_size(0), m_capacity(0) { mp_c[X]=mp_c[Y]=mp_c[Z]=0; }
+    /// constructor copying an array of vec3f
+    explicit vec3fArray(const std::vector<vec3f> & vV);
+    /// copy constructor
+    vec3fArray(const vec3fArray & source);
+    /// destructor
+    ~vec3fArray() { delete [] mp_data; }
+    /// copy operator
+    const vec3fArray & operator=(const vec3fArray & source);
+
+    /// returns number of stored vectors
+    size_t size() const { return m_size; }
+    /// removes all vectors, keeps allocated memory
+    void clear() { m_size=0; }
+    /// releases all allocated memory
+    void release();
+    /// allocates memory for at least n vectors
+    void reserve(size_t n);
+    /// changes the number of stored vectors, new vectors are set to 0|0|0
+    void resize(size_t n);
+    /// appends vector v
+    void push_back(const vec3f & v) {
+        if(m_size==m_capacity) reserve(m_capacity ? 2*m_capacity : 8);
+        mp_c[X][m_size]=v[X]; mp_c[Y][m_size]=v[Y]; mp_c[Z][m_size]=v[Z]; ++m_size; }
+    /// returns vector i
+    /** Warning, for efficiency reasons no range check is performed! */
+    vec3f operator[](size_t i) const { return vec3f(mp_c[X][i], mp_c[Y][i], mp_c[Z][i]); }
+    /// sets vector i to v
+    void set(size_t i, const vec3f & v) { mp_c[X][i]=v[X]; mp_c[Y][i]=v[Y]; mp_c[Z][i]=v[Z]; }
+    /// returns 32 byte aligned array of component c (X, Y, or Z)
+    float * data(unsigned int c) { return mp_c[c]; }
+    /// returns 32 byte aligned array of component c (X, Y, or Z)
+    const float * data(unsigned int c) const { return mp_c[c]; }
+
+    /// replaces content by the vectors of vV
+    void assign(const std::vector<vec3f> & vV);
+    /// copies content to vV
+    void copyTo(std::vector<vec3f> & vV) const;
+
+    /// computes the axis aligned bounding box, returns false if the array is empty
+    bool bounds(vec3f & vMin, vec3f & vMax) const;
+    /// transforms all vectors as coordinates by matrix m
+    void transform(const mat4f & m);
+    /// transforms all vectors as normals by the inverse transpose of matrix m and renormalizes them
+    void transformNormals(const mat4f & m);
+    /// normalizes all vectors, zero length vectors are set to 0|0|1
+    void normalize();
+    /// converts from a z-up to a y-up coordinate system, (x|y|z) becomes (x|-z|y)
+    void zup2yup();
+    /// converts from a y-up to a z-up coordinate system, (x|y|z) becomes (x|z|-y)
+    void yup2zup();
+    /// computes normalized per face normals of the triangles indexed by vIndex
+    /** degenerate faces get the normal 0|0|1 */
+    void faceNormals(const std::vector<unsigned int> & vIndex, vec3fArray & fNormals) const;
+protected:
+    /// allocated memory block
+    float * mp_data;
+    /// aligned component arrays within mp_data
+    float * mp_c[3];
+    /// number of stored vectors
+    size_t m_size;
+    /// number of allocated vectors per component array, multiple of 8
+    size_t m_capacity;
+};
+
 
 //--- class frustum --------------------------------------------
 
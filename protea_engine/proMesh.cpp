@@ -4,20 +4,25 @@
 #include "proStr.h"
 #include "proIo.h"
 #include "proResource.h"
+#include "proProfiler.h"
 #include <map>
+#include <algorithm>
 #include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <climits>
 using namespace std;
 
 /// recursively flattens scene graph
 void meshUtils::flattenHierarchy(proTransform & parent, proNode & node) {
-    if((node.type()!=proTransform::TYPE)&&(node.type()!=proScene::TYPE)) parent.append(&node);
+    if(!(node.typeId()&proNode::TYPE_TRANSFORM)) parent.append(&node);
     else for(unsigned int i=0; i<static_cast<const proTransform*>(&node)->size(); ++i)
         flattenHierarchy(parent,*static_cast<const proTransform*>(&node)->operator[](i));
 }
 
 /// remove transformations from the scene:
 void meshUtils::flattenTransforms(proNode & node) {
-    if((node.type()==proTransform::TYPE)||(node.type()==proScene::TYPE)) {
+    if(node.typeId()&proNode::TYPE_TRANSFORM) {
         proTransform & transf=*((proTransform*)&node);
         for(unsigned int i=0; i<transf.size(); ++i)
             flattenTransforms(*transf[i]);
@@ -29,6 +34,10 @@ void meshUtils::flattenTransforms(proNode & node) {
 }
 
 void meshUtils::genFNormals(proMesh & m) {
+    if(m.storage()==proMesh::STORAGE_SOA) {
+        m.soaCoords().faceNormals(m.indices(), m.soaFNormals());
+        return;
+    }
     m.fNormals().clear();
     m.fNormals().reserve(m.indices().size()/3);
 	for(unsigned int i=0; i+2<m.indices().size(); ++i) {
@@ -99,6 +108,63 @@ void meshUtils::genVNormals(proMesh & m, float creaseAngle) {
         else m.vNormals()[i].normalize();
 }
 
+void meshUtils::genVNormals(proMesh & m, const vector<unsigned int> & vSmoothGroup) {
+    if(vSmoothGroup.size()!=m.indices().size()/3) {
+        genVNormals(m);
+        return;
+    }
+    if(m.fNormals().size()!=m.indices().size()/3)
+        genFNormals(m);
+
+    // list the corners of each vertex:
+    const unsigned int nVtx=static_cast<unsigned int>(m.coords().size());
+    vector<unsigned int> vBegin(nVtx+1,0), vCorner(m.indices().size());
+    unsigned int i;
+    for(i=0; i<m.indices().size(); ++i)
+        ++vBegin[m.indices()[i]+1];
+    for(i=0; i<nVtx; ++i)
+        vBegin[i+1]+=vBegin[i];
+    vector<unsigned int> vPos(vBegin.begin(), vBegin.end()-1);
+    for(i=0; i<m.indices().size(); ++i)
+        vCorner[vPos[m.indices()[i]]++]=i;
+
+    // assign one vertex per distinct smoothing group mask, duplicating where necessary:
+    m.vNormals().assign(nVtx,vec3f(0.0f,0.0f,1.0f));
+    vector<pair<unsigned int, unsigned int> > vMaskVtx;
+    for(unsigned int v=0; v<nVtx; ++v) {
+        vMaskVtx.clear();
+        for(unsigned int c=vBegin[v]; c<vBegin[v+1]; ++c) {
+            unsigned int mask=vSmoothGroup[vCorner[c]/3];
+            unsigned int target=UINT_MAX;
+            if(mask) for(unsigned int k=0; k<vMaskVtx.size(); ++k) if(vMaskVtx[k].first==mask) {
+                target=vMaskVtx[k].second;
+                break;
+            }
+            if(target==UINT_MAX) {
+                if(c==vBegin[v]) target=v;
+                else { // duplicate vertex:
+                    m.coords().push_back(m.coords()[v]);
+                    if(m.texCoords().size()>v)
+                        m.texCoords().push_back(m.texCoords()[v]);
+                    if(m.vertexColors().size()>v)
+                        m.vertexColors().push_back(m.vertexColors()[v]);
+                    m.vNormals().push_back(vec3f(0.0f,0.0f,1.0f));
+                    target=static_cast<unsigned int>(m.coords().size()-1);
+                }
+                vec3f normal(0.0f,0.0f,0.0f);
+                if(!mask) normal=m.fNormals()[vCorner[c]/3];
+                else for(unsigned int d=vBegin[v]; d<vBegin[v+1]; ++d)
+                    if(vSmoothGroup[vCorner[d]/3]&mask) normal+=m.fNormals()[vCorner[d]/3];
+                if(normal.sqrLength()) normal.normalize();
+                else normal.set(0.0f,0.0f,1.0f);
+                m.vNormals()[target]=normal;
+                if(mask) vMaskVtx.push_back(make_pair(mask,target));
+            }
+            m.indices()[vCorner[c]]=target;
+        }
+    }
+}
+
 /// generate texture coordinates:
 void meshUtils::genTexCoords(proMesh & m, const vec2f & texScale) {
     if(m.fNormals().size()!=m.indices().size()/3) genFNormals(m);
@@ -120,6 +186,12 @@ void meshUtils::genTexCoords(proMesh & m, const vec2f & texScale) {
 }
 
 void meshUtils::zup2yup(proMesh & m) {
+    if(m.storage()==proMesh::STORAGE_SOA) {
+        m.soaCoords().zup2yup();
+        m.soaFNormals().zup2yup();
+        m.soaVNormals().zup2yup();
+        return;
+    }
     float f;
     for(unsigned i=0; i<m.coords().size(); ++i) {
         f=m.coords()[i][Y];
@@ -139,6 +211,12 @@ void meshUtils::zup2yup(proMesh & m) {
 }
 
 void meshUtils::yup2zup(proMesh & m) {
+    if(m.storage()==proMesh::STORAGE_SOA) {
+        m.soaCoords().yup2zup();
+        m.soaFNormals().yup2zup();
+        m.soaVNormals().yup2zup();
+        return;
+    }
     float f;
     for(unsigned i=0; i<m.coords().size(); ++i) {
         f=m.coords()[i][Y];
@@ -239,29 +317,104 @@ unsigned int meshUtils::subdivide(proMesh & mesh, float maxDist) {
 
 unsigned int meshUtils::subdivide(proNode & node, float maxDist, bool ignoreTransp) {
     unsigned int nTriangles=0;
-    if(node.type()==proMesh::TYPE) {
+    if(node.typeId()==proNode::TYPE_MESH) {
         if(ignoreTransp&&(node.flags()&FLAG_TRANSPARENT))
             nTriangles+=static_cast<unsigned int>(((proMesh*)(&node))->indices().size())/3;
         else nTriangles+=subdivide(*((proMesh*)(&node)),maxDist);
     }
-    else if((node.type()==proTransform::TYPE)||(node.type()==proScene::TYPE)) {
-        proTransform & transf=*dynamic_cast<proTransform*>(&node);
-        if(&transf) for(size_t n=0; n<transf.size(); ++n)
+    else if(node.typeId()&proNode::TYPE_TRANSFORM) {
+        proTransform & transf=*static_cast<proTransform*>(&node);
+        for(size_t n=0; n<transf.size(); ++n)
             nTriangles+=subdivide(*(transf[n]),maxDist,ignoreTransp);
     }
     return nTriangles;
 }
 
+/// lock serializing the merging of concurrently measured load reports
+static Mutex s_reportMutex;
+
+/// an auxiliary task preparing a single mesh within a ThreadPool
+class PrepareTask : public ThreadPool::Task {
+public:
+    /// constructor
+    PrepareTask(proMesh & mesh, bool edgeList, LoadReport * pReport) : m_mesh(mesh), m_edgeList(edgeList), mp_report(pReport) { }
+    /// prepares the mesh, merges the measured stages into the report
+    virtual void run() {
+        LoadReport report;
+        if(mp_report) report.begin();
+        m_mesh.prepare(m_edgeList);
+        if(!mp_report) return;
+        report.end();
+        MutexLock lock(s_reportMutex);
+        mp_report->merge(report);
+    }
+protected:
+    /// the mesh to be prepared
+    proMesh & m_mesh;
+    /// determines whether an edge list is built
+    bool m_edgeList;
+    /// report receiving the measured stages, 0 if none
+    LoadReport * mp_report;
+};
+
+/// recursively pushes a PrepareTask for each mesh of a node
+static void pushPrepareTasks(proNode & node, bool edgeList, ThreadPool & pool, LoadReport * pReport) {
+    if(node.typeId()==proNode::TYPE_MESH)
+        pool.push(new PrepareTask(*static_cast<proMesh*>(&node), edgeList, pReport));
+    else if(node.typeId()&proNode::TYPE_TRANSFORM) {
+        proTransform & transf=*static_cast<proTransform*>(&node);
+        for(size_t n=0; n<transf.size(); ++n)
+            pushPrepareTasks(*(transf[n]),edgeList,pool,pReport);
+    }
+}
+
+void meshUtils::prepare(proNode & node, bool edgeList, ThreadPool * pPool) {
+    if(pPool) {
+        pushPrepareTasks(node,edgeList,*pPool,LoadReport::active());
+        if(!ThreadPool::inTask()) pPool->wait();
+    }
+    else if(node.typeId()==proNode::TYPE_MESH)
+        static_cast<proMesh*>(&node)->prepare(edgeList);
+    else if(node.typeId()&proNode::TYPE_TRANSFORM) {
+        proTransform & transf=*static_cast<proTransform*>(&node);
+        for(size_t n=0; n<transf.size(); ++n)
+            prepare(*(transf[n]),edgeList);
+    }
+}
+
 
 //--- class ModelMgr --------------------------------------------
 
 ModelMgr* ModelMgr::sp_instance = 0;
 
-ModelMgr::ModelMgr() { 
+ModelMgr::ModelMgr() : m_cache(false), mp_pool(0), mp_asyncPool(0), m_asyncCounter(0) { 
 	loaderRegister(loadRaw,"txt"); 
 	loaderRegister(loadRaw,"raw"); 
 	loaderRegister(loadX3d,"x3d"); 
 	saverRegister(saveX3d,"x3d"); 
+	loaderRegister(loadPbin,"pbin"); 
+	saverRegister(savePbin,"pbin"); 
+}
+
+ModelMgr::~ModelMgr() {
+	delete mp_asyncPool;
+	delete mp_pool;
+}
+
+/// sets up lazily initialized shared state of the loaders before any loader thread runs
+static void initLoaderState() {
+	Xml xCodes; // registers the default xml escape codes
+	MaterialMgr::singleton();
+	TextureMgr::singleton();
+}
+
+ThreadPool & ModelMgr::pool() {
+	MutexLock lock(m_mutex);
+	if(!mp_pool) {
+		initLoaderState();
+		mp_pool = new ThreadPool;
+	}
+	return *mp_pool;
 }
 
 void ModelMgr::loaderRegister(proNode *(*loadFunc)(const std::string &), const std::string & suffix) {
@@ -280,7 +433,7 @@ bool ModelMgr::saverAvailable(const std::string & suffix) const {
 	return mm_saver.find(toLower(suffix))!=mm_saver.end(); 
 }
 
-proNode * ModelMgr::load(const std::string & filename) {
+proNode * ModelMgr::load(const std::string & filename, LoadReport * pReport) {
 	if(filename.rfind('.')>filename.size()) return 0;
 	string suffix=toLower(filename.substr(filename.rfind('.')+1));
 	map<string, proNode * (*)(const string &)>::iterator it = mm_loader.find(suffix);
@@ -288,7 +441,197 @@ proNode * ModelMgr::load(const std::string & filename) {
 	string fname(io::unifyPath(filename));
 	if(fname.rfind('/')<fname.size())
 	TextureMgr::singleton().searchPathAppend(fname.substr(0,fname.rfind('/')+1));
-	return it!=mm_loader.end() ? (*(it->second))(fname) : 0;
+	if(pReport) pReport->begin();
+	proNode * pNode = 0;
+	{
+		LoadStage stage("load");
+		const bool useCache = m_cache && (suffix!="pbin");
+		const string fnCache(fname+".pbin");
+		if(useCache) { // outdated or incompatible cache files are rejected by the loader
+			it = mm_loader.find("pbin");
+			if((it!=mm_loader.end())&&io::fileExist(fnCache))
+				pNode = (*(it->second))(fnCache);
+			it = mm_loader.find(suffix);
+		}
+		if(!pNode) {
+			pNode = (*(it->second))(fname);
+			if(pNode&&useCache&&saverAvailable("pbin")) {
+				meshUtils::prepare(*pNode, proNode::renderer()!=0, ThreadPool::inTask() ? 0 : &pool());
+				LoadStage stageCache("writeCache");
+				save(*pNode, fnCache);
+			}
+		}
+	}
+	if(pReport) pReport->end();
+	return pNode;
+}
+
+/// an auxiliary task loading a single model file within a ThreadPool
+class LoadTask : public ThreadPool::Task {
+public:
+    /// constructor
+    LoadTask(const std::string & filename, proNode *& pModel, LoadReport * pReport) : m_filename(filename), m_pModel(pModel), mp_report(pReport) { }
+    /// loads the file and pushes tasks preparing its meshes
+    virtual void run() {
+        if(mp_report) mp_report->begin();
+        ModelMgr & mgr = ModelMgr::singleton();
+        m_pModel = mgr.load(m_filename);
+        if(m_pModel) meshUtils::prepare(*m_pModel, proNode::renderer()!=0, &mgr.pool());
+        if(mp_report) mp_report->end();
+    }
+protected:
+    /// path of the file to be loaded
+    std::string m_filename;
+    /// receives the loaded model
+    proNode *& m_pModel;
+    /// report of this file, 0 if none
+    LoadReport * mp_report;
+};
+
+size_t ModelMgr::load(const std::vector<std::string> & vFilename, std::vector<proNode*> & vModel, LoadReport * pReport) {
+	vModel.assign(vFilename.size(), 0);
+	vector<LoadReport> vReport(pReport ? vFilename.size() : 0);
+	if(pReport) pReport->begin();
+	{
+		LoadStage stage("loadParallel");
+		ThreadPool & tp = pool();
+		for(size_t i=0; i<vFilename.size(); ++i)
+			tp.push(new LoadTask(vFilename[i], vModel[i], pReport ? &vReport[i] : 0));
+		tp.wait();
+		for(size_t i=0; i<vReport.size(); ++i)
+			pReport->merge(vReport[i]);
+	}
+	if(pReport) pReport->end();
+	size_t nLoaded = 0;
+	for(size_t i=0; i<vModel.size(); ++i)
+		if(vModel[i]) ++nLoaded;
+	return nLoaded;
+}
+
+/// an auxiliary task loading a model in the background for ModelMgr::loadAsync()
+class AsyncLoadTask : public ThreadPool::Task {
+public:
+    /// claims the oldest queued request, loads and prepares its model, decodes its textures, and hands it over to ModelMgr::finalize()
+    virtual void run() {
+        ModelMgr & mgr = ModelMgr::singleton();
+        ModelMgr::AsyncRequest * pRequest = 0;
+        {
+            MutexLock lock(mgr.m_mutex);
+            for(map<unsigned int, ModelMgr::AsyncRequest>::iterator it=mgr.mm_async.begin(); !pRequest&&(it!=mgr.mm_async.end()); ++it)
+                if(it->second.state==ModelMgr::ASYNC_QUEUED) pRequest = &it->second;
+            if(!pRequest) return;
+            pRequest->state = ModelMgr::ASYNC_LOADING;
+        }
+        proNode * pModel = mgr.load(pRequest->filename);
+        vector<proNode*> vInit;
+        vector<string> vTexName;
+        if(pModel) {
+            meshUtils::prepare(*pModel, proNode::renderer()!=0);
+            collect(*pModel, vInit, vTexName);
+        }
+        MutexLock lock(mgr.m_mutex);
+        pRequest->pModel = pModel;
+        pRequest->vInit.swap(vInit);
+        pRequest->vTexName.swap(vTexName);
+        pRequest->state = pModel ? ModelMgr::ASYNC_FINALIZING : ModelMgr::ASYNC_FAILED;
+    }
+protected:
+    /// recursively collects the nodes of a model, children before their parents, and preloads textures
+    static void collect(proNode & node, vector<proNode*> & vInit, vector<string> & vTexName) {
+        if(node.typeId()&proNode::TYPE_TRANSFORM) {
+            proTransform & transf=*static_cast<proTransform*>(&node);
+            for(size_t n=0; n<transf.size(); ++n)
+                collect(*(transf[n]), vInit, vTexName);
+        }
+        else if((node.typeId()==proNode::TYPE_MESH)&&static_cast<proMesh*>(&node)->material().texName().size()) {
+            const string & texName = static_cast<proMesh*>(&node)->material().texName();
+            TextureMgr::singleton().preload(texName);
+            vTexName.push_back(texName);
+        }
+        vInit.push_back(&node);
+    }
+};
+
+unsigned int ModelMgr::loadAsync(const std::string & filename, proTransform & parent) {
+	if(filename.rfind('.')>filename.size()) return 0;
+	if(!loaderAvailable(filename.substr(filename.rfind('.')+1))) return 0;
+	MutexLock lock(m_mutex);
+	if(!mp_asyncPool) {
+		initLoaderState();
+		mp_asyncPool = new ThreadPool(1);
+	}
+	mm_async.insert(make_pair(++m_asyncCounter, AsyncRequest(filename, parent)));
+	mp_asyncPool->push(new AsyncLoadTask);
+	return m_asyncCounter;
+}
+
+size_t ModelMgr::finalize(double timeBudget) {
+	const double tEnd = io::time()+timeBudget;
+	bool finalized = false;
+	size_t nPending = 0;
+	for(map<unsigned int, AsyncRequest>::iterator it=mm_async.begin(); it!=mm_async.end(); ) {
+		AsyncRequest & request = it->second;
+		{
+			MutexLock lock(m_mutex);
+			if(request.state==ASYNC_FAILED) {
+				// the loader task no longer refers to finished requests:
+				mv_asyncFailed.push_back(it->first);
+				mm_async.erase(it++);
+				continue;
+			}
+			if(request.state!=ASYNC_FINALIZING) {
+				++nPending;
+				++it;
+				continue;
+			}
+		}
+		// once handed over, the request is exclusively accessed by the calling thread:
+		while((request.nInit<request.vInit.size())&&(!finalized||(io::time()<tEnd))) {
+			proNode * pNode = request.vInit[request.nInit++];
+			if(pNode->typeId()&proNode::TYPE_TRANSFORM)
+				pNode->proNode::initGraphics(); // its children are already finalized
+			else pNode->initGraphics();
+			finalized = true;
+		}
+		if(request.nInit<request.vInit.size()) {
+			++nPending;
+			++it;
+			continue;
+		}
+		request.pParent->append(request.pModel, false);
+		// textures preloaded but not requested by initGraphics() would otherwise be kept forever:
+		for(size_t i=0; i<request.vTexName.size(); ++i)
+			TextureMgr::singleton().discard(request.vTexName[i]);
+		MutexLock lock(m_mutex);
+		mm_async.erase(it++);
+	}
+	return nPending;
+}
+
+ModelMgr::AsyncState ModelMgr::asyncState(unsigned int id) const {
+	MutexLock lock(m_mutex);
+	map<unsigned int, AsyncRequest>::const_iterator it=mm_async.find(id);
+	if(it!=mm_async.end()) return it->second.state;
+	if(!id||(id>m_asyncCounter)) return ASYNC_NONE;
+	// finished requests are removed by finalize():
+	return (find(mv_asyncFailed.begin(), mv_asyncFailed.end(), id)==mv_asyncFailed.end()) ? ASYNC_DONE : ASYNC_FAILED;
+}
+
+float ModelMgr::progress(unsigned int id) const {
+	MutexLock lock(m_mutex);
+	if(id&&!mm_async.count(id)) // unknown or already removed by finalize()
+		return (id<=m_asyncCounter) ? 1.0f : 0.0f;
+	float sum = 0.0f;
+	unsigned int n = 0;
+	for(map<unsigned int, AsyncRequest>::const_iterator it=mm_async.begin(); it!=mm_async.end(); ++it) {
+		if(id ? (it->first!=id) : (it->second.state==ASYNC_FAILED)) continue;
+		const AsyncRequest & request = it->second;
+		if(request.state==ASYNC_FINALIZING)
+			sum+=0.5f+0.5f*static_cast<float>(request.nInit)/static_cast<float>(request.vInit.size());
+		else if(request.state==ASYNC_FAILED) sum+=1.0f;
+		++n;
+	}
+	return n ? sum/static_cast<float>(n) : id ? 0.0f : 1.0f;
 }
 
 int ModelMgr::save(const proNode & model, const std::string & filename) {
@@ -338,21 +681,387 @@ proNode * ModelMgr::loadRaw(const string & filename) {
 }
 
 proNode * ModelMgr::loadX3d(const std::string & filename) {
-	return proNode::interpret(Xml::load(filename)); 
+	MappedFile file;
+	{
+		LoadStage stage("readFile");
+		if(!file.open(filename)) {
+			cerr << "ModelMgr::loadX3d() ERROR: could not open file \"" << filename << "\".\n";
+			return 0;
+		}
+		stage.bytes(file.size());
+	}
+	return proNode::interpret(file.data(), file.size()); 
 }
 
 int ModelMgr::saveX3d(const proNode & model, const std::string & filename) {
-	Xml xml("X3D");
-	xml.attr("version","3.0");
-	xml.attr("profile","Interchange");
-	Xml head("head");
-	Xml meta("meta");
-	meta.attr("name","filename");
-	meta.attr("content",filename);
-	xml.append(head).append(meta);
-	xml.append(model.xml());
-	xml.child(xml.nChildren()-1).first->tag("Scene");
-	return xml.save(filename);
+    FileWriter file;
+    if(!file.open(filename)) {
+        cerr << "ModelMgr::saveX3d() ERROR: could not open file \"" << filename << "\".\n";
+        return 1;
+    }
+    file << "<?xml version=\"1.0\"?>\n<!-- generated by protea::Xml -->\n\n";
+    XmlWriter writer(file);
+    writer.begin("X3D");
+    writer.attr("version","3.0");
+    writer.attr("profile","Interchange");
+    writer.begin("head");
+    writer.begin("meta");
+    writer.attr("name","filename");
+    writer.attr("content",filename);
+    writer.end();
+    writer.end();
+    model.x3d(writer,"Scene");
+    writer.end();
+    if(!file.close()) {
+        cerr << "ModelMgr::saveX3d() ERROR: could not write file \"" << filename << "\".\n";
+        return 1;
+    }
+    return 0;
+}
+
+//--- binary model cache -------------------------------------------
+
+/// version of the binary model cache format, to be increased with any layout change
+static const unsigned int PBIN_VERSION = 1;
+/// byte order mark of the binary model cache format
+static const unsigned int PBIN_BYTE_ORDER = 0x01020304;
+/// index marking the absence of a parent node or a material
+static const unsigned int PBIN_NONE = 0xFFFFFFFF;
+/// symbolic names of the mesh arrays stored per node
+enum { PBIN_COORD=0, PBIN_NORMAL, PBIN_FNORMAL, PBIN_TEXCOORD, PBIN_COLOR, PBIN_INDEX, PBIN_EDGE, PBIN_ARRAYS };
+
+/// an auxiliary struct referring to an array within a binary model cache file
+struct PbinArray {
+	/// byte offset relative to the file start, aligned to 16 bytes
+	unsigned int offset;
+	/// number of elements
+	unsigned int count;
+};
+
+/// an auxiliary struct forming the header of a binary model cache file
+struct PbinHeader {
+	/// file identifier "PBIN"
+	char magic[4];
+	/// format version
+	unsigned int version;
+	/// PBIN_BYTE_ORDER in the byte order of the writing machine
+	unsigned int byteOrder;
+	/// element sizes of vec2f, vec3f, proMesh::edge, and PbinNode on the writing machine
+	unsigned int elemSize[4];
+	/// size of the source file in bytes, <0.0 if unknown
+	double srcSize;
+	/// modification time of the source file, <0.0 if unknown
+	double srcTime;
+	/// node table in pre-order, parents precede their subnodes
+	PbinArray nodes;
+	/// material table, each element is a PbinArray referring to the xml statement of a material
+	PbinArray materials;
+};
+
+/// an auxiliary struct describing a node within a binary model cache file
+struct PbinNode {
+	/// node type id
+	unsigned int type;
+	/// index of the parent node, PBIN_NONE for the root node
+	unsigned int parent;
+	/// node flags
+	unsigned int flags;
+	/// node query flags
+	unsigned int queryFlags;
+	/// characters of the node name
+	PbinArray name;
+	/// meshes: index into the material table or PBIN_NONE
+	unsigned int material;
+	/// meshes: kind of stored data, transforms: nonzero if the matrix is not an identity
+	unsigned int kind;
+	/// transforms: matrix, lights: position, ambient, diffuse, specular, and shadow color, range
+	float value[21];
+	/// mesh arrays
+	PbinArray array[PBIN_ARRAYS];
+};
+
+/// returns the filename of the source of a cache file, an empty string if it cannot be derived
+static string pbinSource(const string & filename) {
+	const size_t pos = filename.size()-5;
+	if((filename.size()<6)||(toLower(filename.substr(pos))!=".pbin")) return "";
+	const string src(filename.substr(0,pos));
+	return (src.rfind('.')<src.size())&&((src.rfind('/')>src.size())||(src.rfind('/')<src.rfind('.'))) ? src : "";
+}
+
+/// appends n elements of elemSize bytes at pData to buf at a 16 byte aligned offset
+static PbinArray pbinAppend(vector<char> & buf, const void * pData, size_t elemSize, size_t n) {
+	PbinArray arr = { 0, static_cast<unsigned int>(n) };
+	if(!n) return arr;
+	buf.resize((buf.size()+15)&~size_t(15));
+	arr.offset = static_cast<unsigned int>(buf.size());
+	buf.insert(buf.end(), static_cast<const char*>(pData), static_cast<const char*>(pData)+elemSize*n);
+	return arr;
+}
+
+/// appends the elements of v to buf at a 16 byte aligned offset
+template <class T> static PbinArray pbinAppend(vector<char> & buf, const constArray<T> & v) {
+	return pbinAppend(buf, v.data(), sizeof(T), v.size());
+}
+
+/// appends the elements of v to buf at a 16 byte aligned offset
+template <class T> static PbinArray pbinAppend(vector<char> & buf, const vector<T> & v) {
+	return pbinAppend(buf, constArray<T>(v));
+}
+
+/// returns true if arr refers to elements of elemSize bytes within a file of size bytes
+static bool pbinValid(const PbinArray & arr, size_t elemSize, size_t size) {
+	return !arr.count || ((arr.offset<=size)&&(arr.count<=(size-arr.offset)/elemSize));
+}
+
+/// copies the elements referred to by arr into v, returns false if arr is invalid
+template <class T> static bool pbinRead(const char * pData, size_t size, const PbinArray & arr, vector<T> & v) {
+	if(!pbinValid(arr, sizeof(T), size)) return false;
+	const T * pBegin = reinterpret_cast<const T*>(pData+arr.offset); // offsets are aligned
+	v.assign(pBegin, pBegin+arr.count);
+	return true;
+}
+
+/// lets v refer to the elements referred to by arr in place, returns false if arr is invalid
+template <class T> static bool pbinRead(const char * pData, size_t size, const PbinArray & arr, constArray<T> & v) {
+	if(!pbinValid(arr, sizeof(T), size)) return false;
+	v = constArray<T>(reinterpret_cast<const T*>(pData+arr.offset), arr.count); // offsets are aligned
+	return true;
+}
+
+/// returns true if all indices of a mesh read from a cache file refer to existing elements
+/** Meshes are rendered from the mapped file in place, so that corrupt indices must not reach OpenGL. */
+static bool pbinValidIndices(const proMesh & mesh) {
+	const size_t nCoord = mesh.coordArray().size();
+	const constArray<unsigned int> vIndex(mesh.indexArray());
+	for(size_t i=0; i<vIndex.size(); ++i) if(vIndex[i]>=nCoord) return false;
+	// per vertex arrays are indexed alike:
+	const size_t nNormal = mesh.vNormalArray().size(), nTexCoord = mesh.texCoordArray().size(),
+		nColor = mesh.vertexColorArray().size();
+	if((nNormal&&(nNormal<nCoord))||(nTexCoord&&(nTexCoord<nCoord))||(nColor&&(nColor<nCoord))) return false;
+	// face normals refer to triangles of the index array, edges to vertices and face normals:
+	const size_t nFace = mesh.fNormalArray().size();
+	if(nFace>vIndex.size()/3) return false;
+	const constArray<proMesh::edge> vEdge(mesh.edgeArray());
+	for(size_t i=0; i<vEdge.size(); ++i)
+		if((vEdge[i].vertexIndex[0]>=nCoord)||(vEdge[i].vertexIndex[1]>=nCoord)
+			||(vEdge[i].normalIndex[0]>=nFace)||(vEdge[i].normalIndex[1]>=nFace)) return false;
+	return true;
+}
+
+/// appends node and its supported subnodes in pre-order to v, together with their parent indices
+static void pbinCollect(const proNode & node, unsigned int parent, vector< pair<const proNode*,unsigned int> > & v) {
+	const unsigned int type = node.typeId();
+	if((type!=proNode::TYPE_MESH)&&(type!=proNode::TYPE_LIGHT)&&!(type&proNode::TYPE_TRANSFORM)) {
+		cerr << "ModelMgr::savePbin() WARNING: node type \"" << node.type() << "\" not supported, skipped.\n";
+		return;
+	}
+	const unsigned int index = static_cast<unsigned int>(v.size());
+	v.push_back(make_pair(&node, parent));
+	if(type&proNode::TYPE_TRANSFORM) {
+		const proTransform & transf = *static_cast<const proTransform*>(&node);
+		for(size_t n=0; n<transf.size(); ++n)
+			pbinCollect(*(transf[n]), index, v);
+	}
+}
+
+int ModelMgr::savePbin(const proNode & model, const std::string & filename) {
+	vector< pair<const proNode*,unsigned int> > vNode;
+	pbinCollect(model, PBIN_NONE, vNode);
+	if(vNode.empty()) return -1;
+
+	PbinHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "PBIN", 4);
+	header.version = PBIN_VERSION;
+	header.byteOrder = PBIN_BYTE_ORDER;
+	header.elemSize[0] = sizeof(vec2f);
+	header.elemSize[1] = sizeof(vec3f);
+	header.elemSize[2] = sizeof(proMesh::edge);
+	header.elemSize[3] = sizeof(PbinNode);
+	const string src(pbinSource(filename));
+	header.srcTime = src.size() ? io::fileTime(src) : -1.0;
+	header.srcSize = (header.srcTime>=0.0) ? static_cast<double>(io::fileSize(src)) : -1.0;
+
+	vector<char> buf(sizeof(PbinHeader));
+	vector<PbinNode> vRec(vNode.size());
+	vector<proMaterial> vMat;
+	for(size_t i=0; i<vNode.size(); ++i) {
+		const proNode & node = *vNode[i].first;
+		PbinNode & rec = vRec[i];
+		memset(&rec, 0, sizeof(rec));
+		rec.type = (node.typeId()&proNode::TYPE_TRANSFORM) ? static_cast<unsigned int>(proNode::TYPE_TRANSFORM) : node.typeId();
+		rec.parent = vNode[i].second;
+		rec.flags = node.flags();
+		rec.queryFlags = node.queryFlags();
+		rec.name = pbinAppend(buf, node.name().data(), 1, node.name().size());
+		rec.material = PBIN_NONE;
+		if(rec.type==proNode::TYPE_TRANSFORM) {
+			const proTransform & transf = *static_cast<const proTransform*>(&node);
+			rec.kind = !transf.matrix().isIdentity();
+			for(unsigned int j=0; j<16; ++j) rec.value[j] = transf.matrix()[j];
+		}
+		else if(rec.type==proNode::TYPE_LIGHT) {
+			const proLight & light = *static_cast<const proLight*>(&node);
+			const vec4f * pVec[5] = { &light.pos(), &light.ambient(), &light.diffuse(), &light.specular(), &light.shadow() };
+			for(unsigned int j=0; j<20; ++j) rec.value[j] = (*pVec[j/4])[j%4];
+			rec.value[20] = light.range();
+		}
+		else { // TYPE_MESH
+			const proMesh & mesh = *static_cast<const proMesh*>(&node);
+			rec.kind = mesh.kind();
+			if((mesh.material()!=proMaterial())||mesh.material().name().size()) {
+				// proMaterial::operator== disregards names, shared materials are identified by both
+				for(rec.material=0; rec.material<vMat.size(); ++rec.material)
+					if((vMat[rec.material]==mesh.material())&&(vMat[rec.material].name()==mesh.material().name())) break;
+				if(rec.material==vMat.size()) vMat.push_back(mesh.material());
+			}
+			vector<vec3f> vScratch; // gathers STORAGE_SOA data, leaves the mesh layout unchanged
+			rec.array[PBIN_COORD] = pbinAppend(buf, mesh.coordArray(vScratch));
+			rec.array[PBIN_NORMAL] = pbinAppend(buf, mesh.vNormalArray(vScratch));
+			rec.array[PBIN_FNORMAL] = pbinAppend(buf, mesh.fNormalArray(vScratch));
+			rec.array[PBIN_TEXCOORD] = pbinAppend(buf, mesh.texCoordArray());
+			rec.array[PBIN_COLOR] = pbinAppend(buf, mesh.vertexColorArray());
+			rec.array[PBIN_INDEX] = pbinAppend(buf, mesh.indexArray());
+			rec.array[PBIN_EDGE] = pbinAppend(buf, mesh.edgeArray());
+		}
+	}
+	vector<PbinArray> vMatRec(vMat.size());
+	for(size_t i=0; i<vMat.size(); ++i) {
+		const string s(vMat[i].xml().str());
+		vMatRec[i] = pbinAppend(buf, s.data(), 1, s.size());
+	}
+	header.materials = pbinAppend(buf, vMatRec);
+	header.nodes = pbinAppend(buf, vRec);
+	memcpy(&buf[0], &header, sizeof(header));
+
+	// meshes of earlier loads may still map the file, hence it is replaced instead of overwritten:
+	const string fnTemp(io::tempName(filename)); // concurrent writers of the same cache do not share a temporary file
+	FILE * fp = fopen(fnTemp.c_str(), "wb");
+	if(!fp) {
+		cerr << "ModelMgr::savePbin() ERROR: could not write file \"" << filename << "\".\n";
+		return 1;
+	}
+	const size_t nWritten = fwrite(&buf[0], 1, buf.size(), fp);
+	if((fclose(fp)!=0)||(nWritten!=buf.size())||!io::rename(fnTemp, filename)) {
+		cerr << "ModelMgr::savePbin() ERROR: could not write file \"" << filename << "\".\n";
+		remove(fnTemp.c_str());
+		return 1;
+	}
+	return 0;
+}
+
+proNode * ModelMgr::loadPbin(const std::string & filename) {
+	SharedFile * pFile = new SharedFile; // the meshes refer to its content and share ownership
+	{
+		LoadStage stage("readFile");
+		if(!pFile->open(filename)) {
+			cerr << "ModelMgr::loadPbin() ERROR: could not open file \"" << filename << "\".\n";
+			pFile->unref();
+			return 0;
+		}
+		stage.bytes(pFile->size());
+	}
+	proNode * pRoot = pbinInterpret(filename, *pFile);
+	pFile->unref();
+	return pRoot;
+}
+
+proNode * ModelMgr::pbinInterpret(const std::string & filename, SharedFile & file) {
+	LoadStage stage("readCache");
+	const char * pData = file.data();
+	const size_t size = file.size();
+	PbinHeader header;
+	if(size<sizeof(header)) return 0;
+	memcpy(&header, pData, sizeof(header));
+	if(memcmp(header.magic, "PBIN", 4)||(header.version!=PBIN_VERSION)||(header.byteOrder!=PBIN_BYTE_ORDER)
+		||(header.elemSize[0]!=sizeof(vec2f))||(header.elemSize[1]!=sizeof(vec3f))
+		||(header.elemSize[2]!=sizeof(proMesh::edge))||(header.elemSize[3]!=sizeof(PbinNode))) {
+		cerr << "ModelMgr::loadPbin() WARNING: \"" << filename << "\" has an incompatible format.\n";
+		return 0;
+	}
+	const string src(pbinSource(filename));
+	if(src.size()&&io::fileExist(src) // outdated cache file
+		&&((io::fileTime(src)!=header.srcTime)||(static_cast<double>(io::fileSize(src))!=header.srcSize))) return 0;
+
+	vector<PbinArray> vMatRec;
+	vector<PbinNode> vRec;
+	if(!pbinRead(pData, size, header.materials, vMatRec)||!pbinRead(pData, size, header.nodes, vRec)) {
+		cerr << "ModelMgr::loadPbin() ERROR: \"" << filename << "\" is corrupt.\n";
+		return 0;
+	}
+	vector<proMaterial> vMat(vMatRec.size());
+	for(size_t i=0; i<vMatRec.size(); ++i) if(pbinValid(vMatRec[i], 1, size)) {
+		Xml xs;
+		xs.eval(string(pData+vMatRec[i].offset, vMatRec[i].count));
+		vMat[i] = MaterialMgr::singleton()[MaterialMgr::singleton().add(proMaterial(xs))];
+	}
+
+	vector<proNode*> vNode(vRec.size(), static_cast<proNode*>(0));
+	bool valid = true;
+	for(size_t i=0; i<vRec.size(); ++i) {
+		const PbinNode & rec = vRec[i];
+		proNode * pNode = 0;
+		if(rec.type==proNode::TYPE_TRANSFORM) {
+			proTransform * pTransf = new proTransform;
+			if(rec.kind) {
+				mat4f m;
+				for(unsigned int j=0; j<16; ++j) m[j] = rec.value[j];
+				pTransf->set(m);
+			}
+			pNode = pTransf;
+		}
+		else if(rec.type==proNode::TYPE_LIGHT) {
+			proLight * pLight = new proLight(vec4f(rec.value[0], rec.value[1], rec.value[2], rec.value[3]));
+			pLight->ambient(vec4f(rec.value[4], rec.value[5], rec.value[6], rec.value[7]));
+			pLight->diffuse(vec4f(rec.value[8], rec.value[9], rec.value[10], rec.value[11]));
+			pLight->specular(vec4f(rec.value[12], rec.value[13], rec.value[14], rec.value[15]));
+			pLight->shadow(vec4f(rec.value[16], rec.value[17], rec.value[18], rec.value[19]));
+			pLight->range(rec.value[20]);
+			pNode = pLight;
+		}
+		else if(rec.type==proNode::TYPE_MESH) {
+			proMesh * pMesh = new proMesh;
+			pMesh->m_kind = rec.kind;
+			pMesh->m_storage = proMesh::STORAGE_EXTERNAL; // zero-copy, the arrays remain in the mapped file
+			pMesh->mp_file = &file;
+			file.ref();
+			valid = pbinRead(pData, size, rec.array[PBIN_COORD], pMesh->m_coordExt)
+				&& pbinRead(pData, size, rec.array[PBIN_NORMAL], pMesh->m_normalExt)
+				&& pbinRead(pData, size, rec.array[PBIN_FNORMAL], pMesh->m_fNormalExt)
+				&& pbinRead(pData, size, rec.array[PBIN_TEXCOORD], pMesh->m_texCoordExt)
+				&& pbinRead(pData, size, rec.array[PBIN_COLOR], pMesh->m_colorExt)
+				&& pbinRead(pData, size, rec.array[PBIN_INDEX], pMesh->m_indexExt)
+				&& pbinRead(pData, size, rec.array[PBIN_EDGE], pMesh->m_edgeExt)
+				&& pbinValidIndices(*pMesh);
+			if(rec.material<vMat.size()) pMesh->m_mat = vMat[rec.material];
+			stage.elements(pMesh->m_coordExt.size());
+			pNode = pMesh;
+		}
+		if(!valid||!pNode) {
+			delete pNode;
+			valid = false;
+			break;
+		}
+		if(pbinValid(rec.name, 1, size)) pNode->name(string(pData+rec.name.offset, rec.name.count));
+		pNode->flags() = rec.flags;
+		pNode->queryFlags(rec.queryFlags);
+		if(!i&&(rec.parent==PBIN_NONE)) vNode[i] = pNode;
+		else if(i&&(rec.parent<i)&&(vRec[rec.parent].type==proNode::TYPE_TRANSFORM)) {
+			vNode[i] = pNode;
+			static_cast<proTransform*>(vNode[rec.parent])->append(pNode, false);
+		}
+		else {
+			delete pNode;
+			valid = false;
+			break;
+		}
+	}
+	if(!valid) {
+		cerr << "ModelMgr::loadPbin() ERROR: \"" << filename << "\" is corrupt.\n";
+		delete vNode[0]; // owns all attached nodes
+		return 0;
+	}
+	return vNode.size() ? vNode[0] : 0;
 }
 
 
@@ -29,8 +29,10 @@
  */
 
 #include "proMath.h"
+#include "proIo.h"
 class proMesh;
 class proNode;
+class LoadReport;
 class proTransform;
 
 /// a class collecting utility functions for mesh and global scene manipulation
@@ -40,6 +42,11 @@ public:
 	static void genFNormals(proMesh & m);
 	/// generates per vertex normals based on an optional crease angle in degrees
 	static void genVNormals(proMesh & m, float creaseAngle=30.0f);
+	/// generates per vertex normals based on per face smoothing group bit masks, as stored in 3ds files
+	/** Faces sharing a vertex are smoothed if their masks have a common bit, vertices are duplicated 
+	 where this is not the case. Faces with mask 0 are flat shaded. Falls back to the crease angle 
+	 variant if vSmoothGroup does not provide a mask per triangle. */
+	static void genVNormals(proMesh & m, const std::vector<unsigned int> & vSmoothGroup);
 	/// generates texture coordinates:
 	static void genTexCoords(proMesh & m, const vec2f & texScale=vec2f(1.0f,1.0f));
 
@@ -53,6 +60,12 @@ public:
 	/// converts a mesh from a Y up right-handed coordinate system to a Z up right-handed coordinate system
 	static void yup2zup(proMesh & m);
 
+	/// recursively computes the derived rendering data of all meshes of a node, see proMesh::prepare()
+	/** If pPool is provided, each mesh is prepared by a separate task of pPool, and the function 
+	 waits for their completion unless it is called from within a task. The stages measured by 
+	 the tasks are merged into the LoadReport active when calling. */
+	static void prepare(proNode & node, bool edgeList=true, ThreadPool * pPool=0);
+
 	/// removes all transformations from a node
 	/** all transformations are applied to the vertex coordinates */
 	static void flattenTransforms(proNode & node);
@@ -76,13 +89,48 @@ public:
 
 	/// tries to load a file using previously registered or hardcoded loader functions
 	/** \param filename path to the file to be loaded, type will be identified by suffix
+	\param pReport (optional) report receiving per stage timings and counters of the loading process
 	\return pointer to loaded model or 0. */
-	proNode * load(const std::string & filename);
+	proNode * load(const std::string & filename, LoadReport * pReport=0);
 	/// tries to save a model to a file using previously registered saver functions
 	/** \param model the model/node to be saved
 	\param filename path to the file to be loaded, type will be identified by suffix
 	\return 0 in case of success. */
 	int save(const proNode & model, const std::string & filename);
+	/// loads several files in parallel
+	/** The files are loaded by tasks of pool(), each one calling load() for a file and afterwards 
+	 preparing the meshes of the loaded model by further per mesh tasks (see meshUtils::prepare()).
+	 OpenGL resources are not touched, initGraphics() has to be called afterwards by the thread 
+	 owning the OpenGL context, and then only creates the renderables and uploads the textures.
+	\param vFilename paths of the files to be loaded
+	\param vModel receives pointers to the loaded models in the order of vFilename, 0 in case of failure
+	\param pReport (optional) report receiving the stages of all tasks, their durations are summed up
+	\return number of successfully loaded models. */
+	size_t load(const std::vector<std::string> & vFilename, std::vector<proNode*> & vModel, LoadReport * pReport=0);
+	/// returns the thread pool used for parallel loading, started on first use
+	ThreadPool & pool();
+
+	/// states of asynchronous load requests
+	enum AsyncState { ASYNC_NONE=0, ASYNC_QUEUED, ASYNC_LOADING, ASYNC_FINALIZING, ASYNC_DONE, ASYNC_FAILED };
+	/// starts loading a file in the background
+	/** A background thread loads the requested files in the order of the requests, prepares its meshes (see meshUtils::prepare()), and 
+	 decodes its textures (see TextureMgr::preload()). Afterwards, finalize() initializes the 
+	 graphics resources of the model incrementally and appends it to parent.
+	\param filename path of the file to be loaded
+	\param parent node receiving the model once it is completely finalized, must remain valid until then
+	\return id of the request, 0 if no loader is available for the file type */
+	unsigned int loadAsync(const std::string & filename, proTransform & parent);
+	/// finalizes models loaded in the background, has to be called regularly (e.g., per frame) by the thread owning the OpenGL context
+	/** Calls initGraphics() of the nodes of loaded models one by one, thereby uploading textures and 
+	 creating renderables, until timeBudget seconds are used up. At least one node is finalized per call.
+	 Completed requests are removed, asyncState() and progress() continue to report their final state.
+	\return number of requests not yet completed */
+	size_t finalize(double timeBudget=0.005);
+	/// returns the state of an asynchronous load request, ASYNC_NONE for unknown ids
+	AsyncState asyncState(unsigned int id) const;
+	/// returns the progress of an asynchronous load request between 0.0 and 1.0, or of all incomplete requests if id is 0
+	/** Background loading accounts for the first half, finalization for the second half. Completed requests report 1.0. */
+	float progress(unsigned int id=0) const;
 
 	/// registers a loader function handling a file type identified by suffix
 	/** The function has to be of type proNode * loadXYZ(const std::string & filename).*/
@@ -95,9 +143,21 @@ public:
 	bool loaderAvailable(const std::string & suffix) const;
 	/// returns true in case a saver for this kind of model file is available
 	bool saverAvailable(const std::string & suffix) const;
+
+	/// turns the binary model cache on or off, default is off
+	/** When turned on, load() prefers a cache file named after the source file plus the suffix
+	 ".pbin" (e.g., model.x3d.pbin) as long as it matches the size and modification time of the 
+	 source. Otherwise the source is loaded, its meshes are prepared via meshUtils::prepare(), and 
+	 the cache file is (re)written. Loading and saving use the loader and saver functions 
+	 registered for the suffix "pbin". */
+	void cache(bool yesno) { m_cache=yesno; }
+	/// returns true if the binary model cache is turned on
+	bool cache() const { return m_cache; }
 protected:    
 	/// default constructor registering built-in loaders and savers
 	ModelMgr();
+	/// destructor
+	~ModelMgr();
 	/// pointer to singleton instance
 	static ModelMgr* sp_instance;
 
@@ -107,6 +167,57 @@ protected:
 	static proNode * loadX3d(const std::string & filename);
 	/// built-in X3D file saver
 	static int saveX3d(const proNode & model, const std::string & filename);
+	/// built-in loader of the binary model cache format
+	/** The file is memory mapped and the meshes refer to their arrays in place without any 
+	 parsing or copying (proMesh::STORAGE_EXTERNAL), so that several processes loading the same
+	 model share the page cache. The mapping is released together with the last mesh referring 
+	 to it. Files written by an incompatible format version or architecture, and files outdated 
+	 compared to their source file (the filename without the suffix .pbin) are rejected. */
+	static proNode * loadPbin(const std::string & filename);
+	/// builds the node hierarchy stored in the binary model cache file, returns 0 if invalid
+	static proNode * pbinInterpret(const std::string & filename, SharedFile & file);
+	/// built-in saver of the binary model cache format
+	/** Stores the node hierarchy with transformation matrices, lights, materials, and all mesh 
+	 arrays including normals, texture coordinates, and edge lists, i.e., meshes should be 
+	 prepared before. If filename without the suffix .pbin refers to an existing file, its size and
+	 modification time are stored for detecting outdated caches. */
+	static int savePbin(const proNode & model, const std::string & filename);
+
+	/// an auxiliary struct storing an asynchronous load request
+	struct AsyncRequest {
+		/// constructor
+		AsyncRequest(const std::string & fname, proTransform & parent) : filename(fname), pParent(&parent), pModel(0), nInit(0), state(ASYNC_QUEUED) { }
+		/// path of the file to be loaded
+		std::string filename;
+		/// node receiving the model
+		proTransform * pParent;
+		/// loaded model
+		proNode * pModel;
+		/// nodes of the model in the order of their finalization, children before parents
+		std::vector<proNode*> vInit;
+		/// number of finalized nodes
+		size_t nInit;
+		/// textures preloaded for the model
+		std::vector<std::string> vTexName;
+		/// current state, changed under m_mutex
+		AsyncState state;
+	};
+	friend class AsyncLoadTask;
+
+	/// stores whether the binary model cache is turned on
+	bool m_cache;
+	/// thread pool for parallel loading, 0 until first use
+	ThreadPool * mp_pool;
+	/// background thread for asynchronous loading, 0 until first use
+	ThreadPool * mp_asyncPool;
+	/// asynchronous load requests by id
+	std::map<unsigned int, AsyncRequest> mm_async;
+	/// counter for generating request ids
+	unsigned int m_asyncCounter;
+	/// ids of failed requests removed by finalize()
+	std::vector<unsigned int> mv_asyncFailed;
+	/// lock protecting the thread pools and the state of asynchronous requests
+	mutable Mutex m_mutex;
 
 	/// map associating suffixes to loader functions
 	std::map<std::string, proNode * (*)(const std::string &)> mm_loader;
@@ -0,0 +1,351 @@
+#include "proProfiler.h"
+
+#ifdef _HAVE_GL
+# if defined __WIN32__ || defined WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+# endif
+# include <GL/gl.h>
+# if !defined __WIN32__ && !defined WIN32 && !defined __APPLE__
+#  include <GL/glx.h>
+# endif
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+using namespace std;
+
+//--- GL timer query access ----------------------------------------
+
+#ifdef _HAVE_GL
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP 0x8E28
+#endif
+
+/// GL_ARB_timer_query entry points, resolved at runtime
+typedef void (APIENTRY * glGenQueriesFunc)(GLsizei n, GLuint * ids);
+typedef void (APIENTRY * glDeleteQueriesFunc)(GLsizei n, const GLuint * ids);
+typedef void (APIENTRY * glQueryCounterFunc)(GLuint id, GLenum target);
+typedef void (APIENTRY * glGetQueryObjectivFunc)(GLuint id, GLenum pname, GLint * params);
+typedef void (APIENTRY * glGetQueryObjectui64vFunc)(GLuint id, GLenum pname, unsigned long long * params);
+
+static glGenQueriesFunc s_glGenQueries = 0;
+static glDeleteQueriesFunc s_glDeleteQueries = 0;
+static glQueryCounterFunc s_glQueryCounter = 0;
+static glGetQueryObjectivFunc s_glGetQueryObjectiv = 0;
+static glGetQueryObjectui64vFunc s_glGetQueryObjectui64v = 0;
+
+/// returns address of a GL extension function or 0
+static void * glProcAddress(const char * name) {
+#if defined __WIN32__ || defined WIN32
+	return (void*)wglGetProcAddress(name);
+#elif defined __APPLE__
+	return 0;
+#else
+	return (void*)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+}
+
+/// resolves timer query entry points, requires current GL context
+static bool glTimerQueryInit() {
+	const char * ext = (const char*)glGetString(GL_EXTENSIONS);
+	if(!ext || !strstr(ext, "GL_ARB_timer_query")) return false;
+	s_glGenQueries = (glGenQueriesFunc)glProcAddress("glGenQueries");
+	s_glDeleteQueries = (glDeleteQueriesFunc)glProcAddress("glDeleteQueries");
+	s_glQueryCounter = (glQueryCounterFunc)glProcAddress("glQueryCounter");
+	s_glGetQueryObjectiv = (glGetQueryObjectivFunc)glProcAddress("glGetQueryObjectiv");
+	s_glGetQueryObjectui64v = (glGetQueryObjectui64vFunc)glProcAddress("glGetQueryObjectui64v");
+	return s_glGenQueries && s_glDeleteQueries && s_glQueryCounter && s_glGetQueryObjectiv && s_glGetQueryObjectui64v;
+}
+
+#endif // _HAVE_GL
+
+//--- class Profiler -----------------------------------------------
+
+bool Profiler::s_active = false;
+Profiler * Profiler::sp_instance = 0;
+
+Profiler::Profiler() : mv_frame(256), m_current(0), m_nFrames(0), m_frameCounter(0), m_depth(0),
+	m_enabled(false), m_gpu(true), m_gpuAvailable(-1) {
+}
+
+Profiler::~Profiler() {
+	if(sp_instance==this) sp_instance=0;
+}
+
+void Profiler::capacity(unsigned int n) {
+	clear();
+	mv_frame.resize(n ? n : 1);
+}
+
+void Profiler::clear() {
+	for(size_t i=0; i<mv_frame.size(); ++i) {
+		resolve(mv_frame[i], true);
+		mv_frame[i].samples.clear();
+	}
+	m_current=0;
+	m_nFrames=0;
+	m_depth=0;
+	s_active=false;
+}
+
+void Profiler::beginFrame() {
+	if(s_active) endFrame();
+	if(!m_enabled) return;
+#ifdef _HAVE_GL
+	if(m_gpu && (m_gpuAvailable<0)) m_gpuAvailable = glTimerQueryInit() ? 1 : 0;
+#endif
+	// fetch available GPU results of previous frames:
+	for(size_t i=0; i<m_nFrames; ++i) resolve(mv_frame[(m_current+mv_frame.size()-i)%mv_frame.size()], false);
+
+	m_current = (m_current+1)%mv_frame.size();
+	Frame & frm = mv_frame[m_current];
+	resolve(frm, true); // recycle outstanding queries of overwritten frame
+	frm.samples.clear();
+	frm.number = m_frameCounter++;
+	frm.tBegin = io::time();
+	frm.duration = 0.0;
+	frm.query = 0;
+#ifdef _HAVE_GL
+	if(m_gpu && (m_gpuAvailable>0)) {
+		frm.query=queryAlloc();
+		if(frm.query) s_glQueryCounter(frm.query, GL_TIMESTAMP);
+	}
+#endif
+	frm.gpuPending = frm.query!=0;
+	m_depth=0;
+	s_active=true;
+}
+
+void Profiler::endFrame() {
+	if(!s_active) return;
+	Frame & frm = mv_frame[m_current];
+	frm.duration = io::time()-frm.tBegin;
+	if(m_nFrames<mv_frame.size()) ++m_nFrames;
+	s_active=false;
+}
+
+size_t Profiler::begin(const char * name, bool useGpu) {
+	Frame & frm = mv_frame[m_current];
+	frm.samples.push_back(Sample(name, m_depth++, io::time()-frm.tBegin));
+#ifdef _HAVE_GL
+	if(useGpu && frm.query) {
+		Sample & smp = frm.samples.back();
+		smp.query[0]=queryAlloc();
+		smp.query[1]=queryAlloc();
+		if(smp.query[0]) s_glQueryCounter(smp.query[0], GL_TIMESTAMP);
+	}
+#endif
+	return frm.samples.size()-1;
+}
+
+void Profiler::end(size_t id) {
+	Frame & frm = mv_frame[m_current];
+	if(!s_active || (id>=frm.samples.size())) return;
+	Sample & smp = frm.samples[id];
+	smp.duration = io::time()-frm.tBegin-smp.tBegin;
+#ifdef _HAVE_GL
+	if(smp.query[1]) s_glQueryCounter(smp.query[1], GL_TIMESTAMP);
+#endif
+	if(m_depth) --m_depth;
+}
+
+void Profiler::accumulate(const char * name, double duration) {
+	Frame & frm = mv_frame[m_current];
+	for(vector<Sample>::reverse_iterator it=frm.samples.rbegin(); it!=frm.samples.rend(); ++it)
+		if(it->accumulated && ((it->name==name)||!strcmp(it->name, name))) {
+			it->duration += duration;
+			++it->count;
+			return;
+		}
+	frm.samples.push_back(Sample(name, m_depth, io::time()-frm.tBegin-duration));
+	frm.samples.back().duration = duration;
+	frm.samples.back().accumulated = true;
+}
+
+const Profiler::Frame & Profiler::frame(size_t n) const {
+	size_t idx = s_active ? m_current+mv_frame.size()-n-1 : m_current+mv_frame.size()-n;
+	return mv_frame[idx%mv_frame.size()];
+}
+
+double Profiler::average(const char * name, size_t nFrames) const {
+	if(!nFrames || (nFrames>m_nFrames)) nFrames=m_nFrames;
+	if(!nFrames) return 0.0;
+	double sum=0.0;
+	for(size_t i=0; i<nFrames; ++i) {
+		const Frame & frm = frame(i);
+		for(vector<Sample>::const_iterator it=frm.samples.begin(); it!=frm.samples.end(); ++it)
+			if(!strcmp(it->name, name)) sum+=it->duration;
+	}
+	return sum/nFrames;
+}
+
+double Profiler::average(size_t nFrames) const {
+	if(!nFrames || (nFrames>m_nFrames)) nFrames=m_nFrames;
+	if(!nFrames) return 0.0;
+	double sum=0.0;
+	for(size_t i=0; i<nFrames; ++i) sum+=frame(i).duration;
+	return sum/nFrames;
+}
+
+unsigned int Profiler::queryAlloc() {
+#ifdef _HAVE_GL
+	if(m_gpuAvailable<=0) return 0;
+	if(mv_queryFree.empty()) {
+		mv_queryFree.resize(64);
+		s_glGenQueries(64, &mv_queryFree[0]);
+	}
+	unsigned int id = mv_queryFree.back();
+	mv_queryFree.pop_back();
+	return id;
+#else
+	return 0;
+#endif
+}
+
+void Profiler::resolve(Frame & frm, bool wait) {
+	if(!frm.gpuPending) return;
+#ifdef _HAVE_GL
+	if(!wait) { // test whether the last query of the frame is available:
+		GLint available=1;
+		for(vector<Sample>::reverse_iterator it=frm.samples.rbegin(); it!=frm.samples.rend(); ++it)
+			if(it->query[1]) {
+				s_glGetQueryObjectiv(it->query[1], GL_QUERY_RESULT_AVAILABLE, &available);
+				break;
+			}
+		if(!available) return;
+	}
+	unsigned long long tFrame=0, t0=0, t1=0;
+	s_glGetQueryObjectui64v(frm.query, GL_QUERY_RESULT, &tFrame);
+	mv_queryFree.push_back(frm.query);
+	for(vector<Sample>::iterator it=frm.samples.begin(); it!=frm.samples.end(); ++it) if(it->query[0]) {
+		s_glGetQueryObjectui64v(it->query[0], GL_QUERY_RESULT, &t0);
+		s_glGetQueryObjectui64v(it->query[1], GL_QUERY_RESULT, &t1);
+		it->gpuBegin = double(t0-tFrame)*1.0e-9;
+		it->gpuDuration = double(t1-t0)*1.0e-9;
+		mv_queryFree.push_back(it->query[0]);
+		mv_queryFree.push_back(it->query[1]);
+		it->query[0]=it->query[1]=0;
+	}
+	frm.query=0;
+#endif
+	frm.gpuPending=false;
+}
+
+string Profiler::chromeTrace() const {
+	string s("{\"traceEvents\":[\n");
+	s+="{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	s+="{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+	char buf[256];
+	for(size_t n=m_nFrames; n>0; --n) {
+		const Frame & frm = frame(n-1);
+		double tFrame = frm.tBegin*1.0e6;
+		sprintf(buf, ",\n{\"name\":\"frame %u\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+			frm.number, tFrame, frm.duration*1.0e6);
+		s+=buf;
+		for(vector<Sample>::const_iterator it=frm.samples.begin(); it!=frm.samples.end(); ++it) {
+			if(it->accumulated) // accumulated samples are not contiguous and therefore exported as counters
+				sprintf(buf, ",\n{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"ms\":%.4f,\"count\":%u}}",
+					it->name, tFrame, it->duration*1.0e3, it->count);
+			else sprintf(buf, ",\n{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+				it->name, tFrame+it->tBegin*1.0e6, it->duration*1.0e6);
+			s+=buf;
+			if(it->gpuDuration>=0.0) {
+				sprintf(buf, ",\n{\"name\":\"%s\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f}",
+					it->name, tFrame+it->gpuBegin*1.0e6, it->gpuDuration*1.0e6);
+				s+=buf;
+			}
+		}
+	}
+	s+="\n],\n\"displayTimeUnit\":\"ms\"}\n";
+	return s;
+}
+
+bool Profiler::saveChromeTrace(const std::string & filename) const {
+	ofstream file(filename.c_str(), ios::out);
+	if(!file.good()) {
+		fprintf(stderr, "Profiler::saveChromeTrace() ERROR: cannot open file %s.\n", filename.c_str());
+		return false;
+	}
+	file << chromeTrace();
+	return file.good();
+}
+
+//--- class LoadReport ---------------------------------------------
+
+PRO_THREAD_LOCAL LoadReport * LoadReport::sp_active = 0;
+
+void LoadReport::begin() {
+	mp_prev=sp_active;
+	sp_active=this;
+	m_depth=0;
+	m_tBegin=io::time();
+}
+
+void LoadReport::end() {
+	if(sp_active!=this) return;
+	m_duration+=io::time()-m_tBegin;
+	sp_active=mp_prev;
+	mp_prev=0;
+}
+
+size_t LoadReport::enter(const char * name) {
+	size_t id;
+	for(id=0; id<mv_stage.size(); ++id)
+		if((mv_stage[id].name==name)||!strcmp(mv_stage[id].name, name)) break;
+	if(id==mv_stage.size()) mv_stage.push_back(Stage(name, m_depth));
+	++m_depth;
+	return id;
+}
+
+void LoadReport::leave(size_t id, double duration, size_t bytes, size_t elements) {
+	if(m_depth) --m_depth;
+	Stage & stage = mv_stage[id];
+	stage.duration+=duration;
+	stage.bytes+=bytes;
+	stage.elements+=elements;
+	++stage.count;
+}
+
+void LoadReport::merge(const LoadReport & report) {
+	for(vector<Stage>::const_iterator it=report.mv_stage.begin(); it!=report.mv_stage.end(); ++it) {
+		size_t id;
+		for(id=0; id<mv_stage.size(); ++id)
+			if((mv_stage[id].name==it->name)||!strcmp(mv_stage[id].name, it->name)) break;
+		if(id==mv_stage.size()) mv_stage.push_back(Stage(it->name, m_depth+it->depth));
+		Stage & stage = mv_stage[id];
+		stage.duration+=it->duration;
+		stage.bytes+=it->bytes;
+		stage.elements+=it->elements;
+		stage.count+=it->count;
+	}
+}
+
+std::string LoadReport::str() const {
+	string s;
+	char buf[256];
+	sprintf(buf, "%-28s %10s %6s %8s %12s %10s\n", "stage", "ms", "%", "count", "bytes", "elements");
+	s+=buf;
+	for(vector<Stage>::const_iterator it=mv_stage.begin(); it!=mv_stage.end(); ++it) {
+		string name(2*it->depth, ' ');
+		name+=it->name;
+		sprintf(buf, "%-28s %10.3f %6.1f %8u %12lu %10lu\n", name.c_str(), it->duration*1.0e3, 
+			m_duration>0.0 ? it->duration*100.0/m_duration : 0.0, it->count, 
+			static_cast<unsigned long>(it->bytes), static_cast<unsigned long>(it->elements));
+		s+=buf;
+	}
+	sprintf(buf, "%-28s %10.3f\n", "total", m_duration*1.0e3);
+	s+=buf;
+	return s;
+}
@@ -0,0 +1,299 @@
+#ifndef _PRO_PROFILER_H
+#define _PRO_PROFILER_H
+
+/** @file proProfiler.h
+ \brief frame based CPU and GPU profiling and load time reports
+ */
+#include "proIo.h"
+#include <string>
+#include <vector>
+
+//--- class Profiler -----------------------------------------------
+
+/// a singleton class collecting named CPU and optionally GPU timings per frame
+/** Frame records are kept in a ring buffer and can be exported in the Chrome trace event
+ JSON format (chrome://tracing). Instrumentation is done via the ProfileScope and ProfileAccumulator
+ helper classes, which cost a single test as long as the profiler is not enabled.
+ Example :\n
+  \code
+	Profiler::singleton().enable(true);
+	while(running) {
+		Profiler::singleton().beginFrame();
+		{
+			ProfileScope scope("scene", true);
+			scene.draw(camera);
+		}
+		Profiler::singleton().endFrame();
+	}
+	Profiler::singleton().saveChromeTrace("trace.json");
+  \endcode
+*/
+class Profiler {
+public:
+	/// an auxiliary struct storing an individual measurement
+	struct Sample {
+		/// constructor initializing members
+		Sample(const char * sampleName, unsigned int sampleDepth, double begin) : name(sampleName), depth(sampleDepth),
+			tBegin(begin), duration(0.0), gpuBegin(-1.0), gpuDuration(-1.0), count(1), accumulated(false) { query[0]=query[1]=0; }
+		/// sample name, expected to be a string literal
+		const char * name;
+		/// nesting depth
+		unsigned int depth;
+		/// CPU start time in seconds relative to frame start
+		double tBegin;
+		/// CPU duration in seconds
+		double duration;
+		/// GPU start time in seconds relative to frame start, <0.0 if not measured
+		double gpuBegin;
+		/// GPU duration in seconds, <0.0 if not (yet) measured
+		double gpuDuration;
+		/// number of accumulated measurements
+		unsigned int count;
+		/// stores whether sample has been accumulated from multiple measurements
+		bool accumulated;
+		/// GL timer query ids, 0 if unused
+		unsigned int query[2];
+	};
+	/// an auxiliary struct storing all samples of a frame
+	struct Frame {
+		/// constructor
+		Frame() : number(0), tBegin(0.0), duration(0.0), query(0), gpuPending(false) { }
+		/// frame number
+		unsigned int number;
+		/// CPU start time in seconds
+		double tBegin;
+		/// CPU duration in seconds
+		double duration;
+		/// samples in order of their start
+		std::vector<Sample> samples;
+		/// GL timer query marking the frame start on the GPU, 0 if unused
+		unsigned int query;
+		/// stores whether GPU results are outstanding
+		bool gpuPending;
+	};
+
+	/// returns singleton instance
+	static Profiler & singleton() { if(!sp_instance) sp_instance = new Profiler; return *sp_instance; }
+	/// returns true if a frame is currently being recorded
+	static bool active() { return s_active; }
+
+	/// turns profiling on or off
+	void enable(bool yesno) { m_enabled=yesno; if(!yesno) s_active=false; }
+	/// returns true if profiling is turned on
+	bool enabled() const { return m_enabled; }
+	/// turns GPU timer queries on or off, requires GL_ARB_timer_query
+	void gpu(bool yesno) { m_gpu=yesno; }
+	/// returns true if GPU timer queries are requested
+	bool gpu() const { return m_gpu; }
+	/// sets number of frames kept in the ring buffer, clears all records
+	void capacity(unsigned int n);
+	/// returns number of frames kept in the ring buffer
+	unsigned int capacity() const { return static_cast<unsigned int>(mv_frame.size()); }
+
+	/// starts recording a new frame
+	void beginFrame();
+	/// finishes recording the current frame
+	void endFrame();
+	/// starts a named sample, returns its id
+	/** \param name sample name, the pointer has to remain valid, normally a string literal
+	 \param useGpu additionally measures GPU time if GPU timing is available */
+	size_t begin(const char * name, bool useGpu=false);
+	/// finishes sample id
+	void end(size_t id);
+	/// adds duration to a per frame accumulated sample, for frequently measured fine grained sections
+	void accumulate(const char * name, double duration);
+
+	/// returns number of recorded frames
+	size_t size() const { return m_nFrames; }
+	/// returns recorded frame n, 0 is the most recently completed one
+	/** Warning, for efficiency reasons no range check is performed! */
+	const Frame & frame(size_t n) const;
+	/// returns average CPU duration of a named sample in seconds over the last nFrames frames, 0 means all
+	double average(const char * name, size_t nFrames=0) const;
+	/// returns average frame duration in seconds over the last nFrames frames, 0 means all
+	double average(size_t nFrames=0) const;
+	/// clears all frame records
+	void clear();
+
+	/// returns all recorded frames in Chrome trace event JSON format
+	std::string chromeTrace() const;
+	/// saves all recorded frames as Chrome trace event JSON file
+	bool saveChromeTrace(const std::string & filename) const;
+protected:
+	/// constructor
+	Profiler();
+	/// destructor
+	~Profiler();
+	/// tries to fetch outstanding GPU results of frame, optionally blocking
+	void resolve(Frame & frame, bool wait);
+	/// returns a free GL timer query id, 0 if unavailable
+	unsigned int queryAlloc();
+
+	/// ring buffer of frame records
+	std::vector<Frame> mv_frame;
+	/// index of current frame in mv_frame
+	size_t m_current;
+	/// number of recorded frames
+	size_t m_nFrames;
+	/// frame counter
+	unsigned int m_frameCounter;
+	/// current sample nesting depth
+	unsigned int m_depth;
+	/// stores whether profiling is turned on
+	bool m_enabled;
+	/// stores whether GPU timer queries are requested
+	bool m_gpu;
+	/// stores GPU timer query availability, -1 unknown, 0 unavailable, 1 available
+	int m_gpuAvailable;
+	/// unused GL timer query ids
+	std::vector<unsigned int> mv_queryFree;
+	/// stores whether a frame is currently being recorded
+	static bool s_active;
+	/// pointer to singleton instance
+	static Profiler * sp_instance;
+};
+
+//--- class ProfileScope -------------------------------------------
+
+/// a helper class measuring the lifetime of a local scope as Profiler sample
+class ProfileScope {
+public:
+	/// constructor, starts sample
+	ProfileScope(const char * name, bool useGpu=false) : m_id(Profiler::active() ? Profiler::singleton().begin(name, useGpu) : s_none) { }
+	/// destructor, finishes sample
+	~ProfileScope() { if(m_id!=s_none) Profiler::singleton().end(m_id); }
+protected:
+	/// sample id
+	size_t m_id;
+	/// invalid sample id
+	static const size_t s_none = ~size_t(0);
+};
+
+//--- class ProfileAccumulator -------------------------------------
+
+/// a helper class adding the lifetime of a local scope to a per frame accumulated Profiler sample
+/** Intended for fine grained sections executed many times per frame, e.g., per node culling. */
+class ProfileAccumulator {
+public:
+	/// constructor, starts measurement
+	ProfileAccumulator(const char * name) : mp_name(Profiler::active() ? name : 0), m_tBegin(mp_name ? io::time() : 0.0) { }
+	/// destructor, adds measured duration
+	~ProfileAccumulator() { if(mp_name) Profiler::singleton().accumulate(mp_name, io::time()-m_tBegin); }
+protected:
+	/// sample name, 0 if inactive
+	const char * mp_name;
+	/// start time
+	double m_tBegin;
+};
+
+//--- class LoadReport ---------------------------------------------
+
+/// a class collecting per stage timings and counters of a loading process
+/** While a report is active, the loading pipeline (file reading, XML tokenizing, scene graph
+ interpretation, mesh preparation, texture decoding and upload) adds its stages via LoadStage
+ helper objects. Stage durations are inclusive, nested stages are indented by str().
+ Example :\n
+  \code
+	LoadReport report;
+	proNode * pModel = ModelMgr::singleton().load("model.x3d", &report);
+	report.begin();
+	pModel->initGraphics();
+	report.end();
+	cout << report.str();
+  \endcode
+*/
+class LoadReport {
+public:
+	/// an auxiliary struct storing the accumulated measurements of a loading stage
+	struct Stage {
+		/// constructor initializing members
+		Stage(const char * stageName, unsigned int stageDepth) : name(stageName), depth(stageDepth), 
+			duration(0.0), bytes(0), elements(0), count(0) { }
+		/// stage name, expected to be a string literal
+		const char * name;
+		/// nesting depth at first occurrence
+		unsigned int depth;
+		/// accumulated duration in seconds
+		double duration;
+		/// accumulated number of processed bytes
+		size_t bytes;
+		/// accumulated number of processed elements, e.g., tags, vertices, indices
+		size_t elements;
+		/// number of measurements
+		unsigned int count;
+	};
+
+	/// constructor
+	LoadReport() : m_depth(0), m_duration(0.0), m_tBegin(0.0), mp_prev(0) { }
+	/// returns currently active report of the calling thread, 0 if none
+	static LoadReport * active() { return sp_active; }
+	/// activates this report for the calling thread, stages measured until end() is called are added
+	void begin();
+	/// deactivates this report and reactivates a previously active one
+	void end();
+	/// enters stage name, returns its index
+	size_t enter(const char * name);
+	/// leaves stage id, adding the measured values
+	void leave(size_t id, double duration, size_t bytes=0, size_t elements=0);
+	/// adds the stages of report, e.g., measured by another thread, as substages of the current stage
+	/** The durations of stages measured concurrently by several threads are summed up, and may 
+	 therefore exceed the total duration. */
+	void merge(const LoadReport & report);
+
+	/// returns number of stages
+	size_t size() const { return mv_stage.size(); }
+	/// returns stage n in order of first occurrence
+	const Stage & operator[](size_t n) const { return mv_stage[n]; }
+	/// returns total duration of all begin()/end() periods in seconds
+	double duration() const { return m_duration; }
+	/// clears all records
+	void clear() { mv_stage.clear(); m_duration=0.0; }
+	/// returns a human readable table of all stages
+	std::string str() const;
+protected:
+	/// stages in order of their first occurrence
+	std::vector<Stage> mv_stage;
+	/// current stage nesting depth
+	unsigned int m_depth;
+	/// total duration in seconds
+	double m_duration;
+	/// start time of current begin()/end() period
+	double m_tBegin;
+	/// previously active report
+	LoadReport * mp_prev;
+	/// currently active report of each thread
+	static PRO_THREAD_LOCAL LoadReport * sp_active;
+};
+
+//--- class LoadStage ----------------------------------------------
+
+/// a helper class measuring the lifetime of a local scope as stage of the active LoadReport
+class LoadStage {
+public:
+	/// constructor, enters stage
+	LoadStage(const char * name) : mp_report(LoadReport::active()), m_id(mp_report ? mp_report->enter(name) : 0), 
+		m_tBegin(mp_report ? io::time() : 0.0), m_bytes(0), m_elements(0) { }
+	/// destructor, leaves stage
+	~LoadStage() { finish(); }
+	/// leaves stage before the end of the scope
+	void finish() { 
+		if(mp_report) mp_report->leave(m_id, io::time()-m_tBegin, m_bytes, m_elements);
+		mp_report=0; }
+	/// adds to the number of processed bytes
+	void bytes(size_t n) { m_bytes+=n; }
+	/// adds to the number of processed elements
+	void elements(size_t n) { m_elements+=n; }
+protected:
+	/// active report, 0 if none
+	LoadReport * mp_report;
+	/// stage id
+	size_t m_id;
+	/// start time
+	double m_tBegin;
+	/// number of processed bytes
+	size_t m_bytes;
+	/// number of processed elements
+	size_t m_elements;
+};
+
+#endif // _PRO_PROFILER_H
@@ -10,23 +10,80 @@
 #endif
 
 #include "proStr.h"
+#include "proProfiler.h"
+#include <algorithm>
+#include <sstream>
 
 using namespace std;
 
+//--- class RenderStats --------------------------------------------
+
+unsigned int RenderStats::s_counter[RenderStats::N_COUNTERS] = { 0 };
+RenderStats * RenderStats::sp_instance = 0;
+
+RenderStats::RenderStats() {
+	for(unsigned int i=0; i<N_COUNTERS; ++i) m_last[i]=0;
+}
+
+const char * RenderStats::counterName(unsigned int id) {
+	static const char * names[N_COUNTERS] = { "nodesVisited", "nodesCulled", "meshesDrawn", 
+		"triangles", "shadowQuads", "textureBinds", "stateChanges" };
+	return id<N_COUNTERS ? names[id] : "";
+}
+
+void RenderStats::frame() {
+	for(unsigned int i=0; i<N_COUNTERS; ++i) {
+		m_last[i]=s_counter[i];
+		s_counter[i]=0;
+	}
+}
+
+string RenderStats::str() const {
+	ostringstream os;
+	os << m_last[MESHES_DRAWN] << " meshes, " << m_last[TRIANGLES] << " tris, " 
+		<< m_last[NODES_CULLED] << '/' << m_last[NODES_VISITED] << " culled, "
+		<< m_last[SHADOW_QUADS] << " shadow quads, " << m_last[TEXTURE_BINDS] << " binds, " 
+		<< m_last[STATE_CHANGES] << " states";
+	return os.str();
+}
+
 //--- class Renderer -----------------------------------------------
 
 Renderable * Renderer::create(const proNode & node) {
-	map<string, Renderable *(*)(const proNode &)>::iterator it = mm_RenderableFactory.find(node.type());
+	map<unsigned int, Renderable *(*)(const proNode &)>::iterator it = mm_RenderableFactory.find(node.typeId());
 	return it!=mm_RenderableFactory.end() ? (*(it->second))(node) : 0;
 }
 
 //--- class RendererGL ---------------------------------------------
 
+// auxiliary functions issuing OpenGL state changes while drawing, counted as RenderStats::STATE_CHANGES:
+
+/// enables capability cap
+static inline void stateEnable(GLenum cap) { glEnable(cap); RenderStats::add(RenderStats::STATE_CHANGES); }
+/// disables capability cap
+static inline void stateDisable(GLenum cap) { glDisable(cap); RenderStats::add(RenderStats::STATE_CHANGES); }
+/// enables client side array
+static inline void stateEnableClient(GLenum array) { glEnableClientState(array); RenderStats::add(RenderStats::STATE_CHANGES); }
+/// disables client side array
+static inline void stateDisableClient(GLenum array) { glDisableClientState(array); RenderStats::add(RenderStats::STATE_CHANGES); }
+/// enables or disables writing into the depth buffer
+static inline void stateDepthMask(GLboolean flag) { glDepthMask(flag); RenderStats::add(RenderStats::STATE_CHANGES); }
+/// enables or disables writing of all color components
+static inline void stateColorMask(GLboolean flag) { glColorMask(flag, flag, flag, flag); RenderStats::add(RenderStats::STATE_CHANGES); }
+/// sets the rasterization mode of front and back faces
+static inline void statePolygonMode(GLenum mode) { glPolygonMode(GL_FRONT_AND_BACK, mode); RenderStats::add(RenderStats::STATE_CHANGES); }
+/// sets culled faces
+static inline void stateCullFace(GLenum mode) { glCullFace(mode); RenderStats::add(RenderStats::STATE_CHANGES); }
+/// sets stencil test function
+static inline void stateStencilFunc(GLenum func, GLint ref, GLuint mask) { glStencilFunc(func, ref, mask); RenderStats::add(RenderStats::STATE_CHANGES); }
+/// sets stencil operations
+static inline void stateStencilOp(GLenum fail, GLenum zfail, GLenum zpass) { glStencilOp(fail, zfail, zpass); RenderStats::add(RenderStats::STATE_CHANGES); }
+
 RendererGL::RendererGL() : Renderer() {
-	registerFactory(RenderMeshGL::create, proMesh::TYPE);
-	registerFactory(RenderSceneGL::create, proScene::TYPE);
-	registerFactory(RenderLightGL::create, proLight::TYPE);
-	registerFactory(RenderCameraGL::create, proCamera::TYPE);
+	registerFactory(RenderMeshGL::create, proNode::TYPE_MESH);
+	registerFactory(RenderSceneGL::create, proNode::TYPE_SCENE);
+	registerFactory(RenderLightGL::create, proNode::TYPE_LIGHT);
+	registerFactory(RenderCameraGL::create, proNode::TYPE_CAMERA);
 	init();
 }
 
@@ -42,13 +99,8 @@ void RendererGL::init() {
 //--- class RenderCameraGL -----------------------------------------
 
 Renderable* RenderCameraGL::create(const proNode & node) {
-	try {
-		const proCamera & cam = dynamic_cast<const proCamera & >(node);
-		return new RenderCameraGL(cam);
-	}
-	catch(bad_cast) {
-		return 0;
-	}
+	if(node.typeId()!=proNode::TYPE_CAMERA) return 0;
+	return new RenderCameraGL(static_cast<const proCamera &>(node));
 }
 
 RenderCameraGL::RenderCameraGL(const proCamera & cam) : m_camera(cam) {
@@ -84,13 +136,8 @@ void RenderCameraGL::update() {
 unsigned int RenderLightGL::s_counter=0;
 
 Renderable* RenderLightGL::create(const proNode & node) {
-	try {
-		const proLight & light = dynamic_cast<const proLight & >(node);
-		return new RenderLightGL(light);
-	}
-	catch(bad_cast) {
-		return 0;
-	}
+	if(node.typeId()!=proNode::TYPE_LIGHT) return 0;
+	return new RenderLightGL(static_cast<const proLight &>(node));
 }
 
 RenderLightGL::RenderLightGL(const proLight & light) : m_light(light), m_id(GL_LIGHT0+(s_counter++%GL_MAX_LIGHTS)) {
@@ -100,23 +147,23 @@ void RenderLightGL::update() {
     glLightfv(GLenum(m_id), GL_AMBIENT, &m_light.ambient()[0]);
     glLightfv(GLenum(m_id), GL_DIFFUSE, &m_light.diffuse()[0]);
     glLightfv(GLenum(m_id), GL_SPECULAR,&m_light.specular()[0]);
-    m_light.flags() & FLAG_ACTIVE ? glEnable(GLenum(m_id)) : glDisable(GLenum(m_id));
+    m_light.flags() & FLAG_ACTIVE ? stateEnable(GLenum(m_id)) : stateDisable(GLenum(m_id));
 }
 
 void RenderLightGL::draw(proCamera & camera) {
     if(!(camera.flags()&FLAG_LIGHT)) return;
     if((m_light.flags()&FLAG_SHADOW)&&(camera.flags()&FLAG_SHADOW)) {
-        glStencilFunc(GL_LESS, 0x0, 0xff);
+        stateStencilFunc(GL_LESS, 0x0, 0xff);
         glPushMatrix();
         glLoadIdentity();
         glMatrixMode(GL_PROJECTION);
         glPushMatrix();
         glLoadIdentity();
         glOrtho(0, 1, 1, 0, 0, 1);
-        glEnable(GL_BLEND);
+        stateEnable(GL_BLEND);
         glColor4fv(&m_light.shadow()[0]);
         glRecti(0,1, 1,0);
-        glDisable(GL_BLEND);
+        stateDisable(GL_BLEND);
         glPopMatrix();
         glMatrixMode(GL_MODELVIEW);
         glPopMatrix();
@@ -130,84 +177,172 @@ void RenderLightGL::draw(proCamera & camera) {
 //--- class RenderSceneGL ------------------------------------------
 
 Renderable* RenderSceneGL::create(const proNode & node) {
-	try {
-		const proScene & scene = dynamic_cast<const proScene & >(node);
-		return new RenderSceneGL(scene);
-	}
-	catch(bad_cast) {
-		return 0;
-	}
+	if(node.typeId()!=proNode::TYPE_SCENE) return 0;
+	return new RenderSceneGL(static_cast<const proScene &>(node));
 }
 
 void RenderSceneGL::draw(proCamera & camera) {
 	unsigned int flags=camera.flags();
 	proScene & scene = const_cast<proScene &>(m_scene); // dirty but efficient
-	if(flags&FLAG_WIREFRAME) glPolygonMode ( GL_FRONT_AND_BACK, GL_LINE );
+	if(flags&FLAG_WIREFRAME) statePolygonMode(GL_LINE);
 	else if(flags&FLAG_LIGHT) {
-		glEnable(GL_LIGHTING);
+		ProfileScope profile("lights");
+		stateEnable(GL_LIGHTING);
 		camera.flags()=FLAG_LIGHT;
 		scene.proTransform::draw(camera);
 	}
 	if(flags&FLAG_RENDER) {
-		camera.flags()=FLAG_RENDER;
-		scene.proTransform::draw(camera);
-
+		{
+			ProfileScope profile("opaque", true);
+			camera.flags()=FLAG_RENDER;
+			scene.proTransform::draw(camera);
+		}
+		ProfileScope profile("transparent", true);
 		camera.flags()=FLAG_TRANSPARENT;
-		glEnable(GL_BLEND);
-		glDepthMask(GL_FALSE);
+		stateEnable(GL_BLEND);
+		stateDepthMask(GL_FALSE);
 		// TODO sort transparent objects by z distance before rendering
 		scene.proTransform::draw(camera);
-		glDepthMask(GL_TRUE);
-		glDisable(GL_BLEND);
+		stateDepthMask(GL_TRUE);
+		stateDisable(GL_BLEND);
 	}
-	if(flags&FLAG_WIREFRAME) glPolygonMode ( GL_FRONT_AND_BACK, GL_FILL );
-	else if(flags&FLAG_LIGHT) glDisable(GL_LIGHTING);
+	if(flags&FLAG_WIREFRAME) statePolygonMode(GL_FILL);
+	else if(flags&FLAG_LIGHT) stateDisable(GL_LIGHTING);
 		
 	if((flags&FLAG_SHADOW)&&!(flags&FLAG_WIREFRAME)) {
-		glEnable(GL_STENCIL_TEST);
-		glDepthMask(GL_FALSE);
+		ProfileScope profile("shadow", true);
+		stateEnable(GL_STENCIL_TEST);
+		stateDepthMask(GL_FALSE);
+		if(m_revision!=proNode::revision()) {
+			ProfileAccumulator profileCull("cull");
+			buildIndex();
+		}
 		// iterate through lights:
-		vector<proLight*> vLight;
-		for(proNode::iterator iter=&scene; iter!=0; ++iter) 
-		    if((iter->type()==proLight::TYPE)&&(iter->flags()&FLAG_SHADOW)) 
-			vLight.push_back(static_cast<proLight*>(*iter));
-		for(size_t i=0;i<vLight.size(); ++i) {
+		for(size_t i=0;i<mv_light.size(); ++i) {
+		    LightRef & lr = mv_light[i];
+		    if((lr.pos!=lr.pLight->pos())||(lr.range!=lr.pLight->range())) {
+		        ProfileAccumulator profileCull("cull");
+		        queryInfluence(lr);
+		    }
 		    if(i>0) glClear (GL_STENCIL_BUFFER_BIT);        
-		    camera.light(vLight[i]);
+		    camera.light(lr.pLight);
 		    // draw volumes:
-		    glDisableClientState(GL_NORMAL_ARRAY);
-		    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		    stateDisableClient(GL_NORMAL_ARRAY);
+		    stateColorMask(GL_FALSE);
 
-		    if(vLight.size()>1) camera.light()->flags()|=FLAG_UPDATE; // since we can store only one set of shadow volumes, multiple lights must be always updated
+		    if(mv_light.size()>1) camera.light()->flags()|=FLAG_UPDATE; // since we can store only one set of shadow volumes, multiple lights must be always updated
 		    camera.flags()=FLAG_SHADOW;
-		    scene.proTransform::draw(camera);
+		    drawShadows(camera, lr);
 
-		    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-		    glEnableClientState(GL_NORMAL_ARRAY);
+		    stateColorMask(GL_TRUE);
+		    stateEnableClient(GL_NORMAL_ARRAY);
 		    
 		    // tint shadow:
 		    camera.flags()|=FLAG_LIGHT;
 		    camera.light()->draw(camera);
 		}
-		glDepthMask(GL_TRUE);
-		glDisable(GL_STENCIL_TEST);
+		stateDepthMask(GL_TRUE);
+		stateDisable(GL_STENCIL_TEST);
 	}
 	camera.flags()=flags;
 }
 
+void RenderSceneGL::buildIndex() {
+	mv_mesh.clear();
+	mv_key.clear();
+	mv_light.clear();
+	m_radiusMax=0.0f;
+	collect(const_cast<proScene &>(m_scene), mat4f());
+	sort(mv_mesh.begin(), mv_mesh.end());
+	for(size_t i=0; (i<mv_mesh.size())&&(mv_mesh[i].bounding.radius()>=0.0f); ++i) {
+		mv_key.push_back(mv_mesh[i].bounding[X]-mv_mesh[i].bounding.radius());
+		m_radiusMax=max(m_radiusMax, mv_mesh[i].bounding.radius());
+	}
+	for(size_t i=0; i<mv_light.size(); ++i)
+		queryInfluence(mv_light[i]);
+	m_revision=proNode::revision();
+}
 
-//--- class RenderMeshGL -------------------------------------------
+void RenderSceneGL::collect(proNode & node, const mat4f & matrix) {
+	if((node.typeId()==proNode::TYPE_LIGHT)&&(node.flags()&FLAG_SHADOW)) {
+		mv_light.push_back(LightRef(static_cast<proLight*>(&node)));
+		return;
+	}
+	if(!(node.flags()&FLAG_ACTIVE)) return;
+	if(node.typeId()==proNode::TYPE_MESH) {
+		sphere bounding(node.boundingSphere());
+		if(bounding.radius()>=0.0f) { // transform bounding sphere, consider scaling:
+			bounding.transform(matrix);
+			float xl=vec3f(matrix[0],matrix[1],matrix[2]).length();
+			float yl=vec3f(matrix[4],matrix[5],matrix[6]).length();
+			float zl=vec3f(matrix[8],matrix[9],matrix[10]).length();
+			bounding.radius(bounding.radius()*max(xl,max(yl,zl)));
+		}
+		mv_mesh.push_back(MeshRef(static_cast<proMesh*>(&node), matrix, bounding));
+	}
+	else if(node.typeId()&proNode::TYPE_TRANSFORM) {
+		proTransform & tr = static_cast<proTransform &>(node);
+		mat4f mat(matrix*tr.matrix());
+		for(size_t i=0; i<tr.size(); ++i)
+			collect(*tr[i], mat);
+	}
+}
 
-Renderable* RenderMeshGL::create(const proNode & node) {
-	try {
-		const proMesh & mesh = dynamic_cast<const proMesh & >(node);
-		return new RenderMeshGL(mesh);
+void RenderSceneGL::queryInfluence(LightRef & lr) {
+	lr.pos=lr.pLight->pos();
+	lr.range=lr.pLight->range();
+	lr.vMesh.clear();
+	lr.vPos.clear();
+	if((lr.range<0.0f)||(lr.pos[3]==0.0f)) // unlimited or distant light, all meshes are influenced
+		for(size_t i=0; i<mv_mesh.size(); ++i) lr.vMesh.push_back(i);
+	else {
+		vec3f pos(lr.pos);
+		// candidates have their lower x bound within [pos-range-2*radiusMax, pos+range]:
+		size_t iBegin=lower_bound(mv_key.begin(), mv_key.end(), pos[X]-lr.range-2.0f*m_radiusMax)-mv_key.begin();
+		size_t iEnd=upper_bound(mv_key.begin(), mv_key.end(), pos[X]+lr.range)-mv_key.begin();
+		for(size_t i=iBegin; i<iEnd; ++i) {
+			float dist=lr.range+mv_mesh[i].bounding.radius();
+			if(mv_mesh[i].bounding.sqrDistTo(pos)<=dist*dist) lr.vMesh.push_back(i);
+		}
+		for(size_t i=mv_key.size(); i<mv_mesh.size(); ++i) lr.vMesh.push_back(i);
 	}
-	catch(bad_cast) {
-		return 0;
+	// transform light into local coordinate systems of meshes:
+	for(size_t i=0; i<lr.vMesh.size(); ++i) {
+		mat4f matInv(mv_mesh[lr.vMesh[i]].matrix);
+		if(!lr.pos[3]) // do not consider translations for distant lights
+			matInv[12]=matInv[13]=matInv[14]=0.0f;
+		matInv.invert();
+		if(matInv.isNan()) lr.vPos.push_back(lr.pos);
+		else {
+			vec3f posTr(lr.pos);
+			posTr.transform(matInv);
+			lr.vPos.push_back(vec4f(posTr[X],posTr[Y],posTr[Z],lr.pos[3]));
+		}
 	}
 }
 
+void RenderSceneGL::drawShadows(proCamera & camera, const LightRef & lr) {
+	proLight lightTr(*lr.pLight);
+	for(size_t i=0; i<lr.vMesh.size(); ++i) {
+		const MeshRef & mr = mv_mesh[lr.vMesh[i]];
+		lightTr.pos(lr.vPos[i]);
+		lightTr.flags()=lr.pLight->flags();
+		camera.light(&lightTr);
+		camera.push(mr.matrix);
+		mr.pMesh->draw(camera);
+		camera.pop();
+	}
+	camera.light(lr.pLight);
+}
+
+
+//--- class RenderMeshGL -------------------------------------------
+
+Renderable* RenderMeshGL::create(const proNode & node) {
+	if(node.typeId()!=proNode::TYPE_MESH) return 0;
+	return new RenderMeshGL(static_cast<const proMesh &>(node));
+}
+
 RenderMeshGL::RenderMeshGL(const proMesh & mesh) : m_mesh(mesh) {
 	const_cast<proMaterial &>(m_mesh.material()).loadTexture();
 	glEnableClientState(GL_VERTEX_ARRAY);
@@ -220,51 +355,57 @@ void RenderMeshGL::draw(proCamera & camera) {
 		|| ((camera.flags()&FLAG_TRANSPARENT)&&(m_mesh.flags()&FLAG_TRANSPARENT)) ) { 
 		// apply material:
 		const proMaterial & mat = m_mesh.material();
+		// read-only views, arrays of meshes in STORAGE_EXTERNAL layout are passed to OpenGL in place:
+		const constArray<unsigned int> vIndex(m_mesh.indexArray());
+		const constArray<vec2f> vTexCoord(m_mesh.texCoordArray());
+		const constArray<vec3f> vColor(m_mesh.vertexColorArray());
 		
+        RenderStats::add(RenderStats::MESHES_DRAWN);
+        RenderStats::add(RenderStats::TRIANGLES, vIndex.size()/3);
         glColor4fv(&mat.color()[0]);
-		if(m_mesh.flags()&FLAG_FRONT_AND_BACK) glDisable(GL_CULL_FACE);
-        if(mat.texId()&&m_mesh.texCoords().size()) {
-            glEnable( GL_TEXTURE_2D );
+		if(m_mesh.flags()&FLAG_FRONT_AND_BACK) stateDisable(GL_CULL_FACE);
+        if(mat.texId()&&vTexCoord.size()) {
+            RenderStats::add(RenderStats::TEXTURE_BINDS);
+            stateEnable( GL_TEXTURE_2D );
             glBindTexture( GL_TEXTURE_2D, mat.texId() );
             glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
 
-            glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-            glTexCoordPointer  ( 2, GL_FLOAT, 0, &m_mesh.texCoords()[0] );
+            stateEnableClient( GL_TEXTURE_COORD_ARRAY );
+            glTexCoordPointer  ( 2, GL_FLOAT, 0, vTexCoord.data() );
         }
-        glVertexPointer  (3, GL_FLOAT, 0, &m_mesh.coords()[0]);
-        glNormalPointer  (   GL_FLOAT, 0, &m_mesh.vNormals()[0]);
+        glVertexPointer  (3, GL_FLOAT, 0, m_mesh.coordArray().data());
+        glNormalPointer  (   GL_FLOAT, 0, m_mesh.vNormalArray().data());
     
-        if(m_mesh.vertexColors().size()) {
-            glEnableClientState ( GL_COLOR_ARRAY );
-            glColorPointer  ( 3, GL_FLOAT, 0, &m_mesh.vertexColors()[0] );
+        if(vColor.size()) {
+            stateEnableClient( GL_COLOR_ARRAY );
+            glColorPointer  ( 3, GL_FLOAT, 0, vColor.data() );
         }
     
-        glDrawElements ( GL_TRIANGLES, m_mesh.indices().size(), GL_UNSIGNED_INT, &m_mesh.indices()[0] );
+        glDrawElements ( GL_TRIANGLES, vIndex.size(), GL_UNSIGNED_INT, vIndex.data() );
     
-        if(m_mesh.vertexColors().size()) glDisableClientState ( GL_COLOR_ARRAY );
-		if(m_mesh.texCoords().size()&&mat.texId()) {
-			glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-			glDisable(GL_TEXTURE_2D);
+        if(vColor.size()) stateDisableClient( GL_COLOR_ARRAY );
+		if(vTexCoord.size()&&mat.texId()) {
+			stateDisableClient(GL_TEXTURE_COORD_ARRAY);
+			stateDisable(GL_TEXTURE_2D);
 		}
-		if(m_mesh.flags()&FLAG_FRONT_AND_BACK) glEnable(GL_CULL_FACE);
+		if(m_mesh.flags()&FLAG_FRONT_AND_BACK) stateEnable(GL_CULL_FACE);
     }
     
     // shadow volume pass:
-    if((camera.flags()&FLAG_SHADOW)&&camera.light()&&(m_mesh.flags()&FLAG_SHADOW)&&m_mesh.edges().size()) {
-        if((m_mesh.boundingSphere().radius()>=0.0f)&&(camera.light()->range()>=0.0f)&&(m_mesh.boundingSphere().sqrDistTo(camera.light()->pos())>camera.light()->range()*camera.light()->range()))
-            return;    
-        glStencilFunc(GL_ALWAYS, 0x0, 0xff);
+    if((camera.flags()&FLAG_SHADOW)&&camera.light()&&(m_mesh.flags()&FLAG_SHADOW)&&m_mesh.edgeArray().size()) {
+        // light range has already been checked by proMesh::draw()
+        stateStencilFunc(GL_ALWAYS, 0x0, 0xff);
         if(m_mesh.flags()&FLAG_ZFAIL) { // Carmack's reverse:
             // draw backs: 
-            glCullFace(GL_FRONT);
-            glStencilOp(GL_KEEP, GL_INCR, GL_KEEP);
+            stateCullFace(GL_FRONT);
+            stateStencilOp(GL_KEEP, GL_INCR, GL_KEEP);
             glVertexPointer  (3, GL_FLOAT, 0, &m_mesh.shadows()[0]);
             glDrawArrays ( GL_QUADS, 0, m_mesh.shadows().size());
             glVertexPointer  (3, GL_FLOAT, 0, &m_mesh.caps()[0]);
             glDrawArrays ( GL_TRIANGLES, 0, m_mesh.caps().size());
             // draw fronts:
-            glCullFace(GL_BACK);
-            glStencilOp(GL_KEEP, GL_DECR, GL_KEEP);
+            stateCullFace(GL_BACK);
+            stateStencilOp(GL_KEEP, GL_DECR, GL_KEEP);
             glVertexPointer  (3, GL_FLOAT, 0, &m_mesh.shadows()[0]);
             glDrawArrays ( GL_QUADS, 0, m_mesh.shadows().size());
             glVertexPointer  (3, GL_FLOAT, 0, &m_mesh.caps()[0]);
@@ -273,13 +414,13 @@ void RenderMeshGL::draw(proCamera & camera) {
         else { // z pass:
             glVertexPointer  (3, GL_FLOAT, 0, &m_mesh.shadows()[0]);
             // draw fronts:
-            glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+            stateStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
             glDrawArrays ( GL_QUADS, 0, m_mesh.shadows().size());
             // draw backs: 
-            glCullFace(GL_FRONT);
-            glStencilOp(GL_KEEP, GL_KEEP, GL_DECR);
+            stateCullFace(GL_FRONT);
+            stateStencilOp(GL_KEEP, GL_KEEP, GL_DECR);
             glDrawArrays ( GL_QUADS, 0, m_mesh.shadows().size());
-            glCullFace(GL_BACK);
+            stateCullFace(GL_BACK);
         }
     }
 }
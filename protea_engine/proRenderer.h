@@ -25,6 +25,49 @@ public:
     virtual void pop() { }
 };
 
+//--- class RenderStats --------------------------------------------
+
+/// a singleton class counting rendering work per frame
+/** Counters are incremented by the renderables while drawing and are moved to the
+ last frame values by calling frame() once per frame. RenderStatsCallable (see proCallable.h)
+ exposes the counters of the last frame to scripts. */
+class RenderStats {
+public:
+	/// counter ids
+	enum {
+		NODES_VISITED=0, ///< nodes reached by a draw traversal, summed up over all passes
+		NODES_CULLED,    ///< nodes rejected by view frustum culling
+		MESHES_DRAWN,    ///< meshes drawn in normal or transparent passes
+		TRIANGLES,       ///< triangles submitted, excluding shadow volumes
+		SHADOW_QUADS,    ///< shadow volume quads generated
+		TEXTURE_BINDS,   ///< texture bind calls
+		STATE_CHANGES,   ///< OpenGL enable/disable, client state, mask, polygon, stencil and cull mode changes issued while drawing
+		N_COUNTERS       ///< number of counters
+	};
+	/// returns singleton instance
+	static RenderStats & singleton() { if(!sp_instance) sp_instance = new RenderStats; return *sp_instance; }
+	/// increments counter id by n
+	static void add(unsigned int id, unsigned int n=1) { s_counter[id]+=n; }
+	/// returns name of counter id
+	static const char * counterName(unsigned int id);
+
+	/// finishes frame, stores current counters as last frame values and resets them
+	void frame();
+	/// returns value of counter id of the last completed frame
+	unsigned int operator[](unsigned int id) const { return m_last[id]; }
+	/// returns a one line summary of the last completed frame
+	std::string str() const;
+protected:
+	/// constructor
+	RenderStats();
+	/// counter values of the last completed frame
+	unsigned int m_last[N_COUNTERS];
+	/// counter values of the current frame
+	static unsigned int s_counter[N_COUNTERS];
+	/// pointer to singleton instance
+	static RenderStats * sp_instance;
+};
+
 //--- class Renderer -----------------------------------------------
 
 /// a class abstracting a render backend (e.g., OpenGL, DirectX)
@@ -39,11 +82,13 @@ public:
 	/// tries to return a new renderable suitable for the passed node
 	virtual Renderable * create(const proNode & node);
 	/// registers a Renderable factory function fitting to a node class
-	void registerFactory(Renderable *(*factoryFunc)(const proNode &), const std::string & type) {
-		mm_RenderableFactory.insert(make_pair(type, factoryFunc)); }
+	/** \param factoryFunc factory function
+	 \param typeId node type id as returned by proNode::typeId() */
+	void registerFactory(Renderable *(*factoryFunc)(const proNode &), unsigned int typeId) {
+		mm_RenderableFactory.insert(std::make_pair(typeId, factoryFunc)); }
 protected:
-	/// stores Renderable factory methods
-	std::map<std::string, Renderable *(*)(const proNode &)> mm_RenderableFactory;
+	/// stores Renderable factory methods by node type id
+	std::map<unsigned int, Renderable *(*)(const proNode &)> mm_RenderableFactory;
 };
 
 //--- class RendererGL ---------------------------------------------
@@ -112,10 +157,61 @@ public:
 	/// draws renderable
 	virtual void draw(proCamera & camera);
 protected:
+	/// an auxiliary struct storing a mesh together with its accumulated transformation and bounding sphere
+	struct MeshRef {
+		/// constructor initializing members
+		MeshRef(proMesh * mesh, const mat4f & mat, const sphere & bnd) : pMesh(mesh), matrix(mat), bounding(bnd) { }
+		/// comparison operator, sorts by lower bound along the x axis, unbounded meshes last
+		bool operator<(const MeshRef & mr) const { 
+			if(bounding.radius()<0.0f) return false;
+			if(mr.bounding.radius()<0.0f) return true;
+			return bounding[X]-bounding.radius() < mr.bounding[X]-mr.bounding.radius(); }
+		/// pointer to mesh
+		proMesh * pMesh;
+		/// accumulated transformation relative to scene root
+		mat4f matrix;
+		/// bounding sphere relative to scene root, a radius<0.0f means unbounded
+		sphere bounding;
+	};
+	/// an auxiliary struct caching the meshes influenced by a shadow casting light
+	struct LightRef {
+		/// constructor initializing members
+		LightRef(proLight * light) : pLight(light), range(-1.0f) { }
+		/// pointer to light
+		proLight * pLight;
+		/// light position at time of last influence query
+		vec4f pos;
+		/// light range at time of last influence query
+		float range;
+		/// indices of influenced meshes in mv_mesh
+		std::vector<size_t> vMesh;
+		/// light positions transformed into the local coordinate systems of the influenced meshes
+		std::vector<vec4f> vPos;
+	};
+
 	/// constructor
-	RenderSceneGL(const proScene & scene) : m_scene(scene) { }
+	RenderSceneGL(const proScene & scene) : m_scene(scene), m_revision(0), m_radiusMax(0.0f) { }
+	/// rebuilds the spatial index of meshes and the list of shadow casting lights
+	void buildIndex();
+	/// recursively collects meshes and lights of a subgraph
+	void collect(proNode & node, const mat4f & matrix);
+	/// updates the list of meshes influenced by a light by querying the spatial index
+	void queryInfluence(LightRef & lr);
+	/// draws the shadow volumes of all meshes influenced by a light
+	void drawShadows(proCamera & camera, const LightRef & lr);
+
 	/// reference to corresponding mesh node
 	const proScene & m_scene;
+	/// scene graph revision the index has been built for
+	unsigned int m_revision;
+	/// spatial index, bounded meshes sorted by their lower bound along the x axis, followed by unbounded meshes
+	std::vector<MeshRef> mv_mesh;
+	/// lower x bounds of the bounded meshes in mv_mesh, for binary search
+	std::vector<float> mv_key;
+	/// largest bounding sphere radius in mv_mesh
+	float m_radiusMax;
+	/// cached shadow casting lights and their influenced meshes
+	std::vector<LightRef> mv_light;
 };
 
 //--- class RenderMeshGL -------------------------------------------
@@ -1,19 +1,30 @@
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
+#include <cmath>
+#include <algorithm>
 
 #ifdef _HAVE_GL
-# ifdef _MSC_VER
+# if defined _MSC_VER || defined __WIN32__ || defined WIN32
 #  define WIN32_LEAN_AND_MEAN
 #  include <windows.h>
 # endif
 # include <GL/gl.h>
-# include <GL/glu.h>
+# if !defined __WIN32__ && !defined WIN32 && !defined __APPLE__
+// declared here since the X11 headers included by GL/glx.h define a type Font
+extern "C" void (*glXGetProcAddressARB(const GLubyte * procName))();
+# endif
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP>=2))
+#  define _PRO_SSE2
+#  include <emmintrin.h>
 #endif
 
 #include "proResource.h"
 #include "proIo.h"
 #include "proStr.h"
+#include "proProfiler.h"
 
 using namespace std;
 
@@ -219,8 +230,8 @@ unsigned char * Image::upsample(int w2, int h2) const {
     unsigned char *src1, *src2, *src3, *src4;
 
     // Calculate scaling factor
-    xstep = (float)(m_width-1) / (float)(w2-1);
-    ystep = (float)(m_height-1) / (float)(h2-1);
+    xstep = w2>1 ? (float)(m_width-1) / (float)(w2-1) : 0.0f;
+    ystep = h2>1 ? (float)(m_height-1) / (float)(h2-1) : 0.0f;
 
     // Copy source data to destination data with bilinear interpolation
     dy = 0.0f;
@@ -229,8 +240,8 @@ unsigned char * Image::upsample(int w2, int h2) const {
         dx = 0.0f;
         src1 = &mp_data[ y*m_width*bpp ];
         src3 = y < (int)(m_height-1) ? src1 + m_width*bpp : src1;
-        src2 = src1 + bpp;
-        src4 = src3 + bpp;
+        src2 = m_width>1 ? src1 + bpp : src1;
+        src4 = m_width>1 ? src3 + bpp : src3;
         x = 0;
         for( m = 0; m < w2; m ++ ) {
             for( k = 0; k < bpp; k ++ ) {
@@ -270,6 +281,249 @@ unsigned char * Image::upsample(int w2, int h2) const {
     return data;
 }
 
+Image * Image::resample(unsigned int w2, unsigned int h2) const {
+	unsigned char * pUpsampled = upsample(w2, h2);
+	unsigned char * data = new unsigned char[w2*h2*m_depth];
+	memcpy(data, pUpsampled, w2*h2*m_depth);
+	free(pUpsampled);
+	return new Image(data, w2, h2, m_depth);
+}
+
+/// number of linear to sRGB conversion table entries
+static const unsigned int SRGB_STEPS = 1<<14;
+
+/// an auxiliary struct holding the conversion tables and filter weights for generating mip levels
+struct MipTables {
+	/// constructor calculating the tables
+	MipTables() {
+		for(unsigned int i=0; i<256; ++i) {
+			const float c = i/255.0f;
+			linear[i] = c;
+			srgbToLinear[i] = (c<=0.04045f) ? c/12.92f : pow((c+0.055f)/1.055f, 2.4f);
+		}
+		for(unsigned int i=0; i<SRGB_STEPS; ++i) {
+			const float c = i/float(SRGB_STEPS-1);
+			const float v = (c<=0.0031308f) ? c*12.92f : 1.055f*pow(c, 1.0f/2.4f)-0.055f;
+			linearToSrgb[i] = static_cast<unsigned char>(v*255.0f+0.5f);
+		}
+		// Kaiser windowed sinc, half-band cutoff, alpha 4, taps at the distances 3.5 .. 0.5 .. 3.5:
+		const double alpha=4.0, pi=3.14159265358979;
+		double sum=0.0, w[8];
+		for(unsigned int t=0; t<8; ++t) {
+			const double d = t-3.5, r = d/4.0, x = pi*d*0.5;
+			w[t] = sin(x)/x*besselI0(alpha*sqrt(1.0-r*r))/besselI0(alpha);
+			sum+=w[t];
+		}
+		for(unsigned int t=0; t<8; ++t) kaiser[t] = static_cast<float>(w[t]/sum);
+	}
+	/// modified Bessel function of the first kind, order 0, by its power series
+	static double besselI0(double x) {
+		double sum=1.0, term=1.0;
+		for(unsigned int k=1; k<32; ++k) {
+			term *= (x*0.5/k)*(x*0.5/k);
+			sum+=term;
+		}
+		return sum;
+	}
+	/// converts a linear value within [0,1] to an sRGB encoded byte
+	unsigned char toSrgb(float v) const {
+		return (v<=0.0f) ? 0 : (v>=1.0f) ? 255 : linearToSrgb[static_cast<unsigned int>(v*(SRGB_STEPS-1)+0.5f)];
+	}
+	/// byte values scaled to [0,1]
+	float linear[256];
+	/// sRGB encoded byte values converted to linear [0,1]
+	float srgbToLinear[256];
+	/// linear values quantized to SRGB_STEPS converted to sRGB encoded bytes
+	unsigned char linearToSrgb[SRGB_STEPS];
+	/// normalized weights of the 8 Kaiser filter taps
+	float kaiser[8];
+};
+/// tables initialized before main(), so that they may be shared by any thread
+static const MipTables s_mip;
+
+/// downsamples the rows y0 to y1-1 of the destination image by averaging blocks of 2x2 pixels
+static void downsampleBox(const Image & src, unsigned char * data, unsigned int y0, unsigned int y1, bool srgb) {
+	const unsigned int w=src.width(), h=src.height(), depth=src.depth();
+	const unsigned int w2 = w>1 ? w/2 : 1;
+	const unsigned int dx = w>1 ? depth : 0; // offset of the right neighbor
+	const unsigned int dy = h>1 ? w*depth : 0; // offset of the upper neighbor
+	const unsigned int nColor = (srgb&&(depth>=3)) ? 3 : 0;
+	for(unsigned int y=y0; y<y1; ++y) {
+		const unsigned char * src0 = src.data() + (h>1 ? 2*y : y)*w*depth;
+		unsigned char * dst = data + y*w2*depth;
+		unsigned int x=0;
+		if(nColor) {
+			for(const unsigned char * p=src0; x<w2; ++x, p+=2*dx) {
+				for(unsigned int k=0; k<nColor; ++k, ++dst) {
+					const float * lin = s_mip.srgbToLinear;
+					*dst = s_mip.toSrgb(0.25f*(lin[p[k]]+lin[p[k+dx]]+lin[p[k+dy]]+lin[p[k+dx+dy]]));
+				}
+				for(unsigned int k=nColor; k<depth; ++k)
+					*dst++ = static_cast<unsigned char>((p[k]+p[k+dx]+p[k+dy]+p[k+dx+dy]+2)/4);
+			}
+			continue;
+		}
+#ifdef _PRO_SSE2
+		if(dx&&dy&&((depth==4)||(depth==1))) { // 16 source bytes per row and iteration
+			const __m128i zero = _mm_setzero_si128(), two = _mm_set1_epi16(2), one = _mm_set1_epi16(1);
+			const unsigned int step = 8/depth;
+			for(; x+step<=w2; x+=step, dst+=8) {
+				const unsigned char * p = src0 + 2*x*depth;
+				const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+				const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p+dy));
+				__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+				__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+				__m128i sum;
+				if(depth==4) { // add neighboring pixels, i.e., the 64 bit halves
+					lo = _mm_add_epi16(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(1,0,3,2)));
+					hi = _mm_add_epi16(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(1,0,3,2)));
+					sum = _mm_unpacklo_epi64(lo, hi);
+				}
+				else sum = _mm_packs_epi32(_mm_madd_epi16(lo, one), _mm_madd_epi16(hi, one)); // add neighboring bytes
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(sum, sum));
+			}
+		}
+#endif
+		for(const unsigned char * p=src0+2*x*dx; x<w2; ++x, p+=2*dx)
+			for(unsigned int k=0; k<depth; ++k)
+				*dst++ = static_cast<unsigned char>((p[k]+p[k+dx]+p[k+dy]+p[k+dx+dy]+2)/4);
+	}
+}
+
+/// filters a row of linear source pixels horizontally by the Kaiser filter, writing w2 pixels to dst
+/** Source pixels beyond the borders are clamped. */
+template <int depth>
+static void kaiserRow(const float * src, int w, float * dst, int w2) {
+	for(int x=0; x<w2; ++x, dst+=depth) {
+		float sum[depth];
+		for(int k=0; k<depth; ++k) sum[k]=0.0f;
+		if((2*x>=3)&&(2*x+4<w)) { // interior
+			const float * p = src+(2*x-3)*depth;
+#ifdef _PRO_SSE2
+			if(depth==4) {
+				__m128 acc = _mm_setzero_ps();
+				for(int t=0; t<8; ++t)
+					acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(s_mip.kaiser[t]), _mm_loadu_ps(p+4*t)));
+				_mm_storeu_ps(dst, acc);
+				continue;
+			}
+#endif
+			for(int t=0; t<8; ++t, p+=depth)
+				for(int k=0; k<depth; ++k) sum[k] += s_mip.kaiser[t]*p[k];
+		}
+		else for(int t=0; t<8; ++t) {
+			const float * p = src+max(0, min(w-1, 2*x-3+t))*depth;
+			for(int k=0; k<depth; ++k) sum[k] += s_mip.kaiser[t]*p[k];
+		}
+		for(int k=0; k<depth; ++k) dst[k]=sum[k];
+	}
+}
+
+/// downsamples the rows y0 to y1-1 of the destination image by a separable Kaiser filter
+/** Each source row is converted to linear values and filtered horizontally once, the 8 rows 
+ contributing to a destination row are kept in a ring buffer. */
+static void downsampleKaiser(const Image & src, unsigned char * data, unsigned int y0, unsigned int y1, bool srgb) {
+	const int w=src.width(), h=src.height(), depth=src.depth();
+	const int w2 = w>1 ? w/2 : 1;
+	const int nColor = (srgb&&(depth>=3)) ? 3 : 0;
+	const int n2 = w2*depth;
+	vector<float> vLinear(w*depth), vRing(8*n2), vSum(n2);
+	int ringRow[8];
+	for(int t=0; t<8; ++t) ringRow[t]=-1;
+	for(int y=y0; y<static_cast<int>(y1); ++y) {
+		const float * pRow[8];
+		for(int t=0; t<8; ++t) {
+			const int sy = (h>1) ? max(0, min(h-1, 2*y-3+t)) : 0;
+			float * pRing = &vRing[(sy&7)*n2];
+			pRow[t] = pRing;
+			if(ringRow[sy&7]==sy) continue;
+			ringRow[sy&7] = sy;
+			const unsigned char * p = src.data()+sy*w*depth;
+			for(int i=0, n=w*depth; i<n; i+=depth) for(int k=0; k<depth; ++k)
+				vLinear[i+k] = (k<nColor) ? s_mip.srgbToLinear[p[i+k]] : s_mip.linear[p[i+k]];
+			switch(depth) {
+			case 1: kaiserRow<1>(&vLinear[0], w, pRing, w2); break;
+			case 2: kaiserRow<2>(&vLinear[0], w, pRing, w2); break;
+			case 3: kaiserRow<3>(&vLinear[0], w, pRing, w2); break;
+			default: kaiserRow<4>(&vLinear[0], w, pRing, w2);
+			}
+		}
+		// vertical pass:
+		float * sum = &vSum[0];
+		int i=0;
+#ifdef _PRO_SSE2
+		for(; i+4<=n2; i+=4) {
+			__m128 acc = _mm_setzero_ps();
+			for(int t=0; t<8; ++t)
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(s_mip.kaiser[t]), _mm_loadu_ps(pRow[t]+i)));
+			_mm_storeu_ps(sum+i, acc);
+		}
+#endif
+		for(; i<n2; ++i) {
+			sum[i] = 0.0f;
+			for(int t=0; t<8; ++t) sum[i] += s_mip.kaiser[t]*pRow[t][i];
+		}
+		unsigned char * dst = data + y*n2;
+		for(int i=0; i<n2; i+=depth) for(int k=0; k<depth; ++k) {
+			if(k<nColor) dst[i+k] = s_mip.toSrgb(sum[i+k]);
+			else dst[i+k] = static_cast<unsigned char>(max(0.0f, min(255.0f, sum[i+k]*255.0f+0.5f)));
+		}
+	}
+}
+
+/// an auxiliary task downsampling a range of rows within a ThreadPool
+class DownsampleTask : public ThreadPool::Task {
+public:
+	/// constructor
+	DownsampleTask(const Image & src, unsigned char * data, unsigned int y0, unsigned int y1, Image::MipFilter filter, bool srgb) :
+		m_src(src), mp_data(data), m_y0(y0), m_y1(y1), m_filter(filter), m_srgb(srgb) { }
+	/// downsamples the rows
+	virtual void run() {
+		if(m_filter==Image::KAISER) downsampleKaiser(m_src, mp_data, m_y0, m_y1, m_srgb);
+		else downsampleBox(m_src, mp_data, m_y0, m_y1, m_srgb);
+	}
+protected:
+	/// source image
+	const Image & m_src;
+	/// destination pixels
+	unsigned char * mp_data;
+	/// first destination row
+	unsigned int m_y0;
+	/// destination row following the last one
+	unsigned int m_y1;
+	/// filter kernel
+	Image::MipFilter m_filter;
+	/// stores whether color channels are filtered in linear space
+	bool m_srgb;
+};
+
+/// minimum number of destination pixels for distributing a downsample among threads
+static const unsigned int s_downsampleParallel = 256*256;
+
+Image * Image::downsample(MipFilter filter, bool srgb, ThreadPool * pPool) const {
+	const unsigned int w2 = m_width>1 ? m_width/2 : 1;
+	const unsigned int h2 = m_height>1 ? m_height/2 : 1;
+	unsigned char * data = new unsigned char[w2*h2*m_depth];
+	const unsigned int nTask = (pPool&&pPool->size()&&(w2*h2>=s_downsampleParallel)&&!ThreadPool::inTask())
+		? min(h2, 4*(pPool->size()+1)) : 1;
+	if(nTask>1) {
+		for(unsigned int i=0; i<nTask; ++i)
+			pPool->push(new DownsampleTask(*this, data, i*h2/nTask, (i+1)*h2/nTask, filter, srgb));
+		pPool->wait();
+	}
+	else DownsampleTask(*this, data, 0, h2, filter, srgb).run();
+	return new Image(data, w2, h2, m_depth);
+}
+
+void Image::mipmaps(std::vector<Image*> & vLevel, MipFilter filter, bool srgb, ThreadPool * pPool) const {
+	Image * pLevel = 0;
+	for(const Image * pSrc=this; (pSrc->width()>1)||(pSrc->height()>1); pSrc=pLevel) {
+		pLevel = pSrc->downsample(filter, srgb, pPool);
+		vLevel.push_back(pLevel);
+	}
+}
+
 bool Image::saveTGA(const string & filename) const {
 	const size_t headerSize = 18;
 	unsigned char hdr[headerSize];
@@ -367,17 +621,417 @@ Image* Image::createFromXPM(char **xpm) {
 	return new Image(data,width,height,depth);
 }
 
+//--- class CompressedImage ------------------------------------------
+
+/// converts an RGB color to 5:6:5 bits with rounding
+static inline unsigned int bcPack565(const float * rgb) {
+	int r=static_cast<int>(rgb[0]*31.0f/255.0f+0.5f), g=static_cast<int>(rgb[1]*63.0f/255.0f+0.5f), b=static_cast<int>(rgb[2]*31.0f/255.0f+0.5f);
+	r = r<0 ? 0 : r>31 ? 31 : r;
+	g = g<0 ? 0 : g>63 ? 63 : g;
+	b = b<0 ? 0 : b>31 ? 31 : b;
+	return static_cast<unsigned int>((r<<11)|(g<<5)|b);
+}
+
+/// builds the four color palette of a BC1 color block, three colors and black if !fourColors
+static void bcPalette(unsigned int c0, unsigned int c1, bool fourColors, int pal[4][3]) {
+	const unsigned int c[2] = { c0, c1 };
+	for(unsigned int i=0; i<2; ++i) {
+		const int r=(c[i]>>11)&31, g=(c[i]>>5)&63, b=c[i]&31;
+		pal[i][0]=(r<<3)|(r>>2);
+		pal[i][1]=(g<<2)|(g>>4);
+		pal[i][2]=(b<<3)|(b>>2);
+	}
+	for(unsigned int k=0; k<3; ++k) {
+		if(fourColors) {
+			pal[2][k]=(2*pal[0][k]+pal[1][k])/3;
+			pal[3][k]=(pal[0][k]+2*pal[1][k])/3;
+		}
+		else {
+			pal[2][k]=(pal[0][k]+pal[1][k])/2;
+			pal[3][k]=0;
+		}
+	}
+}
+
+/// assigns the 16 RGBA pixels px to their nearest entries of a four color palette
+/** \return sum of squared errors */
+static unsigned int bcAssign(const unsigned char * px, const int pal[4][3], unsigned int & indices) {
+	unsigned int err=0;
+	indices=0;
+	for(unsigned int i=0; i<16; ++i, px+=4) {
+		unsigned int best=UINT_MAX, bestIndex=0;
+		for(unsigned int k=0; k<4; ++k) {
+			const int dr=px[0]-pal[k][0], dg=px[1]-pal[k][1], db=px[2]-pal[k][2];
+			const unsigned int d=static_cast<unsigned int>(dr*dr+dg*dg+db*db);
+			if(d<best) {
+				best=d;
+				bestIndex=k;
+			}
+		}
+		err+=best;
+		indices|=bestIndex<<(2*i);
+	}
+	return err;
+}
+
+/// encodes 16 RGBA pixels as 8 byte BC1 color block in four color mode
+/** The end points are derived from the principal axis of the colors, slightly inset, and then 
+ refined by a least squares fit to the chosen palette indices. */
+static void bcEncodeColor(const unsigned char * px, unsigned char * dst) {
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	unsigned int i, k;
+	for(i=0; i<16; ++i) for(k=0; k<3; ++k) mean[k]+=px[4*i+k];
+	for(k=0; k<3; ++k) mean[k]/=16.0f;
+	float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f }; // rr rg rb gg gb bb
+	for(i=0; i<16; ++i) {
+		const float r=px[4*i]-mean[0], g=px[4*i+1]-mean[1], b=px[4*i+2]-mean[2];
+		cov[0]+=r*r; cov[1]+=r*g; cov[2]+=r*b; cov[3]+=g*g; cov[4]+=g*b; cov[5]+=b*b;
+	}
+	// principal axis by power iteration:
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for(unsigned int it=0; it<4; ++it) {
+		const float r=cov[0]*axis[0]+cov[1]*axis[1]+cov[2]*axis[2];
+		const float g=cov[1]*axis[0]+cov[3]*axis[1]+cov[4]*axis[2];
+		const float b=cov[2]*axis[0]+cov[4]*axis[1]+cov[5]*axis[2];
+		float len=fabs(r)>fabs(g) ? fabs(r) : fabs(g);
+		if(fabs(b)>len) len=fabs(b);
+		if(len<1e-6f) break; // uniform block
+		axis[0]=r/len; axis[1]=g/len; axis[2]=b/len;
+	}
+	// end points are the colors with extreme projections:
+	float minDot=1e30f, maxDot=-1e30f;
+	unsigned int iMin=0, iMax=0;
+	for(i=0; i<16; ++i) {
+		const float d=px[4*i]*axis[0]+px[4*i+1]*axis[1]+px[4*i+2]*axis[2];
+		if(d<minDot) { minDot=d; iMin=i; }
+		if(d>maxDot) { maxDot=d; iMax=i; }
+	}
+	float e0[3], e1[3];
+	for(k=0; k<3; ++k) {
+		const float inset=(px[4*iMax+k]-px[4*iMin+k])/16.0f;
+		e0[k]=px[4*iMax+k]-inset;
+		e1[k]=px[4*iMin+k]+inset;
+	}
+	unsigned int c0=bcPack565(e0), c1=bcPack565(e1), indices=0;
+	int pal[4][3];
+	bcPalette(c0, c1, true, pal);
+	unsigned int err=bcAssign(px, pal, indices);
+
+	// least squares refinement of the end points for the chosen indices:
+	static const float s_weight[4] = { 1.0f, 0.0f, 2.0f/3.0f, 1.0f/3.0f };
+	for(unsigned int it=0; (it<2)&&err; ++it) {
+		float aa=0.0f, ab=0.0f, bb=0.0f, ax[3]={0.0f,0.0f,0.0f}, bx[3]={0.0f,0.0f,0.0f};
+		for(i=0; i<16; ++i) {
+			const float a=s_weight[(indices>>(2*i))&3], b=1.0f-a;
+			aa+=a*a; ab+=a*b; bb+=b*b;
+			for(k=0; k<3; ++k) {
+				ax[k]+=a*px[4*i+k];
+				bx[k]+=b*px[4*i+k];
+			}
+		}
+		const float det=aa*bb-ab*ab;
+		if(fabs(det)<1e-6f) break;
+		for(k=0; k<3; ++k) {
+			e0[k]=(ax[k]*bb-bx[k]*ab)/det;
+			e1[k]=(bx[k]*aa-ax[k]*ab)/det;
+		}
+		const unsigned int c0New=bcPack565(e0), c1New=bcPack565(e1);
+		if((c0New==c0)&&(c1New==c1)) break;
+		unsigned int indicesNew;
+		bcPalette(c0New, c1New, true, pal);
+		const unsigned int errNew=bcAssign(px, pal, indicesNew);
+		if(errNew>=err) break;
+		c0=c0New;
+		c1=c1New;
+		indices=indicesNew;
+		err=errNew;
+	}
+	// four color mode requires c0>c1, swapping the end points swaps indices 0/1 and 2/3:
+	if(c0<c1) {
+		const unsigned int tmp=c0;
+		c0=c1;
+		c1=tmp;
+		indices^=0x55555555u;
+	}
+	else if(c0==c1) indices=0;
+	dst[0]=static_cast<unsigned char>(c0&0xFF);
+	dst[1]=static_cast<unsigned char>(c0>>8);
+	dst[2]=static_cast<unsigned char>(c1&0xFF);
+	dst[3]=static_cast<unsigned char>(c1>>8);
+	for(k=0; k<4; ++k) dst[4+k]=static_cast<unsigned char>(indices>>(8*k));
+}
+
+/// builds the eight value palette of a BC3 alpha block
+static void bcAlphaPalette(int a0, int a1, int pal[8]) {
+	pal[0]=a0;
+	pal[1]=a1;
+	if(a0>a1) for(int k=2; k<8; ++k) pal[k]=((8-k)*a0+(k-1)*a1)/7;
+	else {
+		for(int k=2; k<6; ++k) pal[k]=((6-k)*a0+(k-1)*a1)/5;
+		pal[6]=0;
+		pal[7]=255;
+	}
+}
+
+/// encodes the alpha values of 16 RGBA pixels as 8 byte BC3 alpha block
+static void bcEncodeAlpha(const unsigned char * px, unsigned char * dst) {
+	int lo=255, hi=0;
+	unsigned int i;
+	for(i=0; i<16; ++i) {
+		if(px[4*i+3]<lo) lo=px[4*i+3];
+		if(px[4*i+3]>hi) hi=px[4*i+3];
+	}
+	dst[0]=static_cast<unsigned char>(hi);
+	dst[1]=static_cast<unsigned char>(lo);
+	int pal[8];
+	bcAlphaPalette(hi, lo, pal);
+	unsigned long long bits=0;
+	if(hi>lo) for(i=0; i<16; ++i) {
+		int best=INT_MAX;
+		unsigned long long bestIndex=0;
+		for(unsigned int k=0; k<8; ++k) {
+			const int d=abs(px[4*i+3]-pal[k]);
+			if(d<best) {
+				best=d;
+				bestIndex=k;
+			}
+		}
+		bits|=bestIndex<<(3*i);
+	}
+	for(i=0; i<6; ++i) dst[2+i]=static_cast<unsigned char>(bits>>(8*i));
+}
+
+/// copies the 4x4 pixel block at bx|by of img to px as RGBA, replicating the border pixels of small images
+static void bcFetch(const Image & img, unsigned int bx, unsigned int by, unsigned char * px) {
+	const unsigned int d=img.depth();
+	for(unsigned int y=0; y<4; ++y) {
+		const unsigned int sy = (by*4+y<img.height()) ? by*4+y : img.height()-1;
+		for(unsigned int x=0; x<4; ++x, px+=4) {
+			const unsigned int sx = (bx*4+x<img.width()) ? bx*4+x : img.width()-1;
+			const unsigned char * src=img.data()+(sy*img.width()+sx)*d;
+			px[0]=src[0];
+			px[1]=src[1];
+			px[2]=src[2];
+			px[3]= d>3 ? src[3] : 255;
+		}
+	}
+}
+
+CompressedImage::CompressedImage(const Image & img, Image::MipFilter filter, bool srgb, ThreadPool * pPool) : 
+	m_format(img.depth()>3 ? BC3 : BC1), m_width(1), m_height(1), m_mipFilter(filter), m_srgb(srgb) {
+	while(m_width<img.width()) m_width<<=1;
+	while(m_height<img.height()) m_height<<=1;
+	alloc();
+	if(img.depth()<3) {
+		fprintf(stderr, "ERROR CompressedImage: unsupported color format.\n");
+		return;
+	}
+	vector<Image*> vLevel;
+	if((m_width!=img.width())||(m_height!=img.height())) // resample to power of two
+		vLevel.push_back(img.resample(m_width, m_height));
+	const Image & base = vLevel.size() ? *vLevel[0] : img;
+	base.mipmaps(vLevel, filter, srgb, pPool);
+	const size_t offset = vLevel.size()+1-nLevels(); // 1 if the first level has been resampled
+	const size_t blockSize = (m_format==BC3) ? 16 : 8;
+	unsigned char px[64];
+	for(unsigned int level=0; level<nLevels(); ++level) {
+		const Image & src = level ? *vLevel[offset+level-1] : base;
+		unsigned char * dst = &mv_data[mv_offset[level]];
+		const unsigned int nx=(src.width()+3)/4, ny=(src.height()+3)/4;
+		for(unsigned int by=0; by<ny; ++by) for(unsigned int bx=0; bx<nx; ++bx, dst+=blockSize) {
+			bcFetch(src, bx, by, px);
+			if(m_format==BC3) {
+				bcEncodeAlpha(px, dst);
+				bcEncodeColor(px, dst+8);
+			}
+			else bcEncodeColor(px, dst);
+		}
+	}
+	for(size_t i=0; i<vLevel.size(); ++i) delete vLevel[i];
+}
+
+CompressedImage::CompressedImage(Format format, unsigned int width, unsigned int height, Image::MipFilter filter, bool srgb) : 
+	m_format(format), m_width(width), m_height(height), m_mipFilter(filter), m_srgb(srgb) {
+	alloc();
+}
+
+void CompressedImage::alloc() {
+	const size_t blockSize = (m_format==BC3) ? 16 : 8;
+	mv_offset.assign(1, 0);
+	for(unsigned int level=0; ; ++level) {
+		const unsigned int w=width(level), h=height(level);
+		mv_offset.push_back(mv_offset.back()+((w+3)/4)*((h+3)/4)*blockSize);
+		if((w==1)&&(h==1)) break;
+	}
+	mv_data.assign(mv_offset.back(), 0);
+}
+
+Image * CompressedImage::decompress(unsigned int level) const {
+	const unsigned int w=width(level), h=height(level);
+	unsigned char * pixels = new unsigned char[w*h*4];
+	const unsigned char * src = data(level);
+	int pal[4][3], alpha[8];
+	for(unsigned int by=0; by<(h+3)/4; ++by) for(unsigned int bx=0; bx<(w+3)/4; ++bx) {
+		unsigned long long alphaBits=0;
+		if(m_format==BC3) {
+			bcAlphaPalette(src[0], src[1], alpha);
+			for(unsigned int i=0; i<6; ++i) alphaBits|=static_cast<unsigned long long>(src[2+i])<<(8*i);
+			src+=8;
+		}
+		const unsigned int c0=src[0]|(src[1]<<8), c1=src[2]|(src[3]<<8);
+		const unsigned int indices=src[4]|(src[5]<<8)|(src[6]<<16)|(static_cast<unsigned int>(src[7])<<24);
+		const bool fourColors=(m_format==BC3)||(c0>c1);
+		bcPalette(c0, c1, fourColors, pal);
+		src+=8;
+		for(unsigned int i=0; i<16; ++i) {
+			const unsigned int x=bx*4+i%4, y=by*4+i/4;
+			if((x>=w)||(y>=h)) continue;
+			unsigned char * dst = pixels+(y*w+x)*4;
+			const unsigned int index=(indices>>(2*i))&3;
+			for(unsigned int k=0; k<3; ++k) dst[k]=static_cast<unsigned char>(pal[index][k]);
+			if(m_format==BC3) dst[3]=static_cast<unsigned char>(alpha[(alphaBits>>(3*i))&7]);
+			else dst[3]= (!fourColors&&(index==3)) ? 0 : 255;
+		}
+	}
+	return new Image(pixels, w, h, 4);
+}
+
+/// version of the compressed texture cache format, to be increased with any layout change
+static const unsigned int PTEX_VERSION = 2;
+/// byte order mark of the compressed texture cache format
+static const unsigned int PTEX_BYTE_ORDER = 0x01020304;
+
+/// an auxiliary struct forming the header of a compressed texture cache file, followed by the mip levels
+struct PtexHeader {
+	/// file identifier "PTEX"
+	char magic[4];
+	/// format version
+	unsigned int version;
+	/// PTEX_BYTE_ORDER in the byte order of the writing machine
+	unsigned int byteOrder;
+	/// CompressedImage::Format
+	unsigned int format;
+	/// width of the first mip level
+	unsigned int width;
+	/// height of the first mip level
+	unsigned int height;
+	/// Image::MipFilter used for generating the mip levels
+	unsigned int mipFilter;
+	/// 1 if the mip levels have been filtered in linear space, otherwise 0
+	unsigned int srgb;
+	/// size of the source file in bytes, <0.0 if unknown
+	double srcSize;
+	/// modification time of the source file, <0.0 if unknown
+	double srcTime;
+};
+
+CompressedImage * CompressedImage::load(const std::string & filename, const std::string & src) {
+	if(!io::fileExist(filename)) return 0;
+	MappedFile file;
+	if(!file.open(filename)) return 0;
+	PtexHeader header;
+	if(file.size()<sizeof(header)) return 0;
+	memcpy(&header, file.data(), sizeof(header));
+	if(memcmp(header.magic, "PTEX", 4)||(header.version!=PTEX_VERSION)||(header.byteOrder!=PTEX_BYTE_ORDER)
+		||((header.format!=BC1)&&(header.format!=BC3))||(header.mipFilter>Image::KAISER)||!header.width||!header.height
+		||(header.width>(1u<<16))||(header.height>(1u<<16))) {
+		fprintf(stderr, "CompressedImage::load() WARNING: \"%s\" has an incompatible format.\n", filename.c_str());
+		return 0;
+	}
+	if(src.size()&&io::fileExist(src) // outdated cache file
+		&&((io::fileTime(src)!=header.srcTime)||(static_cast<double>(io::fileSize(src))!=header.srcSize))) return 0;
+	const size_t size0 = ((header.width+3)/4)*((header.height+3)/4)*((header.format==BC3) ? 16 : 8);
+	if(file.size()-sizeof(header)<size0) { // checked before allocating
+		fprintf(stderr, "CompressedImage::load() ERROR: \"%s\" is corrupt.\n", filename.c_str());
+		return 0;
+	}
+	CompressedImage * pImg = new CompressedImage(static_cast<Format>(header.format), header.width, header.height, 
+		static_cast<Image::MipFilter>(header.mipFilter), header.srgb!=0);
+	if(file.size()!=sizeof(header)+pImg->size()) {
+		fprintf(stderr, "CompressedImage::load() ERROR: \"%s\" is corrupt.\n", filename.c_str());
+		delete pImg;
+		return 0;
+	}
+	memcpy(&pImg->mv_data[0], file.data()+sizeof(header), pImg->size());
+	return pImg;
+}
+
+bool CompressedImage::save(const std::string & filename, const std::string & src) const {
+	PtexHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "PTEX", 4);
+	header.version = PTEX_VERSION;
+	header.byteOrder = PTEX_BYTE_ORDER;
+	header.format = m_format;
+	header.width = m_width;
+	header.height = m_height;
+	header.mipFilter = m_mipFilter;
+	header.srgb = m_srgb ? 1 : 0;
+	header.srcTime = src.size() ? io::fileTime(src) : -1.0;
+	header.srcSize = (header.srcTime>=0.0) ? static_cast<double>(io::fileSize(src)) : -1.0;
+	// concurrent loaders may read the previous file, hence it is replaced instead of overwritten:
+	const string fnTemp(io::tempName(filename));
+	FileWriter file;
+	if(!file.open(fnTemp)) {
+		fprintf(stderr, "CompressedImage::save() ERROR: \"%s\" write file error!\n", filename.c_str());
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&mv_data[0]), mv_data.size());
+	if(!file.close()||!io::rename(fnTemp, filename)) {
+		fprintf(stderr, "CompressedImage::save() ERROR: \"%s\" write file error!\n", filename.c_str());
+		remove(fnTemp.c_str());
+		return false;
+	}
+	return true;
+}
+
 //--- class TextureMgr ---------------------------------------------
 
 TextureMgr* TextureMgr::sp_instance = 0;
 
-TextureMgr::TextureMgr() {
+TextureMgr::TextureMgr() : m_compression(false), m_cache(false), m_mipFilter(Image::BOX), m_mipSrgb(false), 
+	m_s3tc(-1), mp_pool(0) {
 	loaderRegister(Image::loadTGA,"tga");
 }
 
 #ifndef GL_CLAMP_TO_EDGE
 #define GL_CLAMP_TO_EDGE 0x812F
 #endif
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+
+#ifdef _HAVE_GL
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+/// glCompressedTexImage2D entry point (OpenGL 1.3), resolved at runtime
+typedef void (APIENTRY * glCompressedTexImage2DFunc)(GLenum target, GLint level, GLenum internalFormat, 
+	GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid * data);
+static glCompressedTexImage2DFunc s_glCompressedTexImage2D = 0;
+
+/// returns address of a GL extension function or 0
+static void * glProcAddress(const char * name) {
+#if defined __WIN32__ || defined WIN32
+	return (void*)wglGetProcAddress(name);
+#elif defined __APPLE__
+	return 0;
+#else
+	return (void*)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+}
+
+/// resolves the compressed texture upload entry point if S3TC is supported, requires current GL context
+static bool glS3tcInit() {
+	const char * ext = (const char*)glGetString(GL_EXTENSIONS);
+	if(!ext || !strstr(ext, "GL_EXT_texture_compression_s3tc")) return false;
+	s_glCompressedTexImage2D = (glCompressedTexImage2DFunc)glProcAddress("glCompressedTexImage2D");
+	if(!s_glCompressedTexImage2D) s_glCompressedTexImage2D = (glCompressedTexImage2DFunc)glProcAddress("glCompressedTexImage2DARB");
+	return s_glCompressedTexImage2D!=0;
+}
+#endif // _HAVE_GL
 
 unsigned int TextureMgr::genTexture(const Image & img, bool repeatX, bool repeatY) {
 #ifdef _HAVE_GL
@@ -390,6 +1044,50 @@ unsigned int TextureMgr::genTexture(const Image & img, bool repeatX, bool repeat
         fprintf(stderr, "ERROR TextureMgr::genTexture: unsupported color format.");
         return 0;
     }
+    unsigned int w2=1, h2=1;
+    while(w2<img.width()) w2<<=1;
+    while(h2<img.height()) h2<<=1;
+    vector<Image*> vLevel;
+    if((w2!=img.width())||(h2!=img.height())) // resample to power of two
+        vLevel.push_back(img.resample(w2, h2));
+    const Image & base = vLevel.size() ? *vLevel[0] : img;
+    base.mipmaps(vLevel, m_mipFilter, m_mipSrgb, (base.width()*base.height()>=4*s_downsampleParallel) ? &pool() : 0);
+    const size_t offset = (&base==&img) ? 0 : 1;
+    GLint maxSize=0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    size_t first=0; // skip levels exceeding the maximum texture size
+    while((maxSize>0)&&(first+offset<vLevel.size())
+        &&(max(base.width()>>first, base.height()>>first)>static_cast<unsigned int>(maxSize))) ++first;
+    unsigned int id=0;
+	glGenTextures(1,&id);
+    glBindTexture (GL_TEXTURE_2D, id);
+    glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, repeatX ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, repeatY ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(vLevel.size()-offset-first));
+    glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    for(size_t level=first; level<=vLevel.size()-offset; ++level) {
+        const Image & src = level ? *vLevel[offset+level-1] : base;
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level-first), colorType, src.width(), src.height(), 0, 
+            colorType, GL_UNSIGNED_BYTE, src.data());
+    }
+    for(size_t i=0; i<vLevel.size(); ++i) delete vLevel[i];
+    return id;
+#else 
+	return 0;
+#endif
+}
+
+unsigned int TextureMgr::genTexture(const CompressedImage & img, bool repeatX, bool repeatY) {
+#ifdef _HAVE_GL
+    if(m_s3tc<0) m_s3tc = glS3tcInit() ? 1 : 0;
+    GLint maxSize=0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    unsigned int first=0; // skip levels exceeding the maximum texture size
+    while((maxSize>0)&&(first+1<img.nLevels())
+        &&(max(img.width(first), img.height(first))>static_cast<unsigned int>(maxSize))) ++first;
     unsigned int id=0;
 	glGenTextures(1,&id);
     glBindTexture (GL_TEXTURE_2D, id);
@@ -398,9 +1096,18 @@ unsigned int TextureMgr::genTexture(const Image & img, bool repeatX, bool repeat
     glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, repeatY ? GL_REPEAT : GL_CLAMP_TO_EDGE);
     glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(img.nLevels()-1-first));
     glTexEnvf (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-    gluBuild2DMipmaps ( GL_TEXTURE_2D, colorType, img.width(), img.height(),
-                       colorType, GL_UNSIGNED_BYTE, img.data());
+    for(unsigned int level=first; level<img.nLevels(); ++level) {
+        if(m_s3tc) s_glCompressedTexImage2D(GL_TEXTURE_2D, level-first, img.format(), img.width(level), img.height(level), 0, 
+            static_cast<GLsizei>(img.size(level)), img.data(level));
+        else { // fallback for drivers without S3TC support
+            Image * pLevel = img.decompress(level);
+            glTexImage2D(GL_TEXTURE_2D, level-first, img.depth()==4 ? GL_RGBA : GL_RGB, pLevel->width(), pLevel->height(), 0, 
+                GL_RGBA, GL_UNSIGNED_BYTE, pLevel->data());
+            delete pLevel;
+        }
+    }
     return id;
 #else 
 	return 0;
@@ -408,31 +1115,142 @@ unsigned int TextureMgr::genTexture(const Image & img, bool repeatX, bool repeat
 }
 
 unsigned int TextureMgr::getTextureId(const std::string & filename, bool repeatX, bool repeatY, bool reload) {
-	if(!reload) {
-		map<string,TexData*>::iterator jt=mm_texDataName.find(filename);
-		if(jt!=mm_texDataName.end()) return jt->second->texId;
-	}
-	Image * pImg = load(filename);
-	if(!pImg) return 0;
-	unsigned int texId=genTexture(*pImg, repeatX, repeatY);
-	if(texId) mm_texDataName.insert(make_pair(filename, new TexData(filename, texId,pImg->width(),pImg->height(),pImg->depth())));
+	Image * pImg = 0;
+	CompressedImage * pComp = 0;
+	{
+		MutexLock lock(m_mutex);
+		if(!reload) {
+			map<string,TexData*>::iterator jt=mm_texDataName.find(filename);
+			if(jt!=mm_texDataName.end()) return jt->second->texId;
+		}
+		map<string,Image*>::iterator it=mm_image.find(filename);
+		if(it!=mm_image.end()) {
+			pImg = it->second;
+			mm_image.erase(it);
+		}
+		map<string,CompressedImage*>::iterator kt=mm_compressed.find(filename);
+		if(kt!=mm_compressed.end()) {
+			pComp = kt->second;
+			mm_compressed.erase(kt);
+		}
+	}
+	if(!pImg&&!pComp&&!decode(filename, pImg, pComp)) return 0;
+	unsigned int texId;
+	{
+		LoadStage stage("textureUpload");
+		if(pComp) {
+			stage.bytes(pComp->size());
+			texId=genTexture(*pComp, repeatX, repeatY);
+		}
+		else {
+			stage.bytes(pImg->width()*pImg->height()*pImg->depth());
+			texId=genTexture(*pImg, repeatX, repeatY);
+		}
+	}
+	if(texId) {
+		MutexLock lock(m_mutex);
+		mm_texDataName.insert(make_pair(filename, pComp ? new TexData(filename, texId, pComp->width(), pComp->height(), pComp->depth())
+			: new TexData(filename, texId, pImg->width(), pImg->height(), pImg->depth())));
+	}
 	delete pImg;
+	delete pComp;
 	return texId;
 }
 
+void TextureMgr::preload(const std::string & filename) {
+	{
+		MutexLock lock(m_mutex);
+		if((mm_texDataName.find(filename)!=mm_texDataName.end())||(mm_image.find(filename)!=mm_image.end())
+			||(mm_compressed.find(filename)!=mm_compressed.end())) return;
+	}
+	Image * pImg = 0;
+	CompressedImage * pComp = 0;
+	if(!decode(filename, pImg, pComp)) return;
+	MutexLock lock(m_mutex);
+	if(pImg&&!mm_image.insert(make_pair(filename, pImg)).second) delete pImg; // decoded concurrently
+	if(pComp&&!mm_compressed.insert(make_pair(filename, pComp)).second) delete pComp;
+}
+
+void TextureMgr::discard(const std::string & filename) {
+	MutexLock lock(m_mutex);
+	map<string,Image*>::iterator it=mm_image.find(filename);
+	if(it!=mm_image.end()) {
+		delete it->second;
+		mm_image.erase(it);
+	}
+	map<string,CompressedImage*>::iterator kt=mm_compressed.find(filename);
+	if(kt!=mm_compressed.end()) {
+		delete kt->second;
+		mm_compressed.erase(kt);
+	}
+}
+
+bool TextureMgr::decode(const std::string & filename, Image *& pImg, CompressedImage *& pComp) {
+	pImg = 0;
+	pComp = 0;
+	LoadStage stage("textureDecode");
+	const string fname(find(filename));
+	if(!fname.size()) return false;
+	const bool useCache = m_compression && m_cache;
+	const string fnCache(fname+".ptex");
+	if(useCache) { // outdated or incompatible cache files are rejected
+		LoadStage stageCache("readCache");
+		pComp = CompressedImage::load(fnCache, fname);
+		if(pComp&&((pComp->mipFilter()!=m_mipFilter)||(pComp->srgb()!=m_mipSrgb))) { // other mipmap settings
+			delete pComp;
+			pComp = 0;
+		}
+		if(pComp) {
+			stageCache.bytes(pComp->size());
+			stage.elements(1);
+			return true;
+		}
+	}
+	pImg = load(fname);
+	if(!pImg) return false;
+	stage.bytes(pImg->width()*pImg->height()*pImg->depth());
+	stage.elements(1);
+	if(m_compression&&(pImg->depth()>=3)) {
+		{
+			LoadStage stageCompress("textureCompress");
+			pComp = new CompressedImage(*pImg, m_mipFilter, m_mipSrgb, 
+				(pImg->width()*pImg->height()>=4*s_downsampleParallel) ? &pool() : 0);
+			stageCompress.bytes(pComp->size());
+		}
+		delete pImg;
+		pImg = 0;
+		if(useCache) {
+			LoadStage stageCache("writeCache");
+			pComp->save(fnCache, fname);
+		}
+	}
+	return true;
+}
+
+ThreadPool & TextureMgr::pool() {
+	MutexLock lock(m_mutex);
+	if(!mp_pool) mp_pool = new ThreadPool;
+	return *mp_pool;
+}
+
+string TextureMgr::find(const std::string & filename) {
+	string fname(io::unifyPath(filename));
+	if(io::fileExist(fname)) return fname;
+	MutexLock lock(m_mutex);
+	for(vector<string>::const_iterator it = mv_searchPath.begin(); it!=mv_searchPath.end(); ++it) {
+		fname = *it+filename;
+		if(io::fileExist(fname)) return fname;
+	}
+	return string();
+}
+
 Image* TextureMgr::load(const std::string & filename) {
 	if(filename.rfind('.')>filename.size()) return 0; // suffix required for loader
 	string suffix=toLower(filename.substr(filename.rfind('.')+1));
 	map<string, Image* (*)(const string &)>::iterator it = mm_loader.find(suffix);
 	if(it==mm_loader.end()) return 0;
-	string fname(io::unifyPath(filename));
-	bool found = io::fileExist(fname);
-	if(!found) for(vector<string>::const_iterator it = mv_searchPath.begin(); it!=mv_searchPath.end(); ++it) {
-		fname = *it+filename;
-		if(!io::fileExist(fname)) continue;
-		found = true;
-	}
-	return found ? (*(it->second))(fname) : 0;
+	string fname(find(filename));
+	return fname.size() ? (*(it->second))(fname) : 0;
 }
 
 Image* TextureMgr::grabScreen(unsigned int screenW, unsigned int screenH, bool frontBuffer) {
@@ -450,6 +1268,7 @@ Image* TextureMgr::grabScreen(unsigned int screenW, unsigned int screenH, bool f
 }
 
 bool TextureMgr::properties(const std::string & name, unsigned int & id, unsigned int & width, unsigned int & height,  unsigned int & depth) const {
+	MutexLock lock(m_mutex);
 	map<string,TexData*>::const_iterator jt=mm_texDataName.find(name);
 	if(jt==mm_texDataName.end()) return false;
 	id=jt->second->texId;
@@ -469,6 +1288,7 @@ bool TextureMgr::loaderAvailable(const std::string & suffix) const {
 
 void TextureMgr::searchPathAppend(const std::string & path) {
 	string p=io::unifyPath(path);
+	MutexLock lock(m_mutex);
 	for(vector<string>::iterator it = mv_searchPath.begin(); it!=mv_searchPath.end(); ++it)
 		if(p==*it) return; // nothing to do
 	mv_searchPath.push_back(p);
@@ -4,6 +4,7 @@
 #include <string>
 #include <map>
 #include <vector>
+#include "proIo.h"
 /** @file proResource.h
  
  \brief Contains resource access classes
@@ -90,10 +91,33 @@ public:
 	/// returns byte depth, bytes per pixel
 	unsigned int depth() const { return m_depth; }	
 	
+	/// filters available for generating mip levels
+	enum MipFilter {
+		/// averages blocks of 2x2 pixels, fastest
+		BOX,
+		/// separable 8 tap Kaiser windowed sinc filter, sharper and less aliasing than BOX
+		KAISER
+	};
+
 	/// flips image vertically
 	void flipV();
 	/// returns an upsampled versio of this image
 	unsigned char * upsample(int w2, int h2) const;
+	/// returns a new image bilinearly resampled to w2 x h2 pixels by upsample()
+	Image * resample(unsigned int w2, unsigned int h2) const;
+	/// returns a new image of half width and height
+	/** A dimension of 1 pixel is kept, odd dimensions are rounded down.
+	 \param filter (optional) filter kernel, by default each pixel averages a block of 2x2 pixels
+	 \param srgb (optional) if true, the color channels of RGB and RGBA images are treated as sRGB 
+	 encoded and filtered in linear space, which keeps the brightness of high contrast textures.
+	 Alpha and gray channels are always filtered linearly.
+	 \param pPool (optional) thread pool among which the rows of large images are distributed. 
+	 It is ignored when called within a task of any ThreadPool. */
+	Image * downsample(MipFilter filter=BOX, bool srgb=false, ThreadPool * pPool=0) const;
+	/// appends the mip chain of this image to vLevel, i.e., the levels 1 to n down to 1x1 pixel
+	/** Each level is generated from its predecessor by downsample(filter, srgb, pPool). The caller 
+	 takes ownership of the appended images. */
+	void mipmaps(std::vector<Image*> & vLevel, MipFilter filter=BOX, bool srgb=false, ThreadPool * pPool=0) const;
 
 	/// creates image from XPM memory data
 	static Image* createFromXPM(char **xpm);
@@ -112,6 +136,74 @@ protected:
 	unsigned char m_depth;
 };
 
+//--- class CompressedImage ----------------------------------------
+/// a class holding an S3TC compressed image including its complete mip chain
+/** RGB images are encoded as BC1 (DXT1), RGBA images as BC3 (DXT5) by the engine itself, i.e., 
+ compression neither requires an OpenGL context nor driver support and may run in any thread. 
+ Images not having power of two dimensions are resampled to the next power of two before. */
+class CompressedImage {
+public:
+	/// supported block compression formats, the values equal the OpenGL internal formats
+	enum Format { BC1=0x83F0, BC3=0x83F3 };
+	/// constructor compressing img, which has to have a depth of 3 or 4 bytes per pixel
+	/** The mip levels are generated by Image::mipmaps(), see there for the optional parameters. */
+	CompressedImage(const Image & img, Image::MipFilter filter=Image::BOX, bool srgb=false, ThreadPool * pPool=0);
+
+	/// returns compression format
+	Format format() const { return m_format; }
+	/// returns width of the first mip level
+	unsigned int width() const { return m_width; }
+	/// returns height of the first mip level
+	unsigned int height() const { return m_height; }
+	/// returns byte depth of the uncompressed source image, 3 or 4
+	unsigned int depth() const { return m_format==BC3 ? 4 : 3; }
+	/// returns number of mip levels
+	unsigned int nLevels() const { return static_cast<unsigned int>(mv_offset.size()-1); }
+	/// returns width of a mip level
+	unsigned int width(unsigned int level) const { return (m_width>>level) ? (m_width>>level) : 1; }
+	/// returns height of a mip level
+	unsigned int height(unsigned int level) const { return (m_height>>level) ? (m_height>>level) : 1; }
+	/// returns pointer to the blocks of a mip level
+	const unsigned char * data(unsigned int level) const { return &mv_data[mv_offset[level]]; }
+	/// returns size of a mip level in bytes
+	size_t size(unsigned int level) const { return mv_offset[level+1]-mv_offset[level]; }
+	/// returns size of all mip levels in bytes
+	size_t size() const { return mv_data.size(); }
+	/// returns filter used for generating the mip levels
+	Image::MipFilter mipFilter() const { return m_mipFilter; }
+	/// returns true if the mip levels have been filtered in linear space
+	bool srgb() const { return m_srgb; }
+	/// returns a mip level decompressed to an RGBA image
+	Image * decompress(unsigned int level=0) const;
+
+	/// loads a compressed image from a cache file written by save()
+	/** \param filename path of the cache file
+	 \param src (optional) path of the source image. If it exists, the cache file is rejected in case 
+	 it does not match size and modification time of the source.
+	 \return new CompressedImage or 0 if the file is missing, outdated, or incompatible */
+	static CompressedImage * load(const std::string & filename, const std::string & src="");
+	/// saves the compressed image to a cache file, storing size and modification time of the optional source image
+	bool save(const std::string & filename, const std::string & src="") const;
+protected:
+	/// constructor for load()
+	CompressedImage(Format format, unsigned int width, unsigned int height, Image::MipFilter filter, bool srgb);
+	/// calculates the level offsets and sizes the data for the current format and dimensions
+	void alloc();
+	/// compression format
+	Format m_format;
+	/// width of the first mip level
+	unsigned int m_width;
+	/// height of the first mip level
+	unsigned int m_height;
+	/// filter used for generating the mip levels
+	Image::MipFilter m_mipFilter;
+	/// stores whether the mip levels have been filtered in linear space
+	bool m_srgb;
+	/// blocks of all mip levels
+	std::vector<unsigned char> mv_data;
+	/// offsets of the mip levels within mv_data, followed by the total size
+	std::vector<size_t> mv_offset;
+};
 
 //--- class TextureMgr ---------------------------------------------
 
@@ -128,11 +220,18 @@ public:
 	/** \return texture id or 0 in case of error */
 	unsigned int getTextureId(const std::string & name, bool repeatX=true, bool repeatY=true, bool reload=false);
 	/// uploads an Image object as texture to OpenGL */
-	/**  \param img Image object to be uploaded
+	/** The mip levels are generated according to mipFilter() and mipSrgb(). Images not having power 
+	 of two dimensions are resampled to the next power of two before, levels exceeding the maximum 
+	 texture size of the driver are skipped.
+	 \param img Image object to be uploaded
 	 \param repeatX (optional) stores whether texture will be repeated or clamped in X direction
 	 \param repeatY (optional) stores whether texture will be repeated or clamped in Y direction
 	\return texture id or 0 in case of error */
 	unsigned int genTexture(const Image & img, bool repeatX=true, bool repeatY=true);
+	/// uploads a CompressedImage object including its mip levels as texture to OpenGL
+	/** If the driver lacks support for S3TC, the mip levels are decompressed and uploaded uncompressed.
+	 \return texture id or 0 in case of error */
+	unsigned int genTexture(const CompressedImage & img, bool repeatX=true, bool repeatY=true);
 	/// returns properties of a previously loaded texture by name
 	bool properties(const std::string & name, unsigned int & id, unsigned int & width, unsigned int & height,  unsigned int & depth) const;
 
@@ -143,6 +242,34 @@ public:
 	bool loaderAvailable(const std::string & suffix) const;
 	/// loads an image
 	Image* load(const std::string & name);
+	/// decodes an image file in advance, so that a later getTextureId() only uploads it
+	/** May be called by any thread, e.g., a background loader, while getTextureId() and genTexture() 
+	 have to be called by the thread owning the OpenGL context. */
+	void preload(const std::string & name);
+	/// frees an image decoded by preload() that has not been uploaded yet
+	void discard(const std::string & name);
+	/// turns S3TC texture compression on or off, default is off
+	/** When turned on, RGB and RGBA images are compressed by the engine (see CompressedImage) after 
+	 decoding, in case of preload() already by the calling thread. Gray images remain uncompressed. */
+	void compression(bool yesno) { m_compression=yesno; }
+	/// returns true if texture compression is turned on
+	bool compression() const { return m_compression; }
+	/// turns the compressed texture cache on or off, default is off
+	/** When turned on together with compression(), compressed mip chains are stored in a cache file 
+	 named after the image file plus the suffix ".ptex" (e.g., wall.jpg.ptex). Later loads read the 
+	 cache file instead of decoding and compressing the image, as long as it matches the size and 
+	 modification time of the image file. */
+	void cache(bool yesno) { m_cache=yesno; }
+	/// returns true if the compressed texture cache is turned on
+	bool cache() const { return m_cache; }
+	/// sets the filter for generating mip levels, default is Image::BOX
+	void mipFilter(Image::MipFilter filter) { m_mipFilter=filter; }
+	/// returns the filter for generating mip levels
+	Image::MipFilter mipFilter() const { return m_mipFilter; }
+	/// turns sRGB correct mip level filtering of RGB and RGBA textures on or off, default is off
+	void mipSrgb(bool yesno) { m_mipSrgb=yesno; }
+	/// returns true if mip levels of RGB and RGBA textures are filtered in linear space
+	bool mipSrgb() const { return m_mipSrgb; }
 	/// makes a screenshot
 	Image* grabScreen(unsigned int screenW, unsigned int screenH, bool frontBuffer=true);
 	/// appends a path to the texture search path
@@ -150,6 +277,13 @@ public:
 protected:    
 	/// default constructor registering built-in loaders and savers
 	TextureMgr();
+	/// returns the path of an existing image file, searching the texture search path, or an empty string
+	std::string find(const std::string & name);
+	/// decodes an image file, respectively compresses it or reads it from the cache if turned on
+	/** \return true if either pImg or pComp has been set */
+	bool decode(const std::string & name, Image *& pImg, CompressedImage *& pComp);
+	/// returns the thread pool for generating mip levels of large images
+	ThreadPool & pool();
 
 	/// structure holding basic texture attributes
 	struct TexData {
@@ -172,6 +306,24 @@ protected:
 	std::map<std::string, Image* (*)(const std::string &)> mm_loader;
 	/// vector of texture search paths
 	std::vector<std::string> mv_searchPath;
+	/// images decoded by preload() and not yet uploaded
+	std::map<std::string, Image*> mm_image;
+	/// compressed images prepared by preload() and not yet uploaded
+	std::map<std::string, CompressedImage*> mm_compressed;
+	/// stores whether texture compression is turned on
+	bool m_compression;
+	/// stores whether the compressed texture cache is turned on
+	bool m_cache;
+	/// filter for generating mip levels
+	Image::MipFilter m_mipFilter;
+	/// stores whether mip levels are filtered in linear space
+	bool m_mipSrgb;
+	/// stores whether the driver supports S3TC, -1 if not yet queried
+	int m_s3tc;
+	/// thread pool generating mip levels of large images, started on first use
+	ThreadPool * mp_pool;
+	/// lock protecting search paths and texture tables against concurrent loaders
+	mutable Mutex m_mutex;
 
 	/// pointer to singleton instance
 	static TextureMgr* sp_instance;
@@ -2,7 +2,10 @@
 #include "proStr.h"
 #include "proMesh.h"
 #include "proRenderer.h"
+#include "proProfiler.h"
+#include "proIo.h"
 #include <map>
+#include <deque>
 #include <climits>
 using namespace std;
 
@@ -96,18 +99,16 @@ proLight::proLight(const Xml & xs) :
     m_name=xs.attr("DEF");
     m_flags=FLAG_ACTIVE|FLAG_UPDATE|FLAG_SHADOW|FLAG_LIGHT|FLAG_RENDER;
     bool isPointLight=(xs.tag()=="PointLight");
-    vector<string> vStr;
-    split(isPointLight ? xs.attr("location") : xs.attr("direction"),vStr);
-    if(vStr.size()>2)
-        m_pos.set(s2f(vStr[0]),-s2f(vStr[Z]),s2f(vStr[Y]), isPointLight ? 1.0f:0.0f);
+    float v[3];
+    if(s2f(xs.attr(isPointLight ? "location" : "direction"),v,3)==3)
+        m_pos.set(v[0],-v[Z],v[Y], isPointLight ? 1.0f:0.0f);
     if(!isPointLight) m_pos*=-1.0f;
-    if(xs.attr("color").size()) {
-        vStr.clear();
-        split(xs.attr("color"),vStr);
-        float intensity=xs.attr("intensity").size() ? s2f(xs.attr("intensity")) : 1.0f;
-        float ambIntens=xs.attr("ambientIntensity").size() ? s2f(xs.attr("ambientIntensity")) : 0.0f;
-        m_dif.set(s2f(vStr[0])*intensity,s2f(vStr[1])*intensity,s2f(vStr[2])*intensity,1.0f);
-        m_amb.set(s2f(vStr[0])*ambIntens,s2f(vStr[1])*ambIntens,s2f(vStr[2])*ambIntens,1.0f);
+    if(s2f(xs.attr("color"),v,3)==3) {
+        const string sIntensity(xs.attr("intensity")), sAmbIntens(xs.attr("ambientIntensity"));
+        float intensity=sIntensity.size() ? s2f(sIntensity) : 1.0f;
+        float ambIntens=sAmbIntens.size() ? s2f(sAmbIntens) : 0.0f;
+        m_dif.set(v[0]*intensity,v[1]*intensity,v[2]*intensity,1.0f);
+        m_amb.set(v[0]*ambIntens,v[1]*ambIntens,v[2]*ambIntens,1.0f);
     }
     if(xs.attr("radius").size())    
         m_bndSphere.radius(s2f(xs.attr("radius")));
@@ -133,6 +134,7 @@ void proLight::update() {
 
 const char* const proNode::TYPE = "node";
 Renderer * proNode::sp_renderer = 0;
+volatile unsigned int proNode::s_revision = 0;
 
 Xml proNode::xml() const {
     Xml node("Node");
@@ -140,6 +142,12 @@ Xml proNode::xml() const {
     return node;
 }
 
+void proNode::x3d(XmlWriter & writer, const char * tag) const {
+    Xml xs(xml());
+    if(tag) xs.tag(tag);
+    writer.write(xs);
+}
+
 void proNode::initGraphics() {
 	if(mp_renderable) {
 		delete mp_renderable;
@@ -166,53 +174,413 @@ void proNode::closeGraphics()  {
 }
 
 bool proNode::testBounding(const frustum & frust, const mat4f & matrix) const {
+    ProfileAccumulator profile("cull");
     if(m_bndSphere.radius()<0.0f) return true;
     sphere bounding(boundingSphere());
     bounding.transform(matrix);
     return frust.intersects(bounding);
 }
 
-/// auxiliary function that substitutes USE attributes by corresponding DEF attributes
-static void substituteUse(Xml & xs, Xml & root) {
-    unsigned int i;
-    for(i=0; i<xs.nAttr(); ++i)
-        if(xs.attr(i).first=="USE") {
-            Xml *pDef=root.find("","DEF",xs.attr(i).second);
-            if(pDef) {
-                for(size_t j=0; j<pDef->nAttr(); ++j)
-                    xs.attr(pDef->attr(j).first,pDef->attr(j).second);
-                for(size_t j=0; j<pDef->nChildren(); ++j)
-                    if(pDef->child(j).first) xs.append(*pDef->child(j).first);
-                    else xs.append(pDef->child(j).second);
+//--- class X3dBuilder ----------------------------------------------
+
+/// an auxiliary class building proNodes directly from the events of an X3D parser
+/** The builder is either fed by XmlParser::parse() or walks an existing Xml DOM via build(). 
+ Only the Shape/IndexedFaceSet Appearance subtrees are converted into Xml statements for the
+ MaterialMgr, all other data is referred to within the parsed buffer. DEF/USE references are 
+ resolved in a single pass via a symbol table, USE creates a copy of the already built node 
+ instead of reinterpreting a textual copy of the DEF subtree. */
+class X3dBuilder : public XmlParser {
+public:
+    /// constructor
+    /** \param decode determines whether entities in the attribute values are decoded */
+    X3dBuilder(bool decode=true) : mp_root(0), m_skip(0), m_hasFaceSet(false), m_inFaceSet(false), m_inShape(false), 
+        mp_appearance(0), m_nElements(0), m_decode(decode) { }
+    /// destructor
+    virtual ~X3dBuilder() {
+        for(map<string,Def>::iterator it=mm_def.begin(); it!=mm_def.end(); ++it) {
+            delete it->second.pXml;
+            if(it->second.isCopy) delete it->second.pNode;
+        }
+        delete mp_appearance;
+    }
+    /// builds nodes from an already decoded Xml statement and its subtree
+    void build(const Xml & xs) {
+        vector<XmlStr> vAttr;
+        vAttr.reserve(2*xs.nAttr());
+        for(size_t i=0; i<xs.nAttr(); ++i) { // attribute values have to remain valid while building
+            pair<string,string> attr(xs.attr(i));
+            vAttr.push_back(store(attr.first));
+            vAttr.push_back(store(attr.second));
+        }
+        const XmlStr tag(xs.tag());
+        startElement(tag, vAttr.size() ? &vAttr[0] : 0, xs.nAttr());
+        for(size_t i=0; i<xs.nChildren(); ++i) {
+            if(xs.child(i).first) build(*xs.child(i).first);
+            else text(store(xs.child(i).second),false);
+        }
+        endElement(tag);
+    }
+    /// returns the root of the built node graph, 0 if none
+    proNode * root() const { return mp_root; }
+    /// returns number of parsed elements
+    size_t nElements() const { return m_nElements; }
+protected:
+    /// element kinds
+    enum { ELEM_OTHER, ELEM_TRANSFORM, ELEM_SHAPE, ELEM_FACESET, ELEM_APPEARANCE };
+    struct Def;
+    /// an auxiliary struct storing the state of an open element
+    struct Frame {
+        /// constructor
+        Frame(unsigned int elemKind, const XmlStr & defName, size_t nDef=0) : kind(elemKind), def(defName), 
+            pTransform(0), isScaled(false), nNodeDef(nDef), pDef(0) { }
+        /// element kind
+        unsigned int kind;
+        /// DEF name, empty if none
+        XmlStr def;
+        /// transform created by this element, 0 if none
+        proTransform * pTransform;
+        /// stores whether the transform contains a scaling
+        bool isScaled;
+        /// number of node definitions at the start of the element
+        size_t nNodeDef;
+        /// node definition completed at the end of the element, 0 if none
+        Def * pDef;
+    };
+    /// an auxiliary struct storing a DEF definition
+    struct Def {
+        /// constructor
+        Def() : pNode(0), pXml(0), isNode(false), isFaceSet(false), isCopy(false) { }
+        /// defined node, 0 while being built or if no node resulted
+        proNode * pNode;
+        /// defined Appearance subtree statement, 0 if none
+        Xml * pXml;
+        /// defined Coordinate/Normal/Color/TextureCoordinate field
+        XmlStr field;
+        /// defined IndexedFaceSet fields
+        proMesh::X3dFields fields;
+        /// defined IndexedFaceSet name
+        XmlStr name;
+        /// stores whether definition is a scene graph node
+        bool isNode;
+        /// stores whether definition is an IndexedFaceSet
+        bool isFaceSet;
+        /// stores whether pNode is a private copy owned by the symbol table
+        bool isCopy;
+    };
+
+    /// returns definition of DEF name, 0 and a warning if it does not exist
+    Def * lookup(const XmlStr & name) {
+        map<string,Def>::iterator it=mm_def.find(name.str());
+        if(it!=mm_def.end()) return &it->second;
+        cerr << "proNode::interpret() WARNING: no DEF=" << name.str() << " found.\n";
+        return 0;
+    }
+    /// returns a range of a persistent copy of s
+    XmlStr store(const string & s) {
+        md_str.push_back(s);
+        return XmlStr(md_str.back());
+    }
+    /// returns s as string, optionally decoded
+    string value(const XmlStr & s) const { return m_decode ? s.decoded() : s.str(); }
+    /// returns a new definition of DEF name, 0 if name is empty or already defined
+    Def * define(const XmlStr & name) {
+        if(name.empty()) return 0;
+        pair<map<string,Def>::iterator,bool> ret=mm_def.insert(make_pair(name.str(),Def()));
+        return ret.second ? &ret.first->second : 0;
+    }
+    /// returns a new node definition of DEF name, 0 if name is empty or already defined
+    Def * defineNode(const XmlStr & name, proNode * pNode=0) {
+        Def * pDef=define(name);
+        if(!pDef) return 0;
+        pDef->isNode=true;
+        pDef->pNode=pNode;
+        mv_nodeDef.push_back(pDef);
+        return pDef;
+    }
+    /// preserves node definitions since the start of a scaled transform before its scaling is applied
+    void preserveDefs(size_t nNodeDef) {
+        for(size_t i=nNodeDef; i<mv_nodeDef.size(); ++i) if(mv_nodeDef[i]->pNode&&!mv_nodeDef[i]->isCopy) {
+            mv_nodeDef[i]->pNode=mv_nodeDef[i]->pNode->copy();
+            mv_nodeDef[i]->isCopy=true;
+        }
+    }
+    /// returns transform of the innermost open transform element, 0 if none
+    proTransform * parentTransform() const {
+        for(vector<Frame>::const_reverse_iterator it=mv_frame.rbegin(); it!=mv_frame.rend(); ++it)
+            if(it->pTransform) return it->pTransform;
+        return 0;
+    }
+    /// attaches a newly built node to the current transform or makes it the root node
+    void attach(proNode * pNode) {
+        if(!pNode) return;
+        proTransform * pParent=parentTransform();
+        if(pParent) pParent->append(pNode,false);
+        else if(!mp_root) mp_root=pNode;
+        else delete pNode;
+    }
+    /// appends a new Xml statement to the current Appearance subtree, or starts it
+    void appendXml(const XmlStr & tag, const XmlStr * pAttr, size_t nAttr) {
+        Xml xs(tag.str());
+        XmlStr use=attr(pAttr,nAttr,"USE");
+        Def * pDef=use.empty() ? 0 : lookup(use);
+        if(pDef&&pDef->pXml) xs=*pDef->pXml;
+        else for(size_t i=0; i<nAttr; ++i) if(pAttr[2*i]!="USE")
+            xs.attr(pAttr[2*i].str(),value(pAttr[2*i+1]));
+        if(mv_xml.size()) mv_xml.push_back(&mv_xml.back()->append(xs));
+        else {
+            delete mp_appearance;
+            mp_appearance=new Xml(xs);
+            mv_xml.push_back(mp_appearance);
+        }
+    }
+    /// starts collecting the fields of an IndexedFaceSet
+    void startFaceSet(const XmlStr * pAttr, size_t nAttr) {
+        XmlStr use=attr(pAttr,nAttr,"USE");
+        if(use.size()) {
+            Def * pDef=lookup(use);
+            if(pDef&&pDef->isFaceSet) {
+                m_fields=pDef->fields;
+                m_name=pDef->name;
             }
-            else cerr << "ioX3d::substituteUse() WARNING: no subTag DEF=" << xs.attr(i).first << " found.\n";
-            xs.attr("USE","");
-            break;
+            return;
         }
-    for(i=0; i<xs.nChildren(); ++i) if(xs.child(i).first) substituteUse(*xs.child(i).first,root);
-}
+        m_name=attr(pAttr,nAttr,"DEF");
+        m_fields.coordIndex=attr(pAttr,nAttr,"coordIndex");
+        m_fields.normalIndex=attr(pAttr,nAttr,"normalIndex");
+        m_fields.colorIndex=attr(pAttr,nAttr,"colorIndex");
+        m_fields.texCoordIndex=attr(pAttr,nAttr,"texCoordIndex");
+        XmlStr solid=attr(pAttr,nAttr,"solid");
+        m_fields.solid=solid.empty() || s2b(solid.str());
+        m_fields.colorPerVertex=(toUpper(attr(pAttr,nAttr,"colorPerVertex").str())!="FALSE");
+    }
+    /// sets field if still unset, from the attribute key or the referenced definition, and registers a DEF
+    void setField(XmlStr & field, const char * key, const XmlStr * pAttr, size_t nAttr) {
+        XmlStr use=attr(pAttr,nAttr,"USE"), value;
+        if(use.size()) {
+            Def * pDef=lookup(use);
+            if(pDef) value=pDef->field;
+        }
+        else value=attr(pAttr,nAttr,key);
+        Def * pDef=define(attr(pAttr,nAttr,"DEF"));
+        if(pDef) pDef->field=value;
+        if(field.empty()) field=value;
+    }
+    /// ends a Shape or standalone IndexedFaceSet by building its mesh
+    proNode * endShape() {
+        proMesh * pMesh=0;
+        if(m_hasFaceSet) {
+            pMesh=new proMesh(m_fields,value(m_name));
+            if(mp_appearance) // allow shared materials:
+                pMesh->material(MaterialMgr::singleton()[MaterialMgr::singleton().add(*mp_appearance)]);
+        }
+        delete mp_appearance;
+        mp_appearance=0;
+        attach(pMesh);
+        return pMesh;
+    }
+
+    /// called at the start of an element
+    virtual void startElement(const XmlStr & tag, const XmlStr * pAttr, size_t nAttr) {
+        ++m_nElements;
+        if(m_skip) { ++m_skip; return; }
+        const XmlStr def=attr(pAttr,nAttr,"DEF");
+        if(mv_xml.size()) { // Appearance subtree
+            appendXml(tag,pAttr,nAttr);
+            mv_frame.push_back(Frame(ELEM_APPEARANCE,def));
+            return;
+        }
+        if(m_inShape||m_inFaceSet) {
+            if(tag=="Appearance") {
+                if(!mp_appearance) {
+                    appendXml(tag,pAttr,nAttr);
+                    mv_frame.push_back(Frame(ELEM_APPEARANCE,def));
+                }
+                else m_skip=1;
+            }
+            else if(tag=="IndexedFaceSet") {
+                if(m_hasFaceSet) { m_skip=1; return; }
+                m_hasFaceSet=true;
+                m_inFaceSet=true;
+                startFaceSet(pAttr,nAttr);
+                mv_frame.push_back(Frame(ELEM_FACESET,def));
+            }
+            else {
+                if(tag=="Normal") setField(m_fields.normal,"vector",pAttr,nAttr);
+                else if(m_inFaceSet) {
+                    if(tag=="Coordinate") setField(m_fields.coord,"point",pAttr,nAttr);
+                    else if(tag=="Color") setField(m_fields.color,"color",pAttr,nAttr);
+                    else if(tag=="TextureCoordinate") setField(m_fields.texCoord,"point",pAttr,nAttr);
+                }
+                mv_frame.push_back(Frame(ELEM_OTHER,XmlStr()));
+            }
+            return;
+        }
+
+        // scene graph nodes:
+        if(mv_frame.empty()&&(tag=="X3D")) {
+            mv_frame.push_back(Frame(ELEM_OTHER,XmlStr()));
+            return;
+        }
+        if(tag=="Scene") {
+            if(mv_frame.size()>1||mp_root) { m_skip=1; return; }
+            Frame frame(ELEM_TRANSFORM,XmlStr());
+            frame.pTransform=new proTransform(value(def));
+            attach(frame.pTransform);
+            mv_frame.push_back(frame);
+            return;
+        }
+        if(mv_frame.size()&&!parentTransform()) { m_skip=1; return; } // outside of Scene
+        const XmlStr use=attr(pAttr,nAttr,"USE");
+        if(use.size()&&(tag!="IndexedFaceSet")) { // IndexedFaceSet fields are reused by startFaceSet()
+            Def * pDef=lookup(use);
+            if(pDef&&pDef->isNode) {
+                if(pDef->pNode) attach(pDef->pNode->copy());
+                else cerr << "proNode::interpret() WARNING: USE=" << use.str() << " refers to an incomplete or empty node.\n";
+            }
+            m_skip=1;
+            return;
+        }
+        if((tag=="Group")||(tag=="Transform")) {
+            Frame frame(ELEM_TRANSFORM,def,mv_nodeDef.size());
+            frame.pTransform=new proTransform(value(def));
+            proTransform::X3dFields fields;
+            fields.translation=attr(pAttr,nAttr,"translation");
+            fields.center=attr(pAttr,nAttr,"center");
+            fields.rotation=attr(pAttr,nAttr,"rotation");
+            fields.scale=attr(pAttr,nAttr,"scale");
+            fields.scaleOrientation=attr(pAttr,nAttr,"scaleOrientation");
+            frame.isScaled=frame.pTransform->set(fields);
+            attach(frame.pTransform);
+            mv_frame.push_back(frame);
+        }
+        else if((tag=="Shape")||(tag=="IndexedFaceSet")) {
+            m_fields=proMesh::X3dFields();
+            m_name=XmlStr();
+            m_hasFaceSet=m_inFaceSet=m_inShape=false;
+            if(tag=="IndexedFaceSet") {
+                m_hasFaceSet=m_inFaceSet=true;
+                startFaceSet(pAttr,nAttr);
+            }
+            else m_inShape=true;
+            mv_frame.push_back(Frame(m_inShape ? ELEM_SHAPE : ELEM_FACESET,def));
+            mv_frame.back().pDef=defineNode(def);
+        }
+        else if((tag=="DirectionalLight")||(tag=="PointLight")) {
+            Xml xs(tag.str());
+            for(size_t i=0; i<nAttr; ++i) xs.attr(pAttr[2*i].str(),value(pAttr[2*i+1]));
+            proNode * pLight=new proLight(xs);
+            attach(pLight);
+            defineNode(def,pLight);
+            m_skip=1;
+        }
+        else m_skip=1;
+    }
+
+    /// called at the end of an element
+    virtual void endElement(const XmlStr & tag) {
+        if(m_skip) { --m_skip; return; }
+        if(mv_frame.empty()) return;
+        Frame frame=mv_frame.back();
+        mv_frame.pop_back();
+        switch(frame.kind) {
+        case ELEM_APPEARANCE: {
+            Def * pDef=define(frame.def);
+            if(pDef) pDef->pXml=new Xml(*mv_xml.back());
+            mv_xml.pop_back();
+            break; }
+        case ELEM_TRANSFORM: {
+            if(frame.isScaled) { // USE refers to the unscaled subnodes
+                preserveDefs(frame.nNodeDef);
+                frame.pTransform->applyMatrix();
+            }
+            defineNode(frame.def,frame.pTransform);
+            break; }
+        case ELEM_FACESET: {
+            m_inFaceSet=false;
+            if(!m_inShape) { // standalone IndexedFaceSet
+                proNode * pNode=endShape();
+                if(frame.pDef) { 
+                    frame.pDef->pNode=pNode; 
+                    frame.pDef->isFaceSet=true; frame.pDef->fields=m_fields; frame.pDef->name=m_name; 
+                }
+            }
+            else {
+                Def * pDef=define(frame.def);
+                if(pDef) { pDef->isFaceSet=true; pDef->fields=m_fields; pDef->name=m_name; }
+            }
+            break; }
+        case ELEM_SHAPE: {
+            m_inShape=false;
+            proNode * pNode=endShape();
+            if(frame.pDef) frame.pDef->pNode=pNode;
+            break; }
+        default: break;
+        }
+    }
+
+    /// called for text content, only kept within Appearance subtrees
+    virtual void text(const XmlStr & s, bool cdata) {
+        if(!m_skip&&mv_xml.size()) mv_xml.back()->append(cdata ? s.str() : value(s));
+    }
+
+    /// root of the built node graph
+    proNode * mp_root;
+    /// nesting depth within an ignored subtree, 0 if none
+    unsigned int m_skip;
+    /// currently open elements
+    vector<Frame> mv_frame;
+    /// symbol table of DEF definitions
+    map<string,Def> mm_def;
+    /// node definitions in order of their start
+    vector<Def*> mv_nodeDef;
+    /// fields of the current IndexedFaceSet
+    proMesh::X3dFields m_fields;
+    /// name of the current IndexedFaceSet
+    XmlStr m_name;
+    /// stores whether the current Shape contains an IndexedFaceSet
+    bool m_hasFaceSet;
+    /// stores whether an IndexedFaceSet is currently open
+    bool m_inFaceSet;
+    /// stores whether a Shape is currently open
+    bool m_inShape;
+    /// Appearance statement of the current Shape, 0 if none
+    Xml * mp_appearance;
+    /// currently open statements of the Appearance subtree
+    vector<Xml*> mv_xml;
+    /// number of parsed elements
+    size_t m_nElements;
+    /// stores whether entities are decoded
+    bool m_decode;
+    /// persistent attribute values of a walked Xml DOM
+    deque<string> md_str;
+};
 
 proNode * proNode::interpret(const Xml & xs) {
-	if((xs.tag()=="X3D")&&xs.find("Scene"))
-		return interpret(*xs.find("Scene"));
-	if(xs.tag()=="Scene") {
-		Xml xSubst(xs);
-		substituteUse(xSubst,xSubst);
-		return new proTransform(xSubst);
-	}
-	if((xs.tag() == "Group")||(xs.tag() == "Transform"))
-		return new proTransform(xs);
-	if(xs.tag()=="Shape") {
-		const Xml* xIndFaceSet=xs.find("IndexedFaceSet");
-		if(xIndFaceSet) return interpret(*xIndFaceSet);
-	}
-	if(xs.tag()=="IndexedFaceSet")
-		return new proMesh(xs);
-	if((xs.tag()=="DirectionalLight")||(xs.tag()=="PointLight"))
-		return new proLight(xs);
-	return 0;
+    LoadStage stage("interpret");
+    X3dBuilder builder(false);
+    builder.build(xs);
+    stage.elements(builder.nElements());
+    return builder.root();
 }
 
+proNode * proNode::interpret(const char * pData, size_t n, XmlParser::Source * pSource) {
+    LoadStage stage("interpret");
+    stage.bytes(n);
+    X3dBuilder builder(!pSource);
+    if(pSource) pSource->parse(pData,n,builder);
+    else builder.parse(pData,n);
+    stage.elements(builder.nElements());
+    return builder.root();
+}
+
+//--- class proNodeArray --------------------------------------------
+
+void proNodeArray::rebuild() {
+	mv_node.clear();
+	if(mp_root) mp_root->flatten(mv_node);
+	m_revision=proNode::revision();
+	m_valid=true;
+}
 
 //--- class proTransform --------------------------------------------
 
@@ -223,57 +591,57 @@ proTransform::proTransform(const proTransform & source) : proNode(source), m_mat
         mv_node.push_back(source.mv_node[i]->copy());
 }
 
-proTransform::proTransform(const Xml & xGet) : proNode(), m_isIdentity(true) {
-    Xml xs(xGet);
+proTransform::proTransform(const Xml & xs) : proNode(), m_isIdentity(true) {
     m_name=xs.attr("DEF");
+    const string sTranslation(xs.attr("translation")), sCenter(xs.attr("center")), sRotation(xs.attr("rotation")), 
+        sScale(xs.attr("scale")), sScaleOrientation(xs.attr("scaleOrientation"));
+    X3dFields fields;
+    fields.translation=XmlStr(sTranslation);
+    fields.center=XmlStr(sCenter);
+    fields.rotation=XmlStr(sRotation);
+    fields.scale=XmlStr(sScale);
+    fields.scaleOrientation=XmlStr(sScaleOrientation);
+    bool isScaled=set(fields);
+
+    for(size_t i=0; i<xs.nChildren(); ++i) if(xs.child(i).first)
+        append(interpret(*xs.child(i).first),false);
+    if(isScaled) applyMatrix();
+}
 
+/// parses up to n floats of s into pF, returns the number of parsed floats
+static size_t parseFloats(const XmlStr & s, float * pF, size_t n) {
+    const char * p=s.data();
+    size_t i=0;
+    while((i<n)&&(p=parseFloat(p,s.end(),pF[i]))) ++i;
+    return i;
+}
+
+bool proTransform::set(const X3dFields & fields) {
+    m_mat.identity();
     bool isScaled=false;
-    vector<string> vStr;
-    if(xs.attr("translation").size()) {
-        //cerr << "translation " << xs.attr("translation") << "\n";
-        vStr.clear();
-        split(xs.attr("translation"),vStr);
-        if(vStr.size()>2)
-            m_mat.translate(s2f(vStr[0]),-s2f(vStr[Z]),s2f(vStr[Y]));
-    }
+    float v[4];
+    if(parseFloats(fields.translation,v,3)==3)
+        m_mat.translate(v[0],-v[Z],v[Y]);
     vec3f center;
-    if(xs.attr("center").size()) {
-        //cerr << "center " << xs.attr("center") << "\n";
-        vStr.clear();
-        split(xs.attr("center"),vStr);
-        if(vStr.size()>2) {
-            center.set(s2f(vStr[0]),-s2f(vStr[Z]),s2f(vStr[Y]));
-            if(center[X]||center[Y]||center[Z])
-                m_mat.translate(center);
-        }
+    if(parseFloats(fields.center,v,3)==3) {
+        center.set(v[0],-v[Z],v[Y]);
+        if(center[X]||center[Y]||center[Z])
+            m_mat.translate(center);
     }
-    if(xs.attr("rotation").size()) {
-        //cerr << "rotation " << xs.attr("rotation") << "\n";
-        vStr.clear();
-        split(xs.attr("rotation"),vStr);
-        if(vStr.size()>3) {
-            float angle=s2f(vStr[3])*RAD2DEG;
-            if(angle)
-                m_mat.rotate(angle, s2f(vStr[0]),-s2f(vStr[Z]),s2f(vStr[Y]));
-        }
+    if(parseFloats(fields.rotation,v,4)==4) {
+        float angle=v[3]*RAD2DEG;
+        if(angle)
+            m_mat.rotate(angle, v[0],-v[Z],v[Y]);
     }
     
-    if(xs.attr("scale").size()) {
+    if(fields.scale.size()) {
         vec4f scOri(0.0f,0.0f,0.0f,0.0f);
-        if(xs.attr("scaleOrientation").size()) {
-            //cerr << "scaleOrientation " << xs.attr("scaleOrientation") << "\n";
-            vStr.clear();
-            split(xs.attr("scaleOrientation"),vStr);
-            if(vStr.size()>3) {
-                scOri.set(s2f(vStr[3])*RAD2DEG, s2f(vStr[0]),-s2f(vStr[Z]),s2f(vStr[Y]));
-                if(scOri[3]) m_mat.rotate(scOri[3],scOri[X],scOri[Y],scOri[Z]);
-            }
+        if(parseFloats(fields.scaleOrientation,v,4)==4) {
+            scOri.set(v[3]*RAD2DEG, v[0],-v[Z],v[Y]);
+            if(scOri[3]) m_mat.rotate(scOri[3],scOri[X],scOri[Y],scOri[Z]);
         }
-        //cerr << "scale " << xs.attr("scale") << "\n";
-        vStr.clear();
-        split(xs.attr("scale"),vStr);
-        if(vStr.size()>2) {
-            vec3f sc(s2f(vStr[X]),s2f(vStr[Z]),s2f(vStr[Y]));
+        if(parseFloats(fields.scale,v,3)==3) {
+            vec3f sc(v[X],v[Z],v[Y]);
             if(sc[X]||sc[Y]||sc[Z]) {
                 isScaled=true;
                 m_mat.scale(sc);
@@ -285,14 +653,16 @@ proTransform::proTransform(const Xml & xGet) : proNode(), m_isIdentity(true) {
         
     if(center[X]||center[Y]||center[Z])
         m_mat.translate(-center);
+    m_isIdentity=m_mat.isIdentity();
+    return isScaled;
+}
 
-    for(size_t i=0; i<xs.nChildren(); ++i) if(xs.child(i).first) {
-        proNode* pChild=interpret(*xs.child(i).first);
-        if(isScaled) pChild->transform(m_mat);
-        append(pChild,false);
-    }
-    if(isScaled) m_mat.identity();
-	else m_isIdentity=m_mat.isIdentity();
+void proTransform::applyMatrix() {
+    if(m_isIdentity) return;
+    for(vector<proNode*>::iterator it=mv_node.begin(); it!=mv_node.end(); ++it)
+        (*it)->transform(m_mat);
+    m_mat.identity();
+    m_isIdentity=true;
 }
 
 void proTransform::draw(proCamera & camera) {
@@ -324,7 +694,11 @@ void proTransform::draw(proCamera & camera) {
     }
     
     // normal draw:
-    if(!testBounding(camera.frs(),camera.matrix())) return;
+    RenderStats::add(RenderStats::NODES_VISITED);
+    if(!testBounding(camera.frs(),camera.matrix())) {
+        RenderStats::add(RenderStats::NODES_CULLED);
+        return;
+    }
     if(!m_isIdentity) camera.push(m_mat);
     for(vector<proNode*>::iterator it=mv_node.begin(); it!=mv_node.end(); ++it)
         (*it)->draw(camera);
@@ -337,6 +711,7 @@ bool proTransform::erase(proNode * node, bool doDelete) {
         if(*it==node) {
             if(doDelete) delete *it;
             mv_node.erase(it);
+            io::atomicAdd(s_revision, 1);
             return true;
         }
     return false;
@@ -346,6 +721,7 @@ void proTransform::clear() {
     for(vector<proNode*>::iterator i=mv_node.begin(); i!=mv_node.end(); ++i)
         delete *i;
     mv_node.clear();
+    io::atomicAdd(s_revision, 1);
 }
 
 proNode * proTransform::next(proNode::iterator & iter) {
@@ -364,8 +740,21 @@ proNode * proTransform::next(proNode::iterator & iter) {
     }
 }
 
+void proTransform::traverse(proNode::visitor & v) {
+    if(!v.visit(*this)) return;
+    for(vector<proNode*>::iterator it=mv_node.begin(); it!=mv_node.end(); ++it)
+        (*it)->traverse(v);
+}
+
+void proTransform::flatten(vector<proNode*> & v) {
+    v.push_back(this);
+    for(vector<proNode*>::iterator it=mv_node.begin(); it!=mv_node.end(); ++it)
+        (*it)->flatten(v);
+}
+
 void proTransform::enable(unsigned int flag) {
     m_flags|=flag;
+    io::atomicAdd(s_revision, 1);
     if((flag&FLAG_SHADOW)||(flag&FLAG_UPDATE))
         for(vector<proNode*>::iterator it=mv_node.begin(); it!=mv_node.end(); ++it)
             (*it)->enable(flag);
@@ -373,6 +762,7 @@ void proTransform::enable(unsigned int flag) {
 
 void proTransform::disable(unsigned int flag) {
     m_flags&=~flag;
+    io::atomicAdd(s_revision, 1);
     if(flag&FLAG_SHADOW)
         for(vector<proNode*>::iterator it=mv_node.begin(); it!=mv_node.end(); ++it)
             (*it)->disable(FLAG_SHADOW);
@@ -390,57 +780,50 @@ void proTransform::calcBounding(bool recursive) {
         m_bbox.first=m_bbox.second=vec3f(0.0f,0.0f,0.0f);
         return;
     }
-    unsigned int i;
-    m_bndSphere.radius(0.0f);
-    float radiusMax=0.0f;
-    if(recursive) mv_node[0]->calcBounding(true);
-    vec3f pMin(mv_node[0]->boundingSphere().center());
-    vec3f pMax(mv_node[0]->boundingSphere().center());
-    m_bbox=mv_node[0]->boundingBox();
+    size_t i;
+    if(recursive) for(i=0; i<mv_node.size(); ++i)
+        mv_node[i]->calcBounding(true);
+    // merge children's axis aligned boxes, other nodes contribute the box around their sphere:
+    vector<pair<vec3f,vec3f> > vBox(mv_node.size());
     for(i=0; i<mv_node.size(); ++i) {
-        if((i>0) && recursive) mv_node[i]->calcBounding(true);
-        if(mv_node[i]->boundingSphere().radius()<0.0f)
+        sphere bounding(mv_node[i]->boundingSphere());
+        if(bounding.radius()<0.0f) {
             m_bndSphere.radius(-1.0f);
-        if(m_bndSphere.radius()>=0.0f) {
-            // calculate bounding box parallel to coordinate system:
-            m_bbox.first[X]=min(mv_node[i]->boundingBox().first[X],m_bbox.first[X]);
-            m_bbox.second[X]=max(mv_node[i]->boundingBox().second[X],m_bbox.second[X]);
-            m_bbox.first[Y]=min(mv_node[i]->boundingBox().first[Y],m_bbox.first[Y]);
-            m_bbox.second[Y]=max(mv_node[i]->boundingBox().second[Y],m_bbox.second[Y]);
-            m_bbox.first[Z]=min(mv_node[i]->boundingBox().first[Z],m_bbox.first[Z]);
-            m_bbox.second[Z]=max(mv_node[i]->boundingBox().second[Z],m_bbox.second[Z]);
-
-            pMin[X]=min(mv_node[i]->boundingSphere()[X],pMin[X]);
-            pMax[X]=max(mv_node[i]->boundingSphere()[X],pMax[X]);
-            pMin[Y]=min(mv_node[i]->boundingSphere()[Y],pMin[Y]);
-            pMax[Y]=max(mv_node[i]->boundingSphere()[Y],pMax[Y]);
-            pMin[Z]=min(mv_node[i]->boundingSphere()[Z],pMin[Z]);
-            pMax[Z]=max(mv_node[i]->boundingSphere()[Z],pMax[Z]);
-            radiusMax=max(radiusMax,mv_node[i]->boundingSphere().radius());
+            return;
+        }
+        if(mv_node[i]->typeId()&(TYPE_MESH|TYPE_TRANSFORM)) vBox[i]=mv_node[i]->boundingBox();
+        else vBox[i]=make_pair(bounding.center()-vec3f(bounding.radius(),bounding.radius(),bounding.radius()),
+            bounding.center()+vec3f(bounding.radius(),bounding.radius(),bounding.radius()));
+        if(!i) m_bbox=vBox[i];
+        else for(unsigned int c=X; c<=Z; ++c) {
+            m_bbox.first[c]=min(vBox[i].first[c],m_bbox.first[c]);
+            m_bbox.second[c]=max(vBox[i].second[c],m_bbox.second[c]);
         }
     }
-    if(m_bndSphere.radius()<0.0f) return;
-    // search for minimal radius from center of bounding box:
-    vec3f c((pMin+pMax)*0.5f);
-    float rSquared=0.0f;
+    // the sphere around the box center has to reach each child's sphere or its farthest box corner:
+    vec3f c((m_bbox.first+m_bbox.second)*0.5f);
+    float radius=0.0f;
     for(i=0; i<mv_node.size(); ++i) {
-        float currDist=c.sqrDistTo(mv_node[i]->boundingSphere().center());
-        if(currDist>rSquared) rSquared=currDist;
+        sphere bounding(mv_node[i]->boundingSphere());
+        float reachSphere=c.distTo(bounding.center())+bounding.radius();
+        vec3f corner(max(fabs(vBox[i].first[X]-c[X]),fabs(vBox[i].second[X]-c[X])),
+            max(fabs(vBox[i].first[Y]-c[Y]),fabs(vBox[i].second[Y]-c[Y])),
+            max(fabs(vBox[i].first[Z]-c[Z]),fabs(vBox[i].second[Z]-c[Z])));
+        radius=max(radius,min(reachSphere,corner.length()));
     }
-    m_bndSphere=sphere(c,sqrt(rSquared)+radiusMax);
-    
-    // apply scaling transform:
-    vec3f vX(1,0,0), vY(0,1,0), vZ(0,0,1), vO(0,0,0);
-    vX.transform(m_mat);
-    vY.transform(m_mat);
-    vZ.transform(m_mat);
-    vO.transform(m_mat);
-    vX-=vO; vY-=vO; vZ-=vO;
-    float xl=vX.length(), yl=vY.length(), zl=vZ.length();
-    float max3=xl>yl ? (xl>zl ? xl : zl) : (yl>zl ? yl : zl);
-    m_bndSphere.radius(m_bndSphere.radius()*max3);
-    m_bbox.first.transform(m_mat);
-    m_bbox.second.transform(m_mat);
+
+    // apply transform, the box is exactly bounded by transforming its center and extents (Arvo):
+    vec3f ext((m_bbox.second-m_bbox.first)*0.5f), extTr;
+    for(unsigned int row=X; row<=Z; ++row)
+        extTr[row]=fabs(m_mat[row])*ext[X]+fabs(m_mat[row+4])*ext[Y]+fabs(m_mat[row+8])*ext[Z];
+    vec3f cTr(c);
+    cTr.transform(m_mat);
+    m_bbox.first=cTr-extTr;
+    m_bbox.second=cTr+extTr;
+    // the sphere center c is transformed by boundingSphere(), the radius scales by at most the largest axis scale:
+    vec3f vX(m_mat[0],m_mat[1],m_mat[2]), vY(m_mat[4],m_mat[5],m_mat[6]), vZ(m_mat[8],m_mat[9],m_mat[10]);
+    float max3=max(vX.length(),max(vY.length(),vZ.length()));
+    m_bndSphere=sphere(c,min(radius*max3,extTr.length()));
 }
 
 sphere proTransform::boundingSphere() const {
@@ -510,7 +893,7 @@ const proNode * proTransform::query(const line & ray, unsigned int queryFlags) c
                 minSqrDist=currSqrDist;
                 if((*it)->queryFlags()&queryFlags) {
 					pNearest = *it;
-					if(pNearest->type()==proTransform::TYPE)
+					if(pNearest->typeId()&TYPE_TRANSFORM)
 						pNearest = pNearest->query(r, queryFlags);
 				}
             }
@@ -552,6 +935,35 @@ Xml proTransform::xml() const {
 	return node;
 }
 
+void proTransform::x3d(XmlWriter & writer, const char * tag) const {
+    writer.begin(tag ? tag : m_isIdentity ? "Group" : "Transform");
+    if(m_name.size()) writer.attr("DEF",m_name);
+    FileWriter & out=writer.out();
+    size_t depth=writer.depth();
+    if(!m_isIdentity) {
+        vec6f pos(m_mat);
+        if(pos[X]||pos[Y]||pos[Z]) {
+            writer.attrBegin("translation");
+            out << pos[X] << ' ' << pos[Z] << ' ' << -pos[Y];
+            writer.attrEnd();
+        }
+        // each further rotation requires a nested Transform:
+        bool hasRotation=false;
+        const char * axes[] = { "0 1 0 ", "1 0 0 ", "0 0 -1 " };
+        const unsigned int dofs[] = { H, P, R };
+        for(unsigned int i=0; i<3; ++i) if(pos[dofs[i]]) {
+            if(hasRotation) writer.begin("Transform");
+            writer.attrBegin("rotation");
+            out << axes[i] << DEG2RAD*pos[dofs[i]];
+            writer.attrEnd();
+            hasRotation=true;
+        }
+    }
+	for(size_t i=0; i<mv_node.size(); ++i)
+		mv_node[i]->x3d(writer);
+    while(writer.depth()>depth) writer.end();
+    writer.end();
+}
 
 //--- class proScene ------------------------------------------------
 
@@ -562,12 +974,13 @@ const char* const proScene::TYPE = "scene";
 
 const char* const proMesh::TYPE = "mesh";
 
-proMesh::proMesh(const std::string & name) : proNode(name), m_kind(KIND_INDEXED_TRIANGLES) { 
+proMesh::proMesh(const std::string & name) : proNode(name), m_kind(KIND_INDEXED_TRIANGLES), m_storage(STORAGE_AOS), mp_file(0) { 
     m_flags|=FLAG_SHADOW|FLAG_ZFAIL|FLAG_RENDER|FLAG_COLLISION; 
 }
 
 proMesh::proMesh(const proMesh& source) : proNode(source), 
     m_kind(source.m_kind),
+    m_storage(source.m_storage),
     mv_coord(source.mv_coord),
     mv_texCoord(source.mv_texCoord),
     mv_color(source.mv_color),
@@ -577,127 +990,158 @@ proMesh::proMesh(const proMesh& source) : proNode(source),
     mv_edge(source.mv_edge),
     mv_shadow(source.mv_shadow),
     mv_cap(source.mv_cap),
-    m_mat(source.m_mat) { }
+    m_coordSoA(source.m_coordSoA),
+    m_normalSoA(source.m_normalSoA),
+    m_fNormalSoA(source.m_fNormalSoA),
+    mp_file(source.mp_file),
+    m_coordExt(source.m_coordExt),
+    m_normalExt(source.m_normalExt),
+    m_fNormalExt(source.m_fNormalExt),
+    m_texCoordExt(source.m_texCoordExt),
+    m_colorExt(source.m_colorExt),
+    m_indexExt(source.m_indexExt),
+    m_edgeExt(source.m_edgeExt),
+    m_mat(source.m_mat) { 
+    if(mp_file) mp_file->ref(); // external data are shared
+}
 
-proMesh::proMesh(const Xml & xs) : proNode(), m_kind(KIND_INDEXED_TRIANGLES) {
+proMesh::proMesh(const Xml & xs) : proNode(), m_kind(KIND_INDEXED_TRIANGLES), m_storage(STORAGE_AOS), mp_file(0) {
     m_flags|=FLAG_SHADOW|FLAG_ZFAIL|FLAG_RENDER|FLAG_COLLISION;
     m_name=xs.attr("DEF");
     if(xs.tag()!="IndexedFaceSet")
         cerr << "proMesh constructor WARNING: statement has wrong tag: [" << xs.tag() << "]\n";
 
-    // search necessary subtags:
+    // search subtags:
     const Xml * coord=xs.find("Coordinate");
+    const Xml * xsNormal=xs.parent() ? xs.parent()->find("Normal") : xs.find("Normal");
+    const Xml * colorValues=xs.find("Color");
+    const Xml * texCoord=xs.find("TextureCoordinate");
+    const string sCoordIndex(xs.attr("coordIndex")), sCoord(coord ? coord->attr("point") : string()),
+        sNormalIndex(xs.attr("normalIndex")), sNormal(xsNormal ? xsNormal->attr("vector") : string()),
+        sColorIndex(xs.attr("colorIndex")), sColor(colorValues ? colorValues->attr("color") : string()),
+        sTexCoordIndex(xs.attr("texCoordIndex")), sTexCoord(texCoord ? texCoord->attr("point") : string());
+    X3dFields fields;
+    fields.coordIndex=XmlStr(sCoordIndex);
+    fields.coord=XmlStr(sCoord);
+    fields.normalIndex=XmlStr(sNormalIndex);
+    fields.normal=XmlStr(sNormal);
+    fields.colorIndex=XmlStr(sColorIndex);
+    fields.color=XmlStr(sColor);
+    fields.texCoordIndex=XmlStr(sTexCoordIndex);
+    fields.texCoord=XmlStr(sTexCoord);
+    fields.solid=!xs.attr("solid").size() || s2b(xs.attr("solid"));
+    fields.colorPerVertex=(toUpper(xs.attr("colorPerVertex"))!="FALSE");
+    if(!interpretX3d(fields)) return;
+
+    // add material information:
+    if(xs.parent()) {
+        const Xml * xMat=xs.parent()->find("Appearance");
+        if(xMat) // allow shared materials:
+            m_mat=MaterialMgr::singleton()[MaterialMgr::singleton().add(*xMat)];
+    }
+}
+
+proMesh::proMesh(const X3dFields & fields, const std::string & name) : proNode(name), m_kind(KIND_INDEXED_TRIANGLES), m_storage(STORAGE_AOS), mp_file(0) {
+    m_flags|=FLAG_SHADOW|FLAG_ZFAIL|FLAG_RENDER|FLAG_COLLISION;
+    interpretX3d(fields);
+}
+
+/// parses all floats of s and appends them to v
+static void parseFloats(const XmlStr & s, vector<float> & v) {
+    const char * p=s.data();
+    float f;
+    while((p=parseFloat(p,s.end(),f))) v.push_back(f);
+}
+
+/// parses all integers of s and appends the non-negative ones to v
+static void parseIndices(const XmlStr & s, vector<size_t> & v) {
+    const char * p=s.data();
+    int i;
+    while((p=parseInt(p,s.end(),i))) if(i>=0) v.push_back(i);
+}
+
+bool proMesh::interpretX3d(const X3dFields & fields) {
     bool abort=false;
-    if(!coord) {
-        cerr << "proMesh constructor ERROR: no Coordinate tag found.\n";
+    if(fields.coord.empty()) {
+        cerr << "proMesh::interpretX3d() ERROR: no Coordinate points found.\n";
         abort=true;
     }
-    if(!xs.attr("coordIndex").size()) {
-        cerr << "proMesh constructor ERROR: no coordIndex tag found.\n";
+    if(fields.coordIndex.empty()) {
+        cerr << "proMesh::interpretX3d() ERROR: no coordIndex found.\n";
         abort=true;
     }
-    if(abort) return;
+    if(abort) return false;
 
     // read into object:
-	if(xs.attr("solid").size() && !s2b(xs.attr("solid"))) m_flags|= FLAG_FRONT_AND_BACK;
-    vector<string> vStr;
+    LoadStage stageParse("meshParse");
+	if(!fields.solid) m_flags|= FLAG_FRONT_AND_BACK;
     size_t i;
-    split(coord->attr("point"),vStr,", \t\n\015");
-    if(vStr.size()%3!=0)
-        cerr << "proMesh constructor WARNING: number of coords not a multiple of 3.\n";
-    else for(i=0; i<vStr.size(); i+=3)
-        mv_coord.push_back(vec3f(s2f(vStr[i]),-s2f(vStr[i+2]),s2f(vStr[i+1]))); // flip YZ
+    const char * p=fields.coord.data(), * pEnd=fields.coord.end();
+    float v[3];
+    for(i=0; (p=parseFloat(p,pEnd,v[i%3])); ++i)
+        if(i%3==2) mv_coord.push_back(vec3f(v[0],-v[2],v[1])); // flip YZ
+    if(i%3!=0) {
+        cerr << "proMesh::interpretX3d() WARNING: number of coords not a multiple of 3.\n";
+        mv_coord.clear();
+    }
 
-    // add coordinate indices:
+    // add coordinate indices, -1 terminates a face:
     vector<size_t> vFaceEnds;
-    vStr.clear();
-    split(xs.attr("coordIndex"),vStr,", \t\n\015");
-    if(vStr.size()>0) {
-        for(i=0; i<vStr.size()-1; ++i) {
-            mv_index.push_back(s2ui(vStr[i]));
-            if(vStr[i+1]=="-1") {
-                vFaceEnds.push_back(mv_index.size()-1);
-                ++i;
-            }
-        }
-        if(i<vStr.size()) {
-            int index=s2i(vStr[i]);
-            if(index>=0) {
-                mv_index.push_back(index);
-                vFaceEnds.push_back(mv_index.size()-1);
-            }
+    p=fields.coordIndex.data();
+    pEnd=fields.coordIndex.end();
+    int index;
+    size_t faceBegin=0;
+    while((p=parseInt(p,pEnd,index))) {
+        if(index>=0) mv_index.push_back(index);
+        else if(mv_index.size()>faceBegin) {
+            vFaceEnds.push_back(mv_index.size()-1);
+            faceBegin=mv_index.size();
         }
     }
+    if(mv_index.size()>faceBegin)
+        vFaceEnds.push_back(mv_index.size()-1);
     
     // storage for further temporary indices:
     vector<size_t> vTexIndices;
     vector<size_t> vNormalIndices;
     vector<size_t> vColorIndices;
     
-    const Xml * xsNormal=xs.parent()->find("Normal");
-    if(xsNormal) {
+    if(fields.normal.size()) {
         vector<float> vNormal;
-        s2f(xsNormal->attr("vector"),vNormal);
+        parseFloats(fields.normal,vNormal);
         mv_normal.reserve(vNormal.size()/3);
         if(vNormal.size()%3!=0)
-            cerr << "proMesh constructor WARNING: number of normals not a multiple of 3.\n";
+            cerr << "proMesh::interpretX3d() WARNING: number of normals not a multiple of 3.\n";
         else for(i=0; i+2<vNormal.size(); i+=3)
             mv_normal.push_back(vec3f(vNormal[i],-vNormal[i+2],vNormal[i+1]));
-        if(xs.attr("normalIndex").size()) {
-            vStr.clear();
-            split(xs.attr("normalIndex"),vStr,", \t\n\015");
-            for(i=0; i<vStr.size(); i++) {
-                int index=s2i(vStr[i]);
-                if(index>=0) vNormalIndices.push_back(index);
-            }
-        }
+        parseIndices(fields.normalIndex,vNormalIndices);
     }
 
     // add color per vertex information:
-    const Xml * colorValues=xs.find("Color");
-    if((toUpper(xs.attr("colorPerVertex"))!="FALSE")&&colorValues) {
+    if(fields.colorPerVertex&&fields.color.size()) {
         vector<float> vColors;
-        s2f(colorValues->attr("color"),vColors);
+        parseFloats(fields.color,vColors);
         mv_color.reserve(vColors.size()/3);
-        for(i=0;i<vColors.size()-2;i+=3)
+        for(i=0;i+2<vColors.size();i+=3)
             mv_color.push_back(vec3f(vColors[i],vColors[i+1],vColors[i+2]));
-
-        if(xs.attr("colorIndex").size()) {
-            vStr.clear();
-            split(xs.attr("colorIndex"),vStr,", \t\n\015");
-            for(i=0; i<vStr.size(); i++) {
-                int index=s2i(vStr[i]);
-                if(index>=0) vColorIndices.push_back(index);
-            }
-        }
+        parseIndices(fields.colorIndex,vColorIndices);
     }
 
     // parse texture coordinate information:
-    const Xml * texCoord=xs.find("TextureCoordinate");
-    if(texCoord) {
+    if(fields.texCoord.size()) {
         vector<float> texCoords;
-        s2f(texCoord->attr("point"),texCoords);
+        parseFloats(fields.texCoord,texCoords);
         mv_texCoord.reserve(texCoords.size()/2);
-        for(i=0; i<texCoords.size(); i+=2) mv_texCoord.push_back(vec2f(texCoords[i],texCoords[i+1]));
-
-        if(xs.attr("texCoordIndex").size()) {
-            vStr.clear();
-            split(xs.attr("texCoordIndex"),vStr,", \t\n\015");
-            for(i=0; i<vStr.size(); i++) {
-                int index=s2i(vStr[i]);
-                if(index>=0) vTexIndices.push_back(index);
-            }
-        }
+        for(i=0; i+1<texCoords.size(); i+=2) mv_texCoord.push_back(vec2f(texCoords[i],texCoords[i+1]));
+        parseIndices(fields.texCoordIndex,vTexIndices);
     }
     
-    // add material information:
-    if(xs.parent()) {
-        const Xml * xMat=xs.parent()->find("Appearance");
-        if(xMat) // allow shared materials:
-            m_mat=MaterialMgr::singleton()[MaterialMgr::singleton().add(*xMat)];
-    }
+    stageParse.elements(mv_coord.size()+mv_index.size()+mv_normal.size()+mv_color.size()+mv_texCoord.size());
+    stageParse.finish();
 
     // normalize between various indices:
+    LoadStage stageNormalize("normalizeIndices");
+    stageNormalize.elements(mv_index.size());
 	if(vTexIndices.size()&&(vTexIndices.size()!=mv_index.size()))
         vTexIndices.clear();
     if(vNormalIndices.size()&&(vNormalIndices.size()!=mv_index.size()))
@@ -765,169 +1209,235 @@ proMesh::proMesh(const Xml & xs) : proNode(), m_kind(KIND_INDEXED_TRIANGLES) {
 		}
 	}
 	mv_index=vIndex;
+	return true;
 }
 
 void proMesh::initGraphics() {
-	proNode::initGraphics();
-
-	if(mv_fNormal.size()*3!=mv_index.size()) meshUtils::genFNormals(*this); // calculate per face normals
+	if(m_storage==STORAGE_SOA) aos(); // OpenGL requires interleaved vertex arrays
+	{
+		LoadStage stage("renderables");
+		proNode::initGraphics();
+	}
+	prepare(sp_renderer!=0);
+	if(m_mat.transparent()) m_flags|=FLAG_TRANSPARENT;
+}
 
-	if(sp_renderer && !buildEdgeList()) // do this before duplicating vertices due to vertex normals
-		m_flags&= (~FLAG_SHADOW);
-	if(mv_normal.size()<mv_coord.size()) // are normals already defined?
+void proMesh::prepare(bool edgeList) {
+	if(m_storage==STORAGE_SOA) aos();
+	// the tests below read external data in place, only the passes actually run copy them:
+	if(fNormalArray().size()*3!=indexArray().size()) { // calculate per face normals
+		LoadStage stage("faceNormals");
+		stage.elements(indexArray().size()/3);
+		meshUtils::genFNormals(*this);
+	}
+	if(edgeList&&edgeArray().empty()) {
+		LoadStage stage("edgeList");
+		stage.elements(indexArray().size()/3);
+		if(!buildEdgeList()) // do this before duplicating vertices due to vertex normals
+			m_flags&= (~FLAG_SHADOW);
+	}
+	if(vNormalArray().size()<coordArray().size()) { // are normals already defined?
+		LoadStage stage("vertexNormals");
+		stage.elements(coordArray().size());
 		meshUtils::genVNormals(*this, 60.0f); // if not, calculate per vertex normals // FIXME: make this factor accessible, dependent on model definition
-	if(mv_texCoord.size()<mv_coord.size()) // generate texture coordinates
+	}
+	if(texCoordArray().size()<coordArray().size()) { // generate texture coordinates
+		LoadStage stage("texCoords");
+		stage.elements(coordArray().size());
 		meshUtils::genTexCoords(*this,m_mat.texScale());
-	if(m_mat.transparent()) m_flags|=FLAG_TRANSPARENT;
+	}
 }
 
 void proMesh::draw(proCamera & camera) {
     if(!(m_flags&FLAG_ACTIVE)||!(m_flags&FLAG_RENDER)) return;
+    RenderStats::add(RenderStats::NODES_VISITED);
+    if(m_storage==STORAGE_SOA) aos();
     if(camera.flags()&FLAG_RENDER) { // normal draw:
         if((m_flags&FLAG_UPDATE) && (m_flags&FLAG_SHADOW)) {
             mv_shadow.clear();
             mv_cap.clear();
             m_flags-=FLAG_UPDATE;
         }
-        if(!testBounding(camera.frs(),camera.matrix()))
+        if(!testBounding(camera.frs(),camera.matrix())) {
+            RenderStats::add(RenderStats::NODES_CULLED);
             return;
+        }
 	}        
-    if((camera.flags()&FLAG_SHADOW)&&camera.light()&&(m_flags&FLAG_SHADOW)&&mv_edge.size()) { // recalculate shadow volumes:
-        if((m_bndSphere.radius()<0.0f)||(camera.light()->range()<0.0f)||(m_bndSphere.sqrDistTo(camera.light()->pos())<=camera.light()->range()*camera.light()->range())) { 
+    if((camera.flags()&FLAG_SHADOW)&&camera.light()&&(m_flags&FLAG_SHADOW)&&edgeArray().size()) { // recalculate shadow volumes:
+        float range=camera.light()->range()+m_bndSphere.radius();
+        if((m_bndSphere.radius()<0.0f)||(camera.light()->range()<0.0f)||(camera.light()->pos()[3]==0.0f)
+            ||(m_bndSphere.sqrDistTo(camera.light()->pos())<=range*range)) { 
 			if(camera.light()->flags()&FLAG_UPDATE) {
 				mv_shadow.clear();
 				mv_cap.clear();
 			}
 			if(!mv_shadow.size()) { // calculate shadow volume:
+				ProfileAccumulator profile("shadowVolumes");
+				const constArray<vec3f> vCoord(coordArray()), vFNormal(fNormalArray());
+				const constArray<unsigned int> vIndex(indexArray());
+				const constArray<edge> vEdge(edgeArray());
 				// build list of dot products indicating whether face is pointing away from light source (vDot>0.0) or not
 				vector<float> vDot;
-				vDot.reserve(mv_fNormal.size());
+				vDot.reserve(vFNormal.size());
 				float length=(camera.light()->range()>=0.0f) ? camera.light()->range() : 100.0f;
 
 				if(camera.light()->pos()[3]==0.0f) { // distant directional light
 					vec3f dir(camera.light()->pos()*-length);
-					for(size_t i=0; i<mv_fNormal.size(); ++i) {
-						float dot=mv_fNormal[i]*dir;
+					for(size_t i=0; i<vFNormal.size(); ++i) {
+						float dot=vFNormal[i]*dir;
 						vDot.push_back(dot);
 						if(dot<=0.0f) { // cap detected
-							mv_cap.push_back(mv_coord[mv_index[i*3]]);
-							mv_cap.push_back(mv_coord[mv_index[i*3+1]]);
-							mv_cap.push_back(mv_coord[mv_index[i*3+2]]);
-							mv_cap.push_back(mv_coord[mv_index[i*3]]+dir);
-							mv_cap.push_back(mv_coord[mv_index[i*3+2]]+dir);
-							mv_cap.push_back(mv_coord[mv_index[i*3+1]]+dir);
+							mv_cap.push_back(vCoord[vIndex[i*3]]);
+							mv_cap.push_back(vCoord[vIndex[i*3+1]]);
+							mv_cap.push_back(vCoord[vIndex[i*3+2]]);
+							mv_cap.push_back(vCoord[vIndex[i*3]]+dir);
+							mv_cap.push_back(vCoord[vIndex[i*3+2]]+dir);
+							mv_cap.push_back(vCoord[vIndex[i*3+1]]+dir);
 						}
 					}
 					// traverse edge list and store edges that have adjacent normals of opposite dot products:
-					for(size_t i=0; i<mv_edge.size(); ++i) 
-						if(vDot[mv_edge[i].normalIndex[0]]*vDot[mv_edge[i].normalIndex[1]]<=0.0f) {
-							if(vDot[mv_edge[i].normalIndex[0]]<=0.0f) {
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[1]]);
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[0]]);
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[0]]+dir);
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[1]]+dir);
+					for(size_t i=0; i<vEdge.size(); ++i) 
+						if(vDot[vEdge[i].normalIndex[0]]*vDot[vEdge[i].normalIndex[1]]<=0.0f) {
+							if(vDot[vEdge[i].normalIndex[0]]<=0.0f) {
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[1]]);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[0]]);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[0]]+dir);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[1]]+dir);
 							}
 							else {
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[0]]);
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[1]]);
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[1]]+dir);
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[0]]+dir);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[0]]);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[1]]);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[1]]+dir);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[0]]+dir);
 							}
 						}
 				}
 				else { // point light
-					for(size_t i=0; i<mv_fNormal.size(); ++i) {
-						vec3f dir0(camera.light()->pos(),mv_coord[mv_index[i*3]]);
-						float dot=mv_fNormal[i]*dir0;
+					for(size_t i=0; i<vFNormal.size(); ++i) {
+						vec3f dir0(camera.light()->pos(),vCoord[vIndex[i*3]]);
+						float dot=vFNormal[i]*dir0;
 						vDot.push_back(dot);
 						if(dot<=0.0f) { // cap detected
 							dir0.normalize();
 							dir0*=length;
-							vec3f dir1(camera.light()->pos(),mv_coord[mv_index[i*3+1]]);
+							vec3f dir1(camera.light()->pos(),vCoord[vIndex[i*3+1]]);
 							dir1.normalize();
 							dir1*=length;
-							vec3f dir2(camera.light()->pos(),mv_coord[mv_index[i*3+2]]);
+							vec3f dir2(camera.light()->pos(),vCoord[vIndex[i*3+2]]);
 							dir2.normalize();
 							dir2*=length;
-							mv_cap.push_back(mv_coord[mv_index[i*3]]);
-							mv_cap.push_back(mv_coord[mv_index[i*3+1]]);
-							mv_cap.push_back(mv_coord[mv_index[i*3+2]]);
-							mv_cap.push_back(mv_coord[mv_index[i*3]]+dir0);
-							mv_cap.push_back(mv_coord[mv_index[i*3+2]]+dir2);
-							mv_cap.push_back(mv_coord[mv_index[i*3+1]]+dir1);
+							mv_cap.push_back(vCoord[vIndex[i*3]]);
+							mv_cap.push_back(vCoord[vIndex[i*3+1]]);
+							mv_cap.push_back(vCoord[vIndex[i*3+2]]);
+							mv_cap.push_back(vCoord[vIndex[i*3]]+dir0);
+							mv_cap.push_back(vCoord[vIndex[i*3+2]]+dir2);
+							mv_cap.push_back(vCoord[vIndex[i*3+1]]+dir1);
 						}
 					}
 					// traverse edge list and store edges that have adjacent normals of opposite dot products:
-					for(size_t i=0; i<mv_edge.size(); ++i) 
-						if(vDot[mv_edge[i].normalIndex[0]]*vDot[mv_edge[i].normalIndex[1]]<=0.0f) {
-							vec3f dir0(camera.light()->pos(),mv_coord[mv_edge[i].vertexIndex[0]]);
+					for(size_t i=0; i<vEdge.size(); ++i) 
+						if(vDot[vEdge[i].normalIndex[0]]*vDot[vEdge[i].normalIndex[1]]<=0.0f) {
+							vec3f dir0(camera.light()->pos(),vCoord[vEdge[i].vertexIndex[0]]);
 							dir0.normalize();
 							dir0*=length;
-							vec3f dir1(camera.light()->pos(),mv_coord[mv_edge[i].vertexIndex[1]]);
+							vec3f dir1(camera.light()->pos(),vCoord[vEdge[i].vertexIndex[1]]);
 							dir1.normalize();
 							dir1*=length;
-							if(vDot[mv_edge[i].normalIndex[0]]<=0.0f) {
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[1]]);
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[0]]);
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[0]]+dir0);
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[1]]+dir1);
+							if(vDot[vEdge[i].normalIndex[0]]<=0.0f) {
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[1]]);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[0]]);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[0]]+dir0);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[1]]+dir1);
 							}
 							else {
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[0]]);
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[1]]);
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[1]]+dir1);
-								mv_shadow.push_back(mv_coord[mv_edge[i].vertexIndex[0]]+dir0);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[0]]);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[1]]);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[1]]+dir1);
+								mv_shadow.push_back(vCoord[vEdge[i].vertexIndex[0]]+dir0);
 							}
 						}
 				}
+				RenderStats::add(RenderStats::SHADOW_QUADS, mv_shadow.size()/4);
 			}
         }
+        else return; // light does not reach this mesh
 	}
 	
 	if(mp_renderable) mp_renderable->draw(camera);
 }
 
 void proMesh::calcBounding(bool) {
-    if(!mv_coord.size()) return;
-    // calculate bounding box parallel to coordinate system:
-    m_bbox.first = m_bbox.second = mv_coord[0];
-    size_t i;
-    for(i=1; i<mv_coord.size(); ++i) {
-        if(mv_coord[i][X]<m_bbox.first[X]) m_bbox.first[X]=mv_coord[i][X];
-        else if(mv_coord[i][X]>m_bbox.second[X]) m_bbox.second[X]=mv_coord[i][X];
-        if(mv_coord[i][Y]<m_bbox.first[Y]) m_bbox.first[Y]=mv_coord[i][Y];
-        else if(mv_coord[i][Y]>m_bbox.second[Y]) m_bbox.second[Y]=mv_coord[i][Y];
-        if(mv_coord[i][Z]<m_bbox.first[Z]) m_bbox.first[Z]=mv_coord[i][Z];
-        else if(mv_coord[i][Z]>m_bbox.second[Z]) m_bbox.second[Z]=mv_coord[i][Z];
-    }
-    // search for minimal radius from center of bounding box:
-    vec3f c((m_bbox.first+m_bbox.second)*0.5f);
-    float rSquared=0.0f;
-    for(i=0; i<mv_coord.size(); ++i) {
-        float currDist=c.sqrDistTo(mv_coord[i]);
-        if(currDist>rSquared) rSquared=currDist;
-    }
-    m_bndSphere=sphere(c,sqrt(rSquared));
+    if(!nCoords()) return;
+    // bounding box and sphere in a single vectorized pass plus a sphere growing pass:
+    if(m_storage==STORAGE_SOA) m_bndSphere.fit(m_coordSoA, &m_bbox);
+    else m_bndSphere.fit(coordArray(), &m_bbox);
 }
 
 void proMesh::transform(const mat4f & m) { 
-	m.transform(mv_coord); 
-	mat4f mTrInv(m.inverse()); // transposed inverse matrix for normals
-	mTrInv.transpose();
-	if(mv_normal.size()) {
-		mTrInv.transform(mv_normal);
-		for(vector<vec3f>::iterator it=mv_normal.begin(); it!=mv_normal.end(); ++it)
-			it->normalize();
+	own();
+	if(m_storage==STORAGE_SOA) {
+		m_coordSoA.transform(m);
+		m_normalSoA.transformNormals(m);
+		m_fNormalSoA.transformNormals(m);
 	}
+	else m.transform(mv_coord, mv_normal); // positions and vertex normals in a single pass
 	if(mv_fNormal.size()) {
-		mTrInv.transform(mv_fNormal);
-		for(vector<vec3f>::iterator it=mv_fNormal.begin(); it!=mv_fNormal.end(); ++it)
-			it->normalize();
+		vector<vec3f> vNone;
+		m.transform(vNone, mv_fNormal);
 	}
-	calcBounding(); 
+	calcBounding();
+	io::atomicAdd(s_revision, 1);
+}
+
+void proMesh::storage(unsigned int mode) {
+	if((mode==m_storage)||(mode==STORAGE_EXTERNAL)) return;
+	if(m_storage==STORAGE_EXTERNAL) { // copy-on-write
+		mv_coord.assign(m_coordExt.begin(), m_coordExt.end());
+		mv_normal.assign(m_normalExt.begin(), m_normalExt.end());
+		mv_fNormal.assign(m_fNormalExt.begin(), m_fNormalExt.end());
+		mv_texCoord.assign(m_texCoordExt.begin(), m_texCoordExt.end());
+		mv_color.assign(m_colorExt.begin(), m_colorExt.end());
+		mv_index.assign(m_indexExt.begin(), m_indexExt.end());
+		mv_edge.assign(m_edgeExt.begin(), m_edgeExt.end());
+		releaseExternal();
+		m_storage=STORAGE_AOS;
+		if(mode==STORAGE_AOS) return;
+	}
+	if(mode==STORAGE_SOA) {
+		m_coordSoA.assign(mv_coord);
+		m_normalSoA.assign(mv_normal);
+		m_fNormalSoA.assign(mv_fNormal);
+		vector<vec3f>().swap(mv_coord); // release memory
+		vector<vec3f>().swap(mv_normal);
+		vector<vec3f>().swap(mv_fNormal);
+	}
+	else {
+		m_coordSoA.copyTo(mv_coord);
+		m_normalSoA.copyTo(mv_normal);
+		m_fNormalSoA.copyTo(mv_fNormal);
+		m_coordSoA.release();
+		m_normalSoA.release();
+		m_fNormalSoA.release();
+	}
+	m_storage=mode;
+}
+
+void proMesh::releaseExternal() {
+	if(!mp_file) return;
+	mp_file->unref();
+	mp_file=0;
+	m_coordExt=m_normalExt=m_fNormalExt=m_colorExt=constArray<vec3f>();
+	m_texCoordExt=constArray<vec2f>();
+	m_indexExt=constArray<unsigned int>();
+	m_edgeExt=constArray<edge>();
 }
 
 Xml proMesh::xml() const {
+    // read any storage layout in place, SoA data is gathered into local copies:
+    vector<vec3f> vCoordTmp, vNormalTmp;
+    const constArray<vec3f> vCoord(coordArray(vCoordTmp)), vNormal(vNormalArray(vNormalTmp)), vColor(vertexColorArray());
+    const constArray<vec2f> vTexCoord(texCoordArray());
+    const constArray<unsigned int> vIndex(indexArray());
     Xml shape("Shape");
     if(m_name.size()) shape.attr("DEF",m_name);
     shape.append(m_mat.xml());
@@ -936,33 +1446,33 @@ Xml proMesh::xml() const {
 	//if(pImageTexture) pImageTexture->attr("texScale","");
     Xml indfs("IndexedFaceSet");
     string ci;
-    for(size_t i=0; i+2<mv_index.size(); i+=3)
-        ci+=i2s(mv_index[i])+' '+i2s(mv_index[i+1])+' '+i2s(mv_index[i+2])+" -1, ";
+    for(size_t i=0; i+2<vIndex.size(); i+=3)
+        ci+=i2s(vIndex[i])+' '+i2s(vIndex[i+1])+' '+i2s(vIndex[i+2])+" -1, ";
     indfs.attr("coordIndex",ci);
     Xml coord("Coordinate");
     string pt;
-    for(size_t i=0; i<mv_coord.size(); ++i)
-        pt+=f2s(mv_coord[i][X])+' '+f2s(mv_coord[i][Z])+' '+f2s(-mv_coord[i][Y])+", ";
+    for(size_t i=0; i<vCoord.size(); ++i)
+        pt+=f2s(vCoord[i][X])+' '+f2s(vCoord[i][Z])+' '+f2s(-vCoord[i][Y])+", ";
     coord.attr("point",pt);
     indfs.append(coord);
-    if(mv_texCoord.size()) {
+    if(vTexCoord.size()) {
         Xml tcoord("TextureCoordinate");
-        tcoord.attr("point",join(mv_texCoord));
+        tcoord.attr("point",join(vector<vec2f>(vTexCoord.begin(),vTexCoord.end())));
         indfs.append(tcoord);
     }
-    if(mv_normal.size()) {
+    if(vNormal.size()) {
         indfs.attr("normalPerVertex","TRUE");
         Xml ncoord("Normal");
         pt.erase();
-        for(size_t i=0; i<mv_normal.size(); ++i)
-            pt+=f2s(mv_normal[i][X])+' '+f2s(mv_normal[i][Z])+' '+f2s(-mv_normal[i][Y])+", ";
+        for(size_t i=0; i<vNormal.size(); ++i)
+            pt+=f2s(vNormal[i][X])+' '+f2s(vNormal[i][Z])+' '+f2s(-vNormal[i][Y])+", ";
         ncoord.attr("vector",pt);
         indfs.append(ncoord);
     }
-    if(mv_color.size()) {
+    if(vColor.size()) {
         indfs.attr("colorPerVertex","TRUE");
         Xml ccoord("Color");
-        ccoord.attr("color",join(mv_color));
+        ccoord.attr("color",join(vector<vec3f>(vColor.begin(),vColor.end())));
         indfs.append(ccoord);
     }
 	if(m_flags&FLAG_FRONT_AND_BACK)
@@ -972,7 +1482,61 @@ Xml proMesh::xml() const {
     return shape;
 }
 
+void proMesh::x3d(XmlWriter & writer, const char * tag) const {
+    // read any storage layout in place, SoA data is gathered into local copies:
+    vector<vec3f> vCoordTmp, vNormalTmp;
+    const constArray<vec3f> vCoord(coordArray(vCoordTmp)), vNormal(vNormalArray(vNormalTmp)), vColor(vertexColorArray());
+    const constArray<vec2f> vTexCoord(texCoordArray());
+    const constArray<unsigned int> vIndex(indexArray());
+    FileWriter & out=writer.out();
+    writer.begin(tag ? tag : "Shape");
+    if(m_name.size()) writer.attr("DEF",m_name);
+    writer.write(m_mat.xml());
+    writer.begin("IndexedFaceSet");
+    writer.attrBegin("coordIndex");
+    for(size_t i=0; i+2<vIndex.size(); i+=3)
+        out << vIndex[i] << ' ' << vIndex[i+1] << ' ' << vIndex[i+2] << " -1, ";
+    writer.attrEnd();
+    if(vNormal.size()) writer.attr("normalPerVertex","TRUE");
+    if(vColor.size()) writer.attr("colorPerVertex","TRUE");
+	if(m_flags&FLAG_FRONT_AND_BACK) writer.attr("solid","FALSE");
+
+    writer.begin("Coordinate");
+    writer.attrBegin("point");
+    for(size_t i=0; i<vCoord.size(); ++i)
+        out << vCoord[i][X] << ' ' << vCoord[i][Z] << ' ' << -vCoord[i][Y] << ", ";
+    writer.attrEnd();
+    writer.end();
+    if(vTexCoord.size()) {
+        writer.begin("TextureCoordinate");
+        writer.attrBegin("point");
+        for(size_t i=0; i<vTexCoord.size(); ++i)
+            out << (i ? ", " : "") << vTexCoord[i][X] << ' ' << vTexCoord[i][Y];
+        writer.attrEnd();
+        writer.end();
+    }
+    if(vNormal.size()) {
+        writer.begin("Normal");
+        writer.attrBegin("vector");
+        for(size_t i=0; i<vNormal.size(); ++i)
+            out << vNormal[i][X] << ' ' << vNormal[i][Z] << ' ' << -vNormal[i][Y] << ", ";
+        writer.attrEnd();
+        writer.end();
+    }
+    if(vColor.size()) {
+        writer.begin("Color");
+        writer.attrBegin("color");
+        for(size_t i=0; i<vColor.size(); ++i)
+            out << (i ? ", " : "") << vColor[i][X] << ' ' << vColor[i][Y] << ' ' << vColor[i][Z];
+        writer.attrEnd();
+        writer.end();
+    }
+    writer.end();
+    writer.end();
+}
+
 bool proMesh::buildEdgeList() {
+	aos();
 	// first build an index list without duplicated vertices:
 	vector<unsigned int> vIndex(mv_index);
 	for(size_t i=0; i<vIndex.size(); ++i)
@@ -1036,9 +1600,12 @@ bool proMesh::buildEdgeList() {
 bool proMesh::intersects(const line & ray) const {
     // first test on bounding level:
     if(!ray.intersects(m_bndSphere)) return false;
+    vector<vec3f> vCoordTmp;
+    const constArray<vec3f> vCoord(coordArray(vCoordTmp));
+    const constArray<unsigned int> vIndex(indexArray());
     // now test on individual triangles:
-    for(size_t i=0; i+2<mv_index.size(); i+=3)
-        if(ray.intersects(mv_coord[mv_index[i]],mv_coord[mv_index[i+1]],mv_coord[mv_index[i+2]])) 
+    for(size_t i=0; i+2<vIndex.size(); i+=3)
+        if(ray.intersects(vCoord[vIndex[i]],vCoord[vIndex[i+1]],vCoord[vIndex[i+2]])) 
             return true;
     return false;
 }
@@ -1046,13 +1613,16 @@ bool proMesh::intersects(const line & ray) const {
 vec3f * proMesh::intersection(const line & ray) const {
     // first test on bounding level:
     if(!ray.intersects(m_bndSphere)) return 0;
+    vector<vec3f> vCoordTmp;
+    const constArray<vec3f> vCoord(coordArray(vCoordTmp));
+    const constArray<unsigned int> vIndex(indexArray());
     // now test on individual triangles:
     vec3f dir(ray[0],ray[1]);
     float minDist=FLT_MAX;
-    for(size_t i=0; i+2<mv_index.size(); i+=3) {
-        const vec3f & tr0=mv_coord[mv_index[i]];
-        const vec3f & tr1=mv_coord[mv_index[i+1]];
-        const vec3f & tr2=mv_coord[mv_index[i+2]];
+    for(size_t i=0; i+2<vIndex.size(); i+=3) {
+        const vec3f & tr0=vCoord[vIndex[i]];
+        const vec3f & tr1=vCoord[vIndex[i+1]];
+        const vec3f & tr2=vCoord[vIndex[i+2]];
         // is dir parallel to tr?:
         vec3f edge1(tr0,tr1);
         vec3f edge2(tr0,tr2);
@@ -1082,6 +1652,7 @@ vec3f * proMesh::intersection(const line & ray) const {
 }
 
 void proMesh::addFace(const vec3f & vtx0, const vec3f & vtx1, const vec3f & vtx2) {
+    aos();
     // store vertex pointers:
     unsigned int vt0Idx=mv_coord.size()+4;
     unsigned int vt1Idx=vt0Idx;
@@ -29,10 +29,12 @@
 #include "proXml.h"
 #include "proMath.h"
 #include "proMaterial.h"
+#include "proIo.h"
 #include <vector>
 
 class Renderer;
 class Renderable;
+class SharedFile;
 
 /// symbolic names for proNode flags
 enum flag_t {
@@ -111,6 +113,16 @@ public:
 		std::vector< std::pair<proNode*, size_t> > mv_stack;
 	};
 
+	/// an abstract callback interface for pre-order scene graph traversals via traverse()
+	class visitor {
+	public:
+		/// destructor
+		virtual ~visitor() { }
+		/// called for each visited node
+		/** \return false if the subnodes of node shall be skipped */
+		virtual bool visit(proNode & node)=0;
+	};
+
     /// default constructor, optional argument is user definable name.
     proNode(const std::string & name="") : m_bndSphere(0.0f,0.0f,0.0f,-1.0f), m_name(name), m_flags(FLAG_ACTIVE|FLAG_UPDATE), m_queryFlags(0), mp_renderable(0) { }
     /// copy constructor
@@ -126,10 +138,17 @@ public:
     const std::string & name() const { return m_name; }
     /// sets individual name
     void name( const std::string & s ) { m_name=s; }
-    /// returns the node type
+    /// returns the node type name, used for serialization
     virtual std::string type() const { return TYPE; }
 	/// type name
 	static const char* const TYPE;
+	/// symbolic names for node type ids
+	/** Derived node types contain the bits of their base type, so that is-a relations can be tested by a bitwise and. */
+	enum { TYPE_NODE=0, TYPE_CAMERA=1<<0, TYPE_LIGHT=1<<1, TYPE_MESH=1<<2, TYPE_TRANSFORM=1<<3, TYPE_SCENE=TYPE_TRANSFORM|(1<<4),
+		/// first bit available for user defined node types
+		TYPE_USER=1<<8 };
+	/// returns the node type id, to be preferred over type() for runtime type checks
+	virtual unsigned int typeId() const { return TYPE_NODE; }
 	
     /// returns flags
     unsigned int flags() const { return m_flags; }
@@ -137,9 +156,9 @@ public:
     /** avoid this function whenever possible, since it does not propagate to children */
     unsigned int & flags() { return m_flags; }
     /// sets one or more flags
-    virtual void enable(unsigned int flag) { m_flags|=flag; }
+    virtual void enable(unsigned int flag) { m_flags|=flag; io::atomicAdd(s_revision, 1); }
     /// unsets one or more flags
-    virtual void disable(unsigned int flag) { m_flags&=~flag; }
+    virtual void disable(unsigned int flag) { m_flags&=~flag; io::atomicAdd(s_revision, 1); }
     /// returns query flags
     unsigned int queryFlags() const { return m_queryFlags; }
     /// sets query flags
@@ -160,6 +179,11 @@ public:
     virtual void closeGraphics();
     /// allows iteration of proNode graphs
     virtual proNode * next(proNode::iterator & iter) { return 0; }
+    /// calls v.visit() for this node and all its subnodes in pre-order
+    /** Unlike proNode::iterator, this method does not need any heap allocated state. */
+    virtual void traverse(proNode::visitor & v) { v.visit(*this); }
+    /// appends pointers to this node and all its subnodes in pre-order to v
+    virtual void flatten(std::vector<proNode*> & v) { v.push_back(this); }
 
     /// transforms this object by multiplying it with matrix m, interface definition.
     virtual void transform(const mat4f &) { }
@@ -188,13 +212,29 @@ public:
 
     /// returns object as xml statement
     virtual Xml xml() const;   
+    /// writes object as X3D statement, the streaming counterpart of xml() for large scenes
+    /** \param writer output receiving the statement
+     \param tag (optional) replaces the tag of the outermost element */
+    virtual void x3d(XmlWriter & writer, const char * tag=0) const;
     /// interprets an X3D xml statement as proNodes
+    /** DEF/USE references are resolved in a single pass via a symbol table, USE creates a copy of the already built node. */
     static proNode * interpret(const Xml & xs);
+    /// interprets n characters of X3D source data at pData as proNodes in a single pass without building a DOM
+    /** \param pSource optional front end replacing the xml parser, e.g. for VRML97 data. Entities are 
+     only decoded if the xml parser is used. */
+    static proNode * interpret(const char * pData, size_t n, XmlParser::Source * pSource=0);
 	/// sets global renderer
 	/** should be done before initializing proNode children instances */
 	static void renderer(Renderer * pRenderer) { sp_renderer = pRenderer; }
 	/// returns global renderer
 	static Renderer *  renderer() { return sp_renderer; }
+	/// returns the global scene graph revision
+	/** The revision is incremented whenever nodes are transformed, flags are changed via enable()/disable(), or the
+	 graph topology changes. Renderers use it to invalidate cached per-frame data such as light influence lists.
+	 Writers increment it via io::atomicAdd(), reading is a plain volatile load. */
+	static unsigned int revision() { return s_revision; }
+	/// marks the scene graph as modified, necessary after direct manipulation of node data
+	static void touch() { io::atomicAdd(s_revision, 1); }
 protected:
     /// stores bounding sphere
     sphere m_bndSphere;
@@ -211,6 +251,53 @@ protected:
 	Renderable * mp_renderable;
 	/// stores pointer to global renderer object
 	static Renderer* sp_renderer;
+	/// stores global scene graph revision, incremented via io::atomicAdd since nodes may be loaded concurrently
+	static volatile unsigned int s_revision;
+};
+
+//--- class proNodeArray --------------------------------------------
+
+/// a flattened pre-order array of all nodes of a scene graph
+/** The array is lazily rebuilt whenever the scene graph revision has changed, so repeated full scene
+ walks only cost a linear pass over a contiguous pointer array. Example :\n
+  \code
+	proNodeArray nodes(&scene);
+	for(proNodeArray::iterator it=nodes.begin(); it!=nodes.end(); ++it)
+		cout << (*it)->type() << " " << (*it)->name() << endl;
+  \endcode
+*/
+class proNodeArray {
+public:
+	/// iterator type
+	typedef std::vector<proNode*>::const_iterator iterator;
+	/// constructor, optionally sets the root node
+	proNodeArray(proNode * pRoot=0) : mp_root(pRoot), m_revision(0), m_valid(false) { }
+	/// sets the root node
+	void root(proNode * pRoot) { mp_root=pRoot; m_valid=false; }
+	/// returns the root node
+	proNode * root() const { return mp_root; }
+	/// returns iterator to first node, rebuilds the array if necessary
+	iterator begin() { refresh(); return mv_node.begin(); }
+	/// returns iterator behind last node of the array refreshed by the preceding begin()
+	/** Does not check the revision, since it is typically evaluated once per loop iteration. */
+	iterator end() const { return mv_node.end(); }
+	/// returns number of nodes
+	size_t size() { refresh(); return mv_node.size(); }
+	/// allows access to node number n in pre-order
+	proNode * operator[](size_t n) { refresh(); return mv_node[n]; }
+	/// rebuilds the array in case the scene graph has been modified
+	void refresh() { if(!m_valid||(m_revision!=proNode::revision())) rebuild(); }
+protected:
+	/// rebuilds the array
+	void rebuild();
+	/// root node
+	proNode * mp_root;
+	/// scene graph revision the array has been built for
+	unsigned int m_revision;
+	/// stores whether the array has been built at all
+	bool m_valid;
+	/// nodes in pre-order
+	std::vector<proNode*> mv_node;
 };
 
 //--- class proCamera -----------------------------------------------
@@ -270,6 +357,8 @@ public:
     std::string type() const { return TYPE; }
 	/// type name
 	static const char* const TYPE;
+	/// returns the node type id
+	unsigned int typeId() const { return TYPE_CAMERA; }
 protected:
     /// stores current time
 	double m_tNow;
@@ -310,6 +399,8 @@ public:
     virtual std::string type() const { return TYPE; }
 	/// type name
 	static const char* const TYPE;
+	/// returns the node type id
+	virtual unsigned int typeId() const { return TYPE_LIGHT; }
     
     /// returns light position
 	const vec4f & pos() const { return m_pos; }
@@ -355,6 +446,20 @@ protected:
 /// generic class for organizing nodes in a tree structure and handling transforms
 class proTransform : public proNode {
 public:
+    /// an auxiliary struct referring to the fields of an X3D Transform node
+    struct X3dFields {
+        /// translation field
+        XmlStr translation;
+        /// center field
+        XmlStr center;
+        /// rotation field
+        XmlStr rotation;
+        /// scale field
+        XmlStr scale;
+        /// scaleOrientation field
+        XmlStr scaleOrientation;
+    };
+
     /// default constructor
     proTransform(const std::string & name="") : proNode(name), m_isIdentity(true) { }
     /// copy constructor
@@ -379,13 +484,15 @@ public:
     virtual std::string type() const { return TYPE; }
 	/// type name
 	static const char* const TYPE;
+	/// returns the node type id
+	virtual unsigned int typeId() const { return TYPE_TRANSFORM; }
 
     /// adds a direct subordinate node, optionally creates a physical copy of node and all subnodes
     virtual proNode* append(proNode* node, bool doCopy=true) { 
-        if(!node) return 0; mv_node.push_back(doCopy ? node->copy() : node);  return mv_node.back(); }
+        if(!node) return 0; mv_node.push_back(doCopy ? node->copy() : node); io::atomicAdd(s_revision, 1); return mv_node.back(); }
     /// creates a new subordinate transform node
     virtual proTransform * create(const std::string & name="") {
-        mv_node.push_back(new proTransform(name)); return static_cast<proTransform*>(mv_node.back()); }
+        mv_node.push_back(new proTransform(name)); io::atomicAdd(s_revision, 1); return static_cast<proTransform*>(mv_node.back()); }
     /// removes and optionally deletes a direct subordinate node
     virtual bool erase(proNode* node, bool doDelete=true);
     /// returns number of direct subnodes
@@ -397,6 +504,10 @@ public:
     void clear();
     /// allows iteration of proNode graphs
     virtual proNode * next(proNode::iterator & iter);
+    /// calls v.visit() for this node and all its subnodes in pre-order
+    virtual void traverse(proNode::visitor & v);
+    /// appends pointers to this node and all its subnodes in pre-order to v
+    virtual void flatten(std::vector<proNode*> & v);
 
     /// computes the bounding sphere, not for realtime!
     virtual void calcBounding(bool recursive=true);
@@ -430,8 +541,16 @@ public:
 	void multiply(const mat4f & m) { m_mat*=m; m_isIdentity=false; enable(FLAG_UPDATE); }
 	/// resets transformation matrix to identity
 	void reset() { m_mat=mat4f(); m_isIdentity=true; enable(FLAG_UPDATE); }
+    /// sets transformation according to the fields of an X3D Transform node
+    /** \return true if the transformation contains a scaling. X3D interpretation applies scalings 
+     permanently to the subnodes via applyMatrix(). */
+    bool set(const X3dFields & fields);
+    /// permanently transforms all subnodes by the transformation matrix and resets it to identity
+    void applyMatrix();
     /// returns object as xml statement
     virtual Xml xml() const;
+    /// writes object as X3D statement
+    virtual void x3d(XmlWriter & writer, const char * tag=0) const;
 
 protected:
     /// stores current transformation
@@ -468,12 +587,16 @@ public:
     virtual std::string type() const { return TYPE; }
 	/// type name
 	static const char* const TYPE;
+	/// returns the node type id
+	virtual unsigned int typeId() const { return TYPE_SCENE; }
 };
 
 //--- class proMesh -----------------------------------------------
 
 /// a generic mesh geometry class
 class proMesh : public proNode {
+    /// ModelMgr is allowed to restore all data members from a binary cache
+    friend class ModelMgr;
 public:
 	// shadow volume structure
     /// an auxiliary struct holding edge information for shadow volume generation
@@ -487,14 +610,42 @@ public:
         unsigned int normalIndex[2];
     };
 	
+    /// an auxiliary struct referring to the fields of an X3D IndexedFaceSet node and its subnodes
+    struct X3dFields {
+        /// constructor
+        X3dFields() : solid(true), colorPerVertex(true) { }
+        /// coordIndex field
+        XmlStr coordIndex;
+        /// point field of the Coordinate subnode
+        XmlStr coord;
+        /// normalIndex field
+        XmlStr normalIndex;
+        /// vector field of the Normal subnode
+        XmlStr normal;
+        /// colorIndex field
+        XmlStr colorIndex;
+        /// color field of the Color subnode
+        XmlStr color;
+        /// texCoordIndex field
+        XmlStr texCoordIndex;
+        /// point field of the TextureCoordinate subnode
+        XmlStr texCoord;
+        /// solid field
+        bool solid;
+        /// colorPerVertex field
+        bool colorPerVertex;
+    };
+	
     /// default constructor, empty mesh.
     proMesh(const std::string & name="");
     /// copy constructor
     proMesh(const proMesh & source);
     /// constructor interpreting an X3D defined IndexedFaceSet node.
     proMesh(const Xml & xs);
+    /// constructor building a mesh from the fields of an X3D IndexedFaceSet node, without material
+    proMesh(const X3dFields & fields, const std::string & name="");
     /// destructor
-    virtual ~proMesh() { }
+    virtual ~proMesh() { releaseExternal(); }
     /// returns a pointer to a physical copy of the object
     virtual proNode * copy() const { return new proMesh(*this); }
 
@@ -503,12 +654,18 @@ public:
     virtual void draw(proCamera & camera);
     /// initializes GL, uploads textures to OpenGL.
     virtual void initGraphics();
+    /// computes the derived data required for rendering, unless already present
+    /** Face normals, the shadow volume edge list (optionally), vertex normals, and texture coordinates
+     are generated. Vertex normal generation may duplicate vertices at creases. Called by initGraphics(). */
+    void prepare(bool edgeList=true);
     /// computes the bounding geometry, not for realtime!
     virtual void calcBounding(bool recursive=false);
     /// returns the node type
     virtual std::string type() const { return TYPE; }
 	/// type name
 	static const char* const TYPE;
+	/// returns the node type id
+	virtual unsigned int typeId() const { return TYPE_MESH; }
 
     /// transforms this object by multiplying it with matrix m, not for realtime!.
     virtual void transform(const mat4f & m);
@@ -519,57 +676,115 @@ public:
     void material(const proMaterial & mat ) { 
         m_mat=MaterialMgr::singleton()[MaterialMgr::singleton().add(mat)]; }
 
+    /// symbolic names for the internal storage layout of coordinates and normals
+    enum { STORAGE_AOS=0, STORAGE_SOA, STORAGE_EXTERNAL };
+    /// returns internal storage layout of coordinates and normals
+    unsigned int storage() const { return m_storage; }
+    /// converts coordinates and normals to the storage layout mode
+    /** STORAGE_SOA keeps coordinates, vertex normals, and face normals in aligned structure of
+     arrays containers, on which bounds, transform, axis swapping, and face normal generation
+     run vectorized. The non-const std::vector based accessors below convert the mesh back
+     to STORAGE_AOS, as does initGraphics(), because OpenGL requires interleaved vertex arrays.
+     Const access never changes the layout: coord(), vNormal(), fNormal(), and the constArray
+     accessors taking a scratch vector read any layout, whereas the plain constArray views of
+     coordinates and normals are empty in STORAGE_SOA.
+     
+     STORAGE_EXTERNAL refers to all arrays read-only within a memory mapped file shared with 
+     copies of the mesh, it is established by ModelMgr when loading a binary model cache and 
+     cannot be requested. Rendering, bounds, and intersection tests read these arrays in place 
+     via the constArray accessors, as does any other const access. Any std::vector based accessor, and hence transform(), 
+     meshUtils::subdivide(), or meshUtils::genVNormals(), first copies the arrays (copy-on-write) 
+     and converts the mesh to STORAGE_AOS. */
+    void storage(unsigned int mode);
+
     /// allows direct access to coordinate data.
-    std::vector<vec3f> & coords() { return mv_coord; }
-    /// allows direct reading of coordinate data.
-    const std::vector<vec3f> & coords() const { return mv_coord; }
+    std::vector<vec3f> & coords() { aos(); return mv_coord; }
     /// allows direct access to vertex normals.
-    std::vector<vec3f> & vNormals() { return mv_normal; }
-    /// allows direct reading of vertex normals.
-    const std::vector<vec3f> & vNormals() const { return mv_normal; }
+    std::vector<vec3f> & vNormals() { aos(); return mv_normal; }
     /// allows direct access to face normals.
-    std::vector<vec3f> & fNormals() { return mv_fNormal; }
-    /// allows direct reading of face normals.
-    const std::vector<vec3f> & fNormals() const { return mv_fNormal; }
+    std::vector<vec3f> & fNormals() { aos(); return mv_fNormal; }
+    /// returns number of coordinates in any storage layout
+    size_t nCoords() const { return m_storage==STORAGE_SOA ? m_coordSoA.size() : coordArray().size(); }
+    /// returns coordinate i in any storage layout
+    vec3f coord(size_t i) const { return m_storage==STORAGE_SOA ? m_coordSoA[i] : coordArray()[i]; }
+    /// returns number of vertex normals in any storage layout
+    size_t nVNormals() const { return m_storage==STORAGE_SOA ? m_normalSoA.size() : vNormalArray().size(); }
+    /// returns vertex normal i in any storage layout
+    vec3f vNormal(size_t i) const { return m_storage==STORAGE_SOA ? m_normalSoA[i] : vNormalArray()[i]; }
+    /// returns number of face normals in any storage layout
+    size_t nFNormals() const { return m_storage==STORAGE_SOA ? m_fNormalSoA.size() : fNormalArray().size(); }
+    /// returns face normal i in any storage layout
+    vec3f fNormal(size_t i) const { return m_storage==STORAGE_SOA ? m_fNormalSoA[i] : fNormalArray()[i]; }
+    /// allows direct access to coordinate data in STORAGE_SOA layout
+    vec3fArray & soaCoords() { return m_coordSoA; }
+    /// allows direct access to vertex normals in STORAGE_SOA layout
+    vec3fArray & soaVNormals() { return m_normalSoA; }
+    /// allows direct access to face normals in STORAGE_SOA layout
+    vec3fArray & soaFNormals() { return m_fNormalSoA; }
+    
+    /// returns a read-only view of the coordinates, does not copy STORAGE_EXTERNAL data, empty in STORAGE_SOA
+    constArray<vec3f> coordArray() const { 
+        return m_storage==STORAGE_EXTERNAL ? m_coordExt : constArray<vec3f>(mv_coord); }
+    /// returns a read-only view of the vertex normals, does not copy STORAGE_EXTERNAL data, empty in STORAGE_SOA
+    constArray<vec3f> vNormalArray() const { 
+        return m_storage==STORAGE_EXTERNAL ? m_normalExt : constArray<vec3f>(mv_normal); }
+    /// returns a read-only view of the face normals, does not copy STORAGE_EXTERNAL data, empty in STORAGE_SOA
+    constArray<vec3f> fNormalArray() const { 
+        return m_storage==STORAGE_EXTERNAL ? m_fNormalExt : constArray<vec3f>(mv_fNormal); }
+    /// returns a read-only view of the coordinates in any storage layout, STORAGE_SOA data is gathered into vScratch
+    constArray<vec3f> coordArray(std::vector<vec3f> & vScratch) const { 
+        return gather(m_coordSoA, vScratch, coordArray()); }
+    /// returns a read-only view of the vertex normals in any storage layout, STORAGE_SOA data is gathered into vScratch
+    constArray<vec3f> vNormalArray(std::vector<vec3f> & vScratch) const { 
+        return gather(m_normalSoA, vScratch, vNormalArray()); }
+    /// returns a read-only view of the face normals in any storage layout, STORAGE_SOA data is gathered into vScratch
+    constArray<vec3f> fNormalArray(std::vector<vec3f> & vScratch) const { 
+        return gather(m_fNormalSoA, vScratch, fNormalArray()); }
+    /// returns a read-only view of the texture coordinates, does not copy STORAGE_EXTERNAL data
+    constArray<vec2f> texCoordArray() const { 
+        return m_storage==STORAGE_EXTERNAL ? m_texCoordExt : constArray<vec2f>(mv_texCoord); }
+    /// returns a read-only view of the vertex colors, does not copy STORAGE_EXTERNAL data
+    constArray<vec3f> vertexColorArray() const { 
+        return m_storage==STORAGE_EXTERNAL ? m_colorExt : constArray<vec3f>(mv_color); }
+    /// returns a read-only view of the indices, does not copy STORAGE_EXTERNAL data
+    constArray<unsigned int> indexArray() const { 
+        return m_storage==STORAGE_EXTERNAL ? m_indexExt : constArray<unsigned int>(mv_index); }
+    /// returns a read-only view of the edges, does not copy STORAGE_EXTERNAL data
+    constArray<proMesh::edge> edgeArray() const { 
+        return m_storage==STORAGE_EXTERNAL ? m_edgeExt : constArray<proMesh::edge>(mv_edge); }
     /// allows direct access to texture coordinate data.
-    std::vector<vec2f> & texCoords() { return mv_texCoord; }
-    /// allows direct reading of texture coordinate data.
-    const std::vector<vec2f> & texCoords() const { return mv_texCoord; }
-    /// allows direct reading of vertex colors.
-    const std::vector<vec3f> & vertexColors() const { return mv_color; }
+    std::vector<vec2f> & texCoords() { own(); return mv_texCoord; }
     /// allows direct access to vertex colors.
-    std::vector<vec3f> & vertexColors() { return mv_color; }
+    std::vector<vec3f> & vertexColors() { own(); return mv_color; }
     /// allows direct access to indices.
-    std::vector<unsigned int> & indices() { return mv_index; }
-    /// allows direct reading of indices.
-    const std::vector<unsigned int> & indices() const { return mv_index; }
+    std::vector<unsigned int> & indices() { own(); return mv_index; }
 	
-	/// allows direct reading of edges
-    const std::vector<proMesh::edge> & edges() const { return mv_edge; }
     /// allows direct reading of shadow volume quads
     const std::vector<vec3f> & shadows() const { return mv_shadow; }
     /// allows direct reading of shadow volume caps
     const std::vector<vec3f> & caps() const { return mv_cap; }
     
     /// adds an individual vertex
-    void addVertex(const vec3f & vtx) { mv_coord.push_back(vtx); }
+    void addVertex(const vec3f & vtx) { 
+        if(m_storage==STORAGE_SOA) m_coordSoA.push_back(vtx); else coords().push_back(vtx); }
     /// adds an individual vertex
-    void addVertex(float x, float y, float z=0.0f) { mv_coord.push_back(vec3f(x,y,z)); }
+    void addVertex(float x, float y, float z=0.0f) { addVertex(vec3f(x,y,z)); }
     /// adds an individual texture coordinate
-    void addTexCoord(const vec2f & uv) { mv_texCoord.push_back(uv); }
+    void addTexCoord(const vec2f & uv) { texCoords().push_back(uv); }
     /// adds an individual texture coordinate
-    void addTexCoord(float u, float v) { mv_texCoord.push_back(vec2f(u,v)); }
+    void addTexCoord(float u, float v) { texCoords().push_back(vec2f(u,v)); }
     /// adds an individual normal
-    void addNormal(const vec3f & vtx) { mv_normal.push_back(vtx); }
+    void addNormal(const vec3f & vtx) { 
+        if(m_storage==STORAGE_SOA) m_normalSoA.push_back(vtx); else vNormals().push_back(vtx); }
     /// adds an individual normal
-    void addNormal(float x, float y, float z) { mv_normal.push_back(vec3f(x,y,z)); }
+    void addNormal(float x, float y, float z) { addNormal(vec3f(x,y,z)); }
     /// adds a triangular face by specifying the vertex indices
     void addFace(unsigned int idx0, unsigned int idx1, unsigned int idx2) { 
-        mv_index.push_back(idx0); mv_index.push_back(idx1); mv_index.push_back(idx2); }
+        own(); mv_index.push_back(idx0); mv_index.push_back(idx1); mv_index.push_back(idx2); }
     /// adds a quad face by specifying the vertex indices
     /** internally the quad is stored as 2 triangles */
     void addFace(unsigned int idx0, unsigned int idx1, unsigned int idx2, unsigned int idx3) { 
-        mv_index.push_back(idx0); mv_index.push_back(idx1); mv_index.push_back(idx2);
+        own(); mv_index.push_back(idx0); mv_index.push_back(idx1); mv_index.push_back(idx2);
         mv_index.push_back(idx0); mv_index.push_back(idx2); mv_index.push_back(idx3); }
     /// adds a triangular face by specifying its vertices
     void addFace(const vec3f & vtx0, const vec3f & vtx1, const vec3f & vtx2);
@@ -579,6 +794,8 @@ public:
 		
     /// returns object as xml statement
     virtual Xml xml() const;
+    /// writes object as X3D statement, the arrays are streamed without intermediate strings
+    virtual void x3d(XmlWriter & writer, const char * tag=0) const;
     /// tests for intersection with ray
     virtual bool intersects(const line & ray) const;
     /// calculates the intersection point between the provided ray and this vertex array mesh
@@ -597,8 +814,24 @@ public:
 	/** Note that a correct edge list and shadow volume requires a well-formed closed solid object geometry as basis.*/
     bool buildEdgeList();
 protected:   
+    /// converts to STORAGE_AOS layout if necessary, only changes the representation
+    void aos() { if(m_storage!=STORAGE_AOS) storage(STORAGE_AOS); }
+    /// returns vView, or in STORAGE_SOA layout a view of vSoA gathered into vScratch
+    constArray<vec3f> gather(const vec3fArray & vSoA, std::vector<vec3f> & vScratch, const constArray<vec3f> & vView) const {
+        if(m_storage!=STORAGE_SOA) return vView;
+        vSoA.copyTo(vScratch);
+        return constArray<vec3f>(vScratch); }
+    /// copies STORAGE_EXTERNAL arrays into the std::vector members if necessary, keeps STORAGE_SOA
+    void own() { if(m_storage==STORAGE_EXTERNAL) storage(STORAGE_AOS); }
+    /// drops the reference to the shared file of STORAGE_EXTERNAL data, without converting the layout
+    void releaseExternal();
+    /// builds mesh geometry from the fields of an X3D IndexedFaceSet node, returns false if they are incomplete
+    bool interpretX3d(const X3dFields & fields);
+
     /// stores kind of stored data
     unsigned int m_kind;
+    /// stores storage layout of coordinates and normals
+    unsigned int m_storage;
     /// stores coordinates
     std::vector<vec3f> mv_coord;
     /// stores texture coords
@@ -618,9 +851,34 @@ protected:
     std::vector<vec3f> mv_shadow;
     /// caches shadow volume caps
     std::vector<vec3f> mv_cap;
+    /// stores coordinates in STORAGE_SOA layout
+    vec3fArray m_coordSoA;
+    /// stores per vertex normals in STORAGE_SOA layout
+    vec3fArray m_normalSoA;
+    /// stores per face normals in STORAGE_SOA layout
+    vec3fArray m_fNormalSoA;
+    /// shared file holding the arrays in STORAGE_EXTERNAL layout, 0 otherwise
+    SharedFile * mp_file;
+    /// refers to coordinates in STORAGE_EXTERNAL layout
+    constArray<vec3f> m_coordExt;
+    /// refers to per vertex normals in STORAGE_EXTERNAL layout
+    constArray<vec3f> m_normalExt;
+    /// refers to per face normals in STORAGE_EXTERNAL layout
+    constArray<vec3f> m_fNormalExt;
+    /// refers to texture coords in STORAGE_EXTERNAL layout
+    constArray<vec2f> m_texCoordExt;
+    /// refers to color values in STORAGE_EXTERNAL layout
+    constArray<vec3f> m_colorExt;
+    /// refers to coordinate indices in STORAGE_EXTERNAL layout
+    constArray<unsigned int> m_indexExt;
+    /// refers to edges in STORAGE_EXTERNAL layout
+    constArray<proMesh::edge> m_edgeExt;
 
 	/// material data
     proMaterial m_mat;
+private:
+    /// prevent assignments, use the copy constructor sharing mp_file instead
+    proMesh & operator=(const proMesh &);
 };
 
 #endif // _PRO_SCENE_H
@@ -3,8 +3,16 @@
 #include "proStr.h"
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
 #include <iostream>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP>=2))
+#  define _PRO_SSE2
+#  include <emmintrin.h>
+#endif
+
 using namespace std;
 
 #ifdef _WIN32
@@ -149,21 +157,255 @@ bool s2b(const string & s) {
     return false;
 }
 
+//--- number parsing -----------------------------------------------
+
+/// default separators of numeric lists, equal to the default arguments of s2f() and s2i()
+static const char * s_numSeparators = ", \t\n\015";
+
+static inline bool isNumSeparator(char c) {
+    return (c==' ')||(c==',')||(c=='\t')||(c=='\n')||(c=='\r');
+}
+
+/// returns end of token starting at p
+static inline const char * tokenEnd(const char * p, const char * end) {
+    while((p<end)&&!isNumSeparator(*p)) ++p;
+    return p;
+}
+
+/// copies token [p,pEnd) into a zero terminated buffer, falls back to heap memory for very long tokens
+class TokenBuffer {
+public:
+    TokenBuffer(const char * p, const char * pEnd) : mp_heap(0) {
+        size_t n=static_cast<size_t>(pEnd-p);
+        char * pDst = (n<sizeof(m_local)) ? m_local : (mp_heap = new char[n+1]);
+        memcpy(pDst, p, n);
+        pDst[n]=0;
+    }
+    ~TokenBuffer() { delete [] mp_heap; }
+    const char * c_str() const { return mp_heap ? mp_heap : m_local; }
+protected:
+    char m_local[64];
+    char * mp_heap;
+};
+
+/// exact powers of ten representable as double
+static const double s_pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+const char * skipSeparators(const char * p, const char * end) {
+    // most numbers are separated by a single character, runs are typically indentation
+    if((p<end)&&isNumSeparator(*p)) ++p;
+    if((p<end)&&!isNumSeparator(*p)) return p;
+#ifdef _PRO_SSE2
+    const __m128i sp=_mm_set1_epi8(' '), co=_mm_set1_epi8(','), ht=_mm_set1_epi8('\t'),
+        lf=_mm_set1_epi8('\n'), cr=_mm_set1_epi8('\r');
+    while(end-p>=16) {
+        __m128i v=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i m=_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v,sp), _mm_cmpeq_epi8(v,co)),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v,ht), _mm_cmpeq_epi8(v,lf)), _mm_cmpeq_epi8(v,cr)));
+        unsigned int mask=static_cast<unsigned int>(_mm_movemask_epi8(m));
+        if(mask!=0xFFFF) {
+            mask=~mask;
+            while(!(mask&1)) { mask>>=1; ++p; }
+            return p;
+        }
+        p+=16;
+    }
+#endif
+    while((p<end)&&isNumSeparator(*p)) ++p;
+    return p;
+}
+
+const char * parseFloat(const char * p, const char * end, float & value) {
+    p=skipSeparators(p,end);
+    if(p==end) return 0;
+    const char * pStart=p;
+    bool negative=false;
+    if(*p=='-') { negative=true; ++p; }
+    else if(*p=='+') ++p;
+    unsigned long long mantissa=0;
+    int nDigits=0, nSignificant=0, exponent=0;
+    for(; (p<end)&&(*p>='0')&&(*p<='9'); ++p, ++nDigits) if(nSignificant||(*p!='0')) {
+        mantissa=mantissa*10+(*p-'0');
+        ++nSignificant;
+    }
+    if((p<end)&&(*p=='.')) for(++p; (p<end)&&(*p>='0')&&(*p<='9'); ++p, ++nDigits) {
+        if(nSignificant||(*p!='0')) {
+            mantissa=mantissa*10+(*p-'0');
+            ++nSignificant;
+        }
+        --exponent;
+    }
+    if(nDigits&&(p<end)&&((*p=='e')||(*p=='E'))) {
+        const char * pExp=++p;
+        bool negExp=false;
+        if((p<end)&&(*p=='-')) { negExp=true; ++p; }
+        else if((p<end)&&(*p=='+')) ++p;
+        int e=0;
+        const char * pDigits=p;
+        for(; (p<end)&&(*p>='0')&&(*p<='9'); ++p) if(e<10000) e=e*10+(*p-'0');
+        if(p==pDigits) p=pExp-1; // no exponent digits, let strtod() decide
+        else exponent+= negExp ? -e : e;
+    }
+    // fast path: up to 15 significant digits and exact power of ten give correctly rounded results
+    if(nDigits&&((p==end)||isNumSeparator(*p))&&(nSignificant<=15)
+        &&(mantissa==0||((exponent>=-22)&&(exponent<=22)))) {
+        double d=static_cast<double>(mantissa);
+        if(exponent<0) d/=s_pow10[-exponent];
+        else if(exponent>0) d*=s_pow10[exponent];
+        value=static_cast<float>(negative ? -d : d);
+        return p;
+    }
+    // slow path for rare notations such as hexadecimal numbers, inf or nan, or garbage
+    p=tokenEnd(p,end);
+    TokenBuffer token(pStart,p);
+    value=static_cast<float>(atof(token.c_str()));
+    return p;
+}
+
+const char * parseInt(const char * p, const char * end, int & value) {
+    p=skipSeparators(p,end);
+    if(p==end) return 0;
+    const char * pStart=p;
+    bool negative=false;
+    if(*p=='-') { negative=true; ++p; }
+    else if(*p=='+') ++p;
+    const char * pDigits=p;
+    int i=0;
+    for(; (p<end)&&(*p>='0')&&(*p<='9')&&(p-pDigits<9); ++p) i=i*10+(*p-'0');
+    if((p>pDigits)&&((p==end)||(*p<'0')||(*p>'9'))) {
+        value= negative ? -i : i;
+        return tokenEnd(p,end);
+    }
+    // slow path for overlong or malformed tokens
+    p=tokenEnd(p,end);
+    TokenBuffer token(pStart,p);
+    value=atoi(token.c_str());
+    return p;
+}
+
+char * printInt(char * p, long i) {
+    unsigned long u=static_cast<unsigned long>(i);
+    if(i<0) {
+        *p++='-';
+        u=0ul-u;
+    }
+    return printUInt(p, u);
+}
+
+char * printUInt(char * p, unsigned long u) {
+    char buf[24];
+    char * q=buf+sizeof(buf);
+    do {
+        *--q=static_cast<char>('0'+u%10);
+        u/=10;
+    } while(u);
+    size_t n=buf+sizeof(buf)-q;
+    memcpy(p,q,n);
+    return p+n;
+}
+
+char * printFloat(char * p, float f) {
+    if(f==0.0f) { // keep the sign of negative zero, coordinates may be negated by the readers
+        if(1.0f/f<0.0f) *p++='-';
+        *p++='0';
+        return p;
+    }
+    double a=fabs(static_cast<double>(f));
+    // the fixed point representation has to stay within the fast path of parseFloat():
+    if(!(a>=1e-12)||!(a<1e14)) return p+sprintf(p,"%.9g",f); // includes nan and inf
+    int e10=static_cast<int>(floor(log10(a)));
+    if((e10>=-1)&&(e10<13)&&(a>=s_pow10[e10+1])) ++e10; // log10() may round down at powers of ten
+    // search the shortest mantissa m with decimal exponent q that parseFloat() maps back to f:
+    unsigned long long m=0;
+    int q=0;
+    for(int nDigits=1; nDigits<=9; ++nDigits) {
+        q=e10-nDigits+1;
+        double d= (q<0) ? a*s_pow10[-q] : a/s_pow10[q];
+        m=static_cast<unsigned long long>(d+0.5);
+        d=static_cast<double>(m);
+        if(q<0) d/=s_pow10[-q];
+        else d*=s_pow10[q];
+        if(static_cast<float>(d)==static_cast<float>(a)) break;
+    }
+    if(f<0.0f) *p++='-';
+    // digits of m, possibly one more than nDigits after rounding up:
+    char digits[24];
+    char * pEnd=digits+sizeof(digits), * pDigit=pEnd;
+    do {
+        *--pDigit=static_cast<char>('0'+m%10);
+        m/=10;
+    } while(m);
+    int nDigits=static_cast<int>(pEnd-pDigit);
+    // strip trailing zeros of the fractional part:
+    while((q<0)&&(pEnd[-1]=='0')) {
+        --pEnd;
+        --nDigits;
+        ++q;
+    }
+    if(q>=0) { // integer
+        memcpy(p,pDigit,nDigits);
+        p+=nDigits;
+        for(; q>0; --q) *p++='0';
+    }
+    else if(nDigits>-q) { // decimal point within the digits
+        int nInt=nDigits+q;
+        memcpy(p,pDigit,nInt);
+        p+=nInt;
+        *p++='.';
+        memcpy(p,pDigit+nInt,-q);
+        p-=q;
+    }
+    else { // leading zeros
+        *p++='0';
+        *p++='.';
+        for(int i=nDigits; i<-q; ++i) *p++='0';
+        memcpy(p,pDigit,nDigits);
+        p+=nDigits;
+    }
+    return p;
+}
+
 size_t s2f(const string & s, vector<float> & vFloat, const string & separators) {
+    if(separators==s_numSeparators) {
+        const char * p=s.data(), * end=p+s.size();
+        size_t n=0;
+        float f;
+        while((p=parseFloat(p,end,f))) {
+            vFloat.push_back(f);
+            ++n;
+        }
+        return n;
+    }
     vector<string> words;
     vFloat.reserve(split(s,words,separators));
     for(size_t i=0; i<words.size(); ++i)
         vFloat.push_back(static_cast<float>(atof(words[i].c_str())));
     return words.size();
 }
-
 size_t s2i(const string & s, vector<int> & vInt, const string & separators) {
+    if(separators==s_numSeparators) {
+        const char * p=s.data(), * end=p+s.size();
+        size_t n=0;
+        int i;
+        while((p=parseInt(p,end,i))) {
+            vInt.push_back(i);
+            ++n;
+        }
+        return n;
+    }
     vector<string> words;
     vInt.reserve(split(s,words,separators));
     for(size_t i=0; i<words.size(); ++i)
         vInt.push_back(atoi(words[i].c_str()));
     return words.size();
 }
+size_t s2f(const string & s, float * pF, size_t n) {
+    const char * p=s.data(), * end=p+s.size();
+    size_t i=0;
+    while((i<n)&&(p=parseFloat(p,end,pF[i]))) ++i;
+    return i;
+}
 
 string toUpper(const string & s) {
     string retStr(s);
@@ -117,6 +117,46 @@ size_t s2f(const std::string & s, std::vector<float> & vFloat, const std::string
 /** The string is splitted according to optional argument separators.
  \return the number of generated ints.*/
 size_t s2i(const std::string & s, std::vector<int> & vInt, const std::string & separators=", \t\n\015");
+/// converts up to n floats of string s into the array pF without allocating memory
+/** \return the number of converted floats */
+size_t s2f(const std::string & s, float * pF, size_t n);
+
+//--- number parsing -----------------------------------------------
+
+/// parses the next float token in the character range [p,end) without allocating memory
+/** Leading whitespace and commata are skipped. The result equals atof() applied to the token,
+ tokens that are no numbers therefore yield 0.0. Typical decimal numbers are converted directly,
+ others fall back to atof(). Example:\n
+  \code
+	const char * p=s.data(), * end=p+s.size();
+	float f;
+	while((p=parseFloat(p,end,f))) vFloat.push_back(f);
+  \endcode
+ \return pointer behind the token, 0 if no further token exists */
+const char * parseFloat(const char * p, const char * end, float & value);
+/// parses the next integer token in the character range [p,end) without allocating memory
+/** Leading whitespace and commata are skipped. The result equals atoi() applied to the token.
+ \return pointer behind the token, 0 if no further token exists */
+const char * parseInt(const char * p, const char * end, int & value);
+/// returns a pointer to the first character in [p,end) that is no whitespace or comma
+const char * skipSeparators(const char * p, const char * end);
+
+//--- number formatting --------------------------------------------
+
+/// writes the decimal representation of i to p without allocating memory
+/** p has to provide space for at least 21 characters, no terminating zero is written.
+ \return pointer behind the last written character */
+char * printInt(char * p, long i);
+/// writes the decimal representation of the unsigned integer u to p without allocating memory
+/** p has to provide space for at least 20 characters, no terminating zero is written.
+ \return pointer behind the last written character */
+char * printUInt(char * p, unsigned long u);
+/// writes the shortest decimal representation of f to p that parseFloat() converts back to f
+/** Typical values are written in fixed point notation with up to nine significant digits, very 
+ large or small values and nan/inf fall back to sprintf(). p has to provide space for at least 
+ 32 characters, no terminating zero is written.
+ \return pointer behind the last written character */
+char * printFloat(char * p, float f);
 
 /// converts a string to upper case, if possible.
 std::string toUpper(const std::string & s);
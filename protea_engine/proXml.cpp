@@ -1,123 +1,14 @@
 #include "proXml.h"
+#include "proProfiler.h"
+#include "proIo.h"
 #include <cstdio>
+#include <cstring>
 #include <cctype>
 
 using namespace std;
 
 vector<pair<string,string> > Xml::sv_code;
 
-//--- class XmlTokenizer -------------------------------------------
-
-class XmlTokenizer {
-public:
-    /// constructor form a string
-    XmlTokenizer(const std::string & str) : s(str), i(0), tagMode(false) { }
-    /// returns next token or an empty string in case no further token is available
-    std::string next();
-protected:
-    /// stores string to be tokenized
-    std::string s;
-    /// stores current read position
-    size_t i;
-    /// stores current read context
-    bool tagMode;
-    /// stores next token, if already determined
-    std::string m_nextToken;
-};
-
-string XmlTokenizer::next() {
-	const unsigned char ESC=27;
-	string word;
-	int quotMode=0;
-	bool tokenComplete = false;   
-	while(m_nextToken.size()||(i<s.size())) {
-		
-		if(m_nextToken.size()) {
-			word=m_nextToken; 
-			m_nextToken.clear();
-			return word;
-		}
-
-		switch(s[i]) {
-		case '"': 
-		case '\'': 
-			if(tagMode) {
-				if(!quotMode) quotMode=s[i];
-				else if(quotMode==s[i]) quotMode=0;
-			}
-			word+=s[i]; 
-			break;
-		case '<': 
-			if(!quotMode&&(i+4<s.size())&&(s.substr(i,4)=="<!--")) // strip comments
-				i=s.find("-->",i+4)+2;
-			else if(!quotMode&&(i+9<s.size())&&(s.substr(i,9)=="<![CDATA[")) { // interpet CDATA
-				size_t b=i+9;
-				i=s.find("]]>",b)+3;
-				if(!word.size()) return s.substr(b,i-b-3);
-				tokenComplete = true;
-				m_nextToken=s.substr(b,i-b-3);
-				--i;
-			}
-			else if(!quotMode&&(i+1<s.size())&&((s[i+1]=='?')||(s[i+1]=='!'))) // strip meta information
-				i=s.find('>',i+2);
-			else if(!quotMode&&!tagMode) {
-				if((i+1<s.size())&&(s[i+1]=='/')) {
-					m_nextToken=ESC;
-					i=s.find('>',i+2);
-				}
-				else {
-					m_nextToken='<';
-					tagMode=true; 
-				}
-				tokenComplete = true;
-			}
-			else word+=s[i];
-			break;
-		case '/': 
-			if(tagMode&&!quotMode) {
-				tokenComplete = true;
-				if(i+1<s.size()&&(s[i+1]=='>')) {
-					tagMode=false;
-					m_nextToken=ESC;
-					++i;
-				}
-				else word+=s[i];
-			}                    
-			else word+=s[i];
-			break;
-		case '>': 
-			if(!quotMode&&tagMode) {
-				tagMode=false;
-				tokenComplete = true;
-				m_nextToken='>'; 
-			}                    
-			else word+=s[i];
-			break;
-		case ' ':
-		case '\r':
-		case '\n':
-		case '\t':
-			if(tagMode&&!quotMode) {
-				if(word.size()) tokenComplete=true;
-			}
-			else word+=s[i];
-			break;
-		default: word+=s[i];
-		}
-        if(i<s.size()) ++i;
-        if((i>=s.size())||(tokenComplete&&word.size())) {
-            tokenComplete=false;
-            size_t b = word.find_first_not_of(" \t\n\015"); // trim whitespace
-            if(b < word.size()) {
-                word=word.substr(b, word.find_last_not_of(" \t\n\015") - b + 1); 
-                if(word.size()) break;
-            }
-            else word.clear();
-        }
-    }
-    return word;
-}
-
 //--- string utilities ---------------------------------------------
 
 static string replaceAll(string s, const string & search, const string & repl) {
@@ -332,91 +223,411 @@ const Xml * Xml::find(const string & tagName, const string & attrKey, const stri
 //--- file input output --------------------------------------------
 
 Xml Xml::load(const string & filename) {
-    FILE * file=fopen(filename.c_str(),"r");
-    if(!file) {
+    XmlDoc doc;
+    if(!doc.load(filename)) {
         fprintf(stderr,"Xml ERROR: \"%s\" file error or file not found!",filename.c_str());
         return Xml("ERROR");
     }
-    fseek (file , 0 , SEEK_END);
-    size_t sz = ftell (file);
-    rewind (file);
-    char* buffer = new char[sz];
-    fread (buffer,1,sz,file);
-    fclose(file);
-    buffer[sz-1]=0;
-    Xml xml;
-    xml.eval(buffer);
-    delete[] buffer;
+    LoadStage stage("xmlDom");
+    stage.elements(doc.size());
+    Xml xml("");
+    if(doc.size()) doc.root().copyTo(xml);
     return xml;
 }
 
 int Xml::save(const string & filename) const {
-    FILE * file=fopen(filename.c_str(),"w");
-    if (!file) {
+    FileWriter file;
+    if (!file.open(filename)) {
         fprintf(stderr,"Xml ERROR: \"%s\" write file error!",filename.c_str());
         return 1;
     }
-    string header("<?xml version=\"1.0\"?>\n<!-- generated by protea::Xml -->\n\n");
-    fwrite(header.c_str(),sizeof(header[0]),header.size(),file);
-    string body(str());
-    fwrite(body.c_str(),sizeof(body[0]),body.size(),file);
-    fclose(file);
-    return 0;
+    file << "<?xml version=\"1.0\"?>\n<!-- generated by protea::Xml -->\n\n";
+    print(file, 0);
+    return file.close() ? 0 : 1;
 }
 
 void Xml::eval(const string & s) {
-	const unsigned char ESC=27;
+	LoadStage stage("xmlEval");
+	stage.bytes(s.size());
 	clear();
 	m_tag.clear();
-	Xml *currSt = 0;
-	XmlTokenizer tokenizer(s);
-	string token;
-	while((token = tokenizer.next()).size()) {
-		if(token[0]=='<') { // new tag found
-			if(currSt) {
-				currSt->append(Xml(tokenizer.next()));
-				currSt=currSt->mv_elem.back().first;
-			}
-			else {
-				if(!m_tag.size()) m_tag=tokenizer.next();
-				else return;
-				currSt=this;
-			}
-			while((token = tokenizer.next()).size()&&(token[0]!='>')&&(token[0]!=ESC)) { // parse tag header
-				size_t sepPos=token.find('=');
-				if(sepPos<token.size()) { // regular attribute
-					string aName(token,0,sepPos);
-					string aValue(token, sepPos+2, token.rfind(token[sepPos+1])-sepPos-2);
-					currSt->attr(aName, decode(aValue));
-				}
-			}
-			if((token[0]==ESC)&&currSt)
-				currSt=currSt->parent(); // this tag has no content, only attributes
-		}
-		else if((token[0]==ESC)&&currSt) currSt=currSt->parent(); // tag is over
-		else if(currSt) currSt->append(decode(token));
-	}
+	XmlDoc doc;
+	doc.eval(s.data(), s.size());
+	stage.elements(doc.size());
+	if(doc.size()) doc.root().copyTo(*this);
 }
 
-string Xml::str(unsigned int nTabs) const {
-    string s;
+/// an auxiliary class appending the output of Xml::print() to a string
+class StringSink {
+public:
+    /// constructor
+    StringSink(string & s) : m_s(s) { }
+    /// appends characters and strings
+    template <class T> StringSink & operator<<(const T & v) { m_s+=v; return *this; }
+protected:
+    /// target string
+    string & m_s;
+};
+
+template <class Sink> void Xml::print(Sink & sink, unsigned int nTabs) const {
     unsigned int i;
-    string tabStr;
-    for(i=0; i<nTabs; ++i) tabStr+='\t';
-    s+=tabStr+"<"+m_tag;
+    for(i=0; i<nTabs; ++i) sink << '\t';
+    sink << '<' << m_tag;
     for(i=0; i<mv_attr.size(); i+=2)
-        s+= " "+mv_attr[i]+"=\""+encode(mv_attr[i+1])+"\"";
-    if(!mv_elem.size()) s+="/>\n";
+        sink << ' ' << mv_attr[i] << "=\"" << encode(mv_attr[i+1]) << '"';
+    if(!mv_elem.size()) sink << "/>\n";
     else {
-        s+=">";
+        sink << '>';
         if((mv_elem.size()==1)&&!mv_elem[0].first) // content only
-            s+=' '+mv_elem[0].second+" </"+m_tag+">\n";
+            sink << ' ' << mv_elem[0].second << " </" << m_tag << ">\n";
         else { // substatements only
-            s+='\n';
-            for(i=0; i<mv_elem.size();i++)
-                s+=mv_elem[i].first ? mv_elem[i].first->str(nTabs+1) : (mv_elem[i].second+'\n');
-            s+=tabStr+"</"+m_tag+">\n";
+            sink << '\n';
+            for(i=0; i<mv_elem.size();i++) {
+                if(mv_elem[i].first) mv_elem[i].first->print(sink, nTabs+1);
+                else sink << mv_elem[i].second << '\n';
+            }
+            for(i=0; i<nTabs; ++i) sink << '\t';
+            sink << "</" << m_tag << ">\n";
         }
     }
+}
+
+string Xml::str(unsigned int nTabs) const {
+    string s;
+    StringSink sink(s);
+    print(sink, nTabs);
     return s;
 }
+
+//--- class XmlWriter ----------------------------------------------
+
+void XmlWriter::closeStartTag() {
+    if(!m_startTag) return;
+    m_out << ">\n";
+    m_startTag=false;
+}
+
+void XmlWriter::begin(const string & tag) {
+    closeStartTag();
+    for(size_t i=0; i<mv_tag.size(); ++i) m_out << '\t';
+    m_out << '<' << tag;
+    mv_tag.push_back(tag);
+    m_startTag=true;
+}
+
+void XmlWriter::attr(const string & name, const string & value) {
+    if(!Xml::sv_code.size()) Xml::registerDefaultCodes();
+    m_out << ' ' << name << "=\"" << Xml::encode(value) << '"';
+}
+
+void XmlWriter::attrBegin(const string & name) {
+    m_out << ' ' << name << "=\"";
+}
+
+void XmlWriter::attrEnd() {
+    m_out << '"';
+}
+
+void XmlWriter::end() {
+    if(!mv_tag.size()) return;
+    if(m_startTag) m_out << "/>\n";
+    else {
+        for(size_t i=1; i<mv_tag.size(); ++i) m_out << '\t';
+        m_out << "</" << mv_tag.back() << ">\n";
+    }
+    mv_tag.pop_back();
+    m_startTag=false;
+}
+
+void XmlWriter::write(const Xml & xml) {
+    closeStartTag();
+    xml.print(m_out, static_cast<unsigned int>(mv_tag.size()));
+}
+
+//--- class XmlStr -------------------------------------------------
+
+bool XmlStr::operator==(const char * s) const {
+    if(!m_size) return !*s;
+    return !strncmp(s, mp_data, m_size) && !s[m_size];
+}
+
+string XmlStr::decoded() const {
+    if(!m_size||!memchr(mp_data, '&', m_size)) return str();
+    if(!Xml::sv_code.size()) Xml::registerDefaultCodes();
+    return Xml::decode(str());
+}
+
+//--- class XmlParser ----------------------------------------------
+
+static inline bool isXmlSpace(char ch) {
+    return (ch==' ')||(ch=='\t')||(ch=='\n')||(ch=='\r');
+}
+
+/// returns position of zero terminated string pattern in [p,pEnd) or pEnd
+static const char * search(const char * p, const char * pEnd, const char * pattern) {
+    size_t n=strlen(pattern);
+    for(; p+n<=pEnd; ++p) {
+        p=static_cast<const char*>(memchr(p, pattern[0], pEnd-p));
+        if(!p||(p+n>pEnd)) return pEnd;
+        if(!memcmp(p, pattern, n)) return p;
+    }
+    return pEnd;
+}
+
+/// returns true if [p,pEnd) starts with zero terminated string pattern
+static inline bool startsWith(const char * p, const char * pEnd, const char * pattern) {
+    size_t n=strlen(pattern);
+    return (p+n<=pEnd)&&!memcmp(p, pattern, n);
+}
+
+XmlStr XmlParser::attr(const XmlStr * pAttr, size_t nAttr, const char * name) {
+    for(size_t i=nAttr; i>0; --i) // later definitions override earlier ones
+        if(pAttr[2*i-2]==name) return pAttr[2*i-1];
+    return XmlStr();
+}
+
+void XmlParser::parse(const char * pData, size_t n) {
+    const char * p=pData, * pEnd=pData+n;
+    bool rootFound=false;
+    mv_open.clear();
+    while(p<pEnd) {
+        const char * pText=p;
+        p=static_cast<const char*>(memchr(p, '<', pEnd-p));
+        if(!p) p=pEnd;
+        if(mv_open.size()) { // trim whitespace
+            while((pText<p)&&isXmlSpace(*pText)) ++pText;
+            const char * pTextEnd=p;
+            while((pTextEnd>pText)&&isXmlSpace(pTextEnd[-1])) --pTextEnd;
+            if(pText<pTextEnd) text(XmlStr(pText, pTextEnd-pText), false);
+        }
+        if(p==pEnd) break;
+
+        if(startsWith(p, pEnd, "<!--")) { // strip comments
+            p=search(p+4, pEnd, "-->");
+            p= (p<pEnd) ? p+3 : pEnd;
+        }
+        else if(startsWith(p, pEnd, "<![CDATA[")) { // interpret CDATA
+            const char * pCData=p+9;
+            p=search(pCData, pEnd, "]]>");
+            if(mv_open.size()&&(p>pCData)) text(XmlStr(pCData, p-pCData), true);
+            p= (p<pEnd) ? p+3 : pEnd;
+        }
+        else if((p+1<pEnd)&&((p[1]=='?')||(p[1]=='!'))) { // strip meta information
+            p=static_cast<const char*>(memchr(p, '>', pEnd-p));
+            p= p ? p+1 : pEnd;
+        }
+        else if((p+1<pEnd)&&(p[1]=='/')) { // closing tag
+            p=static_cast<const char*>(memchr(p, '>', pEnd-p));
+            p= p ? p+1 : pEnd;
+            if(mv_open.size()) {
+                XmlStr tag(mv_open.back());
+                mv_open.pop_back();
+                endElement(tag);
+                if(mv_open.empty()) return; // root is complete
+            }
+        }
+        else { // new element
+            if(rootFound&&mv_open.empty()) return; // only a single root is accepted
+            rootFound=true;
+            const char * pName=++p;
+            while((p<pEnd)&&!isXmlSpace(*p)&&(*p!='/')&&(*p!='>')) ++p;
+            XmlStr tag(pName, p-pName);
+            bool isEmpty=false;
+            mv_attrBuf.clear();
+            while(p<pEnd) { // parse attributes
+                while((p<pEnd)&&isXmlSpace(*p)) ++p;
+                if(p==pEnd) break;
+                if(*p=='>') {
+                    ++p;
+                    break;
+                }
+                if(*p=='/') {
+                    if((p+1<pEnd)&&(p[1]=='>')) { // element without content
+                        p+=2;
+                        isEmpty=true;
+                        break;
+                    }
+                    ++p;
+                    continue;
+                }
+                const char * pKey=p;
+                while((p<pEnd)&&!isXmlSpace(*p)&&(*p!='=')&&(*p!='>')&&(*p!='/')) ++p;
+                XmlStr key(pKey, p-pKey);
+                while((p<pEnd)&&isXmlSpace(*p)) ++p;
+                if((p==pEnd)||(*p!='=')) continue; // attribute without value, ignored
+                ++p;
+                while((p<pEnd)&&isXmlSpace(*p)) ++p;
+                if((p==pEnd)||((*p!='"')&&(*p!='\''))) continue; // unquoted value, ignored
+                const char * pValue=p+1;
+                p=static_cast<const char*>(memchr(pValue, *p, pEnd-pValue));
+                if(!p) p=pEnd;
+                mv_attrBuf.push_back(key);
+                mv_attrBuf.push_back(XmlStr(pValue, p-pValue));
+                if(p<pEnd) ++p;
+            }
+            startElement(tag, mv_attrBuf.size() ? &mv_attrBuf[0] : 0, mv_attrBuf.size()/2);
+            if(!isEmpty) mv_open.push_back(tag);
+            else {
+                endElement(tag);
+                if(mv_open.empty()) return; // root is complete
+            }
+        }
+    }
+    while(mv_open.size()) { // close open elements
+        XmlStr tag(mv_open.back());
+        mv_open.pop_back();
+        endElement(tag);
+    }
+}
+
+//--- class XmlDoc -------------------------------------------------
+
+XmlDoc::~XmlDoc() {
+    delete mp_file;
+}
+
+void XmlDoc::clear() {
+    mv_node.clear();
+    mv_attr.clear();
+    mv_child.clear();
+    delete mp_file;
+    mp_file=0;
+    m_copy.clear();
+}
+
+bool XmlDoc::load(const string & filename) {
+    clear();
+    LoadStage stage("readFile");
+    mp_file=new MappedFile;
+    if(!mp_file->open(filename)) {
+        delete mp_file;
+        mp_file=0;
+        return false;
+    }
+    stage.bytes(mp_file->size());
+    stage.finish();
+    build(mp_file->data(), mp_file->size());
+    return true;
+}
+
+void XmlDoc::eval(const char * pData, size_t n) {
+    clear();
+    build(pData, n);
+}
+
+void XmlDoc::eval(const string & s) {
+    clear();
+    m_copy=s;
+    build(m_copy.data(), m_copy.size());
+}
+
+XmlNode XmlDoc::root() const {
+    return mv_node.size() ? XmlNode(this,0) : XmlNode();
+}
+
+void XmlDoc::build(const char * pData, size_t n) {
+    LoadStage stage("xmlTokenize");
+    stage.bytes(n);
+    m_curr=NONE;
+    parse(pData, n);
+    // arrange children contiguously:
+    unsigned int i, nNodes=static_cast<unsigned int>(mv_node.size()), nChildren=0;
+    for(i=0; i<nNodes; ++i) {
+        mv_node[i].childBegin=nChildren;
+        nChildren+=mv_node[i].nChildren;
+        mv_node[i].nChildren=0;
+    }
+    mv_child.resize(nChildren);
+    for(i=1; i<nNodes; ++i) {
+        Node & parent=mv_node[mv_node[i].parent];
+        mv_child[parent.childBegin+parent.nChildren++]=i;
+    }
+    stage.elements(nNodes);
+}
+
+void XmlDoc::startElement(const XmlStr & tag, const XmlStr * pAttr, size_t nAttr) {
+    Node node;
+    node.name=tag;
+    node.parent=m_curr;
+    node.attrBegin=static_cast<unsigned int>(mv_attr.size());
+    node.nAttr=static_cast<unsigned int>(nAttr);
+    node.childBegin=node.nChildren=node.subtreeEnd=0;
+    node.kind=ELEMENT;
+    mv_attr.insert(mv_attr.end(), pAttr, pAttr+2*nAttr);
+    if(m_curr!=NONE) ++mv_node[m_curr].nChildren;
+    m_curr=static_cast<unsigned int>(mv_node.size());
+    mv_node.push_back(node);
+}
+
+void XmlDoc::endElement(const XmlStr &) {
+    mv_node[m_curr].subtreeEnd=static_cast<unsigned int>(mv_node.size());
+    m_curr=mv_node[m_curr].parent;
+}
+
+void XmlDoc::text(const XmlStr & s, bool cdata) {
+    Node node;
+    node.name=s;
+    node.parent=m_curr;
+    node.attrBegin=static_cast<unsigned int>(mv_attr.size());
+    node.nAttr=node.childBegin=node.nChildren=0;
+    node.subtreeEnd=static_cast<unsigned int>(mv_node.size()+1);
+    node.kind= cdata ? CDATA : TEXT;
+    ++mv_node[m_curr].nChildren;
+    mv_node.push_back(node);
+}
+
+//--- class XmlNode ------------------------------------------------
+
+XmlStr XmlNode::attrView(const char * name) const {
+    return node().nAttr ? XmlParser::attr(&mp_doc->mv_attr[node().attrBegin], node().nAttr, name) : XmlStr();
+}
+
+string XmlNode::attr(const string & name) const {
+    return attrView(name.c_str()).decoded();
+}
+
+pair<string,string> XmlNode::attr(size_t n) const {
+    if(n>=node().nAttr) return make_pair(string(),string());
+    const XmlStr * pAttr=&mp_doc->mv_attr[node().attrBegin+2*n];
+    return make_pair(pAttr[0].str(), pAttr[1].decoded());
+}
+bool XmlNode::matches(const string & tagName, const string & attrKey, const string & attrValue) const {
+    if(isText()) return false;
+    if(tagName.size()&&(node().name!=tagName)) return false;
+    return !attrKey.size()||!attrValue.size()||(attr(attrKey)==attrValue);
+}
+
+XmlNode XmlNode::child(const string & tagName, const string & attrKey, const string & attrValue) const {
+    for(size_t i=0; i<nChildren(); ++i) {
+        XmlNode xn(child(i));
+        if(xn.matches(tagName, attrKey, attrValue)) return xn;
+    }
+    return XmlNode();
+}
+
+XmlNode XmlNode::find(const string & tagName, const string & attrKey, const string & attrValue) const {
+    for(unsigned int i=m_id; i<node().subtreeEnd; ++i) { // descendants follow in document order
+        XmlNode xn(mp_doc, i);
+        if(xn.matches(tagName, attrKey, attrValue)) return xn;
+    }
+    return XmlNode();
+}
+
+Xml XmlNode::xml() const {
+    Xml xml("");
+    copyTo(xml);
+    return xml;
+}
+
+void XmlNode::copyTo(Xml & target) const {
+    target.tag(node().name.str());
+    for(size_t i=0; i<nAttr(); ++i) {
+        const XmlStr * pAttr=&mp_doc->mv_attr[node().attrBegin+2*i];
+        target.attr(pAttr[0].str(), pAttr[1].decoded());
+    }
+    for(size_t i=0; i<nChildren(); ++i) {
+        XmlNode xn(child(i));
+        if(xn.isText()) target.append(xn.text());
+        else xn.copyTo(target.append(Xml("")));
+    }
+}
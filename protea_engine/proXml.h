@@ -31,6 +31,11 @@
 #include <vector>
 #include <string>
 
+class XmlNode;
+class MappedFile;
+
+//--- class Xml ----------------------------------------------------
+
 /// a class implementing a document object model (DOM) of an xml file
 class Xml {
 public:
@@ -148,6 +153,302 @@ protected:
     static void registerDefaultCodes();
     /// stores code table for special characters
     static std::vector<std::pair<std::string,std::string> > sv_code;
+    /// writes the preformatted xml to sink, which has to provide operator<< for characters and strings
+    template <class Sink> void print(Sink & sink, unsigned int nTabs) const;
+    
+    friend class XmlStr;
+    friend class XmlWriter;
+};
+
+//--- class XmlWriter ----------------------------------------------
+
+class FileWriter;
+
+/// a class streaming xml statements to a FileWriter without building a DOM
+/** Elements are opened by begin() and closed by end(), their attributes have to be added directly 
+ after begin(). The layout equals Xml::str(). Large attribute values such as number arrays can be 
+ streamed via attrBegin(), writing to out(), and attrEnd(), these values are not encoded. Example:\n
+  \code
+	FileWriter file("points.xml");
+	XmlWriter xw(file);
+	xw.begin("Coordinate");
+	xw.attrBegin("point");
+	for(size_t i=0; i<vPoint.size(); ++i) xw.out() << vPoint[i][X] << ' ' << vPoint[i][Y] << ", ";
+	xw.attrEnd();
+	xw.end();
+  \endcode */
+class XmlWriter {
+public:
+    /// constructor
+    XmlWriter(FileWriter & out) : m_out(out), m_startTag(false) { }
+    /// returns the underlying file writer
+    FileWriter & out() { return m_out; }
+    /// opens an element
+    void begin(const std::string & tag);
+    /// adds an attribute to the element opened last, the value is encoded
+    void attr(const std::string & name, const std::string & value);
+    /// starts an attribute of the element opened last, its value has to be written to out()
+    void attrBegin(const std::string & name);
+    /// completes an attribute started by attrBegin()
+    void attrEnd();
+    /// closes the element opened last
+    void end();
+    /// writes a complete Xml statement as child of the element opened last
+    void write(const Xml & xml);
+    /// returns the number of open elements
+    size_t depth() const { return mv_tag.size(); }
+protected:
+    /// completes the start tag of the innermost element if still open
+    void closeStartTag();
+    /// output file
+    FileWriter & m_out;
+    /// tags of the open elements
+    std::vector<std::string> mv_tag;
+    /// stores whether the start tag of the innermost element is still open for attributes
+    bool m_startTag;
+};
+
+//--- class XmlStr -------------------------------------------------
+
+/// a non-owning reference to a character range, used by XmlDoc to refer into its buffer
+class XmlStr {
+public:
+    /// default constructor, creates an empty reference
+    XmlStr() : mp_data(0), m_size(0) { }
+    /// constructor referring to n characters at pData
+    XmlStr(const char * pData, size_t n) : mp_data(pData), m_size(n) { }
+    /// constructor referring to the characters of string s, which has to outlive this object
+    explicit XmlStr(const std::string & s) : mp_data(s.data()), m_size(s.size()) { }
+    /// returns pointer to first character, the range is not zero terminated
+    const char * data() const { return mp_data; }
+    /// returns pointer behind last character
+    const char * end() const { return mp_data+m_size; }
+    /// returns number of characters
+    size_t size() const { return m_size; }
+    /// returns true if the range is empty
+    bool empty() const { return !m_size; }
+    /// returns a copy as std::string
+    std::string str() const { return std::string(mp_data, m_size); }
+    /// returns a copy as std::string with decoded xml entities
+    std::string decoded() const;
+    /// comparison operator equality
+    bool operator==(const std::string & s) const { return !s.compare(0, s.size(), mp_data, m_size); }
+    /// comparison operator equality with a zero terminated string
+    bool operator==(const char * s) const;
+    /// comparison operator inequality
+    bool operator!=(const std::string & s) const { return !operator==(s); }
+    /// comparison operator inequality with a zero terminated string
+    bool operator!=(const char * s) const { return !operator==(s); }
+protected:
+    /// pointer to first character
+    const char * mp_data;
+    /// number of characters
+    size_t m_size;
+};
+
+//--- class XmlParser ----------------------------------------------
+
+/// an abstract base class for event based (SAX style) parsing of xml data without building a DOM
+/** Derived classes implement the element and text callbacks. All XmlStr arguments refer into
+ the parsed buffer, entities are not decoded. Comments and meta information are skipped. 
+ Parsing stops after the first toplevel element, elements left open at the end of the data 
+ are closed implicitly. */
+class XmlParser {
+public:
+    /// an abstract base class for alternative front ends delivering element events to an XmlParser
+    /** Allows to feed data of other encodings of the same element structure, e.g. VRML97, into
+     parsers written for xml. Attribute values have to remain valid until the sink is destroyed. */
+    class Source {
+    public:
+        /// destructor
+        virtual ~Source() { }
+        /// parses n characters at pData and delivers the resulting events to sink
+        virtual void parse(const char * pData, size_t n, XmlParser & sink) = 0;
+    protected:
+        /// forwards the start of an element to sink
+        static void startElement(XmlParser & sink, const XmlStr & tag, const XmlStr * pAttr, size_t nAttr) {
+            sink.startElement(tag, pAttr, nAttr); }
+        /// forwards the end of an element to sink
+        static void endElement(XmlParser & sink, const XmlStr & tag) { sink.endElement(tag); }
+    };
+    friend class Source;
+
+    /// destructor
+    virtual ~XmlParser() { }
+    /// parses n characters at pData
+    void parse(const char * pData, size_t n);
+    /// returns the value of attribute name within nAttr key/value pairs at pAttr, an empty range if it does not exist
+    static XmlStr attr(const XmlStr * pAttr, size_t nAttr, const char * name);
+protected:
+    /// called at the start of an element
+    /** \param tag element tag
+     \param pAttr pointer to nAttr attribute key/value pairs, keys have even indices */
+    virtual void startElement(const XmlStr & tag, const XmlStr * pAttr, size_t nAttr) = 0;
+    /// called at the end of an element, also for elements without content
+    virtual void endElement(const XmlStr & tag) = 0;
+    /// called for text content, whitespace is trimmed except in CDATA sections
+    virtual void text(const XmlStr & s, bool cdata) { }
+private:
+    /// attributes of the current element
+    std::vector<XmlStr> mv_attrBuf;
+    /// tags of the currently open elements
+    std::vector<XmlStr> mv_open;
+};
+
+//--- class XmlDoc -------------------------------------------------
+
+/// a compact read-only document object model referring into a memory mapped or borrowed buffer
+/** In contrast to Xml, an XmlDoc does not copy any tag names, attributes or contents. All nodes 
+ are stored in a single array in document order, names and values are XmlStr references into
+ the source buffer. Entities are only decoded on access. The nodes are queried via XmlNode 
+ handles, which provide the query interface of Xml. Example:\n
+  \code
+	XmlDoc doc;
+	if(doc.load("model.x3d")) {
+		XmlNode coord = doc.root().find("Coordinate");
+		XmlStr points = coord.attrView("point"); // no copy
+		Xml xml = doc.root().xml(); // conversion into a conventional Xml DOM
+	}
+  \endcode
+*/
+class XmlDoc : protected XmlParser {
+public:
+    /// constructor
+    XmlDoc() : mp_file(0), m_curr(NONE) { }
+    /// destructor
+    ~XmlDoc();
+    /// maps file filename into memory and parses it, previous information is cleared.
+    /** \return true in case of success */
+    bool load(const std::string & filename);
+    /// parses n characters at pData, previous information is cleared.
+    /** The buffer is not copied and has to remain valid as long as the document is used. */
+    void eval(const char * pData, size_t n);
+    /// parses a copy of string s, previous information is cleared.
+    void eval(const std::string & s);
+    /// clears all existing information and releases the buffer.
+    void clear();
+    /// returns the root element, an invalid node if the document is empty
+    XmlNode root() const;
+    /// returns the number of element and text nodes
+    size_t size() const { return mv_node.size(); }
+protected:
+    /// an auxiliary struct storing a single element or text node
+    struct Node {
+        /// tag name of elements, content of text nodes
+        XmlStr name;
+        /// index of parent node, NONE for the root
+        unsigned int parent;
+        /// index of first attribute key in mv_attr
+        unsigned int attrBegin;
+        /// number of attributes
+        unsigned int nAttr;
+        /// index of first child in mv_child
+        unsigned int childBegin;
+        /// number of children
+        unsigned int nChildren;
+        /// index behind last descendant in mv_node
+        unsigned int subtreeEnd;
+        /// node kind
+        unsigned char kind;
+    };
+    /// node kinds
+    enum { ELEMENT=0, TEXT, CDATA };
+    /// invalid node index
+    static const unsigned int NONE = ~0u;
+    /// builds the nodes from n characters at pData
+    void build(const char * pData, size_t n);
+    /// adds an element node
+    virtual void startElement(const XmlStr & tag, const XmlStr * pAttr, size_t nAttr);
+    /// completes an element node
+    virtual void endElement(const XmlStr & tag);
+    /// adds a text node
+    virtual void text(const XmlStr & s, bool cdata);
+
+    /// all nodes in document order
+    std::vector<Node> mv_node;
+    /// attribute keys and values, keys have even indices
+    std::vector<XmlStr> mv_attr;
+    /// child node indices, children of a node are contiguous
+    std::vector<unsigned int> mv_child;
+    /// mapped file, 0 if the buffer is not a file
+    MappedFile * mp_file;
+    /// owned copy of an evaluated string
+    std::string m_copy;
+    /// index of currently open element while building
+    unsigned int m_curr;
+
+    friend class XmlNode;
+private:
+    /// prevent copies
+    XmlDoc(const XmlDoc &);
+    /// prevent copies
+    XmlDoc & operator=(const XmlDoc &);
+};
+
+//--- class XmlNode ------------------------------------------------
+
+/// a lightweight handle of an XmlDoc node, providing the query interface of Xml
+/** Nodes are either elements or text nodes. Methods returning nodes return invalid nodes
+ instead of NULL pointers. A node is only valid as long as its XmlDoc exists and is unchanged. */
+class XmlNode {
+public:
+    /// default constructor, creates an invalid node
+    XmlNode() : mp_doc(0), m_id(0) { }
+    /// returns true if node refers to an existing node
+    bool valid() const { return mp_doc!=0; }
+    /// returns true if node is a text node
+    bool isText() const { return node().kind!=XmlDoc::ELEMENT; }
+    /// returns tag name, an empty string for text nodes
+    std::string tag() const { return isText() ? std::string() : node().name.str(); }
+    /// returns a reference to the tag name in the document buffer
+    XmlStr tagView() const { return isText() ? XmlStr() : node().name; }
+    /// returns decoded content of a text node
+    std::string text() const { return !isText() ? std::string() : (node().kind==XmlDoc::CDATA) ? node().name.str() : node().name.decoded(); }
+    /// returns parent element or an invalid node if toplevel
+    XmlNode parent() const { return node().parent==XmlDoc::NONE ? XmlNode() : XmlNode(mp_doc, node().parent); }
+
+    /// returns decoded attribute value as string. If it does not exist, an empty string is returned.
+    std::string attr(const std::string & name) const;
+    /// returns a reference to the undecoded attribute value in the document buffer, empty if it does not exist.
+    XmlStr attrView(const char * name) const;
+    /// returns a pair consisting of key and decoded value of attribute n as string. If it does not exist, an empty string is returned.
+    std::pair<std::string,std::string> attr(size_t n) const;
+    /// returns number of attributes
+    size_t nAttr() const { return node().nAttr; }
+
+    /// returns number of child elements and text nodes
+    size_t nChildren() const { return node().nChildren; }
+    /// returns the nth child element or text node
+    XmlNode child(size_t n) const { return XmlNode(mp_doc, mp_doc->mv_child[node().childBegin+n]); }
+    /// returns a specified direct child element or an invalid node
+    /** \param  tagName the tag of the searched element. Pass an empty string "" to select only by attribute 
+        \param attrKey (optional) the key of a specified attribute
+        \param attrValue (optional) the value of a specified attribute */
+    XmlNode child(const std::string & tagName, const std::string & attrKey="", const std::string & attrValue="") const;
+    /// returns the first (sub)element with suitable tag and optionally attribute, or an invalid node if none is found
+    /** \param  tagName the tag of the searched element. Pass an empty string "" to select only by attribute 
+        \param attrKey (optional) the key of a specified attribute
+        \param attrValue (optional) the value of a specified attribute */
+    XmlNode find(const std::string & tagName, const std::string & attrKey="", const std::string & attrValue="") const;
+
+    /// returns a conventional Xml DOM copy of this element and its subelements
+    Xml xml() const;
+    /// appends attributes and content of this element to target and sets its tag
+    void copyTo(Xml & target) const;
+protected:
+    /// constructor
+    XmlNode(const XmlDoc * pDoc, unsigned int id) : mp_doc(pDoc), m_id(id) { }
+    /// returns node data
+    const XmlDoc::Node & node() const { return mp_doc->mv_node[m_id]; }
+    /// returns true if this element matches the search criteria of child() and find()
+    bool matches(const std::string & tagName, const std::string & attrKey, const std::string & attrValue) const;
+
+    /// document
+    const XmlDoc * mp_doc;
+    /// node index
+    unsigned int m_id;
+
+    friend class XmlDoc;
 };
 
 /// operator for output of Xml objects to streams
@@ -41,5 +41,6 @@
 #include "proDeviceLocal.h"
 #include "proRenderer.h"
 #include "proCallable.h"
+#include "proProfiler.h"
 
 #endif // _PROTEA_H
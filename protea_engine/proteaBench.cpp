@@ -0,0 +1,216 @@
+// proteaBench headless protea rendering benchmark
+// renders scenes into an offscreen Mesa context along a camera path and reports frame timings
+//
+// camera path files contain one pose per line: x y z h p r, lines starting with # are ignored.
+// Without a camera path, the camera orbits around the bounding sphere of the loaded scene.
+
+#include "protea.h"
+#include "proIoWrl.h"
+#include "proIoObj.h"
+#include "proIo3ds.h"
+#include "proIoPng.h"
+#include "proIoJpg.h"
+
+#include <GL/gl.h>
+#include <GL/osmesa.h>
+#include <cstdio>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+using namespace std;
+
+//--- struct FrameRecord -------------------------------------------
+
+/// an auxiliary struct storing the measurements of a single benchmark frame
+struct FrameRecord {
+	/// frame duration in seconds, including glFinish()
+	double duration;
+	/// render statistics of the frame
+	unsigned int stats[RenderStats::N_COUNTERS];
+};
+
+//--- functions ----------------------------------------------------
+
+/// loads a camera path, returns number of poses read
+size_t loadPath(const string & filename, vector<vec6f> & vPose) {
+	vector<string> vLine;
+	split(io::load(filename), vLine, "\n\015");
+	for(size_t i=0; i<vLine.size(); ++i) {
+		if(!vLine[i].size()||(vLine[i][0]=='#')) continue;
+		vector<float> v;
+		if(s2f(vLine[i], v)<6) {
+			cerr << "proteaBench ERROR: invalid pose in line " << i+1 << " of \"" << filename << "\".\n";
+			continue;
+		}
+		vPose.push_back(vec6f(v[0],v[1],v[2],v[3],v[4],v[5]));
+	}
+	return vPose.size();
+}
+
+/// generates a camera path of n poses orbiting around a bounding sphere
+void orbitPath(const sphere & bounding, size_t n, vector<vec6f> & vPose) {
+	vec3f center(bounding.radius()>0.0f ? bounding.center() : vec3f(0.0f,0.0f,0.0f));
+	float dist=(bounding.radius()>0.0f ? bounding.radius() : 1.0f)*2.5f;
+	proCamera camera;
+	for(size_t i=0; i<n; ++i) {
+		camera.pos().set(0.0f,0.0f,0.0f, 360.0f*float(i)/float(n), -20.0f, 0.0f);
+		vec3f pos(center-camera.direction()*dist);
+		vPose.push_back(vec6f(pos[X],pos[Y],pos[Z], camera.pos()[H], camera.pos()[P], 0.0f));
+	}
+}
+
+/// returns the nearest rank percentile p (0.0..1.0) of a sorted vector
+double percentile(const vector<double> & vSorted, double p) {
+	if(!vSorted.size()) return 0.0;
+	size_t i=static_cast<size_t>(p*vSorted.size()+0.5);
+	return vSorted[i>0 ? min(i,vSorted.size())-1 : 0];
+}
+
+/// returns benchmark results in JSON format
+string report(const vector<string> & vScene, const vector<FrameRecord> & vFrame, unsigned int w, unsigned int h) {
+	vector<double> vSorted;
+	double sum=0.0;
+	for(size_t i=0; i<vFrame.size(); ++i) {
+		vSorted.push_back(vFrame[i].duration);
+		sum+=vFrame[i].duration;
+	}
+	sort(vSorted.begin(), vSorted.end());
+
+	ostringstream os;
+	os << "{\"scenes\":[";
+	for(size_t i=0; i<vScene.size(); ++i)
+		os << (i ? "," : "") << '"' << vScene[i] << '"';
+	os << "],\n\"width\":" << w << ",\"height\":" << h << ",\"frames\":" << vFrame.size() << ",\n";
+	os << "\"ms\":{\"mean\":" << (vFrame.size() ? sum*1000.0/vFrame.size() : 0.0)
+		<< ",\"min\":" << (vSorted.size() ? vSorted.front()*1000.0 : 0.0)
+		<< ",\"p50\":" << percentile(vSorted, 0.5)*1000.0
+		<< ",\"p90\":" << percentile(vSorted, 0.9)*1000.0
+		<< ",\"p95\":" << percentile(vSorted, 0.95)*1000.0
+		<< ",\"p99\":" << percentile(vSorted, 0.99)*1000.0
+		<< ",\"max\":" << (vSorted.size() ? vSorted.back()*1000.0 : 0.0) << "},\n";
+	os << "\"frame\":[\n";
+	for(size_t i=0; i<vFrame.size(); ++i) {
+		os << "{\"ms\":" << vFrame[i].duration*1000.0;
+		for(unsigned int j=0; j<RenderStats::N_COUNTERS; ++j)
+			os << ",\"" << RenderStats::counterName(j) << "\":" << vFrame[i].stats[j];
+		os << (i+1<vFrame.size() ? "},\n" : "}\n");
+	}
+	os << "]}\n";
+	return os.str();
+}
+
+//--- main ---------------------------------------------------------
+int main( int argc, char **argv ) {
+	cmdLine::author     ("Gerald Franz, www.viremo.de");
+	cmdLine::version    ("0.1.0");
+	cmdLine::date       ("2009-08-13");
+	cmdLine::shortDescr ("A headless protea rendering benchmark.");
+	cmdLine::usage      ("[-x(width)] [-y(height)] [-p(camera path file)] [-n(frames, default 360)] [-w(warmup frames, default 10)] [-s(hadows)] [-o(output file)] [-t(Chrome trace file)] scene [scene ...]");
+	cmdLine::interpret(argc, argv);
+	if(!cmdLine::nArg()) {
+		cerr << cmdLine::cmd() << ' ' << cmdLine::usage() << endl;
+		return 1;
+	}
+
+	// initialize offscreen context:
+	const unsigned int w = cmdLine::opt('x') ? s2ui(cmdLine::optArg('x')) : 640;
+	const unsigned int h = cmdLine::opt('y') ? s2ui(cmdLine::optArg('y')) : 480;
+	OSMesaContext ctx = OSMesaCreateContextExt(OSMESA_RGBA, 24, 8, 0, 0);
+	vector<unsigned char> vBuffer(w*h*4);
+	if(!ctx||!OSMesaMakeCurrent(ctx, &vBuffer[0], GL_UNSIGNED_BYTE, w, h)) {
+		cerr << "proteaBench ERROR: cannot create offscreen context.\n";
+		return 1;
+	}
+	glViewport(0, 0, w, h);
+	glClearColor(0.3f, 0.3f, 0.5f, 0.0f);
+
+	// initialize file format codecs:
+	ModelMgr & modelMgr = ModelMgr::singleton();
+	modelMgr.loaderRegister(ioWrl::load,"wrl");
+	modelMgr.loaderRegister(io3ds::load,"3ds");
+	modelMgr.loaderRegister(ioObj::load,"obj");
+	TextureMgr & textureMgr = TextureMgr::singleton();
+	textureMgr.loaderRegister(ioPng::load,"png");
+	textureMgr.loaderRegister(ioJpg::load,"jpg");
+
+	// initialize scene:
+	proNode::renderer(new RendererGL);
+	proCamera camera;
+	camera.dim().set(-1.0f, 1.0f, -.75f, .75f, 1.0f,1000.0f);
+	camera.flags()=FLAG_LIGHT|FLAG_RENDER;
+	if(cmdLine::opt('s')) camera.flags()|=FLAG_SHADOW;
+	proScene scene("Scene");
+	scene.enable(FLAG_SHADOW);
+	scene.append(new proLight(vec4f(0.5f,-0.5f,1.0f,0.0f)), false);
+	vector<string> vScene;
+	for(size_t i=0; i<cmdLine::nArg(); ++i) {
+		string filename(io::unifyPath(cmdLine::arg(i)));
+		proNode* pScenery = modelMgr.load(filename);
+		if(!pScenery) {
+			cerr << "proteaBench ERROR: cannot load \"" << filename << "\".\n";
+			return 1;
+		}
+		scene.append(pScenery, false);
+		vScene.push_back(filename);
+	}
+	scene.initGraphics();
+
+	// prepare camera path:
+	const size_t nFrames = cmdLine::opt('n') ? s2ui(cmdLine::optArg('n')) : 360;
+	const size_t nWarmup = cmdLine::opt('w') ? s2ui(cmdLine::optArg('w')) : 10;
+	vector<vec6f> vPose;
+	if(cmdLine::opt('p')) {
+		if(!loadPath(cmdLine::optArg('p'), vPose)) {
+			cerr << "proteaBench ERROR: empty camera path \"" << cmdLine::optArg('p') << "\".\n";
+			return 1;
+		}
+	}
+	else orbitPath(scene.boundingSphere(), nFrames, vPose);
+	const size_t nPoses = cmdLine::opt('p')&&!cmdLine::opt('n') ? vPose.size() : nFrames;
+
+	// render frames:
+	Profiler & profiler = Profiler::singleton();
+	if(cmdLine::opt('t')) {
+		profiler.capacity(static_cast<unsigned int>(nPoses));
+		profiler.enable(true);
+	}
+	RenderStats & stats = RenderStats::singleton();
+	vector<FrameRecord> vFrame;
+	vFrame.reserve(nPoses);
+	for(size_t i=0; i<nWarmup+nPoses; ++i) {
+		bool isMeasured = i>=nWarmup;
+		if(isMeasured) profiler.beginFrame();
+		double tStart=io::time();
+		camera.pos()=vPose[(i>=nWarmup ? i-nWarmup : i)%vPose.size()];
+		camera.time(tStart);
+		glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
+		glPushMatrix();
+		camera.update();
+		scene.draw(camera);
+		glPopMatrix();
+		glFinish();
+		double duration=io::time()-tStart;
+		stats.frame();
+		if(!isMeasured) continue;
+		profiler.endFrame();
+		FrameRecord fr;
+		fr.duration=duration;
+		for(unsigned int j=0; j<RenderStats::N_COUNTERS; ++j) fr.stats[j]=stats[j];
+		vFrame.push_back(fr);
+	}
+
+	// report results:
+	string result(report(vScene, vFrame, w, h));
+	if(cmdLine::opt('o')) {
+		if(!io::save(result, cmdLine::optArg('o'))) {
+			cerr << "proteaBench ERROR: cannot write \"" << cmdLine::optArg('o') << "\".\n";
+			return 1;
+		}
+	}
+	else cout << result;
+	if(cmdLine::opt('t')&&!profiler.saveChromeTrace(cmdLine::optArg('t')))
+		cerr << "proteaBench ERROR: cannot write \"" << cmdLine::optArg('t') << "\".\n";
+
+	OSMesaDestroyContext(ctx);
+	return 0;
+}
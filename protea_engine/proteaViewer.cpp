@@ -18,20 +18,23 @@ using namespace std;
 class Application : public Callable {
 public:
 	/// constructor
-	Application(proScene & scene, proLight & sun) : m_scene(scene), m_sun(sun), m_wireframe(false), m_groundPlane(true), m_shadow(true) { }
+	Application(proScene & scene, proLight & sun) : m_scene(scene), m_sun(sun), m_wireframe(false), m_groundPlane(true), m_shadow(true), m_stats(false), m_nAsync(0) { }
 	/// generic method calling the object instance to evalute the provided commands
 	virtual Var call(const std::string & cmd, const Var & arg);
 	/// returns all keys/command names provided by this Callable as Var::ARRAY
 	virtual Var info() const {
 		return Var().append("about").append("msgbox").append("load").append("clear")
-			.append("wireframe").append("groundplane").append("shadow"); }
-	/// updates application
-	int update(double deltaT) { return 0; }
+			.append("wireframe").append("groundplane").append("shadow").append("profile").append("stats").append("loadReport")
+			.append("loadAsync").append("loadProgress"); }
+	/// updates application, finalizes models loaded in the background
+	int update(double deltaT);
 	/// returns and clears current application message
 	std::string message() { std::string ret=m_msg; m_msg.clear(); return ret; }
 
 	/// loads scene
 	bool load(const std::string & filename);
+	/// loads several files and directory contents in parallel into the scene
+	bool load(const std::vector<std::string> & vPath);
 	/// clears scene
 	void clear() { m_scene.erase(&m_sun, false); m_scene.clear(); m_scene.append(&m_sun, false); m_msg = "Scene cleared"; }
 
@@ -56,6 +59,13 @@ public:
 		m_shadow=yesno; 
 		m_msg="Shadows "+string(m_shadow? "on":"off");
 	}
+	/// returns true if render statistics shall be displayed
+	bool showStats() const { return m_stats; }
+	/// turns display of render statistics on/off
+	void showStats(bool yesno){ 
+		m_stats=yesno; 
+		m_msg="Statistics "+string(m_stats? "on":"off");
+	}
 protected:
 	/// scene reference
 	proScene & m_scene;
@@ -67,6 +77,12 @@ protected:
 	bool m_groundPlane;
 	/// flag turning shadows on/off
 	bool m_shadow;
+	/// flag turning display of render statistics on/off
+	bool m_stats;
+	/// timings and counters of the most recent scene loading process
+	LoadReport m_loadReport;
+	/// number of pending background loading requests
+	size_t m_nAsync;
 	/// message string
 	std::string m_msg;
 };
@@ -90,18 +106,84 @@ Var Application::call(const std::string & cmd, const Var & arg ) {
 		if(arg[0].type()) drawShadow(arg[0].boolean());
 		return m_shadow;
 	}
+	else if(cmd=="profile") { // turns profiling on/off, or saves recorded frames as Chrome trace file
+		Profiler & profiler = Profiler::singleton();
+		if(arg[0].type()==Var::STRING) {
+			if(!profiler.saveChromeTrace(arg[0].string())) return false;
+			m_msg="Profile saved to \""+arg[0].string()+"\".";
+			return true;
+		}
+		if(arg[0].type()) {
+			profiler.enable(arg[0].boolean());
+			m_msg="Profiling "+string(profiler.enabled() ? "on":"off");
+		}
+		return profiler.enabled();
+	}
+	else if(cmd=="stats") {
+		if(arg[0].type()) showStats(arg[0].boolean());
+		return m_stats;
+	}
+	else if(cmd=="loadReport") // returns per stage timings of the most recent scene loading process
+		return m_loadReport.str();
+	else if(cmd=="loadAsync") { // loads a scene in the background, returns a request id for loadProgress
+		unsigned int id = ModelMgr::singleton().loadAsync(io::unifyPath(arg[0].string()), m_scene);
+		if(id) ++m_nAsync;
+		return id;
+	}
+	else if(cmd=="loadProgress") // returns progress 0.0..1.0 of a background loading request, or of all if no id is provided
+		return ModelMgr::singleton().progress(arg[0].type() ? arg[0].integer() : 0);
 	return Var::null;
 }
 
+int Application::update(double deltaT) {
+	if(!m_nAsync) return 0;
+	// finalization of background loaded models is limited to a fraction of the frame:
+	size_t nPending = ModelMgr::singleton().finalize(0.25*deltaT);
+	if(nPending<m_nAsync) m_msg=nPending ? i2s(long(nPending))+" scenes loading..." : "Background loading completed.";
+	m_nAsync = nPending;
+	return 0;
+}
+
 bool Application::load(const std::string & filename) {
-	proNode* pScenery = ModelMgr::singleton().load(filename);
+	m_loadReport.clear();
+	proNode* pScenery = ModelMgr::singleton().load(filename, &m_loadReport);
 	if(!pScenery) return false;
 	m_scene.append(pScenery,false);
+	m_loadReport.begin();
 	pScenery->initGraphics();
-	m_msg="Scene \""+filename+"\" loaded.";		
+	m_loadReport.end();
+	m_msg="Scene \""+filename+"\" loaded in "+f2s(m_loadReport.duration(), 2)+" s.";
+	dout(m_loadReport.str());
 	return true;
 }
 
+bool Application::load(const std::vector<std::string> & vPath) {
+	ModelMgr & modelMgr = ModelMgr::singleton();
+	vector<string> vFilename;
+	for(size_t i=0; i<vPath.size(); ++i) {
+		if(!io::isDir(vPath[i])) { vFilename.push_back(vPath[i]); continue; }
+		string dir(vPath[i]);
+		if(dir[dir.size()-1]!='/') dir+='/';
+		vector<string> vEntry(io::dir(dir));
+		for(size_t j=0; j<vEntry.size(); ++j)
+			if((vEntry[j].rfind('.')<vEntry[j].size())&&modelMgr.loaderAvailable(vEntry[j].substr(vEntry[j].rfind('.')+1)))
+				vFilename.push_back(dir+vEntry[j]);
+	}
+	if(vFilename.size()==1) return load(vFilename[0]);
+	m_loadReport.clear();
+	vector<proNode*> vModel;
+	size_t nLoaded = modelMgr.load(vFilename, vModel, &m_loadReport);
+	m_loadReport.begin();
+	for(size_t i=0; i<vModel.size(); ++i) if(vModel[i]) {
+		m_scene.append(vModel[i],false);
+		vModel[i]->initGraphics();
+	}
+	m_loadReport.end();
+	m_msg=i2s(long(nLoaded))+" of "+i2s(long(vFilename.size()))+" models loaded in "+f2s(m_loadReport.duration(), 2)+" s.";
+	dout(m_loadReport.str());
+	return nLoaded>0;
+}
+
 //--- class SkyController ------------------------------------------
 
 /// a dynamic controller for the sky dome and cloud layer
@@ -210,7 +292,7 @@ int main( int argc, char **argv ) {
 	cmdLine::version    ("0.1.2");
 	cmdLine::date       ("2009-08-13");
 	cmdLine::shortDescr ("A protea-based scene and model viewer.");
-	cmdLine::usage      ("[-i(niFile.lua)] [-jN(input from joystick n)] [-lDeviceName (input from local device)] [-x(window width)] [-y(window height)] [-f(ullscreen)] [-v(frustum vertical shift)] [scene]");
+	cmdLine::usage      ("[-i(niFile.lua)] [-jN(input from joystick n)] [-lDeviceName (input from local device)] [-x(window width)] [-y(window height)] [-f(ullscreen)] [-v(frustum vertical shift)] [scene|directory ...]");
 	cmdLine::interpret(argc, argv);	
 
 	dout("loading startup script...");
@@ -294,9 +376,14 @@ int main( int argc, char **argv ) {
 	vm.bind("app",app);
 	vm.bind("Sky", *pSkyCtrl);
 	vm.bind("Gui", *pGui);
+	RenderStatsCallable stats;
+	vm.bind("Stats", stats);
 	dout(" done.\n");
 	dout("loading scene...");	
-	if(cmdLine::nArg()) app.load(io::unifyPath(cmdLine::arg(0)));
+	vector<string> vArg;
+	for(size_t i=0; i<cmdLine::nArg(); ++i)
+		vArg.push_back(io::unifyPath(cmdLine::arg(i)));
+	if(vArg.size()) app.load(vArg);
 	dout(" done.\n");
 
 	double tFps=camera.time();
@@ -307,7 +394,9 @@ int main( int argc, char **argv ) {
     
 	// main loop:
 	dout("entering main loop...\n");
+	Profiler & profiler = Profiler::singleton();
 	while(pWnd->open()) {
+		profiler.beginFrame();
 		// update timing:
 		camera.time(timer.update());
 		++fps;
@@ -315,6 +404,8 @@ int main( int argc, char **argv ) {
 			infoLeft=f2s(camera.pos()[X],2)+" "+f2s(camera.pos()[Y],2)+" "+f2s(camera.pos()[Z],2)+" "+f2s(camera.pos()[H],2)+" "+f2s(camera.pos()[P],2)+" "+f2s(camera.pos()[R],2);
 		if(timer.now()>=tFps+1.0)  {
 			string infoRight=i2s(fps)+" fps";
+			if(profiler.enabled()) infoRight+=" "+f2s(profiler.average(fps)*1000.0, 1)+" ms";
+			if(app.showStats()) infoRight=RenderStats::singleton().str()+", "+infoRight;
 			pInfoRight->text(infoRight);			
 			fps=0;
 			tFps=timer.now();
@@ -391,6 +482,8 @@ int main( int argc, char **argv ) {
 		glDepthMask(GL_TRUE);
 		glEnable(GL_DEPTH_TEST);
 		DeviceInput::updateAll(timer.deltaT());
+		RenderStats::singleton().frame();
+		profiler.endFrame();
 		timer.sleep(0.01);
 	}
 	dout("closing down...");
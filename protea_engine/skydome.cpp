@@ -1,5 +1,6 @@
 // a physics based sky model
 #include "skydome.h"
+#include "proProfiler.h"
 
 #include <cstdlib>
 #include <cstdio>
@@ -144,6 +145,7 @@ vec3f SkyDome::color( float theta, float phi ) const {
 }
 
 void SkyDome::draw(proCamera & camera) {
+	ProfileScope profile("sky", true);
 	glDisable(GL_LIGHTING);
 	glDisable(GL_DEPTH_TEST);
 	glDepthMask(GL_FALSE);
@@ -213,6 +215,7 @@ void CloudLayer::initGraphics() {
 
 void CloudLayer::draw(proCamera & camera) {
 	if(!m_visible) return;
+	ProfileScope profile("clouds", true);
 	glPushMatrix();
 	glTranslatef(camera.pos()[X], camera.pos()[Y], camera.pos()[Z]);
 		